@@ -28,6 +28,7 @@
 
 #include "sx_node.hpp"
 #include "serializing_stream.hpp"
+#include "global_options.hpp"
 
 /// \cond INTERNAL
 namespace casadi {
@@ -60,6 +61,17 @@ class BinarySX : public SXNode {
         double ret_val;
         casadi_math<double>::fun(op, dep0_val, dep1_val, ret_val);
         return ret_val;
+      } else if (GlobalOptions::hash_consing) {
+        // Reuse a structurally identical node, if any
+        SXNode* n = SXHashCons::find({op, dep0.get(), dep1.get()});
+        if (n) {
+          SXElem ret = SXElem::create(n);
+          n->count--;
+          return ret;
+        }
+        n = new BinarySX(op, dep0, dep1);
+        SXHashCons::insert(n);
+        return SXElem::create(n);
       } else {
         // Expression containing free variables
         return SXElem::create(new BinarySX(op, dep0, dep1));
@@ -73,6 +85,7 @@ class BinarySX : public SXNode {
 
         \identifier{118} */
     ~BinarySX() override {
+      SXHashCons::erase(this);
       safe_delete(dep0_.assignNoDelete(casadi_limits<SXElem>::nan));
       safe_delete(dep1_.assignNoDelete(casadi_limits<SXElem>::nan));
     }
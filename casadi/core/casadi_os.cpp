@@ -24,6 +24,21 @@
 #include "exception.hpp"
 #include "global_options.hpp"
 
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#else // _WIN32
+#include <dirent.h>
+#include <utime.h>
+#endif // _WIN32
+
 namespace casadi {
 
 // http://stackoverflow.com/questions/303562/c-format-macro-inline-ostringstream
@@ -46,6 +61,74 @@ std::string filesep() {
     #endif
 }
 
+bool file_stat(const std::string& path, double& size, double& mtime) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st)) return false;
+#else // _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st)) return false;
+#endif // _WIN32
+    size = static_cast<double>(st.st_size);
+    mtime = static_cast<double>(st.st_mtime);
+    return true;
+}
+
+bool file_touch(const std::string& path) {
+#ifdef _WIN32
+    return _utime(path.c_str(), nullptr)==0;
+#else // _WIN32
+    return utime(path.c_str(), nullptr)==0;
+#endif // _WIN32
+}
+
+bool file_rename(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    // rename does not overwrite on Windows
+    if (MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING)) return true;
+    remove(from.c_str());
+    return false;
+#else // _WIN32
+    return rename(from.c_str(), to.c_str())==0;
+#endif // _WIN32
+}
+
+bool ensure_directory(const std::string& path) {
+    double size, mtime;
+    if (file_stat(path, size, mtime)) return true;
+#ifdef _WIN32
+    if (_mkdir(path.c_str())==0) return true;
+#else // _WIN32
+    if (mkdir(path.c_str(), 0755)==0) return true;
+#endif // _WIN32
+    // Possibly created concurrently by another process
+    return file_stat(path, size, mtime);
+}
+
+std::vector<std::string> directory_files(const std::string& path) {
+    std::vector<std::string> ret;
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE h = FindFirstFileA((path + "\\*").c_str(), &data);
+    if (h==INVALID_HANDLE_VALUE) return ret;
+    do {
+      if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) ret.push_back(data.cFileName);
+    } while (FindNextFileA(h, &data));
+    FindClose(h);
+#else // _WIN32
+    DIR* d = opendir(path.c_str());
+    if (d==nullptr) return ret;
+    while (struct dirent* e = readdir(d)) {
+      std::string name = e->d_name;
+      if (name=="." || name=="..") continue;
+      struct stat st;
+      if (stat((path + "/" + name).c_str(), &st)==0 && S_ISREG(st.st_mode)) ret.push_back(name);
+    }
+    closedir(d);
+#endif // _WIN32
+    return ret;
+}
+
 std::vector<std::string> get_search_paths() {
 
     // Build up search paths;
@@ -77,6 +77,27 @@ CASADI_EXPORT char pathsep();
  */
 CASADI_EXPORT std::string filesep();
 
+/* \brief Size in bytes and last modification time (seconds since epoch) of a file
+ * \return false if the file does not exist
+ */
+CASADI_EXPORT bool file_stat(const std::string& path, double& size, double& mtime);
+
+/* \brief Set the modification time of an existing file to now
+ */
+CASADI_EXPORT bool file_touch(const std::string& path);
+
+/* \brief Atomically replace a file by another one in the same directory
+ */
+CASADI_EXPORT bool file_rename(const std::string& from, const std::string& to);
+
+/* \brief Create a directory if it does not already exist
+ */
+CASADI_EXPORT bool ensure_directory(const std::string& path);
+
+/* \brief Names of the regular files in a directory
+ */
+CASADI_EXPORT std::vector<std::string> directory_files(const std::string& path);
+
 // For dynamic loading
 #ifdef WITH_DL
 
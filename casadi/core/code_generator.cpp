@@ -55,6 +55,11 @@ namespace casadi {
     bool prefix_set = false;
     this->prefix = "";
     avoid_stack_ = false;
+    shard_size_ = 0;
+    n_outlined_ = 0;
+    stream_ = false;
+    body_spill_ = nullptr;
+    buffer_spill_ = nullptr;
     indent_ = 2;
 
     // Read options
@@ -100,6 +105,11 @@ namespace casadi {
         casadi_assert_dev(indent_>=0);
       } else if (e.first=="avoid_stack") {
         avoid_stack_ = e.second;
+      } else if (e.first=="shard_size") {
+        shard_size_ = e.second;
+        casadi_assert(shard_size_>=0, "Option 'shard_size' must be nonnegative");
+      } else if (e.first=="stream") {
+        stream_ = e.second;
       } else if (e.first=="prefix") {
         this->prefix = e.second.to_string();
         prefix_set = true;
@@ -123,6 +133,11 @@ namespace casadi {
       }
     }
 
+    // Work vector elements of SX functions must outlive outlined function parts
+    if (shard_size_>0) avoid_stack_ = true;
+    casadi_assert(!(stream_ && shard_size_>0),
+      "Options 'stream' and 'shard_size' cannot be combined");
+
     // Start at new line with no indentation
     newline_ = true;
     current_indent_ = 0;
@@ -182,6 +197,11 @@ namespace casadi {
 
   }
 
+  CodeGenerator::~CodeGenerator() {
+    if (body_spill_) fclose(body_spill_);
+    if (buffer_spill_) fclose(buffer_spill_);
+  }
+
   void CodeGenerator::scope_enter() {
     local_variables_.clear();
     local_default_.clear();
@@ -233,8 +253,34 @@ namespace casadi {
     // Generate declarations
     f->codegen_declarations(*this);
 
+    bool fun_needs_mem = !f->codegen_mem_type().empty();
+    needs_mem_ |= fun_needs_mem;
+
+    // Functions without state of their own may be put in a separate translation unit
+    bool to_shard = shard_size_>0 && !fun_needs_mem && !f->has_refcount_;
+    if (shard_size_>0) {
+      shard_header_ << f->signature(fname) << ";\n";
+      if (f->has_refcount_) {
+        shard_header_ << "void " << fname << "_incref(void);\n"
+                      << "void " << fname << "_decref(void);\n";
+      }
+      if (fun_needs_mem) {
+        shard_header_ << "int " << fname << "_alloc_mem(void);\n"
+                      << "int " << fname << "_init_mem(int mem);\n"
+                      << "void " << fname << "_free_mem(int mem);\n"
+                      << "int " << fname << "_checkout(void);\n"
+                      << "void " << fname << "_release(int mem);\n";
+      }
+    }
+
     // Print to file
+    std::stringstream main_body;
+    if (to_shard) body.swap(main_body);
     f->codegen(*this, fname);
+    if (to_shard) {
+      body.swap(main_body);
+      add_shard(main_body.str());
+    }
 
     // Codegen reference count functions, if needed
     if (f->has_refcount_) {
@@ -249,9 +295,6 @@ namespace casadi {
       *this << "}\n\n";
     }
 
-    bool fun_needs_mem = !f->codegen_mem_type().empty();
-    needs_mem_ |= fun_needs_mem;
-
     if (fun_needs_mem) {
       // Alloc memory
       *this << "int " << fname << "_alloc_mem(void) {\n";
@@ -448,10 +491,38 @@ namespace casadi {
     // Create c file
     std::ofstream s;
     std::string fullname = prefix + this->name + this->suffix;
-    file_open(s, fullname, this->cpp);
+    shard_files_.clear();
+    if (shards_.empty()) {
+      file_open(s, fullname, this->cpp);
 
-    // Dump code to file
-    dump(s);
+      // Dump code to file
+      dump(s);
+    } else {
+      // Declarations shared by all translation units
+      std::string shared = this->name + "_shared.h";
+      s.open(prefix + shared);
+      s << "/* This file was automatically generated by CasADi " << casadi_version() << ". */\n"
+        << "#ifndef " << this->name << "_SHARED_H\n"
+        << "#define " << this->name << "_SHARED_H\n\n";
+      dump_preamble(s, true);
+      s << this->shard_header_.str() << "\n"
+        << "#endif /* " << this->name << "_SHARED_H */\n";
+      s.close();
+
+      // Additional translation units
+      for (casadi_int i=0; i<shards_.size(); ++i) {
+        shard_files_.push_back(prefix + this->name + "_" + str(i+1) + this->suffix);
+        file_open(s, shard_files_.back(), this->cpp);
+        s << "#include \"" << shared << "\"\n\n" << shards_[i];
+        file_close(s, this->cpp);
+      }
+
+      // Main translation unit, with all stateful code
+      file_open(s, fullname, this->cpp);
+      s << "#include \"" << shared << "\"\n\n";
+      dump_file_scope(s, "");
+      s << this->body.str() << std::endl;
+    }
 
     // Mex entry point
     if (this->mex) generate_mex(s);
@@ -784,6 +855,45 @@ namespace casadi {
   }
 
   void CodeGenerator::dump(std::ostream& s) {
+    // Everything before the function definitions
+    dump_preamble(s, false);
+    dump_file_scope(s, "static ");
+
+    // Split code, if any, goes into the same file
+    if (!shards_.empty()) {
+      s << this->shard_header_.str() << std::endl;
+      for (const std::string& e : shards_) s << e;
+    }
+
+    // Codegen body
+    if (body_spill_) unspill(body_spill_, s);
+    s << this->body.str();
+
+    // End with new line
+    s << std::endl;
+  }
+
+  void CodeGenerator::dump_file_scope(std::ostream& s, const std::string& qualifier) const {
+    // Print file scope double work
+    if (!file_scope_double_.empty()) {
+      casadi_int i=0;
+      for (const auto& it : file_scope_double_) {
+        s << qualifier << "casadi_real casadi_rd" + str(i++) + "[" + str(it.second) + "];\n";
+      }
+      s << std::endl;
+    }
+
+    // Print file scope integer work
+    if (!file_scope_integer_.empty()) {
+      casadi_int i=0;
+      for (const auto& it : file_scope_integer_) {
+        s << qualifier << "casadi_real casadi_ri" + str(i++) + "[" + str(it.second) + "];\n";
+      }
+      s << std::endl;
+    }
+  }
+
+  void CodeGenerator::dump_preamble(std::ostream& s, bool shared) {
     // Consistency check
     casadi_assert_dev(current_indent_ == 0);
 
@@ -838,8 +948,12 @@ namespace casadi {
       }
     }
 
-    // Codegen auxiliary functions
-    s << this->auxiliaries.str();
+    // Codegen auxiliary functions, defined in every translation unit if shared
+    if (shared) {
+      s << static_functions(this->auxiliaries.str());
+    } else {
+      s << this->auxiliaries.str();
+    }
 
     // Print integer constants
     if (!integer_constants_.empty()) {
@@ -873,23 +987,8 @@ namespace casadi {
       s << std::endl;
     }
 
-    // Print file scope double work
-    if (!file_scope_double_.empty()) {
-      casadi_int i=0;
-      for (const auto& it : file_scope_double_) {
-        s << "static casadi_real casadi_rd" + str(i++) + "[" + str(it.second) + "];\n";
-      }
-      s << std::endl;
-    }
-
-    // Print file scope integer work
-    if (!file_scope_integer_.empty()) {
-      casadi_int i=0;
-      for (const auto& it : file_scope_integer_) {
-        s << "static casadi_real casadi_ri" + str(i++) + "[" + str(it.second) + "];\n";
-      }
-      s << std::endl;
-    }
+    // File scope work is defined in the main translation unit only
+    if (shared) dump_file_scope(s, "extern ");
 
     // External function declarations
     if (!added_externals_.empty()) {
@@ -899,12 +998,43 @@ namespace casadi {
       }
       s << std::endl << std::endl;
     }
+  }
 
-    // Codegen body
-    s << this->body.str();
+  std::string CodeGenerator::static_functions(const std::string& src) {
+    std::stringstream ret;
+    std::string line;
+    std::istringstream stream(src);
+    while (std::getline(stream, line)) {
+      // A function signature starts in the first column, unlike statements
+      if (!line.empty() && line.find('(')!=std::string::npos
+          && (isalpha(line[0]) || line[0]=='_')
+          && line.find("static ")!=0 && line.find("extern ")!=0
+          && line.find("typedef ")!=0 && line.find("struct ")!=0) {
+        ret << "static ";
+      }
+      ret << line << "\n";
+    }
+    return ret.str();
+  }
 
-    // End with new line
-    s << std::endl;
+  void CodeGenerator::add_shard(const std::string& code) {
+    if (shards_.empty() || shards_.back().size() + code.size() > shard_size_) {
+      shards_.push_back(code);
+    } else {
+      shards_.back() += code;
+    }
+  }
+
+  void CodeGenerator::outline() {
+    std::string code = this->buffer.str();
+    this->buffer.str(std::string());
+    if (code.empty()) return;
+    std::string fname = shorthand("part" + str(n_outlined_++));
+    std::string sig = "void " + fname
+      + "(const casadi_real** arg, casadi_real** res, casadi_real* w)";
+    shard_header_ << sig << ";\n";
+    add_shard(sig + " {\n" + code + "}\n\n");
+    *this << fname << "(arg, res, w);\n";
   }
 
   std::string CodeGenerator::work(casadi_int n, casadi_int sz) const {
@@ -1449,6 +1579,26 @@ namespace casadi {
 
       this->auxiliaries << sanitize_source(casadi_qrqp_str, inst);
       break;
+    case AUX_IPQP:
+      add_auxiliary(AUX_COPY);
+      add_auxiliary(AUX_FILL);
+      add_auxiliary(AUX_CLEAR);
+      add_auxiliary(AUX_AXPY);
+      add_auxiliary(AUX_FMIN);
+      add_auxiliary(AUX_FMAX);
+      add_auxiliary(AUX_INF);
+      add_auxiliary(AUX_REAL_MIN);
+      add_include("stdio.h");
+      add_include("math.h");
+      this->auxiliaries << sanitize_source(casadi_ipqp_str, inst);
+      break;
+    case AUX_RIQP:
+      add_auxiliary(AUX_IPQP);
+      add_auxiliary(AUX_COPY);
+      add_auxiliary(AUX_CLEAR);
+      add_include("math.h");
+      this->auxiliaries << sanitize_source(casadi_riqp_str, inst);
+      break;
     case AUX_NLP:
       add_auxiliary(AUX_ORACLE);
       this->auxiliaries << sanitize_source(casadi_nlp_str, inst);
@@ -1546,6 +1696,14 @@ namespace casadi {
       add_auxiliary(AUX_RANK1);
       this->auxiliaries << sanitize_source(casadi_bfgs_str, inst);
       break;
+    case AUX_LBFGS:
+      add_auxiliary(AUX_COPY);
+      add_auxiliary(AUX_AXPY);
+      add_auxiliary(AUX_DOT);
+      add_auxiliary(AUX_SCAL);
+      add_auxiliary(AUX_FILL);
+      this->auxiliaries << sanitize_source(casadi_lbfgs_str, inst);
+      break;
     case AUX_ORACLE:
       this->auxiliaries << sanitize_source(casadi_oracle_str, inst);
       break;
@@ -2176,10 +2334,52 @@ namespace casadi {
   }
 
   void CodeGenerator::flush(std::ostream &s) {
+    if (stream_) {
+      // Only the body is flushed to
+      casadi_assert_dev(&s==&this->body);
+      if (buffer_spill_) {
+        // Statements written out earlier go after the current body
+        spill(this->body, body_spill_);
+        unspill(buffer_spill_, body_spill_);
+        fclose(buffer_spill_);
+        buffer_spill_ = nullptr;
+      }
+      s << this->buffer.str();
+      this->buffer.str(std::string());
+      if (static_cast<casadi_int>(this->body.tellp()) > stream_chunk) spill(this->body, body_spill_);
+      return;
+    }
     s << this->buffer.str();
     this->buffer.str(std::string());
   }
 
+  void CodeGenerator::spill(std::stringstream& s, std::FILE*& f) {
+    if (f==nullptr) {
+      f = std::tmpfile();
+      casadi_assert(f!=nullptr, "Failed to create temporary file");
+    }
+    std::string str = s.str();
+    s.str(std::string());
+    casadi_assert(fwrite(str.data(), 1, str.size(), f)==str.size(),
+      "Failed to write temporary file");
+  }
+
+  void CodeGenerator::unspill(std::FILE* f, std::ostream& s) {
+    std::vector<char> chunk(stream_chunk);
+    rewind(f);
+    while (size_t n = fread(get_ptr(chunk), 1, chunk.size(), f)) s.write(get_ptr(chunk), n);
+    fseek(f, 0, SEEK_END);
+  }
+
+  void CodeGenerator::unspill(std::FILE* f, std::FILE*& s) {
+    std::vector<char> chunk(stream_chunk);
+    rewind(f);
+    while (size_t n = fread(get_ptr(chunk), 1, chunk.size(), f)) {
+      casadi_assert(fwrite(get_ptr(chunk), 1, n, s)==n, "Failed to write temporary file");
+    }
+    fseek(f, 0, SEEK_END);
+  }
+
   void CodeGenerator::local(const std::string& name, const std::string& type,
                             const std::string& ref) {
     // Check if the variable already exists
@@ -2381,6 +2581,16 @@ namespace casadi {
            + d + ", " + p + ", " + w + ");";
   }
 
+  std::string CodeGenerator::
+  ldl_sn(const std::string& sp_a, const std::string& a,
+      const std::string& sp_lt, const std::string& lt, const std::string& d,
+      const std::string& p, const std::string& sn, const std::string& iw,
+      const std::string& w) {
+    add_auxiliary(CodeGenerator::AUX_LDL);
+    return "casadi_ldl_sn(" + sp_a + ", " + a + ", " + sp_lt + ", " + lt + ", "
+           + d + ", " + p + ", " + sn + ", " + iw + ", " + w + ");";
+  }
+
   std::string CodeGenerator::
   ldl_solve(const std::string& x, casadi_int nrhs,
     const std::string& sp_lt, const std::string& lt, const std::string& d,
@@ -31,6 +31,7 @@
 #include <map>
 #include <set>
 #include <sstream>
+#include <cstdio>
 
 namespace casadi {
 
@@ -45,6 +46,15 @@ namespace casadi {
     /// Constructor
     CodeGenerator(const std::string& name, const Dict& opts = Dict());
 
+    /// Destructor
+    ~CodeGenerator();
+
+#ifndef SWIG
+    /// Not copyable, the destructor closes the temporary files
+    CodeGenerator(const CodeGenerator&) = delete;
+    CodeGenerator& operator=(const CodeGenerator&) = delete;
+#endif // SWIG
+
     /// Add a function (name generated)
     void add(const Function& f, bool with_jac_sparsity=false);
 
@@ -65,6 +75,14 @@ namespace casadi {
         \identifier{rv} */
     std::string generate(const std::string& prefix="");
 
+    /** \brief Additional source files written by the last call to generate
+
+      Nonempty when the code has been split into several translation units
+      (option 'shard_size'). The files are to be compiled separately and
+      linked together with the file returned by generate.
+    */
+    const std::vector<std::string>& shard_files() const { return shard_files_;}
+
     /// Add an include file optionally using a relative path "..." instead of an absolute path <...>
     void add_include(const std::string& new_include, bool relative_path=false,
                     const std::string& use_ifdef=std::string());
@@ -244,6 +262,25 @@ namespace casadi {
         \identifier{si} */
     bool avoid_stack() { return avoid_stack_;}
 
+    /** \brief Approximate size in bytes of a translation unit, 0 if not splitting */
+    casadi_int shard_size() const { return shard_size_;}
+
+    /** \brief Write out the buffered part of a function body, when streaming
+
+      To be called regularly when generating large function bodies.
+    */
+    void stream() {
+      if (stream_ && static_cast<casadi_int>(buffer.tellp()) > stream_chunk) {
+        spill(buffer, buffer_spill_);
+      }
+    }
+
+    /** \brief Move the buffered part of an SX-type function body to a function of its own
+
+      The code may only access arg, res and w. The buffer is replaced by a call.
+    */
+    void outline();
+
     /** \brief Print a constant in a lossless but compact manner
 
         \identifier{sj} */
@@ -424,6 +461,13 @@ namespace casadi {
                    const std::string& d, const std::string& p,
                    const std::string& w);
 
+    /** \brief Supernodal LDL factorization */
+    std::string ldl_sn(const std::string& sp_a, const std::string& a,
+                   const std::string& sp_lt, const std::string& lt,
+                   const std::string& d, const std::string& p,
+                   const std::string& sn, const std::string& iw,
+                   const std::string& w);
+
     /** \brief LDL solve
 
         \identifier{t3} */
@@ -592,6 +636,8 @@ namespace casadi {
       AUX_QR,
       AUX_QP,
       AUX_QRQP,
+      AUX_IPQP,
+      AUX_RIQP,
       AUX_NLP,
       AUX_SQPMETHOD,
       AUX_FEASIBLESQPMETHOD,
@@ -631,6 +677,7 @@ namespace casadi {
       AUX_LOGSUMEXP,
       AUX_SPARSITY,
       AUX_BFGS,
+      AUX_LBFGS,
       AUX_ORACLE_CALLBACK,
       AUX_OCP_BLOCK,
       AUX_ORACLE,
@@ -821,6 +868,25 @@ namespace casadi {
     // Generate main entry point
     void generate_main(std::ostream &s) const;
 
+    // Everything that comes before the function definitions
+    void dump_preamble(std::ostream& s, bool shared);
+
+    // Definitions of file scope work arrays
+    void dump_file_scope(std::ostream& s, const std::string& qualifier) const;
+
+    // Add code to the shards, starting a new one if the current one is full
+    void add_shard(const std::string& code);
+
+    // Give the functions defined in auxiliary code internal linkage
+    static std::string static_functions(const std::string& src);
+
+    // Move the contents of a stream to the end of a temporary file
+    static void spill(std::stringstream& s, std::FILE*& f);
+
+    // Copy the contents of a temporary file to a stream or another temporary file
+    static void unspill(std::FILE* f, std::ostream& s);
+    static void unspill(std::FILE* f, std::FILE*& s);
+
     // Generate export symbol macros
     void generate_export_symbol(std::ostream &s) const;
 
@@ -874,6 +940,31 @@ namespace casadi {
     // Do we want to be lean on stack usage?
     bool avoid_stack_;
 
+    // Split into translation units of approximately this size, 0 if not splitting
+    casadi_int shard_size_;
+
+    // Code of the additional translation units
+    std::vector<std::string> shards_;
+
+    // Declarations of functions with external linkage, when splitting
+    std::stringstream shard_header_;
+
+    // Files written for the shards
+    std::vector<std::string> shard_files_;
+
+    // Number of outlined function parts
+    casadi_int n_outlined_;
+
+    // Write the body to temporary files while generating?
+    bool stream_;
+
+    // Temporary files holding the beginning of the body and of the current function
+    std::FILE* body_spill_;
+    std::FILE* buffer_spill_;
+
+    // Size in bytes of the pieces written to the temporary files
+    static const casadi_int stream_chunk = 1 << 20;
+
     std::string infinity, nan, real_min;
 
     /** \brief Codegen scalar
@@ -36,6 +36,14 @@
 #include <unordered_map>
 #define CACHING_MAP std::unordered_map
 
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+#ifdef CASADI_WITH_THREAD_MINGW
+#include <mingw.mutex.h>
+#else // CASADI_WITH_THREAD_MINGW
+#include <mutex>
+#endif // CASADI_WITH_THREAD_MINGW
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+
 namespace casadi {
 
 /** \brief Represents a constant SX
@@ -108,29 +116,42 @@ class RealtypeSX : public ConstantSX {
 
     /// Destructor
     ~RealtypeSX() override {
-      size_t num_erased = cached_constants_.erase(value);
-      assert(num_erased==1);
-      (void)num_erased;
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+      std::lock_guard<std::mutex> lock(mutex_);
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+      // Remove from the hash table, unless already replaced by create
+      CACHING_MAP<double, RealtypeSX*>::iterator it = cached_constants_.find(value);
+      if (it!=cached_constants_.end() && it->second==this) cached_constants_.erase(it);
     }
 
-    /// Static creator function (use instead of constructor)
+    /** \brief Static creator function (use instead of constructor)
+
+        Returns a node with the reference counter increased, i.e. the reference
+        is owned by the caller
+    */
     inline static RealtypeSX* create(double value) {
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+      std::lock_guard<std::mutex> lock(mutex_);
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
       // Try to find the constant
       CACHING_MAP<double, RealtypeSX*>::iterator it = cached_constants_.find(value);
 
-      // If not found, add it,
-      if (it==cached_constants_.end()) {
-        // Allocate a new object
-        RealtypeSX* n = new RealtypeSX(value);
+      // Return the object, if found and not being destroyed
+      if (it!=cached_constants_.end() && it->second->try_count_up()) return it->second;
 
-        // Add to hash_table
-        cached_constants_.insert(it, std::make_pair(value, n));
+      // Allocate a new object
+      RealtypeSX* n = new RealtypeSX(value);
+      n->count++;
 
-        // Return it to caller
-        return n;
-      } else { // Else, returned the object
-        return it->second;
+      // Add to hash_table, replacing any node being destroyed
+      if (it==cached_constants_.end()) {
+        cached_constants_.insert(it, std::make_pair(value, n));
+      } else {
+        it->second = n;
       }
+
+      // Return it to caller
+      return n;
     }
 
     ///@{
@@ -156,6 +177,11 @@ class RealtypeSX : public ConstantSX {
         \identifier{1js} */
     static CACHING_MAP<double, RealtypeSX*> cached_constants_;
 
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+    /// Lock for the hash map
+    static std::mutex mutex_;
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+
     /** \brief  Data members
 
         \identifier{1jt} */
@@ -181,29 +207,42 @@ class IntegerSX : public ConstantSX {
 
     /// Destructor
     ~IntegerSX() override {
-      size_t num_erased = cached_constants_.erase(value);
-      assert(num_erased==1);
-      (void)num_erased;
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+      std::lock_guard<std::mutex> lock(mutex_);
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+      // Remove from the hash table, unless already replaced by create
+      CACHING_MAP<casadi_int, IntegerSX*>::iterator it = cached_constants_.find(value);
+      if (it!=cached_constants_.end() && it->second==this) cached_constants_.erase(it);
     }
 
-    /// Static creator function (use instead of constructor)
+    /** \brief Static creator function (use instead of constructor)
+
+        Returns a node with the reference counter increased, i.e. the reference
+        is owned by the caller
+    */
     inline static IntegerSX* create(casadi_int value) {
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+      std::lock_guard<std::mutex> lock(mutex_);
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
       // Try to find the constant
       CACHING_MAP<casadi_int, IntegerSX*>::iterator it = cached_constants_.find(value);
 
-      // If not found, add it,
-      if (it==cached_constants_.end()) {
-        // Allocate a new object
-        IntegerSX* n = new IntegerSX(value);
+      // Return the object, if found and not being destroyed
+      if (it!=cached_constants_.end() && it->second->try_count_up()) return it->second;
 
-        // Add to hash_table
-        cached_constants_.insert(it, std::make_pair(value, n));
+      // Allocate a new object
+      IntegerSX* n = new IntegerSX(value);
+      n->count++;
 
-        // Return it to caller
-        return n;
-      } else { // Else, returned the object
-        return it->second;
+      // Add to hash_table, replacing any node being destroyed
+      if (it==cached_constants_.end()) {
+        cached_constants_.insert(it, std::make_pair(value, n));
+      } else {
+        it->second = n;
       }
+
+      // Return it to caller
+      return n;
     }
 
     ///@{
@@ -233,6 +272,11 @@ class IntegerSX : public ConstantSX {
         \identifier{1jx} */
     static CACHING_MAP<casadi_int, IntegerSX*> cached_constants_;
 
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+    /// Lock for the hash map
+    static std::mutex mutex_;
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+
     /** \brief  Data members
 
         \identifier{1jy} */
@@ -471,13 +515,19 @@ inline SXNode* ConstantSX_deserialize(DeserializingStream& s) {
     case 'r': {
       double value;
       s.unpack("ConstantSX::value", value);
-      return RealtypeSX::create(value);
+      // The caller takes its own reference, cf. SXNode::try_count_up
+      RealtypeSX* n = RealtypeSX::create(value);
+      n->count--;
+      return n;
     }
     case 'i': {
       int value;
       s.unpack("ConstantSX::value", value);
       if (value==2) return casadi_limits<SXElem>::two.get();
-      return IntegerSX::create(value);
+      // The caller takes its own reference, cf. SXNode::try_count_up
+      IntegerSX* n = IntegerSX::create(value);
+      n->count--;
+      return n;
     }
     case 'n': return casadi_limits<SXElem>::nan.get();
     case 'f': return casadi_limits<SXElem>::minus_inf.get();
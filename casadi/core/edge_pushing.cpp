@@ -0,0 +1,604 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "edge_pushing.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace casadi {
+
+  OpDerivatives::OpDerivatives() : d_nz{false, false}, h_nz{false, false, false} {
+  }
+
+  OpDerivatives::OpDerivatives(casadi_int op) {
+    // First order partial derivatives
+    SXElem x = SXElem::sym("x"), y = SXElem::sym("y"), f, d[2];
+    casadi_math<SXElem>::fun(op, x, y, f);
+    casadi_math<SXElem>::der(op, x, y, f, d);
+    if (casadi_math<double>::ndeps(op)==1) d[1] = 0;
+    for (casadi_int i=0; i<2; ++i) d_nz[i] = !d[i].is_zero();
+
+    // Second order partial derivatives
+    SX H = densify(jacobian(SX(std::vector<SXElem>{d[0], d[1]}),
+                            SX(std::vector<SXElem>{x, y})));
+    std::vector<SXElem> h = {H->at(0), H->at(2), H->at(3)};
+    for (casadi_int i=0; i<3; ++i) h_nz[i] = !h[i].is_zero();
+    hess = Function("op_hess", {SX(x), SX(y)}, {SX(h[0]), SX(h[1]), SX(h[2])});
+  }
+
+  std::vector<OpDerivatives> op_derivatives(const SXFunction& f) {
+    std::vector<OpDerivatives> ret(NUM_BUILT_IN_OPS);
+    for (auto&& a : f.algorithm_) {
+      switch (a.op) {
+      case OP_INPUT:
+      case OP_OUTPUT:
+      case OP_CONST:
+      case OP_PARAMETER:
+        break;
+      default:
+        if (ret.at(a.op).hess.is_null()) ret[a.op] = OpDerivatives(a.op);
+      }
+    }
+    return ret;
+  }
+
+  // Multiply with a partial derivative, cf. SXFunction::ad_reverse
+  template<typename T>
+  inline T ep_mul(int op, const T& d, const T& v) {
+    return op==OP_IF_ELSE_ZERO ? if_else_zero(d, v) : d*v;
+  }
+
+  // Second order adjoints in hash maps, entries are created as needed
+  template<typename T>
+  struct EpHashW {
+    // Nonzeros of each row
+    std::vector<std::unordered_map<casadi_int, T> > W;
+    // If not null, record the column of each created entry
+    std::vector<std::vector<casadi_int> >* fill;
+    EpHashW(casadi_int n, std::vector<std::vector<casadi_int> >* fill) : W(n), fill(fill) {}
+    // Add to an entry
+    void add(casadi_int i, casadi_int j, const T& v) {
+      auto it = W[i].insert(std::make_pair(j, v));
+      if (!it.second) {
+        it.first->second += v;
+      } else if (fill) {
+        (*fill)[i].push_back(j);
+      }
+    }
+    // Diagonal entry, if any
+    bool diag(casadi_int k, T& v) const {
+      auto it = W[k].find(k);
+      if (it==W[k].end()) return false;
+      v = it->second;
+      return true;
+    }
+    // Loop over the off-diagonal entries of row k
+    template<typename F>
+    void for_each(casadi_int k, F fcn) const {
+      for (auto&& e : W[k]) if (e.first!=k) fcn(e.first, e.second);
+    }
+    // Remove row and column k
+    void remove(casadi_int k) {
+      for (auto&& e : W[k]) if (e.first!=k) W[e.first].erase(k);
+      std::unordered_map<casadi_int, T>().swap(W[k]);
+    }
+  };
+
+  // Second order adjoints with a fixed sparsity pattern, stored in a work vector
+  template<typename T>
+  struct EpStaticW {
+    // Sparsity pattern, compressed rows with sorted columns
+    const casadi_int *rowind, *col;
+    // Nonzeros
+    T* nz;
+    // Algorithm, to tell eliminated variables from inputs
+    const SXFunction::AlgEl* alg;
+    // Locate an entry in the pattern
+    casadi_int find(casadi_int i, casadi_int j) const {
+      const casadi_int* it = std::lower_bound(col + rowind[i], col + rowind[i+1], j);
+      return it==col + rowind[i+1] || *it!=j ? -1 : it - col;
+    }
+    // Add to an entry
+    void add(casadi_int i, casadi_int j, const T& v) {
+      casadi_int el = find(i, j);
+      casadi_assert_dev(el>=0);
+      nz[el] += v;
+    }
+    // Diagonal entry, if any
+    bool diag(casadi_int k, T& v) const {
+      casadi_int el = find(k, k);
+      if (el<0) return false;
+      v = nz[el];
+      return true;
+    }
+    // Loop over the off-diagonal entries of row k, skipping eliminated variables
+    template<typename F>
+    void for_each(casadi_int k, F fcn) const {
+      for (casadi_int el=rowind[k]; el<rowind[k+1]; ++el) {
+        casadi_int j = col[el];
+        if (j==k || (j>k && alg[j].op!=OP_INPUT)) continue;
+        fcn(j, nz[el]);
+      }
+    }
+    // Remove row and column k: nothing to do, eliminated variables are skipped
+    void remove(casadi_int k) {}
+  };
+
+  // Variables each instruction depends on, and if they depend on the inputs
+  void ep_dependencies(const SXFunction& f, std::vector<casadi_int>& dep,
+      std::vector<bool>& active) {
+    const std::vector<SXFunction::AlgEl>& alg = f.algorithm_;
+    casadi_int n = alg.size();
+    dep.assign(2*n, -1);
+    active.assign(n, false);
+    std::vector<casadi_int> var(f.worksize_, -1);
+    for (casadi_int k=0; k<n; ++k) {
+      const SXFunction::AlgEl& a = alg[k];
+      switch (a.op) {
+      case OP_OUTPUT:
+        dep[2*k] = var[a.i1];
+        continue;
+      case OP_INPUT:
+        active[k] = true;
+        break;
+      case OP_CONST:
+      case OP_PARAMETER:
+        break;
+      default:
+        dep[2*k] = var[a.i1];
+        if (casadi_math<double>::ndeps(a.op)==2) dep[2*k+1] = var[a.i2];
+        active[k] = active[dep[2*k]] || (dep[2*k+1]>=0 && active[dep[2*k+1]]);
+      }
+      var[a.i0] = k;
+    }
+  }
+
+  // Work vectors for the second order partial derivatives
+  void ep_work(const std::vector<OpDerivatives>& opd, size_t& sz_iw, size_t& sz_w) {
+    sz_iw = sz_w = 0;
+    for (auto&& e : opd) {
+      if (e.hess.is_null()) continue;
+      sz_iw = std::max(sz_iw, e.hess.sz_iw());
+      sz_w = std::max(sz_w, e.hess.sz_w());
+    }
+  }
+
+  // Values of the variables, one for each instruction
+  template<typename T>
+  void ep_values(const SXFunction& f, const T** arg, const casadi_int* dep, T* val) {
+    casadi_assert(f.free_vars_.empty(), "Cannot evaluate \"" + f.name_ + "\" since variables "
+      + str(f.get_free()) + " are free.");
+    for (casadi_int k=0; k<f.algorithm_.size(); ++k) {
+      const SXFunction::AlgEl& a = f.algorithm_[k];
+      switch (a.op) {
+      case OP_INPUT:
+        val[k] = arg[a.i1]==nullptr ? 0 : arg[a.i1][a.i2];
+        break;
+      case OP_OUTPUT:
+        break;
+      case OP_CONST:
+        val[k] = a.d;
+        break;
+      default:
+        casadi_math<T>::fun(a.op, val[dep[2*k]], val[dep[2*k + (dep[2*k+1]>=0)]], val[k]);
+      }
+    }
+  }
+
+  // Symbolic values: reuse the expressions of the function
+  template<>
+  void ep_values(const SXFunction& f, const SXElem** arg, const casadi_int* dep, SXElem* val) {
+    auto b_it = f.operations_.begin();
+    auto c_it = f.constants_.begin();
+    auto p_it = f.free_vars_.begin();
+    for (casadi_int k=0; k<f.algorithm_.size(); ++k) {
+      const SXFunction::AlgEl& a = f.algorithm_[k];
+      switch (a.op) {
+      case OP_INPUT:
+        val[k] = arg[a.i1]==nullptr ? 0 : arg[a.i1][a.i2];
+        break;
+      case OP_OUTPUT:
+        break;
+      case OP_CONST:
+        val[k] = *c_it++;
+        break;
+      case OP_PARAMETER:
+        val[k] = *p_it++;
+        break;
+      default:
+        val[k] = *b_it++;
+      }
+    }
+  }
+
+  // Reverse sweep, leaving the second order adjoints with respect to the inputs in W
+  template<typename T, typename M>
+  void ep_sweep(const SXFunction& f, casadi_int oind, const casadi_int* dep,
+      const std::vector<bool>& active, const T* val, const std::vector<OpDerivatives>& opd,
+      bool pattern, M& W, T* bar, casadi_int* iw, T* w) {
+    const std::vector<SXFunction::AlgEl>& alg = f.algorithm_;
+    casadi_int n = alg.size();
+
+    // Adjoints, seeded by the output
+    std::fill(bar, bar + n, T(0));
+    for (casadi_int k=0; k<n; ++k) {
+      if (alg[k].op==OP_OUTPUT && alg[k].i0==oind && active[dep[2*k]]) bar[dep[2*k]] += 1;
+    }
+
+    // Eliminate variables in reverse order
+    T d[2], h[3], wkk;
+    casadi_int j[2];
+    for (casadi_int k=n-1; k>=0; --k) {
+      const SXFunction::AlgEl& a = alg[k];
+      if (!active[k] || a.op==OP_INPUT) continue;
+      casadi_int nd = casadi_math<double>::ndeps(a.op);
+      j[0] = dep[2*k];
+      j[1] = nd==2 ? dep[2*k+1] : j[0];
+      const OpDerivatives& od = opd.at(a.op);
+
+      // First order partial derivatives, zero for dependencies not depending on the inputs
+      if (pattern) {
+        for (casadi_int i=0; i<2; ++i) d[i] = od.d_nz[i] ? 1 : 0;
+      } else {
+        casadi_math<T>::der(a.op, val[j[0]], val[j[1]], val[k], d);
+      }
+      for (casadi_int i=0; i<2; ++i) {
+        if (i>=nd || !od.d_nz[i] || !active[j[i]]) d[i] = 0;
+      }
+
+      // Pushing: second order adjoints involving k are moved to its dependencies
+      W.for_each(k, [&](casadi_int e, const T& we) {
+        for (casadi_int i=0; i<nd; ++i) {
+          if (casadi_limits<T>::is_zero(d[i])) continue;
+          T v = ep_mul(a.op, d[i], we);
+          if (j[i]==e) {
+            W.add(j[i], j[i], 2*v);
+          } else {
+            W.add(j[i], e, v);
+            W.add(e, j[i], v);
+          }
+        }
+      });
+      if (W.diag(k, wkk) && !casadi_limits<T>::is_zero(wkk)) {
+        for (casadi_int i=0; i<nd; ++i) {
+          if (casadi_limits<T>::is_zero(d[i])) continue;
+          T v = ep_mul(a.op, d[i], wkk);
+          for (casadi_int l=0; l<nd; ++l) {
+            if (casadi_limits<T>::is_zero(d[l])) continue;
+            W.add(j[i], j[l], ep_mul(a.op, d[l], v));
+          }
+        }
+      }
+
+      // Creating: nonlinear contribution of the operation itself, and adjoints
+      if (!casadi_limits<T>::is_zero(bar[k])) {
+        if (pattern) {
+          for (casadi_int i=0; i<3; ++i) h[i] = od.h_nz[i] ? 1 : 0;
+        } else {
+          const T* h_arg[2] = {&val[j[0]], &val[j[1]]};
+          T* h_res[3] = {h, h+1, h+2};
+          od.hess(h_arg, h_res, iw, w);
+        }
+        for (casadi_int i=0; i<3; ++i) if (!od.h_nz[i]) h[i] = 0;
+        if (!active[j[0]]) h[0] = h[1] = 0;
+        if (nd<2 || !active[j[1]]) h[1] = h[2] = 0;
+        if (!casadi_limits<T>::is_zero(h[0])) W.add(j[0], j[0], bar[k]*h[0]);
+        if (!casadi_limits<T>::is_zero(h[2])) W.add(j[1], j[1], bar[k]*h[2]);
+        if (!casadi_limits<T>::is_zero(h[1])) {
+          T v = bar[k]*h[1];
+          if (j[0]==j[1]) {
+            W.add(j[0], j[0], 2*v);
+          } else {
+            W.add(j[0], j[1], v);
+            W.add(j[1], j[0], v);
+          }
+        }
+        for (casadi_int i=0; i<nd; ++i) {
+          if (!casadi_limits<T>::is_zero(d[i])) bar[j[i]] += ep_mul(a.op, d[i], bar[k]);
+        }
+      }
+
+      // Remove k from the graph
+      W.remove(k);
+    }
+  }
+
+  // Concatenated input nonzero of an input instruction
+  inline casadi_int ep_input_nz(const SXFunction& f, const SXFunction::AlgEl& a) {
+    casadi_int r = a.i2;
+    for (casadi_int i=0; i<a.i1; ++i) r += f.nnz_in(i);
+    return r;
+  }
+
+  template<typename T>
+  void edge_pushing(const SXFunction& f, casadi_int oind, const T** arg,
+      const std::vector<OpDerivatives>& opd, bool pattern,
+      std::vector<casadi_int>& hrow, std::vector<casadi_int>& hcol, std::vector<T>& hnz) {
+    const std::vector<SXFunction::AlgEl>& alg = f.algorithm_;
+    casadi_int n = alg.size();
+
+    // Variables each instruction depends on, and if they depend on the inputs
+    std::vector<casadi_int> dep;
+    std::vector<bool> active;
+    ep_dependencies(f, dep, active);
+
+    // Values of the variables
+    std::vector<T> val;
+    if (!pattern) {
+      val.resize(n, 0);
+      ep_values(f, arg, get_ptr(dep), get_ptr(val));
+    }
+
+    // Work vectors for the adjoints and the second order partial derivatives
+    size_t sz_iw, sz_w;
+    ep_work(opd, sz_iw, sz_w);
+    std::vector<casadi_int> iw(sz_iw);
+    std::vector<T> bar(n), w(sz_w);
+
+    // Second order adjoints, symmetric
+    EpHashW<T> W(n, nullptr);
+    ep_sweep(f, oind, get_ptr(dep), active, get_ptr(val), opd, pattern, W,
+      get_ptr(bar), get_ptr(iw), get_ptr(w));
+
+    // Only the inputs remain, collect lower triangular part
+    hrow.clear();
+    hcol.clear();
+    hnz.clear();
+    for (casadi_int k=0; k<n; ++k) {
+      if (alg[k].op!=OP_INPUT) continue;
+      casadi_int r = ep_input_nz(f, alg[k]);
+      W.for_each(k, [&](casadi_int e, const T& we) {
+        if (e>k) return;
+        casadi_int c = ep_input_nz(f, alg[e]);
+        hrow.push_back(std::max(r, c));
+        hcol.push_back(std::min(r, c));
+        hnz.push_back(we);
+      });
+      T wkk;
+      if (W.diag(k, wkk)) {
+        hrow.push_back(r);
+        hcol.push_back(r);
+        hnz.push_back(wkk);
+      }
+    }
+  }
+
+  template void edge_pushing(const SXFunction& f, casadi_int oind, const double** arg,
+    const std::vector<OpDerivatives>& opd, bool pattern,
+    std::vector<casadi_int>& hrow, std::vector<casadi_int>& hcol, std::vector<double>& hnz);
+
+  template void edge_pushing(const SXFunction& f, casadi_int oind, const SXElem** arg,
+    const std::vector<OpDerivatives>& opd, bool pattern,
+    std::vector<casadi_int>& hrow, std::vector<casadi_int>& hcol, std::vector<SXElem>& hnz);
+
+  EdgePushing::EdgePushing(const std::string& name, const Function& f,
+      const std::vector<std::string>& name_out,
+      const std::vector<casadi_int>& oind, const std::vector<casadi_int>& iind1,
+      const std::vector<casadi_int>& iind2, const std::vector<std::vector<std::string> >& attr)
+    : FunctionInternal(name), f_(f), oind_(oind), iind1_(iind1), iind2_(iind2), attr_(attr) {
+    name_out_ = name_out;
+  }
+
+  EdgePushing::~EdgePushing() {
+    clear_mem();
+  }
+
+  bool EdgePushing::is_a(const std::string& type, bool recursive) const {
+    return type=="EdgePushing"
+      || (recursive && FunctionInternal::is_a(type, recursive));
+  }
+
+  const Function& EdgePushing::get_function(const std::string &name) const {
+    casadi_assert(has_function(name),
+      "No function \"" + name + "\" in " + name_ + ". " +
+      "Available functions: " + join(get_function()) + ".");
+    return f_;
+  }
+
+  void EdgePushing::init_sweep() {
+    const SXFunction& f = *f_.get<SXFunction>();
+    casadi_int n = f.algorithm_.size();
+    opd_ = op_derivatives(f);
+    ep_dependencies(f, dep_, active_);
+    ep_work(opd_, opd_sz_iw_, opd_sz_w_);
+
+    // Offsets of the inputs in the concatenated nonzeros
+    std::vector<casadi_int> offset(f_.n_in() + 1, 0);
+    for (casadi_int i=0; i<f_.n_in(); ++i) offset[i+1] = offset[i] + f_.nnz_in(i);
+
+    // Sparsity of the second order adjoints and of the Hessians, by a sweep over the pattern
+    hess_sp_.resize(f_.n_out());
+    w_rowind_.resize(f_.n_out());
+    w_col_.resize(f_.n_out());
+    w_hess_.resize(f_.n_out());
+    std::vector<casadi_int> iw(opd_sz_iw_);
+    std::vector<double> bar(n), w(opd_sz_w_);
+    sz_hnz_ = sz_wnz_ = 0;
+    for (casadi_int oind : oind_) {
+      casadi_assert(f_.sparsity_out(oind).is_scalar(),
+        "Can only take Hessian of scalar expression.");
+      if (!w_rowind_[oind].empty()) continue;
+      std::vector<std::vector<casadi_int> > fill(n);
+      EpHashW<double> W(n, &fill);
+      ep_sweep<double>(f, oind, get_ptr(dep_), active_, nullptr, opd_, true, W,
+        get_ptr(bar), get_ptr(iw), get_ptr(w));
+      // Every entry ever created, sorted, in compressed rows
+      std::vector<casadi_int>& rowind = w_rowind_[oind];
+      std::vector<casadi_int>& col = w_col_[oind];
+      rowind.resize(n + 1);
+      rowind[0] = 0;
+      col.clear();
+      for (casadi_int k=0; k<n; ++k) {
+        std::sort(fill[k].begin(), fill[k].end());
+        col.insert(col.end(), fill[k].begin(), fill[k].end());
+        rowind[k+1] = col.size();
+      }
+      // Lower triangular Hessian, from the entries between inputs
+      std::vector<casadi_int> hrow, hcol, hel;
+      for (casadi_int k=0; k<n; ++k) {
+        const SXFunction::AlgEl& a = f.algorithm_[k];
+        if (a.op!=OP_INPUT) continue;
+        for (casadi_int el=rowind[k]; el<rowind[k+1]; ++el) {
+          const SXFunction::AlgEl& b = f.algorithm_[col[el]];
+          if (col[el]>k || b.op!=OP_INPUT) continue;
+          hrow.push_back(offset[a.i1] + a.i2);
+          hcol.push_back(offset[b.i1] + b.i2);
+          hel.push_back(el);
+        }
+      }
+      std::vector<casadi_int> mapping;
+      hess_sp_[oind] = Sparsity::triplet(offset.back(), offset.back(), hrow, hcol, mapping, true);
+      w_hess_[oind].assign(col.size(), -1);
+      for (casadi_int i=0; i<hel.size(); ++i) w_hess_[oind][hel[i]] = mapping[i];
+      sz_hnz_ = std::max(sz_hnz_, static_cast<size_t>(hess_sp_[oind].nnz()));
+      sz_wnz_ = std::max(sz_wnz_, col.size());
+    }
+  }
+
+  void EdgePushing::init(const Dict& opts) {
+    casadi_assert(f_.is_a("SXFunction"), "Edge-pushing requires an SXFunction");
+    const SXFunction& f = *f_.get<SXFunction>();
+    casadi_assert(!f.has_free(), "Cannot create \"" + name_ + "\" since variables "
+      + str(f.get_free()) + " are free.");
+
+    // Dependencies, partial derivatives and sparsity of the second order adjoints
+    init_sweep();
+
+    // Offsets of the inputs in the concatenated nonzeros
+    std::vector<casadi_int> offset(f_.n_in() + 1, 0);
+    for (casadi_int i=0; i<f_.n_in(); ++i) offset[i+1] = offset[i] + f_.nnz_in(i);
+
+    // Nonzeros of the Hessian blocks, via the nonzero indices shifted by one
+    sparsity_out_.resize(oind_.size());
+    hess_nz_.resize(oind_.size());
+    for (casadi_int k=0; k<oind_.size(); ++k) {
+      const Sparsity& sp = hess_sp_[oind_[k]];
+      std::vector<double> nz(sp.nnz());
+      for (casadi_int i=0; i<nz.size(); ++i) nz[i] = static_cast<double>(i + 1);
+      DM H(sp, nz);
+      H += tril(H, false).T();
+      // Block, with rows and columns of the input matrices
+      casadi_int i1 = iind1_[k], i2 = iind2_[k];
+      H = H(Slice(offset[i1], offset[i1+1]), Slice(offset[i2], offset[i2+1]));
+      std::vector<casadi_int> r, c;
+      H.sparsity().get_triplet(r, c);
+      std::vector<casadi_int> r_ind = f_.sparsity_in(i1).find(), c_ind = f_.sparsity_in(i2).find();
+      for (casadi_int& e : r) e = r_ind[e];
+      for (casadi_int& e : c) e = c_ind[e];
+      H = DM::triplet(r, c, H, f_.numel_in(i1), f_.numel_in(i2));
+      // Attributes, innermost first
+      for (auto it = attr_[k].rbegin(); it != attr_[k].rend(); ++it) {
+        if (*it=="transpose") {
+          H = H.T();
+        } else if (*it=="triu") {
+          H = triu(H);
+        } else if (*it=="tril") {
+          H = tril(H);
+        } else if (*it=="densify") {
+          H = densify(H);
+        } else {
+          casadi_error("Cannot process attribute \"" + *it + "\"");
+        }
+      }
+      sparsity_out_[k] = H.sparsity();
+      hess_nz_[k].resize(H.nnz());
+      for (casadi_int i=0; i<H.nnz(); ++i) {
+        hess_nz_[k][i] = static_cast<casadi_int>(H.nonzeros()[i]) - 1;
+      }
+    }
+
+    // Call the initialization method of the base class
+    FunctionInternal::init(opts);
+
+    // Lower triangular Hessian, values, adjoints, second order adjoints, partial derivatives
+    alloc_w(sz_hnz_ + 2*f.algorithm_.size() + sz_wnz_ + opd_sz_w_, true);
+    alloc_iw(opd_sz_iw_, true);
+  }
+
+  int EdgePushing::eval(const double** arg, double** res, casadi_int* iw, double* w,
+      void* mem) const {
+    const SXFunction& f = *f_.get<SXFunction>();
+    casadi_int n = f.algorithm_.size();
+    // Partition the work vector
+    double* hnz = w;
+    w += sz_hnz_;
+    double* val = w;
+    w += n;
+    double* bar = w;
+    w += n;
+    double* wnz = w;
+    w += sz_wnz_;
+    // Values of the variables
+    ep_values(f, arg, get_ptr(dep_), val);
+    for (casadi_int oind=0; oind<hess_sp_.size(); ++oind) {
+      // Skip if not needed
+      bool needed = false;
+      for (casadi_int k=0; k<oind_.size(); ++k) needed = needed || (oind_[k]==oind && res[k]);
+      if (!needed) continue;
+      // Second order adjoints
+      const std::vector<casadi_int>& w_hess = w_hess_[oind];
+      casadi_clear(wnz, w_hess.size());
+      EpStaticW<double> W = {get_ptr(w_rowind_[oind]), get_ptr(w_col_[oind]), wnz,
+        get_ptr(f.algorithm_)};
+      ep_sweep(f, oind, get_ptr(dep_), active_, val, opd_, false, W, bar, iw, w);
+      // Lower triangular Hessian
+      casadi_clear(hnz, hess_sp_[oind].nnz());
+      for (casadi_int el=0; el<w_hess.size(); ++el) {
+        if (w_hess[el]>=0) hnz[w_hess[el]] += wnz[el];
+      }
+      // Distribute to the Hessian blocks
+      for (casadi_int k=0; k<oind_.size(); ++k) {
+        if (oind_[k]!=oind || !res[k]) continue;
+        for (casadi_int i=0; i<hess_nz_[k].size(); ++i) {
+          res[k][i] = hess_nz_[k][i]<0 ? 0 : hnz[hess_nz_[k][i]];
+        }
+      }
+    }
+    return 0;
+  }
+
+  void EdgePushing::serialize_body(SerializingStream &s) const {
+    FunctionInternal::serialize_body(s);
+    s.version("EdgePushing", 2);
+    s.pack("EdgePushing::f", f_);
+    s.pack("EdgePushing::oind", oind_);
+    s.pack("EdgePushing::iind1", iind1_);
+    s.pack("EdgePushing::iind2", iind2_);
+    s.pack("EdgePushing::attr", attr_);
+    s.pack("EdgePushing::hess_nz", hess_nz_);
+  }
+
+  EdgePushing::EdgePushing(DeserializingStream& s) : FunctionInternal(s) {
+    s.version("EdgePushing", 2);
+    s.unpack("EdgePushing::f", f_);
+    s.unpack("EdgePushing::oind", oind_);
+    s.unpack("EdgePushing::iind1", iind1_);
+    s.unpack("EdgePushing::iind2", iind2_);
+    s.unpack("EdgePushing::attr", attr_);
+    s.unpack("EdgePushing::hess_nz", hess_nz_);
+    init_sweep();
+  }
+
+} // namespace casadi
@@ -0,0 +1,200 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef CASADI_EDGE_PUSHING_HPP
+#define CASADI_EDGE_PUSHING_HPP
+
+#include "sx_function.hpp"
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  /** \brief Partial derivatives of a built-in operation up to second order
+
+      The second order partial derivatives are obtained by differentiating the
+      first order partial derivatives of casadi_math symbolically, once per operation.
+  */
+  struct CASADI_EXPORT OpDerivatives {
+    /// Function (x, y) -> (d2f/dx2, d2f/dxdy, d2f/dy2)
+    Function hess;
+
+    /// Structurally nonzero first order partial derivatives
+    bool d_nz[2];
+
+    /// Structurally nonzero second order partial derivatives
+    bool h_nz[3];
+
+    /// Default constructor
+    OpDerivatives();
+
+    /// Construct for a given operation
+    explicit OpDerivatives(casadi_int op);
+  };
+
+  /// Partial derivatives of all operations appearing in the algorithm of a function
+  CASADI_EXPORT std::vector<OpDerivatives> op_derivatives(const SXFunction& f);
+
+  /** \brief Hessian of a scalar output by edge-pushing
+
+      Reverse sweep over the algorithm, propagating the adjoints together with
+      a sparse symmetric matrix of second order adjoints, in which the
+      contributions of each eliminated variable are pushed onto the edges of
+      its dependencies, cf. Gower and Mello, "A new framework for the
+      computation of Hessians", Optimization Methods and Software, 2012.
+
+      Returns the lower triangular part in triplet form, indexed by the
+      nonzeros of all inputs concatenated. For SXElem, arg must hold the
+      symbolic inputs of the function. If pattern is true, only the sparsity
+      pattern is calculated, arg is not accessed and the values are meaningless.
+  */
+  template<typename T>
+  void edge_pushing(const SXFunction& f, casadi_int oind, const T** arg,
+    const std::vector<OpDerivatives>& opd, bool pattern,
+    std::vector<casadi_int>& hrow, std::vector<casadi_int>& hcol, std::vector<T>& hnz);
+
+  /** \brief Hessian blocks of an SXFunction, evaluated numerically by edge-pushing
+
+      No expression for the Hessian is formed, the second order adjoints are
+      propagated numerically over the algorithm of the function at each call.
+      Each output is a Hessian block of a scalar output of the function,
+      possibly with the attributes "transpose", "triu", "tril" or "densify"
+      applied, as in Function::factory.
+  */
+  class CASADI_EXPORT EdgePushing : public FunctionInternal {
+  public:
+    /** \brief Constructor
+
+        Output k is the block of the Hessian of output oind[k] of f with respect
+        to inputs iind1[k] and iind2[k], attributes attr[k] applied from the back.
+    */
+    EdgePushing(const std::string& name, const Function& f,
+      const std::vector<std::string>& name_out,
+      const std::vector<casadi_int>& oind, const std::vector<casadi_int>& iind1,
+      const std::vector<casadi_int>& iind2, const std::vector<std::vector<std::string> >& attr);
+
+    /** \brief Destructor */
+    ~EdgePushing() override;
+
+    /** \brief Get type name */
+    std::string class_name() const override {return "EdgePushing";}
+
+    /** \brief Check if the function is of a particular type */
+    bool is_a(const std::string& type, bool recursive) const override;
+
+    // Get list of dependency functions
+    std::vector<std::string> get_function() const override { return {"f"};}
+
+    // Get a dependency function
+    const Function& get_function(const std::string &name) const override;
+
+    // Check if a particular dependency exists
+    bool has_function(const std::string& fname) const override { return fname=="f";}
+
+    /** \brief Sparsities of function inputs */
+    Sparsity get_sparsity_in(casadi_int i) override { return f_.sparsity_in(i);}
+
+    /** \brief Get default input value */
+    double get_default_in(casadi_int ind) const override { return f_.default_in(ind);}
+
+    ///@{
+    /** \brief Number of function inputs and outputs */
+    size_t get_n_in() override { return f_.n_in();}
+    size_t get_n_out() override { return oind_.size();}
+    ///@}
+
+    /** \brief Names of function inputs */
+    std::string get_name_in(casadi_int i) override { return f_.name_in(i);}
+
+    /** \brief  Initialize */
+    void init(const Dict& opts) override;
+
+    /// Evaluate numerically
+    int eval(const double** arg, double** res, casadi_int* iw, double* w, void* mem) const override;
+
+    /** Obtain information about node */
+    Dict info() const override { return {{"f", f_}}; }
+
+    /** \brief Serialize an object without type information */
+    void serialize_body(SerializingStream &s) const override;
+
+    /** \brief String used to identify the immediate FunctionInternal subclass */
+    std::string serialize_base_function() const override { return "EdgePushing"; }
+
+    /** \brief Deserialize without type information */
+    static ProtoFunction* deserialize(DeserializingStream& s) { return new EdgePushing(s); }
+
+  protected:
+    /** \brief Deserializing constructor */
+    explicit EdgePushing(DeserializingStream& s);
+
+    /** \brief Partial derivatives, dependencies and sparsity of the second order adjoints
+
+        The sparsity is obtained by a sweep over the pattern, so that the numerical
+        sweeps can use fixed storage in the work vectors.
+    */
+    void init_sweep();
+
+    // Function being differentiated
+    Function f_;
+
+    // Output, first and second input of f for each Hessian block
+    std::vector<casadi_int> oind_, iind1_, iind2_;
+
+    // Attributes for each Hessian block
+    std::vector<std::vector<std::string> > attr_;
+
+    // Lower triangular Hessian of each output of f, with respect to all input nonzeros
+    std::vector<Sparsity> hess_sp_;
+
+    // Nonzero of the lower triangular Hessian for each output nonzero, -1 if zero
+    std::vector<std::vector<casadi_int> > hess_nz_;
+
+    // Partial derivatives of the operations
+    std::vector<OpDerivatives> opd_;
+
+    // Work vector sizes for the second order partial derivatives
+    size_t opd_sz_iw_, opd_sz_w_;
+
+    // Variables each instruction depends on, two per instruction, -1 if none
+    std::vector<casadi_int> dep_;
+
+    // Does the instruction depend on the inputs
+    std::vector<bool> active_;
+
+    // Sparsity of the second order adjoints for each output of f, compressed rows
+    std::vector<std::vector<casadi_int> > w_rowind_, w_col_;
+
+    // Nonzero of the lower triangular Hessian for each second order adjoint, -1 if none
+    std::vector<std::vector<casadi_int> > w_hess_;
+
+    // Largest number of nonzeros of the lower triangular Hessians and second order adjoints
+    size_t sz_hnz_, sz_wnz_;
+  };
+
+} // namespace casadi
+
+/// \endcond
+
+#endif // CASADI_EDGE_PUSHING_HPP
@@ -74,6 +74,9 @@ namespace casadi {
     // Hessian blocks
     std::vector<HBlock> hess_;
 
+    // Calculate Hessian blocks by edge-pushing
+    bool edge_pushing_ = false;
+
     // Read a Jacobian or gradient block
     Block block(const std::string& s1, const std::string& s) const;
 
@@ -455,7 +458,30 @@ namespace casadi {
       }
       // Calculate Hessian blocks
       try {
-        if (all_x1.size() == 1 && all_x2.size() == 1) {
+        if (edge_pushing_) {
+          // Extended Hessian with respect to all arguments involved, in one sweep
+          std::vector<size_t> all_x = {b.x1, b.x2};
+          all_x.insert(all_x.end(), all_x1.begin(), all_x1.end());
+          all_x.insert(all_x.end(), all_x2.begin(), all_x2.end());
+          std::sort(all_x.begin(), all_x.end());
+          all_x.erase(std::unique(all_x.begin(), all_x.end()), all_x.end());
+          std::vector<MatType> x(all_x.size());
+          for (size_t i = 0; i < x.size(); ++i) x[i] = in_.at(all_x[i]);
+          Dict ep_opts = opts;
+          ep_opts["edge_pushing"] = true;
+          MatType H = hessian(out_.at(f), vertcat(x), ep_opts);
+          std::vector<std::vector<MatType>> H_all = blocksplit(H, offset(x), offset(x));
+          // Collect Hessian blocks
+          for (auto &&b1 : hess_) {
+            if (b1.f != f || b1.calculated) continue;
+            auto it_x1 = std::find(all_x.begin(), all_x.end(), b1.x1);
+            auto it_x2 = std::find(all_x.begin(), all_x.end(), b1.x2);
+            if (it_x1 != all_x.end() && it_x2 != all_x.end()) {
+              add_output(b1.s, H_all.at(it_x1 - all_x.begin()).at(it_x2 - all_x.begin()), true);
+              b1.calculated = true;
+            }
+          }
+        } else if (all_x1.size() == 1 && all_x2.size() == 1) {
           // Single block
           MatType H = b.x1 == b.x2 ? hessian(out_.at(f), in_[b.x1], opts)
             : jacobian(gradient(out_.at(f), in_[b.x1]), in_[b.x2]);
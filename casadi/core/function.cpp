@@ -31,6 +31,7 @@
 #include "bspline.hpp"
 #include "nlpsol.hpp"
 #include "mapsum.hpp"
+#include "mapaccum.hpp"
 #include "conic.hpp"
 #include "jit_function.hpp"
 #include "serializing_stream.hpp"
@@ -510,7 +511,10 @@ namespace casadi {
     std::vector<MX> base_in = base.mx_in();
     std::vector<MX> out = base(base_in);
     out[0] = out[0](Slice(), range((N-1)*size2_out(0), N*size2_out(0))); // NOLINT
-    return Function("fold_"+name(), base_in, out, name_in(), name_out(), opts);
+    // Options that only apply to the mapaccum
+    Dict options = opts;
+    for (const char* op : {"base", "checkpoints", "checkpoint_schedule"}) options.erase(op);
+    return Function("fold_"+name(), base_in, out, name_in(), name_out(), options);
   }
   Function Function::mapaccum(casadi_int N, const Dict& opts) const {
     return mapaccum("mapaccum_"+name(), N, opts);
@@ -532,6 +536,22 @@ namespace casadi {
 
     casadi_assert(N>0, "mapaccum: N must be positive");
 
+    // Loop with checkpointed reverse mode
+    it = options.find("checkpoints");
+    if (it!=options.end()) {
+      casadi_int checkpoints = it->second;
+      options.erase(it);
+      std::string schedule = "binomial";
+      it = options.find("checkpoint_schedule");
+      if (it!=options.end()) {
+        schedule = it->second.to_string();
+        options.erase(it);
+      }
+      return MapAccum::create(name, *this, N, n_accum, checkpoints, schedule, options);
+    }
+    casadi_assert(options.find("checkpoint_schedule")==options.end(),
+      "mapaccum: option 'checkpoint_schedule' requires 'checkpoints'");
+
     if (base==-1)
       return mapaccum(name, std::vector<Function>(N, *this), n_accum, options);
     casadi_assert(base>=2, "mapaccum: base must be positive");
@@ -682,6 +682,16 @@ namespace casadi {
 
         Set base to -1 to unroll all the way; no gains in memory efficiency here.
 
+        Set the option checkpoints to evaluate with a loop instead. Reverse mode
+        derivatives then keep only the given number of intermediate states and
+        recompute the others, which bounds the memory for long horizons.
+        The option checkpoint_schedule selects the placement of the stored states:
+        'binomial' (default, as in Revolve: least recomputation for the memory)
+        or 'equidistant' (each step recomputed once, but all states of one
+        interval between stored states are kept).
+        The reverse mode derivative cannot itself be differentiated, so there are
+        no second order derivatives (e.g. exact Hessians) with checkpoints.
+
         \identifier{1wi} */
     Function mapaccum(const std::string& name, casadi_int N, const Dict& opts = Dict()) const;
     Function mapaccum(const std::string& name, casadi_int N, casadi_int n_accum,
@@ -27,14 +27,19 @@
 #include "casadi_call.hpp"
 #include "casadi_misc.hpp"
 #include "global_options.hpp"
+#include "thread_pool.hpp"
+#include "jit_cache.hpp"
 #include "external.hpp"
 #include "finite_differences.hpp"
+#include "edge_pushing.hpp"
+#include "tape_ad.hpp"
 #include "serializing_stream.hpp"
 #include "mx_function.hpp"
 #include "sx_function.hpp"
 #include "rootfinder_impl.hpp"
 #include "map.hpp"
 #include "mapsum.hpp"
+#include "mapaccum.hpp"
 #include "switch.hpp"
 #include "interpolant_impl.hpp"
 #include "nlpsol_impl.hpp"
@@ -75,6 +80,8 @@ namespace casadi {
     ad_weight_ = 0.33; // i.e. nf <= 2*na <=> 1/3*nf <= (1-1/3)*na, forward when tie
     // Both modes equally expensive by default (no "taping" needed)
     ad_weight_sp_ = 0.49; // Forward when tie
+    sparsity_threads_ = 1;
+    jac_threads_ = 1;
     always_inline_ = false;
     never_inline_ = false;
     jac_penalty_ = 2;
@@ -86,6 +93,8 @@ namespace casadi {
     jit_serialize_ = "source";
     jit_base_name_ = "jit_tmp";
     jit_temp_suffix_ = true;
+    jit_cache_size_ = 1073741824;
+    jit_shard_size_ = 0;
     compiler_plugin_ = CASADI_STR(CASADI_DEFAULT_COMPILER_PLUGIN);
 
     eval_ = nullptr;
@@ -126,6 +135,9 @@ namespace casadi {
       std::string jit_directory = get_from_dict(jit_options_, "directory", std::string(""));
       std::string jit_name = jit_directory + jit_name_ + ".c";
       if (remove(jit_name.c_str())) casadi_warning("Failed to remove " + jit_name);
+      for (const std::string& f : jit_shard_files_) {
+        if (remove(f.c_str())) casadi_warning("Failed to remove " + f);
+      }
     }
   }
 
@@ -194,6 +206,19 @@ namespace casadi {
         "Overrides default behavior. Set to 0 and 1 to force forward and "
         "reverse mode respectively. Cf. option \"ad_weight\". "
         "When set to -1, sparsity is completely ignored and dense matrices are used."}},
+      {"sparsity_threads",
+       {OT_INT,
+        "Number of threads used for propagating independent blocks of seeds "
+        "when calculating Jacobian sparsity patterns. "
+        "Zero or negative means as many as possible, cf. GlobalOptions::setMaxNumThreads. "
+        "Only used by functions whose propagation calls no other functions, e.g. SXFunction. "
+        "The result does not depend on this setting. Default: 1"}},
+      {"jac_threads",
+       {OT_INT,
+        "Number of threads used for differentiating independent groups of directions "
+        "when constructing symbolic Jacobians. Only effective for SX with thread-safe "
+        "symbolics (WITH_THREADSAFE_SYMBOLICS). Zero or negative means as many as possible. "
+        "The result does not depend on this setting. Default: 1"}},
       {"always_inline",
        {OT_BOOL,
         "Force inlining."}},
@@ -246,6 +271,21 @@ namespace casadi {
         "This is desired for thread-safety. "
         "This behaviour may defeat caching compiler wrappers. "
         "Default: true"}},
+      {"jit_cache",
+       {OT_STRING,
+        "Directory of a persistent cache of jit-compiled libraries, "
+        "shared between processes and keyed by the generated code, "
+        "the compiler, its options and the CasADi version. Default: '' (no cache)"}},
+      {"jit_cache_size",
+       {OT_INT,
+        "Size limit in bytes of the jit cache directory, "
+        "beyond which the least recently used entries are evicted. "
+        "Non-positive for unlimited. Default: 1 GiB"}},
+      {"jit_shard_size",
+       {OT_INT,
+        "Split the code generated for jit into source files of approximately "
+        "this many bytes, compiled concurrently. Requires the shell compiler. "
+        "Default: 0 (single file)"}},
       {"compiler",
        {OT_STRING,
         "Just-in-time compiler plugin to be used."}},
@@ -386,8 +426,13 @@ namespace casadi {
     opts["jit_options"] = jit_options_;
     opts["jit_name"] = jit_base_name_;
     opts["jit_temp_suffix"] = jit_temp_suffix_;
+    opts["jit_cache"] = jit_cache_;
+    opts["jit_cache_size"] = jit_cache_size_;
+    opts["jit_shard_size"] = jit_shard_size_;
     opts["ad_weight"] = ad_weight_;
     opts["ad_weight_sp"] = ad_weight_sp_;
+    opts["sparsity_threads"] = sparsity_threads_;
+    opts["jac_threads"] = jac_threads_;
     opts["always_inline"] = always_inline_;
     opts["never_inline"] = never_inline_;
     opts["max_num_dir"] = max_num_dir_;
@@ -425,6 +470,10 @@ namespace casadi {
       ad_weight_ = option_value;
     } else if (option_name=="ad_weight_sp") {
       ad_weight_sp_ = option_value;
+    } else if (option_name=="sparsity_threads") {
+      sparsity_threads_ = option_value;
+    } else if (option_name=="jac_threads") {
+      jac_threads_ = option_value;
     } else if (option_name=="dump") {
       dump_ = option_value;
     } else if (option_name=="dump_in") {
@@ -478,12 +527,22 @@ namespace casadi {
         jit_base_name_ = op.second.to_string();
       } else if (op.first=="jit_temp_suffix") {
         jit_temp_suffix_ = op.second;
+      } else if (op.first=="jit_cache") {
+        jit_cache_ = op.second.to_string();
+      } else if (op.first=="jit_cache_size") {
+        jit_cache_size_ = op.second;
+      } else if (op.first=="jit_shard_size") {
+        jit_shard_size_ = op.second;
       } else if (op.first=="derivative_of") {
         derivative_of_ = op.second;
       } else if (op.first=="ad_weight") {
         ad_weight_ = op.second;
       } else if (op.first=="ad_weight_sp") {
         ad_weight_sp_ = op.second;
+      } else if (op.first=="sparsity_threads") {
+        sparsity_threads_ = op.second;
+      } else if (op.first=="jac_threads") {
+        jac_threads_ = op.second;
       } else if (op.first=="max_num_dir") {
         max_num_dir_ = op.second;
       } else if (op.first=="enable_forward") {
@@ -678,6 +737,40 @@ namespace casadi {
     return "o" + str(i);
   }
 
+  void FunctionInternal::jit_cached(const std::string& source_file, const Dict& jit_options) {
+    JitCache cache(jit_cache_, jit_cache_size_);
+    std::stringstream source;
+    source << std::ifstream(source_file, std::ios_base::binary).rdbuf();
+    for (const std::string& f : jit_shard_files_) {
+      source << std::ifstream(f, std::ios_base::binary).rdbuf();
+    }
+    // The sharded sources refer to each other by the, possibly random, jit name
+    std::string code = source.str();
+    if (!jit_shard_files_.empty()) code = replace(code, jit_name_, "jit_name");
+    std::string key = JitCache::key(code, compiler_plugin_, jit_options);
+    // Load a previously compiled library
+    std::string library = cache.lookup(key);
+    if (!library.empty()) {
+      try {
+        compiler_ = Importer(library, "dll");
+        if (verbose_) casadi_message("Loaded '" + library + "' from jit cache.");
+        return;
+      } catch (CasadiException&) {
+        // Evicted by another process in the meantime
+      }
+    }
+    // Compile and store
+    compiler_ = Importer(source_file, compiler_plugin_, jit_options);
+    try {
+      library = compiler_.library();
+    } catch (CasadiException&) {
+      // Compiler plugin does not produce a shared library
+      return;
+    }
+    library = cache.insert(key, library);
+    if (verbose_ && !library.empty()) casadi_message("Stored '" + library + "' in jit cache.");
+  }
+
   void FunctionInternal::finalize() {
     if (jit_) {
       jit_name_ = jit_base_name_;
@@ -692,11 +785,25 @@ namespace casadi {
           Dict opts;
           // Override the default to avoid random strings in the generated code
           opts["prefix"] = "jit";
+          if (jit_shard_size_>0) opts["shard_size"] = jit_shard_size_;
           CodeGenerator gen(jit_name_, opts);
           gen.add(self());
           if (verbose_) casadi_message("Compiling function '" + name_ + "'..");
           std::string jit_directory = get_from_dict(jit_options_, "directory", std::string(""));
-          compiler_ = Importer(gen.generate(jit_directory), compiler_plugin_, jit_options_);
+          std::string jit_source = gen.generate(jit_directory);
+          Dict jit_options = jit_options_;
+          jit_shard_files_ = gen.shard_files();
+          if (!jit_shard_files_.empty()) {
+            casadi_assert(compiler_plugin_=="shell",
+              "Option 'jit_shard_size' requires the 'shell' compiler plugin");
+            jit_options["extra_sources"] = jit_shard_files_;
+            jit_shard_files_.push_back(jit_directory + jit_name_ + "_shared.h");
+          }
+          if (jit_cache_.empty()) {
+            compiler_ = Importer(jit_source, compiler_plugin_, jit_options);
+          } else {
+            jit_cached(jit_source, jit_options);
+          }
           if (verbose_) casadi_message("Compiling function '" + name_ + "' done.");
         }
         // Try to load
@@ -1026,6 +1133,8 @@ namespace casadi {
       my_opts["ad_weight_sp"] = sp_weight();
     if (my_opts.find("max_num_dir")==my_opts.end())
       my_opts["max_num_dir"] = max_num_dir_;
+    if (my_opts.find("sparsity_threads")==my_opts.end())
+      my_opts["sparsity_threads"] = sparsity_threads_;
     // Wrap the function
     std::vector<MX> arg = mx_in();
     std::vector<MX> res = self()(arg);
@@ -1042,6 +1151,7 @@ namespace casadi {
       opts["ad_weight"] = ad_weight();
       opts["ad_weight_sp"] = sp_weight();
       opts["max_num_dir"] = max_num_dir_;
+      opts["sparsity_threads"] = sparsity_threads_;
       opts["is_diff_in"] = is_diff_in_;
       opts["is_diff_out"] = is_diff_out_;
       // Wrap the function
@@ -1119,46 +1229,87 @@ namespace casadi {
     }
   };
 
+  /// \cond INTERNAL
+  // Work buffers of one thread propagating sparsity patterns
+  struct JacSparsityWork {
+    std::vector<const bvec_t*> arg_fwd;
+    std::vector<bvec_t*> arg_adj, res;
+    std::vector<casadi_int> iw;
+    std::vector<bvec_t> w, s_in, s_out;
+  };
+  /// \endcond
+
+  casadi_int FunctionInternal::num_threads(casadi_int n_req, casadi_int n_task) {
+#ifdef CASADI_WITH_THREAD
+    casadi_int n_max = ThreadPool::max_num_threads();
+    casadi_int n = n_req > 0 ? std::min(n_req, n_max) : n_max;
+    return std::max(casadi_int(1), std::min(n, n_task));
+#else // CASADI_WITH_THREAD
+    return 1;
+#endif // CASADI_WITH_THREAD
+  }
+
+  casadi_int FunctionInternal::sparsity_num_threads(casadi_int nsweep) const {
+    if (!has_sp_threads()) return 1;
+    return num_threads(sparsity_threads_, nsweep);
+  }
+
   template<bool fwd>
   Sparsity FunctionInternal::get_jac_sparsity_gen(casadi_int oind, casadi_int iind) const {
     // Number of nonzero inputs and outputs
     casadi_int nz_in = nnz_in(iind);
     casadi_int nz_out = nnz_out(oind);
 
-    // Evaluation buffers
-    std::vector<typename JacSparsityTraits<fwd>::arg_t> arg(sz_arg(), nullptr);
-    std::vector<bvec_t*> res(sz_res(), nullptr);
-    std::vector<casadi_int> iw(sz_iw());
-    std::vector<bvec_t> w(sz_w(), 0);
-
-    // Seeds and sensitivities
-    std::vector<bvec_t> seed(nz_in, 0);
-    arg[iind] = get_ptr(seed);
-    std::vector<bvec_t> sens(nz_out, 0);
-    res[oind] = get_ptr(sens);
-    if (!fwd) std::swap(seed, sens);
+    // Number of seed and sensitivity directions
+    casadi_int nz_seed = fwd ? nz_in : nz_out;
+    casadi_int nz_sens = fwd ? nz_out : nz_in;
 
     // Number of forward sweeps we must make
-    casadi_int nsweep = seed.size() / bvec_size;
-    if (seed.size() % bvec_size) nsweep++;
+    casadi_int nsweep = nz_seed / bvec_size;
+    if (nz_seed % bvec_size) nsweep++;
+
+    // Number of threads
+    casadi_int n_thread = sparsity_num_threads(nsweep);
 
     // Print
     if (verbose_) {
       casadi_message(str(nsweep) + std::string(fwd ? " forward" : " reverse") + " sweeps "
-                     "needed for " + str(seed.size()) + " directions");
-    }
-
-    // Progress
+                     "needed for " + str(nz_seed) + " directions"
+                     + (n_thread>1 ? " (" + str(n_thread) + " threads)" : ""));
+    }
+
+    // Evaluation buffers and memory objects for each thread, memory(0) for the calling thread
+    std::vector<JacSparsityWork> work(n_thread);
+    std::vector< scoped_checkout<FunctionInternal> > mem;
+    mem.reserve(n_thread-1);
+    for (casadi_int t=0; t<n_thread; ++t) {
+      JacSparsityWork& wk = work[t];
+      wk.arg_fwd.resize(sz_arg(), nullptr);
+      wk.arg_adj.resize(sz_arg(), nullptr);
+      wk.res.resize(sz_res(), nullptr);
+      wk.iw.resize(sz_iw());
+      wk.w.resize(sz_w(), 0);
+      wk.s_in.resize(nz_in, 0);
+      wk.s_out.resize(nz_out, 0);
+      wk.arg_fwd[iind] = wk.arg_adj[iind] = get_ptr(wk.s_in);
+      wk.res[oind] = get_ptr(wk.s_out);
+      if (t>0) mem.emplace_back(*this);
+    }
+
+    // Progress, only reported for serial evaluation
     casadi_int progress = -10;
 
-    // Temporary vectors
-    std::vector<casadi_int> jcol, jrow;
+    // Sparsity triplets for each sweep, concatenated in order afterwards
+    std::vector< std::vector<casadi_int> > jcol_s(nsweep), jrow_s(nsweep);
 
     // Loop over the variables, bvec_size variables at a time
-    for (casadi_int s=0; s<nsweep; ++s) {
+    ThreadPool::run(nsweep, n_thread, [&](casadi_int s, casadi_int t) {
+      JacSparsityWork& wk = work[t];
+      bvec_t* seed = fwd ? get_ptr(wk.s_in) : get_ptr(wk.s_out);
+      bvec_t* sens = fwd ? get_ptr(wk.s_out) : get_ptr(wk.s_in);
 
       // Print progress
-      if (verbose_) {
+      if (verbose_ && n_thread==1) {
         casadi_int progress_new = (s*100)/nsweep;
         // Print when entering a new decade
         if (progress_new / 10 > progress / 10) {
@@ -1171,7 +1322,7 @@ namespace casadi {
       casadi_int offset = s*bvec_size;
 
       // Number of local seed directions
-      casadi_int ndir_local = seed.size()-offset;
+      casadi_int ndir_local = nz_seed-offset;
       ndir_local = std::min(static_cast<casadi_int>(bvec_size), ndir_local);
 
       for (casadi_int i=0; i<ndir_local; ++i) {
@@ -1179,11 +1330,21 @@ namespace casadi {
       }
 
       // Propagate the dependencies
-      JacSparsityTraits<fwd>::sp(this, get_ptr(arg), get_ptr(res),
-                                  get_ptr(iw), get_ptr(w), memory(0));
+      void* m = memory(t==0 ? 0 : static_cast<int>(mem[t-1]));
+      if (fwd) {
+        JacSparsityTraits<true>::sp(this, get_ptr(wk.arg_fwd), get_ptr(wk.res),
+                                    get_ptr(wk.iw), get_ptr(wk.w), m);
+      } else {
+        // Sweeps may be distributed arbitrarily over the threads
+        std::fill(wk.w.begin(), wk.w.end(), 0);
+        JacSparsityTraits<false>::sp(this, get_ptr(wk.arg_adj), get_ptr(wk.res),
+                                     get_ptr(wk.iw), get_ptr(wk.w), m);
+      }
 
       // Loop over the nonzeros of the output
-      for (casadi_int el=0; el<sens.size(); ++el) {
+      std::vector<casadi_int>& jcol = jcol_s[s];
+      std::vector<casadi_int>& jrow = jrow_s[s];
+      for (casadi_int el=0; el<nz_sens; ++el) {
 
         // Get the sparsity sensitivity
         bvec_t spsens = sens[el];
@@ -1213,6 +1374,13 @@ namespace casadi {
       for (casadi_int i=0; i<ndir_local; ++i) {
         seed[offset+i] = 0;
       }
+    });
+
+    // Collect the triplets
+    std::vector<casadi_int> jcol, jrow;
+    for (casadi_int s=0; s<nsweep; ++s) {
+      jcol.insert(jcol.end(), jcol_s[s].begin(), jcol_s[s].end());
+      jrow.insert(jrow.end(), jrow_s[s].begin(), jrow_s[s].end());
     }
 
     // Construct sparsity pattern and return
@@ -1467,18 +1635,11 @@ namespace casadi {
     // Number of nonzero outputs
     casadi_int nz_out = nnz_out(oind);
 
-    // Seeds and sensitivities
-    std::vector<bvec_t> s_in(nz_in, 0);
-    std::vector<bvec_t> s_out(nz_out, 0);
+    // Evaluation buffers, seeds and sensitivities for each thread, allocated on demand
+    std::vector<JacSparsityWork> work;
 
-    // Evaluation buffers
-    std::vector<const bvec_t*> arg_fwd(sz_arg(), nullptr);
-    std::vector<bvec_t*> arg_adj(sz_arg(), nullptr);
-    arg_fwd[iind] = arg_adj[iind] = get_ptr(s_in);
-    std::vector<bvec_t*> res(sz_res(), nullptr);
-    res[oind] = get_ptr(s_out);
-    std::vector<casadi_int> iw(sz_iw());
-    std::vector<bvec_t> w(sz_w());
+    // Memory objects for all but the calling thread, which uses memory(0)
+    std::vector< scoped_checkout<FunctionInternal> > mem;
 
     // Sparsity triplet accumulator
     std::vector<casadi_int> jcol, jrow;
@@ -1557,17 +1718,10 @@ namespace casadi {
             "(fwd cost: " + str(fwd_cost) + ", adj cost: " + str(adj_cost) + ")");
       }
 
-      // Get seeds and sensitivities
-      bvec_t* seed_v = use_fwd ? get_ptr(s_in) : get_ptr(s_out);
-      bvec_t* sens_v = use_fwd ? get_ptr(s_out) : get_ptr(s_in);
-
       // The number of zeros in the seed and sensitivity directions
       casadi_int nz_seed = use_fwd ? nz_in  : nz_out;
       casadi_int nz_sens = use_fwd ? nz_out : nz_in;
 
-      // Clear the seeds
-      for (casadi_int i=0; i<nz_seed; ++i) seed_v[i]=0;
-
       // Choose the active jacobian coloring scheme
       Sparsity D = use_fwd ? D1 : D2;
 
@@ -1620,6 +1774,13 @@ namespace casadi {
         n_fine_blocks_max = std::max(n_fine_blocks_max, del);
       }
 
+      // Seeds to be toggled on, as (begin, end, bit) triplets, for each sweep
+      std::vector< std::vector<casadi_int> > sweep_toggle;
+      std::vector<casadi_int> toggle;
+
+      // Lookup tables for each sweep
+      std::vector<IM> sweep_lookup;
+
       // Loop over all coarse seed directions from the coloring
       for (casadi_int csd=0; csd<D.size2(); ++csd) {
 
@@ -1657,8 +1818,9 @@ namespace casadi {
               }
 
               // Toggle on seeds
-              bvec_toggle(seed_v, fine_row[fci+fci_start], fine_row[fci+fci_start+1],
-                          bvec_i+bvec_i_mod);
+              toggle.push_back(fine_row[fci+fci_start]);
+              toggle.push_back(fine_row[fci+fci_start+1]);
+              toggle.push_back(bvec_i+bvec_i_mod);
               bvec_i_mod++;
             }
           }
@@ -1668,58 +1830,13 @@ namespace casadi {
 
           // Check if bvec buffer is full
           if (bvec_i==bvec_size || csd==D.size2()-1) {
-            // Calculate sparsity for bvec_size directions at once
-
-            // Statistics
-            nsweeps+=1;
+            // Record a sweep for bvec_size directions at once
+            sweep_toggle.push_back(toggle);
+            toggle.clear();
 
             // Construct lookup table
-            IM lookup = IM::triplet(lookup_row, lookup_col, lookup_value, bvec_size,
-                                    coarse_col.size());
-
-            // Propagate the dependencies
-            if (use_fwd) {
-              JacSparsityTraits<true>::sp(this, get_ptr(arg_fwd), get_ptr(res),
-                get_ptr(iw), get_ptr(w), memory(0));
-            } else {
-              std::fill(w.begin(), w.end(), 0);
-              JacSparsityTraits<false>::sp(this, get_ptr(arg_adj), get_ptr(res),
-                get_ptr(iw), get_ptr(w), memory(0));
-            }
-
-            // Temporary bit work vector
-            bvec_t spsens;
-
-            // Loop over the cols of coarse blocks
-            for (casadi_int cri=0;cri<coarse_col.size()-1;++cri) {
-
-              // Loop over the cols of fine blocks within the current coarse block
-              for (casadi_int fri=fine_col_lookup[coarse_col[cri]];
-                   fri<fine_col_lookup[coarse_col[cri+1]];++fri) {
-                // Lump individual sensitivities together into fine block
-                bvec_or(sens_v, spsens, fine_col[fri], fine_col[fri+1]);
-
-                // Next iteration if no sparsity
-                if (!spsens) continue;
-
-                // Loop over all bvec_bits
-                for (casadi_int bvec_i=0;bvec_i<bvec_size;++bvec_i) {
-                  if (spsens & bvec_lookup[bvec_i]) {
-                    // if dependency is found, add it to the new sparsity pattern
-                    casadi_int ind = lookup.sparsity().get_nz(bvec_i, cri);
-                    if (ind==-1) continue;
-                    jrow.push_back(bvec_i+lookup->at(ind));
-                    jcol.push_back(fri);
-                  }
-                }
-              }
-            }
-
-            // Clear the forward seeds/adjoint sensitivities, ready for next bvec sweep
-            std::fill(s_in.begin(), s_in.end(), 0);
-
-            // Clear the adjoint seeds/forward sensitivities, ready for next bvec sweep
-            std::fill(s_out.begin(), s_out.end(), 0);
+            sweep_lookup.push_back(IM::triplet(lookup_row, lookup_col, lookup_value, bvec_size,
+                                               coarse_col.size()));
 
             // Clean lookup table
             lookup_col.clear();
@@ -1739,6 +1856,97 @@ namespace casadi {
 
       }
 
+      // Number of sweeps for this block size
+      casadi_int nsweep = sweep_toggle.size();
+      nsweeps += nsweep;
+
+      // Allocate work buffers and memory objects for each thread
+      casadi_int n_thread = sparsity_num_threads(nsweep);
+      for (casadi_int t=work.size(); t<n_thread; ++t) {
+        work.push_back(JacSparsityWork());
+        JacSparsityWork& wk = work.back();
+        wk.arg_fwd.resize(sz_arg(), nullptr);
+        wk.arg_adj.resize(sz_arg(), nullptr);
+        wk.res.resize(sz_res(), nullptr);
+        wk.iw.resize(sz_iw());
+        wk.w.resize(sz_w(), 0);
+        wk.s_in.resize(nz_in, 0);
+        wk.s_out.resize(nz_out, 0);
+        wk.arg_fwd[iind] = wk.arg_adj[iind] = get_ptr(wk.s_in);
+        wk.res[oind] = get_ptr(wk.s_out);
+        if (t>0) mem.emplace_back(*this);
+      }
+
+      // Sparsity triplets for each sweep, concatenated in order afterwards
+      std::vector< std::vector<casadi_int> > jcol_s(nsweep), jrow_s(nsweep);
+
+      // Calculate sparsity for bvec_size directions at once, in independent sweeps
+      ThreadPool::run(nsweep, n_thread, [&](casadi_int s, casadi_int t) {
+        JacSparsityWork& wk = work[t];
+
+        // Get seeds and sensitivities
+        bvec_t* seed_v = use_fwd ? get_ptr(wk.s_in) : get_ptr(wk.s_out);
+        bvec_t* sens_v = use_fwd ? get_ptr(wk.s_out) : get_ptr(wk.s_in);
+
+        // Toggle on seeds
+        const std::vector<casadi_int>& tg = sweep_toggle[s];
+        for (casadi_int k=0; k<tg.size(); k+=3) bvec_toggle(seed_v, tg[k], tg[k+1], tg[k+2]);
+
+        // Propagate the dependencies
+        void* m = memory(t==0 ? 0 : static_cast<int>(mem[t-1]));
+        if (use_fwd) {
+          JacSparsityTraits<true>::sp(this, get_ptr(wk.arg_fwd), get_ptr(wk.res),
+            get_ptr(wk.iw), get_ptr(wk.w), m);
+        } else {
+          std::fill(wk.w.begin(), wk.w.end(), 0);
+          JacSparsityTraits<false>::sp(this, get_ptr(wk.arg_adj), get_ptr(wk.res),
+            get_ptr(wk.iw), get_ptr(wk.w), m);
+        }
+
+        // Lookup table
+        const IM& lookup = sweep_lookup[s];
+
+        // Temporary bit work vector
+        bvec_t spsens;
+
+        // Loop over the cols of coarse blocks
+        for (casadi_int cri=0;cri<coarse_col.size()-1;++cri) {
+
+          // Loop over the cols of fine blocks within the current coarse block
+          for (casadi_int fri=fine_col_lookup[coarse_col[cri]];
+               fri<fine_col_lookup[coarse_col[cri+1]];++fri) {
+            // Lump individual sensitivities together into fine block
+            bvec_or(sens_v, spsens, fine_col[fri], fine_col[fri+1]);
+
+            // Next iteration if no sparsity
+            if (!spsens) continue;
+
+            // Loop over all bvec_bits
+            for (casadi_int bvec_i=0;bvec_i<bvec_size;++bvec_i) {
+              if (spsens & bvec_lookup[bvec_i]) {
+                // if dependency is found, add it to the new sparsity pattern
+                casadi_int ind = lookup.sparsity().get_nz(bvec_i, cri);
+                if (ind==-1) continue;
+                jrow_s[s].push_back(bvec_i+lookup->at(ind));
+                jcol_s[s].push_back(fri);
+              }
+            }
+          }
+        }
+
+        // Clear the forward seeds/adjoint sensitivities, ready for next bvec sweep
+        std::fill(wk.s_in.begin(), wk.s_in.end(), 0);
+
+        // Clear the adjoint seeds/forward sensitivities, ready for next bvec sweep
+        std::fill(wk.s_out.begin(), wk.s_out.end(), 0);
+      });
+
+      // Collect the triplets
+      for (casadi_int s=0; s<nsweep; ++s) {
+        jcol.insert(jcol.end(), jcol_s[s].begin(), jcol_s[s].end());
+        jrow.insert(jrow.end(), jrow_s[s].begin(), jrow_s[s].end());
+      }
+
       // Swap results if adjoint mode was used
       if (use_fwd) {
         // Construct fine sparsity pattern
@@ -2280,7 +2488,9 @@ namespace casadi {
   void FunctionInternal::codegen(CodeGenerator& g, const std::string& fname) const {
     // Define function
     g << "/* " << definition() << " */\n";
-    g << "static " << signature(fname) << " {\n";
+    // External linkage if the definition may end up in a separate translation unit
+    if (g.shard_size()==0) g << "static ";
+    g << signature(fname) << " {\n";
 
     // Reset local variables, flush buffer
     g.flush(g.body);
@@ -3841,7 +4051,7 @@ namespace casadi {
 
   void FunctionInternal::serialize_body(SerializingStream& s) const {
     ProtoFunction::serialize_body(s);
-    s.version("FunctionInternal", 6);
+    s.version("FunctionInternal", 9);
     s.pack("FunctionInternal::is_diff_in", is_diff_in_);
     s.pack("FunctionInternal::is_diff_out", is_diff_out_);
     s.pack("FunctionInternal::sp_in", sparsity_in_);
@@ -3864,6 +4074,9 @@ namespace casadi {
     s.pack("FunctionInternal::jit_base_name", jit_base_name_);
     s.pack("FunctionInternal::jit_options", jit_options_);
     s.pack("FunctionInternal::compiler_plugin", compiler_plugin_);
+    s.pack("FunctionInternal::jit_cache", jit_cache_);
+    s.pack("FunctionInternal::jit_cache_size", jit_cache_size_);
+    s.pack("FunctionInternal::jit_shard_size", jit_shard_size_);
     s.pack("FunctionInternal::has_refcount", has_refcount_);
 
     s.pack("FunctionInternal::cache_init", cache_init_);
@@ -3883,6 +4096,8 @@ namespace casadi {
 
     s.pack("FunctionInternal::ad_weight", ad_weight_);
     s.pack("FunctionInternal::ad_weight_sp", ad_weight_sp_);
+    s.pack("FunctionInternal::sparsity_threads", sparsity_threads_);
+    s.pack("FunctionInternal::jac_threads", jac_threads_);
     s.pack("FunctionInternal::always_inline", always_inline_);
     s.pack("FunctionInternal::never_inline", never_inline_);
 
@@ -3917,7 +4132,7 @@ namespace casadi {
   }
 
   FunctionInternal::FunctionInternal(DeserializingStream& s) : ProtoFunction(s) {
-    int version = s.version("FunctionInternal", 1, 6);
+    int version = s.version("FunctionInternal", 1, 9);
     s.unpack("FunctionInternal::is_diff_in", is_diff_in_);
     s.unpack("FunctionInternal::is_diff_out", is_diff_out_);
     s.unpack("FunctionInternal::sp_in", sparsity_in_);
@@ -3953,6 +4168,14 @@ namespace casadi {
     s.unpack("FunctionInternal::jit_base_name", jit_base_name_);
     s.unpack("FunctionInternal::jit_options", jit_options_);
     s.unpack("FunctionInternal::compiler_plugin", compiler_plugin_);
+    if (version >= 9) {
+      s.unpack("FunctionInternal::jit_cache", jit_cache_);
+      s.unpack("FunctionInternal::jit_cache_size", jit_cache_size_);
+      s.unpack("FunctionInternal::jit_shard_size", jit_shard_size_);
+    } else {
+      jit_cache_size_ = 1073741824;
+      jit_shard_size_ = 0;
+    }
     s.unpack("FunctionInternal::has_refcount", has_refcount_);
 
     if (version >= 6) {
@@ -3974,6 +4197,16 @@ namespace casadi {
 
     s.unpack("FunctionInternal::ad_weight", ad_weight_);
     s.unpack("FunctionInternal::ad_weight_sp", ad_weight_sp_);
+    if (version >= 7) {
+      s.unpack("FunctionInternal::sparsity_threads", sparsity_threads_);
+    } else {
+      sparsity_threads_ = 1;
+    }
+    if (version >= 8) {
+      s.unpack("FunctionInternal::jac_threads", jac_threads_);
+    } else {
+      jac_threads_ = 1;
+    }
     s.unpack("FunctionInternal::always_inline", always_inline_);
     s.unpack("FunctionInternal::never_inline", never_inline_);
 
@@ -4061,6 +4294,9 @@ namespace casadi {
     {"External", External::deserialize},
     {"Conic", Conic::deserialize},
     {"FmuFunction", FmuFunction::deserialize},
+    {"EdgePushing", EdgePushing::deserialize},
+    {"TapeAD", TapeAD::deserialize},
+    {"MapAccum", MapAccum::deserialize},
   };
 
 } // namespace casadi
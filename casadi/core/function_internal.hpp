@@ -365,6 +365,12 @@ namespace casadi {
     virtual bool has_sprev() const { return false;}
     ///@}
 
+    /** \brief Can seeds be propagated concurrently, using one memory object per thread?
+
+        Not the case if the propagation reaches other functions, whose memory
+        objects and cached sparsity patterns are shared. */
+    virtual bool has_sp_threads() const { return false;}
+
     ///@{
     /** \brief  Evaluate numerically
 
@@ -879,6 +885,9 @@ namespace casadi {
         \identifier{m4} */
     virtual void jit_dependencies(const std::string& fname) {}
 
+    /** \brief Load compiled code from the persistent jit cache, compiling on a miss */
+    void jit_cached(const std::string& source_file, const Dict& jit_options);
+
     /** \brief Export function in a specific language
 
         \identifier{m5} */
@@ -986,6 +995,12 @@ namespace casadi {
     /// Convert from compact Jacobian sparsity pattern
     Sparsity from_compact(casadi_int oind, casadi_int iind, const Sparsity& sp) const;
 
+    /// Number of threads to use for n_task tasks, n_req requested, nonpositive for any
+    static casadi_int num_threads(casadi_int n_req, casadi_int n_task);
+
+    /// Number of threads to use for a given number of sparsity propagation sweeps
+    casadi_int sparsity_num_threads(casadi_int nsweep) const;
+
     /// Get the sparsity pattern via sparsity seed propagation
     template<bool fwd>
     Sparsity get_jac_sparsity_gen(casadi_int oind, casadi_int iind) const;
@@ -1252,6 +1267,18 @@ namespace casadi {
         \identifier{nj} */
     bool jit_temp_suffix_;
 
+    /** \brief Directory of the persistent jit cache, empty if disabled */
+    std::string jit_cache_;
+
+    /** \brief Size limit of the persistent jit cache in bytes */
+    casadi_int jit_cache_size_;
+
+    /** \brief Approximate size of jit source files, 0 for a single file */
+    casadi_int jit_shard_size_;
+
+    /** \brief Additional jit source files */
+    std::vector<std::string> jit_shard_files_;
+
     /** \brief Numerical evaluation redirected to a C function
 
         \identifier{nk} */
@@ -1309,6 +1336,12 @@ namespace casadi {
     /// Weighting factor for derivative calculation and sparsity pattern calculation
     double ad_weight_, ad_weight_sp_;
 
+    /// Number of threads for sparsity pattern propagation, nonpositive for as many as possible
+    casadi_int sparsity_threads_;
+
+    /// Number of threads for symbolic Jacobian construction, nonpositive for as many as possible
+    casadi_int jac_threads_;
+
     /// Maximum number of sensitivity directions
     casadi_int max_num_dir_;
 
@@ -60,6 +60,14 @@ namespace casadi {
           \identifier{17v} */
       static bool simplification_on_the_fly;
 
+      /** \brief Indicates whether new SX operations are looked up among existing ones
+
+      * When enabled, creating an operation structurally identical to a live one,
+      * i.e. same operation and same dependency nodes, returns the existing node.
+      * Default: false
+      */
+      static bool hash_consing;
+
       static std::string casadipath;
 
       static std::string casadi_include_path;
@@ -68,6 +76,8 @@ namespace casadi {
 
       static casadi_int max_num_dir;
 
+      static casadi_int max_num_threads;
+
       static casadi_int start_index;
 
       static bool julia_initialized;
@@ -77,6 +87,10 @@ namespace casadi {
       static void setSimplificationOnTheFly(bool flag) { simplification_on_the_fly = flag; }
       static bool getSimplificationOnTheFly() { return simplification_on_the_fly; }
 
+      // Setter and getter for hash_consing
+      static void setHashConsing(bool flag) { hash_consing = flag; }
+      static bool getHashConsing() { return hash_consing; }
+
       // Setter and getter for hierarchical_sparsity
       static void setHierarchicalSparsity(bool flag) { hierarchical_sparsity = flag; }
       static bool getHierarchicalSparsity() { return hierarchical_sparsity; }
@@ -90,6 +104,11 @@ namespace casadi {
       static void setMaxNumDir(casadi_int ndir) { max_num_dir=ndir; }
       static casadi_int getMaxNumDir() { return max_num_dir; }
 
+      // Setter and getter for the maximum number of threads used for parallel evaluation
+      // (e.g. map with "thread" parallelization). Zero means hardware concurrency
+      static void setMaxNumThreads(casadi_int n) { max_num_threads=n; }
+      static casadi_int getMaxNumThreads() { return max_num_threads; }
+
   };
 
 } // namespace casadi
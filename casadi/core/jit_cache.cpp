@@ -0,0 +1,178 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "jit_cache.hpp"
+#include "casadi_os.hpp"
+#include "casadi_meta.hpp"
+#include "casadi_misc.hpp"
+#include <casadi/config.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace casadi {
+
+  JitCache::JitCache(const std::string& directory, casadi_int max_size)
+      : directory_(directory), max_size_(max_size) {
+    casadi_assert(!directory_.empty(), "JIT cache directory must not be empty");
+    char last = directory_.back();
+    if (last!='/' && last!='\\') directory_ += filesep();
+  }
+
+  std::string JitCache::key(const std::string& source, const std::string& compiler,
+                            const Dict& opts) {
+    std::stringstream ss;
+    ss << "casadi " << CasadiMeta::version() << " " << CasadiMeta::git_revision() << "\n";
+    ss << "compiler " << compiler << "\n";
+    for (auto&& op : opts) {
+      // Options that do not affect the compiled library
+      // (the contents of additional sources are part of the source)
+      if (op.first=="directory" || op.first=="name" || op.first=="temp_suffix"
+          || op.first=="cleanup" || op.first=="verbose" || op.first=="jobs"
+          || op.first=="extra_sources") continue;
+      ss << "option " << op.first << " " << op.second << "\n";
+    }
+    ss << source;
+    return ss.str();
+  }
+
+  std::string JitCache::hash(const std::string& key) {
+    // 64-bit FNV-1a, stable across platforms and processes
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : key) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 1099511628211ULL;
+    }
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return ss.str();
+  }
+
+  std::string JitCache::path(const std::string& hash, const std::string& suffix) const {
+    return directory_ + "jit_" + hash + suffix;
+  }
+
+#ifdef WITH_DL
+  std::string JitCache::lookup(const std::string& key) const {
+    std::string h = hash(key);
+    std::string library = path(h, SHARED_LIBRARY_SUFFIX);
+    double size, mtime;
+    if (!file_stat(library, size, mtime)) return "";
+    // Compare the full key
+    std::ifstream f(path(h, ".key"), std::ios_base::binary);
+    if (!f.good()) return "";
+    std::stringstream stored;
+    stored << f.rdbuf();
+    if (stored.str()!=key) return "";
+    // Mark as recently used
+    file_touch(library);
+    return library;
+  }
+
+  std::string JitCache::insert(const std::string& key, const std::string& library) const {
+    if (!ensure_directory(directory_)) return "";
+    std::string h = hash(key);
+    // Key file first: a library is only ever visible next to its key
+    std::string tmp = temporary_file(path(h, ".tmp"), ".key");
+    {
+      std::ofstream f(tmp, std::ios_base::binary);
+      f << key;
+      if (!f.good()) {
+        remove(tmp.c_str());
+        return "";
+      }
+    }
+    if (!file_rename(tmp, path(h, ".key"))) return "";
+    // Copy the library
+    std::string ret = path(h, SHARED_LIBRARY_SUFFIX);
+    tmp = temporary_file(path(h, ".tmp"), SHARED_LIBRARY_SUFFIX);
+    {
+      std::ifstream src(library, std::ios_base::binary);
+      std::ofstream dst(tmp, std::ios_base::binary);
+      dst << src.rdbuf();
+      if (!src.good() || !dst.good()) {
+        dst.close();
+        remove(tmp.c_str());
+        return "";
+      }
+    }
+    if (!file_rename(tmp, ret)) return "";
+    // Enforce the size limit
+    evict(h);
+    return ret;
+  }
+#else // WITH_DL
+  std::string JitCache::lookup(const std::string& key) const {
+    return "";
+  }
+
+  std::string JitCache::insert(const std::string& key, const std::string& library) const {
+    return "";
+  }
+#endif // WITH_DL
+
+  void JitCache::evict(const std::string& keep) const {
+    if (max_size_<=0) return;
+    // Group the files of the cache by hash
+    struct Entry {
+      double size, mtime;
+      std::vector<std::string> files;
+    };
+    std::map<std::string, Entry> entries;
+    double total = 0;
+    for (const std::string& name : directory_files(directory_)) {
+      if (name.size() < 4 + 16 || name.compare(0, 4, "jit_")) continue;
+      double size, mtime;
+      if (!file_stat(directory_ + name, size, mtime)) continue;
+      Entry& e = entries[name.substr(4, 16)];
+      if (e.files.empty()) e.size = e.mtime = 0;
+      e.size += size;
+      e.mtime = std::max(e.mtime, mtime);
+      // Library first
+      if (name.find(".key")==std::string::npos) {
+        e.files.insert(e.files.begin(), name);
+      } else {
+        e.files.push_back(name);
+      }
+      total += size;
+    }
+    if (total <= max_size_) return;
+    // Least recently used first
+    std::vector<std::pair<double, std::string> > order;
+    for (auto&& e : entries) {
+      if (e.first!=keep) order.push_back(std::make_pair(e.second.mtime, e.first));
+    }
+    std::sort(order.begin(), order.end());
+    for (auto&& o : order) {
+      if (total <= max_size_) break;
+      const Entry& e = entries[o.second];
+      for (const std::string& name : e.files) remove((directory_ + name).c_str());
+      total -= e.size;
+    }
+  }
+
+} // namespace casadi
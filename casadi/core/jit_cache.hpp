@@ -0,0 +1,92 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_JIT_CACHE_HPP
+#define CASADI_JIT_CACHE_HPP
+
+#include "casadi_common.hpp"
+#include "generic_type.hpp"
+
+/// \cond INTERNAL
+namespace casadi {
+
+  /** \brief Persistent, content-addressed cache of jit-compiled shared libraries
+
+      An entry consists of a key file and a shared library, named after a hash of the key.
+      The key is made up of the generated source code, the compiler plugin, the compiler
+      options and the CasADi version. The stored key file is compared in full on lookup,
+      so that hash collisions cannot result in loading the wrong library.
+
+      The directory may be shared by several processes. Files are written under
+      temporary names and moved into place by an atomic rename, the key file first, and
+      evicted library first, so that a reader never observes a partially written entry.
+      Two processes missing on the same entry simultaneously both compile it, the last
+      rename wins.
+
+      Entries are evicted, least recently used first, when the total size of the
+      directory exceeds a limit.
+  */
+  class CASADI_EXPORT JitCache {
+  public:
+    /// Constructor, max_size in bytes, non-positive for unlimited
+    JitCache(const std::string& directory, casadi_int max_size);
+
+    /// Assemble the key of a jit compilation
+    static std::string key(const std::string& source, const std::string& compiler,
+                           const Dict& opts);
+
+    /** \brief Look up the shared library of an entry
+
+        \return Path to the library, or empty string on a miss
+    */
+    std::string lookup(const std::string& key) const;
+
+    /** \brief Store a compiled shared library under a key, evicting old entries if needed
+
+        \return Path to the cached library, or empty string on failure
+    */
+    std::string insert(const std::string& key, const std::string& library) const;
+
+  private:
+    /// Path of an entry file
+    std::string path(const std::string& hash, const std::string& suffix) const;
+
+    /// Evict least recently used entries, keeping one
+    void evict(const std::string& keep) const;
+
+    /// Hash of a key, as a hexadecimal string
+    static std::string hash(const std::string& key);
+
+    // Cache directory, ending with a file separator
+    std::string directory_;
+
+    // Size limit in bytes
+    casadi_int max_size_;
+  };
+
+} // namespace casadi
+/// \endcond
+
+#endif // CASADI_JIT_CACHE_HPP
@@ -24,15 +24,9 @@
 
 
 #include "map.hpp"
+#include "sx_function.hpp"
 #include "serializing_stream.hpp"
-
-#ifdef CASADI_WITH_THREAD
-#ifdef CASADI_WITH_THREAD_MINGW
-#include <mingw.thread.h>
-#else // CASADI_WITH_THREAD_MINGW
-#include <thread>
-#endif // CASADI_WITH_THREAD_MINGW
-#endif // CASADI_WITH_THREAD
+#include "thread_pool.hpp"
 
 namespace casadi {
 
@@ -51,7 +45,7 @@ namespace casadi {
   }
 
   Map::Map(const std::string& name, const Function& f, casadi_int n)
-    : FunctionInternal(name), f_(f), n_(n) {
+    : FunctionInternal(name), f_(f), n_(n), batch_(false) {
   }
 
   bool Map::is_a(const std::string& type, bool recursive) const {
@@ -98,6 +92,11 @@ namespace casadi {
   Map::Map(DeserializingStream& s) : FunctionInternal(s) {
     s.unpack("Map::f", f_);
     s.unpack("Map::n", n_);
+
+    // Instances serialized without the work vector needed for batched evaluation
+    // are evaluated one by one
+    batch_ = f_.is_a("SXFunction") && f_.get<SXFunction>()->has_eval_batch()
+      && sz_w() >= f_.sz_w()*SXFunction::batch_width;
   }
 
   ProtoFunction* Map::deserialize(DeserializingStream& s) {
@@ -129,6 +128,10 @@ namespace casadi {
     alloc_res(f_.sz_res());
     alloc_w(f_.sz_w());
     alloc_iw(f_.sz_iw());
+
+    // Evaluate SXFunction instances in groups, using a structure-of-arrays work vector
+    batch_ = f_.is_a("SXFunction") && f_.get<SXFunction>()->has_eval_batch();
+    if (batch_) alloc_w(f_.sz_w()*SXFunction::batch_width);
   }
 
   template<typename T>
@@ -315,6 +318,9 @@ namespace casadi {
   }
 
   int Map::eval(const double** arg, double** res, casadi_int* iw, double* w, void* mem) const {
+    // Batched evaluation of SXFunction instances
+    if (batch_) return f_.get<SXFunction>()->eval_batch(arg, res, iw, w, n_);
+
     // This checkout/release dance is an optimization.
     // Could also use the thread-safe variant f_(arg1, res1, iw, w)
     // in Map::eval_gen
@@ -423,6 +429,7 @@ namespace casadi {
 
   void ThreadsWork(const Function& f, casadi_int i,
       const double** arg, double** res,
+      const double** arg1, double** res1,
       casadi_int* iw, double* w,
       casadi_int ind, int& ret) {
 
@@ -430,24 +437,18 @@ namespace casadi {
     casadi_int n_in = f.n_in();
     casadi_int n_out = f.n_out();
 
-    // Function work sizes
-    size_t sz_arg, sz_res, sz_iw, sz_w;
-    f.sz_work(sz_arg, sz_res, sz_iw, sz_w);
-
     // Input buffers
-    const double** arg1 = arg + n_in + i*sz_arg;
     for (casadi_int j=0; j<n_in; ++j) {
       arg1[j] = arg[j] ? arg[j] + i*f.nnz_in(j) : nullptr;
     }
 
     // Output buffers
-    double** res1 = res + n_out + i*sz_res;
     for (casadi_int j=0; j<n_out; ++j) {
       res1[j] = res[j] ? res[j] + i*f.nnz_out(j) : nullptr;
     }
 
     try {
-      ret = f(arg1, res1, iw + i*sz_iw, w + i*sz_w, ind);
+      ret = f(arg1, res1, iw, w, ind);
     } catch (std::exception& e) {
       ret = 1;
       casadi_warning("Exception raised: " + std::string(e.what()));
@@ -463,35 +464,27 @@ namespace casadi {
 #ifndef CASADI_WITH_THREAD
     return Map::eval(arg, res, iw, w, mem);
 #else // CASADI_WITH_THREAD
-    // Checkout memory objects
-    std::vector< scoped_checkout<Function> > ind; ind.reserve(n_);
-    for (casadi_int i=0; i<n_; ++i) ind.emplace_back(f_);
+    auto m = static_cast<ThreadMapMemory*>(mem);
 
-    // Allocate space for return values
-    std::vector<int> ret_values(n_);
+    // Function work sizes
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    f_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
 
-    // Spawn threads
-    std::vector<std::thread> threads;
-    for (casadi_int i=0; i<n_; ++i) {
-      // Why the lambda function?
-      // Because it was the first iteration to pass tests on MingGW
-      // using mingw-std-threads.
-      threads.emplace_back(
-        [i](const Function& f, const double** arg, double** res,
-            casadi_int* iw, double* w, casadi_int ind, int& ret) {
-              ThreadsWork(f, i, arg, res, iw, w, ind, ret);
-            },
-        std::ref(f_), arg, res, iw, w, casadi_int(ind[i]), std::ref(ret_values[i]));
-    }
+    // Checkout memory objects, one for each thread
+    std::vector< scoped_checkout<Function> > ind; ind.reserve(m->n_thread);
+    for (casadi_int t=0; t<m->n_thread; ++t) ind.emplace_back(f_);
 
-    // Join threads
-    for (auto && th : threads) th.join();
+    // Evaluate instances using the thread pool
+    ThreadPool::run(n_, m->n_thread, [&](casadi_int i, casadi_int t) {
+      ThreadsWork(f_, i, arg, res, get_ptr(m->arg) + t*sz_arg, get_ptr(m->res) + t*sz_res,
+        get_ptr(m->iw) + t*sz_iw, get_ptr(m->w) + t*sz_w, ind[t], m->ret[i]);
+    });
 
     // Anticipate success
     int ret = 0;
 
     // Compute aggregate return value
-    for (int e : ret_values) ret = ret || e;
+    for (int e : m->ret) ret = ret || e;
 
     return ret;
 #endif // CASADI_WITH_THREAD
@@ -509,14 +502,25 @@ namespace casadi {
     // Call the initialization method of the base class
     Map::init(opts);
 
-    // Allocate memory for holding memory object references
-    alloc_iw(n_, true);
+    // Work memory for parallel evaluation is allocated in the memory object
+  }
 
-    // Allocate sufficient memory for parallel evaluation
-    alloc_arg(f_.sz_arg() * n_);
-    alloc_res(f_.sz_res() * n_);
-    alloc_w(f_.sz_w() * n_);
-    alloc_iw(f_.sz_iw() * n_);
+  int ThreadMap::init_mem(void* mem) const {
+    if (Map::init_mem(mem)) return 1;
+    auto m = static_cast<ThreadMapMemory*>(mem);
+
+    // Number of participating threads
+    m->n_thread = std::min(n_, ThreadPool::max_num_threads());
+
+    // Allocate sufficient memory for each thread
+    size_t sz_arg, sz_res, sz_iw, sz_w;
+    f_.sz_work(sz_arg, sz_res, sz_iw, sz_w);
+    m->arg.resize(sz_arg * m->n_thread);
+    m->res.resize(sz_res * m->n_thread);
+    m->iw.resize(sz_iw * m->n_thread);
+    m->w.resize(sz_w * m->n_thread);
+    m->ret.resize(n_);
+    return 0;
   }
 
 } // namespace casadi
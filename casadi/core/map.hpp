@@ -212,6 +212,9 @@ namespace casadi {
 
     // Number of times to evaluate this function
     casadi_int n_;
+
+    // Evaluate all instances simultaneously, cf. SXFunction::eval_batch
+    bool batch_;
   };
 
   /** A map Evaluate in parallel using OpenMP
@@ -265,10 +268,27 @@ namespace casadi {
     explicit OmpMap(DeserializingStream& s) : Map(s) {}
   };
 
+  /** \brief Memory for ThreadMap
+
+      Work memory for each of the threads participating in the evaluation
+  */
+  struct CASADI_EXPORT ThreadMapMemory : public FunctionMemory {
+    // Number of participating threads
+    casadi_int n_thread;
+    // Work vectors, n_thread times the work vectors of the mapped function
+    std::vector<const double*> arg;
+    std::vector<double*> res;
+    std::vector<casadi_int> iw;
+    std::vector<double> w;
+    // Return flag for each instance
+    std::vector<int> ret;
+  };
+
   /** A map Evaluate in parallel using std::thread
-      Note: Do not use this class with much more than the intended number of
-      threads for the parallel evaluation as it will cause excessive memory use.
 
+      Instances are evaluated by the process-wide ThreadPool. Work memory is
+      allocated for each participating thread, at most GlobalOptions::max_num_threads
+      (default: hardware concurrency), rather than for each instance.
       \author Joris Gillis
       \date 2018
   */
@@ -304,6 +324,18 @@ namespace casadi {
     /// Type of parallellization
     std::string parallelization() const override { return "thread"; }
 
+    /** \brief Create memory block
+    */
+    void* alloc_mem() const override { return new ThreadMapMemory();}
+
+    /** \brief Initalize memory block
+    */
+    int init_mem(void* mem) const override;
+
+    /** \brief Free memory block
+    */
+    void free_mem(void *mem) const override { delete static_cast<ThreadMapMemory*>(mem);}
+
     /** \brief Generate code for the body of the C function
 
         \identifier{hy} */
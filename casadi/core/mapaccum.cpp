@@ -0,0 +1,523 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "mapaccum.hpp"
+#include "serializing_stream.hpp"
+
+namespace casadi {
+
+  MapAccum::MapAccum(const std::string& name, const Function& f, casadi_int n,
+      casadi_int n_accum, casadi_int checkpoints, CheckpointSchedule schedule, casadi_int nadj)
+    : FunctionInternal(name), f_(f), n_(n), n_accum_(n_accum), checkpoints_(checkpoints),
+      schedule_(schedule), nadj_(nadj) {
+  }
+
+  Function MapAccum::create(const std::string& name, const Function& f, casadi_int n,
+      casadi_int n_accum, casadi_int checkpoints, const std::string& schedule,
+      const Dict& opts) {
+    casadi_assert(n>0, "mapaccum: N must be positive");
+    casadi_assert(n_accum<=std::min(f.n_in(), f.n_out()), "mapaccum: too many accumulators");
+    casadi_assert(checkpoints>=0, "mapaccum: number of checkpoints must be nonnegative");
+    CheckpointSchedule sched;
+    if (schedule=="binomial") {
+      sched = CheckpointSchedule::BINOMIAL;
+    } else if (schedule=="equidistant") {
+      sched = CheckpointSchedule::EQUIDISTANT;
+    } else {
+      casadi_error("Unknown checkpoint schedule: " + schedule
+        + ". Options are 'binomial' and 'equidistant'");
+    }
+    Function ret;
+    ret.own(new MapAccum(name, f, n, n_accum, checkpoints, sched));
+    ret->name_in_ = f.name_in();
+    ret->name_out_ = f.name_out();
+    ret->construct(opts);
+    return ret;
+  }
+
+  MapAccum::~MapAccum() {
+    clear_mem();
+  }
+
+  bool MapAccum::is_a(const std::string& type, bool recursive) const {
+    return type=="MapAccum"
+      || (recursive && FunctionInternal::is_a(type, recursive));
+  }
+
+  std::vector<std::string> MapAccum::get_function() const {
+    if (nadj_==0) return {"f"};
+    return {"f", "fr"};
+  }
+
+  const Function& MapAccum::get_function(const std::string &name) const {
+    casadi_assert(has_function(name),
+      "No function \"" + name + "\" in " + name_ + ". " +
+      "Available functions: " + join(get_function()) + ".");
+    return name=="f" ? f_ : fr_;
+  }
+
+  bool MapAccum::has_function(const std::string& fname) const {
+    return fname=="f" || (nadj_>0 && fname=="fr");
+  }
+
+  size_t MapAccum::get_n_in() {
+    return nadj_==0 ? f_.n_in() : f_.n_in() + 2*f_.n_out();
+  }
+
+  size_t MapAccum::get_n_out() {
+    return nadj_==0 ? f_.n_out() : f_.n_in();
+  }
+
+  Sparsity MapAccum::get_sparsity_in(casadi_int i) {
+    casadi_int n_in = f_.n_in(), n_out = f_.n_out();
+    if (i<n_accum_) {
+      // Initial state
+      return f_.sparsity_in(i);
+    } else if (i<n_in) {
+      // Stacked input
+      return repmat(f_.sparsity_in(i), 1, n_);
+    } else if (i<n_in+n_out) {
+      // Non-differentiated output, not used
+      i -= n_in;
+      return Sparsity(f_.size1_out(i), n_*f_.size2_out(i));
+    } else {
+      // Adjoint seeds
+      return repmat(f_.sparsity_out(i-n_in-n_out), 1, n_*nadj_);
+    }
+  }
+
+  Sparsity MapAccum::get_sparsity_out(casadi_int i) {
+    if (nadj_==0) {
+      return repmat(f_.sparsity_out(i), 1, n_);
+    } else if (i<n_accum_) {
+      return repmat(f_.sparsity_in(i), 1, nadj_);
+    } else {
+      return repmat(f_.sparsity_in(i), 1, n_*nadj_);
+    }
+  }
+
+  double MapAccum::get_default_in(casadi_int ind) const {
+    return ind<f_.n_in() ? f_.default_in(ind) : 0;
+  }
+
+  Dict MapAccum::info() const {
+    std::string schedule = schedule_==CheckpointSchedule::BINOMIAL ? "binomial" : "equidistant";
+    return {{"f", f_}, {"n", n_}, {"n_accum", n_accum_}, {"checkpoints", checkpoints_},
+      {"schedule", schedule}, {"nadj", nadj_}};
+  }
+
+  void MapAccum::init(const Dict& opts) {
+    // Call the initialization method of the base class
+    FunctionInternal::init(opts);
+
+    // State passed from one call to the next
+    for (casadi_int i=0; i<n_accum_; ++i) {
+      casadi_assert(f_.sparsity_out(i)==f_.sparsity_in(i),
+        "mapaccum: sparsity of accumulated output " + str(i) + " must match that of the "
+        "corresponding input for checkpointing");
+    }
+
+    // Nonzero offsets
+    x_off_.resize(1, 0);
+    for (casadi_int i=0; i<n_accum_; ++i) x_off_.push_back(x_off_.back() + f_.nnz_in(i));
+    in_off_.resize(1, 0);
+    for (casadi_int i=0; i<f_.n_in(); ++i) in_off_.push_back(in_off_.back() + f_.nnz_in(i));
+    out_off_.resize(1, 0);
+    for (casadi_int i=0; i<f_.n_out(); ++i) out_off_.push_back(out_off_.back() + f_.nnz_out(i));
+    casadi_int nx = x_off_.back();
+
+    // Work vectors for calling f
+    alloc(f_);
+
+    if (nadj_==0) {
+      // Current and next state
+      alloc_w(2*nx, true);
+    } else {
+      // Work vectors for calling the derivative of f
+      if (fr_.is_null()) fr_ = f_.reverse(nadj_);
+      alloc(fr_);
+      // Stored states
+      casadi_int n_snap = checkpoints_ + 1;
+      if (schedule_==CheckpointSchedule::EQUIDISTANT) n_snap += (n_ + checkpoints_) / n_snap;
+      // Stored states, temporary states, outputs, seeds and sensitivities of one call,
+      // adjoint state
+      alloc_w((n_snap+3)*nx + (1+nadj_)*out_off_.back() + nadj_*in_off_.back() + nadj_*nx,
+        true);
+      if (verbose_) {
+        casadi_message(name_ + ": " + str(n_snap) + " stored states of " + str(nx)
+          + " nonzeros for " + str(n_) + " steps");
+      }
+    }
+  }
+
+  template<typename T>
+  int MapAccum::eval_gen(const T** arg, T** res, casadi_int* iw, T* w, int mem) const {
+    casadi_int nx = x_off_.back();
+    T* x = w;
+    T* x_next = w + nx;
+    w += 2*nx;
+    const T** arg1 = arg+n_in_;
+    T** res1 = res+n_out_;
+    // Initial state
+    for (casadi_int i=0; i<n_accum_; ++i) {
+      if (arg[i]) {
+        std::copy_n(arg[i], f_.nnz_in(i), x + x_off_[i]);
+      } else {
+        std::fill_n(x + x_off_[i], f_.nnz_in(i), T(0));
+      }
+    }
+    for (casadi_int k=0; k<n_; ++k) {
+      for (casadi_int i=0; i<n_in_; ++i) {
+        if (i<n_accum_) {
+          arg1[i] = x + x_off_[i];
+        } else {
+          arg1[i] = arg[i] ? arg[i] + k*f_.nnz_in(i) : nullptr;
+        }
+      }
+      for (casadi_int i=0; i<n_out_; ++i) {
+        if (i<n_accum_) {
+          res1[i] = x_next + x_off_[i];
+        } else {
+          res1[i] = res[i] ? res[i] + k*f_.nnz_out(i) : nullptr;
+        }
+      }
+      if (f_(arg1, res1, iw, w, mem)) return 1;
+      // Save the next state
+      for (casadi_int i=0; i<n_accum_; ++i) {
+        if (res[i]) std::copy_n(x_next + x_off_[i], f_.nnz_out(i), res[i] + k*f_.nnz_out(i));
+      }
+      std::swap(x, x_next);
+    }
+    return 0;
+  }
+
+  int MapAccum::eval_sx(const SXElem** arg, SXElem** res, casadi_int* iw, SXElem* w,
+      void* mem) const {
+    casadi_assert(nadj_==0, "Symbolic evaluation of the checkpointed reverse sweep "
+      "not supported");
+    return eval_gen(arg, res, iw, w);
+  }
+
+  int MapAccum::sp_forward(const bvec_t** arg, bvec_t** res,
+      casadi_int* iw, bvec_t* w, void* mem) const {
+    return eval_gen(arg, res, iw, w);
+  }
+
+  int MapAccum::sp_reverse(bvec_t** arg, bvec_t** res, casadi_int* iw, bvec_t* w,
+      void* mem) const {
+    casadi_int nx = x_off_.back();
+    // Dependencies on the current state and on the next state
+    bvec_t* lam = w;
+    bvec_t* lam_next = w + nx;
+    w += 2*nx;
+    std::fill_n(lam, nx, 0);
+    bvec_t** arg1 = arg+n_in_;
+    bvec_t** res1 = res+n_out_;
+    for (casadi_int k=n_-1; k>=0; --k) {
+      // Seeds of the next state: the output and the later calls
+      std::swap(lam, lam_next);
+      for (casadi_int i=0; i<n_accum_; ++i) {
+        if (!res[i]) continue;
+        bvec_t* r = res[i] + k*f_.nnz_out(i);
+        for (casadi_int j=0; j<f_.nnz_out(i); ++j) {
+          lam_next[x_off_[i]+j] |= r[j];
+          r[j] = 0;
+        }
+      }
+      std::fill_n(lam, nx, 0);
+      for (casadi_int i=0; i<n_in_; ++i) {
+        if (i<n_accum_) {
+          arg1[i] = lam + x_off_[i];
+        } else {
+          arg1[i] = arg[i] ? arg[i] + k*f_.nnz_in(i) : nullptr;
+        }
+      }
+      for (casadi_int i=0; i<n_out_; ++i) {
+        if (i<n_accum_) {
+          res1[i] = lam_next + x_off_[i];
+        } else {
+          res1[i] = res[i] ? res[i] + k*f_.nnz_out(i) : nullptr;
+        }
+      }
+      if (f_.rev(arg1, res1, iw, w)) return 1;
+    }
+    // Dependencies on the initial state
+    for (casadi_int i=0; i<n_accum_; ++i) {
+      if (arg[i]) {
+        for (casadi_int j=0; j<f_.nnz_in(i); ++j) arg[i][j] |= lam[x_off_[i]+j];
+      }
+    }
+    return 0;
+  }
+
+  int MapAccum::step(RevWork& m, casadi_int k, const double* x, double* x_next,
+      double* y) const {
+    for (casadi_int i=0; i<f_.n_in(); ++i) {
+      if (i<n_accum_) {
+        m.arg[i] = x + x_off_[i];
+      } else {
+        m.arg[i] = m.map_arg[i] ? m.map_arg[i] + k*f_.nnz_in(i) : nullptr;
+      }
+    }
+    for (casadi_int i=0; i<f_.n_out(); ++i) {
+      if (y) {
+        m.res[i] = y + out_off_[i];
+      } else if (i<n_accum_) {
+        m.res[i] = x_next + x_off_[i];
+      } else {
+        m.res[i] = nullptr;
+      }
+    }
+    return f_(m.arg, m.res, m.iw, m.w, m.mem_f);
+  }
+
+  int MapAccum::advance(RevWork& m, casadi_int k0, casadi_int k1, const double* x, double* x1,
+      double* tmp) const {
+    casadi_int nx = x_off_.back();
+    if (k0==k1) {
+      std::copy_n(x, nx, x1);
+      return 0;
+    }
+    for (casadi_int k=k0; k<k1; ++k) {
+      // Alternate between the two temporary states, the last step writes to x1
+      double* x_next = k==k1-1 ? x1 : tmp + ((k-k0)%2)*nx;
+      if (step(m, k, x, x_next, nullptr)) return 1;
+      x = x_next;
+    }
+    return 0;
+  }
+
+  int MapAccum::reverse_step(RevWork& m, casadi_int k, const double* x) const {
+    casadi_int n_in = f_.n_in(), n_out = f_.n_out();
+    // Outputs of the call, used by the derivative
+    if (step(m, k, x, nullptr, m.y)) return 1;
+    // Adjoint seeds: the stacked seeds and, for the next state, the adjoint of the later calls
+    for (casadi_int i=0; i<n_out; ++i) {
+      casadi_int nnz = f_.nnz_out(i);
+      double* seed = m.seed + nadj_*out_off_[i];
+      for (casadi_int d=0; d<nadj_; ++d) {
+        if (m.map_seed[i]) {
+          std::copy_n(m.map_seed[i] + (d*n_ + k)*nnz, nnz, seed + d*nnz);
+        } else {
+          std::fill_n(seed + d*nnz, nnz, 0.);
+        }
+        if (i<n_accum_) {
+          const double* lam = m.lam + nadj_*x_off_[i] + d*nnz;
+          for (casadi_int j=0; j<nnz; ++j) seed[d*nnz + j] += lam[j];
+        }
+      }
+    }
+    // Call the derivative, the nondifferentiated inputs are already in place
+    for (casadi_int i=0; i<n_out; ++i) {
+      m.arg[n_in + i] = m.y + out_off_[i];
+      m.arg[n_in + n_out + i] = m.seed + nadj_*out_off_[i];
+    }
+    for (casadi_int i=0; i<n_in; ++i) m.res[i] = m.sens + nadj_*in_off_[i];
+    if (fr_(m.arg, m.res, m.iw, m.w, m.mem_fr)) return 1;
+    // Adjoint of the state, sensitivities of the stacked inputs
+    for (casadi_int i=0; i<n_in; ++i) {
+      casadi_int nnz = f_.nnz_in(i);
+      const double* sens = m.sens + nadj_*in_off_[i];
+      if (i<n_accum_) {
+        std::copy_n(sens, nadj_*nnz, m.lam + nadj_*x_off_[i]);
+      } else if (m.map_sens[i]) {
+        for (casadi_int d=0; d<nadj_; ++d) {
+          std::copy_n(sens + d*nnz, nnz, m.map_sens[i] + (d*n_ + k)*nnz);
+        }
+      }
+    }
+    return 0;
+  }
+
+  // Number of steps that can be reversed with s stored states and t recomputations,
+  // binomial coefficient (s+t, s), not exceeding bound
+  static casadi_int binomial_steps(casadi_int s, casadi_int t, casadi_int bound) {
+    if (t<s) std::swap(s, t);
+    casadi_int b = 1;
+    for (casadi_int i=1; i<=s; ++i) {
+      b = b*(t+i)/i;
+      if (b>=bound) return bound;
+    }
+    return b;
+  }
+
+  int MapAccum::reverse_binomial(RevWork& m, casadi_int l, casadi_int r, double* snap,
+      casadi_int s, double* tmp) const {
+    casadi_int nx = x_off_.back();
+    while (true) {
+      casadi_int n = r-l;
+      if (n==1) return reverse_step(m, l, snap);
+      if (s==0) {
+        // No storage left: recompute each state from the stored one
+        double* x = tmp + 2*nx;
+        for (casadi_int k=r-1; k>=l; --k) {
+          if (advance(m, l, k, snap, x, tmp)) return 1;
+          if (reverse_step(m, k, x)) return 1;
+        }
+        return 0;
+      }
+      // Smallest number of recomputations t for which n steps can be reversed
+      casadi_int t = 0;
+      while (binomial_steps(s, t, n)<n) t++;
+      // Store a state such that the steps before it can be reversed with one recomputation
+      // less and the steps after it with one stored state less
+      casadi_int mid = l + std::min(binomial_steps(s, t-1, n), n-1);
+      if (advance(m, l, mid, snap, snap + nx, tmp)) return 1;
+      if (reverse_binomial(m, mid, r, snap + nx, s-1, tmp)) return 1;
+      r = mid;
+    }
+  }
+
+  int MapAccum::eval(const double** arg, double** res, casadi_int* iw, double* w,
+      void* mem) const {
+    scoped_checkout<Function> mem_f(f_);
+    if (nadj_==0) return eval_gen(arg, res, iw, w, mem_f);
+
+    // Reverse sweep
+    scoped_checkout<Function> mem_fr(fr_);
+    casadi_int n_in = f_.n_in(), n_out = f_.n_out(), nx = x_off_.back();
+    casadi_int n_snap = checkpoints_ + 1;
+    if (schedule_==CheckpointSchedule::EQUIDISTANT) n_snap += (n_ + checkpoints_) / n_snap;
+    RevWork m;
+    m.map_arg = arg;
+    m.map_seed = arg + n_in + n_out;
+    m.map_sens = res;
+    m.arg = arg + n_in_;
+    m.res = res + n_out_;
+    m.iw = iw;
+    m.mem_f = mem_f;
+    m.mem_fr = mem_fr;
+    double* snap = w;
+    w += n_snap*nx;
+    double* tmp = w;
+    w += 3*nx;
+    m.y = w;
+    w += out_off_.back();
+    m.seed = w;
+    w += nadj_*out_off_.back();
+    m.sens = w;
+    w += nadj_*in_off_.back();
+    m.lam = w;
+    w += nadj_*nx;
+    m.w = w;
+
+    // No adjoint from beyond the last call
+    std::fill_n(m.lam, nadj_*nx, 0.);
+
+    // Initial state
+    for (casadi_int i=0; i<n_accum_; ++i) {
+      if (arg[i]) {
+        std::copy_n(arg[i], f_.nnz_in(i), snap + x_off_[i]);
+      } else {
+        std::fill_n(snap + x_off_[i], f_.nnz_in(i), 0.);
+      }
+    }
+
+    if (schedule_==CheckpointSchedule::BINOMIAL) {
+      if (reverse_binomial(m, 0, n_, snap, checkpoints_, tmp)) return 1;
+    } else {
+      // Intervals between the stored states
+      casadi_int len = (n_ + checkpoints_) / (checkpoints_ + 1);
+      casadi_int n_int = (n_ + len - 1) / len;
+      for (casadi_int j=1; j<n_int; ++j) {
+        if (advance(m, (j-1)*len, j*len, snap + (j-1)*nx, snap + j*nx, tmp)) return 1;
+      }
+      // All states of an interval
+      double* x = snap + (checkpoints_ + 1)*nx;
+      for (casadi_int j=n_int-1; j>=0; --j) {
+        casadi_int k0 = j*len, k1 = std::min(n_, (j+1)*len);
+        std::copy_n(snap + j*nx, nx, x);
+        for (casadi_int k=k0; k<k1-1; ++k) {
+          if (step(m, k, x + (k-k0)*nx, x + (k-k0+1)*nx, nullptr)) return 1;
+        }
+        for (casadi_int k=k1-1; k>=k0; --k) {
+          if (reverse_step(m, k, x + (k-k0)*nx)) return 1;
+        }
+      }
+    }
+
+    // Sensitivities of the initial state
+    for (casadi_int i=0; i<n_accum_; ++i) {
+      if (res[i]) std::copy_n(m.lam + nadj_*x_off_[i], nadj_*f_.nnz_in(i), res[i]);
+    }
+    return 0;
+  }
+
+  Function MapAccum::get_forward(casadi_int nfwd, const std::string& name,
+      const std::vector<std::string>& inames,
+      const std::vector<std::string>& onames,
+      const Dict& opts) const {
+    // Forward mode does not need the intermediate states: differentiate the unrolled mapaccum
+    Function df = f_.mapaccum(name_ + "_unrolled", n_, n_accum_).forward(nfwd);
+    std::vector<MX> arg = df.mx_in();
+    Dict options = opts;
+    options["allow_duplicate_io_names"] = true;
+    return Function(name, arg, df(arg), inames, onames, options);
+  }
+
+  Function MapAccum::get_reverse(casadi_int nadj, const std::string& name,
+      const std::vector<std::string>& inames,
+      const std::vector<std::string>& onames,
+      const Dict& opts) const {
+    Function ret;
+    ret.own(new MapAccum(name, f_, n_, n_accum_, checkpoints_, schedule_, nadj));
+    ret->name_in_ = inames;
+    ret->name_out_ = onames;
+    ret->construct(opts);
+    return ret;
+  }
+
+  void MapAccum::serialize_body(SerializingStream &s) const {
+    FunctionInternal::serialize_body(s);
+    s.version("MapAccum", 1);
+    s.pack("MapAccum::f", f_);
+    s.pack("MapAccum::n", n_);
+    s.pack("MapAccum::n_accum", n_accum_);
+    s.pack("MapAccum::checkpoints", checkpoints_);
+    s.pack("MapAccum::schedule", static_cast<casadi_int>(schedule_));
+    s.pack("MapAccum::nadj", nadj_);
+    s.pack("MapAccum::fr", fr_);
+    s.pack("MapAccum::x_off", x_off_);
+    s.pack("MapAccum::in_off", in_off_);
+    s.pack("MapAccum::out_off", out_off_);
+  }
+
+  MapAccum::MapAccum(DeserializingStream& s) : FunctionInternal(s) {
+    s.version("MapAccum", 1);
+    s.unpack("MapAccum::f", f_);
+    s.unpack("MapAccum::n", n_);
+    s.unpack("MapAccum::n_accum", n_accum_);
+    s.unpack("MapAccum::checkpoints", checkpoints_);
+    casadi_int schedule;
+    s.unpack("MapAccum::schedule", schedule);
+    schedule_ = static_cast<CheckpointSchedule>(schedule);
+    s.unpack("MapAccum::nadj", nadj_);
+    s.unpack("MapAccum::fr", fr_);
+    s.unpack("MapAccum::x_off", x_off_);
+    s.unpack("MapAccum::in_off", in_off_);
+    s.unpack("MapAccum::out_off", out_off_);
+  }
+
+} // namespace casadi
@@ -0,0 +1,224 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_MAPACCUM_HPP
+#define CASADI_MAPACCUM_HPP
+
+#include "function_internal.hpp"
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  /// Placement of the stored states in the reverse sweep of MapAccum
+  enum class CheckpointSchedule {BINOMIAL, EQUIDISTANT};
+
+  /** \brief Accumulated map, evaluated by a loop, with checkpointed reverse mode
+
+      Evaluates f: (x, u) -> (x_next, y) N times, the first n_accum outputs
+      feeding the first n_accum inputs of the next call, like the unrolled
+      Function::mapaccum. Reverse mode derivatives do not keep every
+      intermediate state but a fixed number of checkpoints, recomputing the
+      states in between:
+
+       - BINOMIAL: the states are placed as in Griewank's Revolve, minimizing
+         the number of recomputed steps for the given memory
+       - EQUIDISTANT: states are stored at equidistant intervals in a forward
+         sweep, the states of each interval are then recomputed and stored
+         in full. Each step is recomputed once, at the cost of the memory
+         for one interval
+
+      The same class implements the reverse mode derivative, if nadj>0. It has
+      no derivatives itself, so second order derivatives are not available.
+  */
+  class CASADI_EXPORT MapAccum : public FunctionInternal {
+  public:
+    /** \brief Constructor */
+    MapAccum(const std::string& name, const Function& f, casadi_int n, casadi_int n_accum,
+      casadi_int checkpoints, CheckpointSchedule schedule, casadi_int nadj=0);
+
+    /** \brief Create the accumulated map */
+    static Function create(const std::string& name, const Function& f, casadi_int n,
+      casadi_int n_accum, casadi_int checkpoints, const std::string& schedule,
+      const Dict& opts);
+
+    /** \brief Destructor */
+    ~MapAccum() override;
+
+    /** \brief Get type name */
+    std::string class_name() const override {return "MapAccum";}
+
+    /** \brief Check if the function is of a particular type */
+    bool is_a(const std::string& type, bool recursive) const override;
+
+    // Get list of dependency functions
+    std::vector<std::string> get_function() const override;
+
+    // Get a dependency function
+    const Function& get_function(const std::string &name) const override;
+
+    // Check if a particular dependency exists
+    bool has_function(const std::string& fname) const override;
+
+    /// @{
+    /** \brief Sparsities of function inputs and outputs */
+    Sparsity get_sparsity_in(casadi_int i) override;
+    Sparsity get_sparsity_out(casadi_int i) override;
+    /// @}
+
+    /** \brief Get default input value */
+    double get_default_in(casadi_int ind) const override;
+
+    ///@{
+    /** \brief Number of function inputs and outputs */
+    size_t get_n_in() override;
+    size_t get_n_out() override;
+    ///@}
+
+    /** \brief  Initialize */
+    void init(const Dict& opts) override;
+
+    /** \brief  Evaluate or propagate sparsities forward, without derivatives */
+    template<typename T>
+    int eval_gen(const T** arg, T** res, casadi_int* iw, T* w, int mem=0) const;
+
+    /// Evaluate the function numerically
+    int eval(const double** arg, double** res, casadi_int* iw, double* w, void* mem) const override;
+
+    /** \brief  Evaluate symbolically, unrolling the loop */
+    int eval_sx(const SXElem** arg, SXElem** res,
+                casadi_int* iw, SXElem* w, void* mem) const override;
+
+    /** \brief  Propagate sparsity forward */
+    int sp_forward(const bvec_t** arg, bvec_t** res,
+                    casadi_int* iw, bvec_t* w, void* mem) const override;
+
+    /** \brief  Propagate sparsity backwards */
+    int sp_reverse(bvec_t** arg, bvec_t** res, casadi_int* iw, bvec_t* w, void* mem) const override;
+
+    ///@{
+    /// Is the class able to propagate seeds through the algorithm?
+    bool has_spfwd() const override { return nadj_==0;}
+    bool has_sprev() const override { return nadj_==0;}
+    ///@}
+
+    ///@{
+    /** \brief Forward derivatives, by the unrolled mapaccum */
+    bool has_forward(casadi_int nfwd) const override { return nadj_==0;}
+    Function get_forward(casadi_int nfwd, const std::string& name,
+                         const std::vector<std::string>& inames,
+                         const std::vector<std::string>& onames,
+                         const Dict& opts) const override;
+    ///@}
+
+    ///@{
+    /** \brief Reverse derivatives, with checkpointing */
+    bool has_reverse(casadi_int nadj) const override { return nadj_==0;}
+    Function get_reverse(casadi_int nadj, const std::string& name,
+                         const std::vector<std::string>& inames,
+                         const std::vector<std::string>& onames,
+                         const Dict& opts) const override;
+    ///@}
+
+    /** Obtain information about node */
+    Dict info() const override;
+
+    /** \brief Serialize an object without type information */
+    void serialize_body(SerializingStream &s) const override;
+
+    /** \brief String used to identify the immediate FunctionInternal subclass */
+    std::string serialize_base_function() const override { return "MapAccum"; }
+
+    /** \brief Deserialize without type information */
+    static ProtoFunction* deserialize(DeserializingStream& s) { return new MapAccum(s); }
+
+  protected:
+    /** \brief Deserializing constructor */
+    explicit MapAccum(DeserializingStream& s);
+
+    // Work vectors of the reverse sweep
+    struct RevWork {
+      const double** arg;
+      double** res;
+      casadi_int* iw;
+      double* w;
+      int mem_f, mem_fr;
+      // Nondifferentiated inputs, adjoint seeds and sensitivities of the map
+      const double** map_arg;
+      const double** map_seed;
+      double** map_sens;
+      // Outputs, seeds and sensitivities of one call
+      double *y, *seed, *sens;
+      // Adjoint of the state
+      double* lam;
+    };
+
+    // Evaluate f at step k from state x, writing the next state and all outputs if given
+    int step(RevWork& m, casadi_int k, const double* x, double* x_next, double* y) const;
+
+    // Advance state x from step k0 to step k1
+    int advance(RevWork& m, casadi_int k0, casadi_int k1, const double* x, double* x1,
+      double* tmp) const;
+
+    // Reverse step k, given its state x
+    int reverse_step(RevWork& m, casadi_int k, const double* x) const;
+
+    // Reverse steps [l, r) with binomial checkpointing, the state at l in snap[0]
+    int reverse_binomial(RevWork& m, casadi_int l, casadi_int r, double* snap,
+      casadi_int s, double* tmp) const;
+
+    // Function being mapped
+    Function f_;
+
+    // Number of calls
+    casadi_int n_;
+
+    // Number of accumulated inputs and outputs
+    casadi_int n_accum_;
+
+    // Number of stored intermediate states in the reverse sweep
+    casadi_int checkpoints_;
+
+    // Placement of the stored states
+    CheckpointSchedule schedule_;
+
+    // Number of adjoint directions, zero if not differentiated
+    casadi_int nadj_;
+
+    // Reverse mode derivative of f_, if nadj_>0
+    Function fr_;
+
+    // Nonzero offsets of the accumulated inputs in the state vector
+    std::vector<casadi_int> x_off_;
+
+    // Nonzero offsets of all inputs and outputs of f_
+    std::vector<casadi_int> in_off_, out_off_;
+  };
+
+} // namespace casadi
+
+/// \endcond
+
+#endif // CASADI_MAPACCUM_HPP
@@ -29,6 +29,11 @@
 #include "casadi_interrupt.hpp"
 #include "io_instruction.hpp"
 #include "serializing_stream.hpp"
+#include "getnonzeros.hpp"
+#include "setnonzeros_impl.hpp"
+#include "multiplication.hpp"
+#include "casadi_call.hpp"
+#include "split.hpp"
 
 #include <stack>
 #include <typeinfo>
@@ -66,6 +71,16 @@ namespace casadi {
       {"cse",
        {OT_BOOL,
         "Perform common subexpression elimination (complexity is N*log(N) in graph size)"}},
+      {"optimize_graph",
+       {OT_BOOL,
+        "Simplify the expression graph before sorting it: fuse nonzero index maps, "
+        "cancel transpose pairs and split/concatenation pairs, remove operations "
+        "that do not change their argument and fold constants. "
+        "Statistics are available in stats()"}},
+      {"optimize_graph_options",
+       {OT_DICT,
+        "Options for the graph optimization: fold_constants, cancel_transpose, "
+        "cancel_split, remove_identity, fuse_nonzeros (all true by default)"}},
       {"allow_free",
        {OT_BOOL,
         "Allow construction with free variables (Default: false)"}},
@@ -117,6 +132,8 @@ namespace casadi {
     print_instructions_ = false;
     bool cse_opt = false;
     bool allow_free = false;
+    bool optimize_graph_opt = false;
+    Dict optimize_graph_options;
 
     // Read options
     for (auto&& op : opts) {
@@ -128,6 +145,10 @@ namespace casadi {
         print_instructions_ = op.second;
       } else if (op.first=="cse") {
         cse_opt = op.second;
+      } else if (op.first=="optimize_graph") {
+        optimize_graph_opt = op.second;
+      } else if (op.first=="optimize_graph_options") {
+        optimize_graph_options = op.second;
       } else if (op.first=="allow_free") {
         allow_free = op.second;
       }
@@ -148,6 +169,8 @@ namespace casadi {
         "You must use get_output() to make a concrete instance.");
     }
 
+    graph_stats_.clear();
+    if (optimize_graph_opt) out_ = optimize_graph(out_, optimize_graph_options, graph_stats_);
     if (cse_opt) out_ = cse(out_);
 
     // Stack used to sort the computational graph
@@ -416,6 +439,32 @@ namespace casadi {
       "Set option 'allow_free' to allow free variables.");
     }
 
+    // Complete the graph optimization statistics with the nodes that remain
+    if (optimize_graph_opt) {
+      Dict before = graph_stats_["nodes_before"], removed;
+      std::map<std::string, casadi_int> after;
+      casadi_int n_after = 0;
+      for (auto&& e : algorithm_) {
+        if (e.op==OP_INPUT || e.op==OP_OUTPUT || e.op==OP_PARAMETER) continue;
+        after[casadi_math<double>::name(e.op)]++;
+        n_after++;
+      }
+      casadi_int n_before = 0;
+      for (auto&& b : before) {
+        casadi_int n = b.second.to_int();
+        n_before += n;
+        if (n>after[b.first]) removed[b.first] = n - after[b.first];
+      }
+      graph_stats_["n_nodes_before"] = n_before;
+      graph_stats_["n_nodes_after"] = n_after;
+      graph_stats_["removed"] = removed;
+      if (verbose_) {
+        casadi_message(name_ + "::init: graph optimization reduced " + str(n_before)
+          + " operations to " + str(n_after) + ", removed " + str(removed) + ", folded "
+          + str(graph_stats_["constants_folded"]) + " constant subexpressions");
+      }
+    }
+
     // Does any embedded function have reference counting for codegen?
     for (auto&& a : algorithm_) {
       if (a.data->has_refcount()) {
@@ -423,6 +472,245 @@ namespace casadi {
         break;
       }
     }
+
+    // Flattened execution plan
+    init_exec();
+  }
+
+  // Evaluate a node with constant dependencies, return false if not possible
+  static bool fold_constant(MX& x) {
+    if (x.is_constant() || x.is_output() || x.n_dep()==0) return false;
+    // Not for calls and operations with side effects
+    if (x.op()==OP_CALL || x.op()==OP_MONITOR || x.op()==OP_ASSERTION) return false;
+    for (casadi_int i=0; i<x.n_dep(); ++i) {
+      if (!x.dep(i).is_constant()) return false;
+    }
+    try {
+      std::vector<DM> dep(x.n_dep());
+      std::vector<const double*> arg(x->sz_arg(), nullptr);
+      for (casadi_int i=0; i<dep.size(); ++i) {
+        dep[i] = x.dep(i)->get_DM();
+        if (dep[i].sparsity()!=x.dep(i).sparsity()) return false;
+        arg[i] = get_ptr(dep[i].nonzeros());
+      }
+      std::vector<double> nz(x.nnz());
+      std::vector<double*> res(x->sz_res(), nullptr);
+      res[0] = get_ptr(nz);
+      std::vector<casadi_int> iw(x->sz_iw());
+      std::vector<double> w(x->sz_w());
+      if (x->eval(get_ptr(arg), get_ptr(res), get_ptr(iw), get_ptr(w))) return false;
+      x = MX(DM(x.sparsity(), nz));
+    } catch (std::exception&) {
+      // Numerical evaluation not supported by the node
+      return false;
+    }
+    return true;
+  }
+
+  // Does a node return its (only) dependency unchanged?
+  static bool is_identity(const MX& x) {
+    switch (x.op()) {
+      case OP_RESHAPE:
+      case OP_SPARSITY_CAST:
+      case OP_PROJECT:
+        return x.sparsity()==x.dep().sparsity();
+      case OP_GETNONZEROS:
+        return x.sparsity()==x.dep().sparsity()
+          && is_range(static_cast<const GetNonzeros*>(x.get())->all(), 0, x.nnz());
+      default:
+        return false;
+    }
+  }
+
+  std::vector<MX> MXFunction::optimize_graph(const std::vector<MX>& ex, const Dict& opts,
+      Dict& stats) {
+    // Read options
+    bool fold_constants = true, cancel_transpose = true, cancel_split = true;
+    bool remove_identity = true, fuse_nonzeros = true;
+    for (auto&& op : opts) {
+      if (op.first=="fold_constants") {
+        fold_constants = op.second;
+      } else if (op.first=="cancel_transpose") {
+        cancel_transpose = op.second;
+      } else if (op.first=="cancel_split") {
+        cancel_split = op.second;
+      } else if (op.first=="remove_identity") {
+        remove_identity = op.second;
+      } else if (op.first=="fuse_nonzeros") {
+        fuse_nonzeros = op.second;
+      } else {
+        casadi_error("No such graph optimization option: " + op.first);
+      }
+    }
+
+    // Sort the graph
+    Function f("f", std::vector<MX>{}, ex,
+      {{"live_variables", false}, {"max_io", 0}, {"allow_free", true}});
+    const MXFunction* ff = f.get<MXFunction>();
+
+    // Rebuilt expression for each work vector element
+    std::vector<MX> swork(ff->workloc_.size()-1);
+    std::vector<std::vector<MX> > res_split(ex.size());
+    for (casadi_int i=0; i<ex.size(); ++i) res_split[i].resize(ex[i].n_primitives());
+
+    // Statistics
+    std::map<std::string, casadi_int> nodes_before;
+    casadi_int n_folded = 0, n_transpose = 0, n_split = 0, n_identity = 0, n_fused = 0;
+
+    // Rebuild the graph in topological order. Recreating each node from its rebuilt
+    // dependencies applies the simplifications done at construction, in particular
+    // the fusion of nested nonzero index maps.
+    std::vector<MX> arg1, res1;
+    for (auto&& e : ff->algorithm_) {
+      if (e.op==OP_OUTPUT) {
+        res_split.at(e.data->ind()).at(e.data->segment()) = swork[e.arg.front()];
+      } else if (e.op==OP_PARAMETER) {
+        swork[e.res.front()] = e.data;
+      } else {
+        nodes_before[casadi_math<double>::name(e.op)]++;
+        arg1.resize(e.arg.size());
+        for (casadi_int i=0; i<arg1.size(); ++i) {
+          arg1[i] = e.arg[i]<0 ? MX(e.data->dep(i).size()) : swork[e.arg[i]];
+        }
+        res1.resize(e.res.size());
+        e.data->eval_mx(arg1, res1);
+
+        // Split of a concatenation: take the nonzeros from the concatenated expressions
+        if (cancel_split && (e.op==OP_HORZSPLIT || e.op==OP_VERTSPLIT || e.op==OP_DIAGSPLIT)
+            && (arg1[0].op()==OP_HORZCAT || arg1[0].op()==OP_VERTCAT
+            || arg1[0].op()==OP_DIAGCAT) && arg1[0].sparsity()==e.data->dep(0).sparsity()) {
+          const std::vector<casadi_int>& offset = static_cast<const Split*>(e.data.get())->offset_;
+          // Nonzero offsets of the concatenated expressions
+          std::vector<casadi_int> cat_offset(1, 0);
+          for (casadi_int j=0; j<arg1[0].n_dep(); ++j) {
+            cat_offset.push_back(cat_offset.back() + arg1[0].dep(j).nnz());
+          }
+          for (casadi_int i=0; i<res1.size(); ++i) {
+            if (!res1[i].is_output() || e.res[i]<0) continue;
+            const Sparsity& sp = e.data->sparsity(i);
+            auto it = std::upper_bound(cat_offset.begin(), cat_offset.end(), offset[i]);
+            casadi_int j = it - cat_offset.begin() - 1;
+            if (sp.nnz()==0 || j>=arg1[0].n_dep() || offset[i+1]>cat_offset[j+1]) continue;
+            if (offset[i]==cat_offset[j] && arg1[0].dep(j).sparsity()==sp) {
+              res1[i] = arg1[0].dep(j);
+            } else {
+              res1[i] = arg1[0]->get_nzref(sp, range(offset[i], offset[i+1]));
+            }
+            n_split++;
+          }
+        }
+
+        for (casadi_int i=0; i<res1.size(); ++i) {
+          if (e.res[i]<0) continue;
+          MX& r = res1[i];
+          // Transpose of a transpose
+          while (cancel_transpose && r.op()==OP_TRANSPOSE && r.dep().op()==OP_TRANSPOSE) {
+            r = r.dep().dep();
+            n_transpose++;
+          }
+          // Nonzero selection from a reshape: select from the reshaped expression directly
+          while (fuse_nonzeros && r.op()==OP_GETNONZEROS
+              && (r.dep().op()==OP_RESHAPE || r.dep().op()==OP_SPARSITY_CAST)) {
+            r = r.dep().dep()->get_nzref(r.sparsity(),
+              static_cast<const GetNonzeros*>(r.get())->all());
+            n_fused++;
+          }
+          // Reshape, projection or nonzero selection that leaves its argument unchanged
+          while (remove_identity && is_identity(r)) {
+            r = r.dep();
+            n_identity++;
+          }
+          // Constant subexpression
+          if (fold_constants && fold_constant(r)) n_folded++;
+          swork[e.res[i]] = r;
+        }
+      }
+    }
+
+    // Statistics, completed by the caller once the graph has been sorted
+    Dict before;
+    for (auto&& n : nodes_before) before[n.first] = n.second;
+    stats["nodes_before"] = before;
+    stats["constants_folded"] = n_folded;
+    stats["transposes_cancelled"] = n_transpose;
+    stats["splits_cancelled"] = n_split;
+    stats["identities_removed"] = n_identity;
+    stats["nonzeros_fused"] = n_fused;
+
+    // Join split outputs
+    std::vector<MX> ret(ex.size());
+    for (casadi_int i=0; i<ret.size(); ++i) ret[i] = ex[i].join_primitives(res_split[i]);
+    return ret;
+  }
+
+  /// \cond INTERNAL
+  // Evaluate a node with a virtual function call
+  static int exec_virtual(const MXNode* node, const double** arg, double** res,
+                          casadi_int* iw, double* w) {
+    return node->eval(arg, res, iw, w);
+  }
+
+  // Evaluate a node of a known class, bypassing the virtual function table
+  template<typename Node>
+  static int exec_bound(const MXNode* node, const double** arg, double** res,
+                        casadi_int* iw, double* w) {
+    return static_cast<const Node*>(node)->Node::eval(arg, res, iw, w);
+  }
+
+  // Bind the evaluation of a node, if of the exact class Node
+  template<typename Node>
+  static bool exec_bind(const MXNode* node, MXExecFcn& fcn) {
+    if (typeid(*node)!=typeid(Node)) return false;
+    fcn = exec_bound<Node>;
+    return true;
+  }
+  /// \endcond
+
+  void MXFunction::init_exec() {
+    exec_.clear();
+    exec_.reserve(algorithm_.size());
+    exec_loc_.clear();
+    for (auto&& e : algorithm_) {
+      MXExecEl x;
+      x.op = e.op;
+      x.node = e.data.get();
+      x.ind = x.offset = x.nnz = 0;
+      x.fcn = nullptr;
+      // Argument locations
+      x.arg = exec_loc_.size();
+      x.n_arg = e.arg.size();
+      for (casadi_int a : e.arg) exec_loc_.push_back(a>=0 ? workloc_[a] : -1);
+      // Result locations
+      x.res = exec_loc_.size();
+      x.n_res = e.res.size();
+      for (casadi_int r : e.res) exec_loc_.push_back(r>=0 ? workloc_[r] : -1);
+      if (e.op==OP_INPUT) {
+        x.ind = e.data->ind();
+        x.offset = e.data->offset();
+        x.nnz = e.data.nnz();
+      } else if (e.op==OP_OUTPUT) {
+        x.ind = e.data->ind();
+        x.offset = e.data->offset();
+        x.nnz = e.data->dep().nnz();
+      } else {
+        // Bind common nodes directly, fall back to a virtual call
+        if (!(exec_bind<GetNonzerosVector>(x.node, x.fcn)
+            || exec_bind<GetNonzerosSlice>(x.node, x.fcn)
+            || exec_bind<GetNonzerosSlice2>(x.node, x.fcn)
+            || exec_bind<SetNonzerosVector<false> >(x.node, x.fcn)
+            || exec_bind<SetNonzerosVector<true> >(x.node, x.fcn)
+            || exec_bind<SetNonzerosSlice<false> >(x.node, x.fcn)
+            || exec_bind<SetNonzerosSlice<true> >(x.node, x.fcn)
+            || exec_bind<SetNonzerosSlice2<false> >(x.node, x.fcn)
+            || exec_bind<SetNonzerosSlice2<true> >(x.node, x.fcn)
+            || exec_bind<Multiplication>(x.node, x.fcn)
+            || exec_bind<DenseMultiplication>(x.node, x.fcn)
+            || exec_bind<Call>(x.node, x.fcn))) {
+          x.fcn = exec_virtual;
+        }
+      }
+      exec_.push_back(x);
+    }
   }
 
   int MXFunction::eval(const double** arg, double** res,
@@ -440,45 +728,44 @@ namespace casadi {
                    + str(free_vars_) + " are free.");
     }
 
-    // Operation number (for printing)
-    casadi_int k = 0;
+    // Work vector offsets of arguments and results
+    const casadi_int* loc = get_ptr(exec_loc_);
 
     // Evaluate all of the nodes of the algorithm:
     // should only evaluate nodes that have not yet been calculated!
-    for (auto&& e : algorithm_) {
+    casadi_int n_exec = exec_.size();
+    for (casadi_int k=0; k<n_exec; ++k) {
+      const MXExecEl& e = exec_[k];
       // Perform the operation
       if (e.op==OP_INPUT) {
         // Pass an input
-        double *w1 = w+workloc_[e.res.front()];
-        casadi_int nnz=e.data.nnz();
-        casadi_int i=e.data->ind();
-        casadi_int nz_offset=e.data->offset();
-        if (arg[i]==nullptr) {
-          std::fill(w1, w1+nnz, 0);
+        double *w1 = w+loc[e.res];
+        const double* a = arg[e.ind];
+        if (a==nullptr) {
+          std::fill_n(w1, e.nnz, 0);
         } else {
-          std::copy(arg[i]+nz_offset, arg[i]+nz_offset+nnz, w1);
+          std::copy_n(a+e.offset, e.nnz, w1);
         }
       } else if (e.op==OP_OUTPUT) {
         // Get an output
-        double *w1 = w+workloc_[e.arg.front()];
-        casadi_int nnz=e.data->dep().nnz();
-        casadi_int i=e.data->ind();
-        casadi_int nz_offset=e.data->offset();
-        if (res[i]) std::copy(w1, w1+nnz, res[i]+nz_offset);
+        const double *w1 = w+loc[e.arg];
+        if (res[e.ind]) std::copy_n(w1, e.nnz, res[e.ind]+e.offset);
       } else {
         // Point pointers to the data corresponding to the element
-        for (casadi_int i=0; i<e.arg.size(); ++i)
-          arg1[i] = e.arg[i]>=0 ? w+workloc_[e.arg[i]] : nullptr;
-        for (casadi_int i=0; i<e.res.size(); ++i)
-          res1[i] = e.res[i]>=0 ? w+workloc_[e.res[i]] : nullptr;
+        for (casadi_int i=0; i<e.n_arg; ++i) {
+          casadi_int l = loc[e.arg+i];
+          arg1[i] = l>=0 ? w+l : nullptr;
+        }
+        for (casadi_int i=0; i<e.n_res; ++i) {
+          casadi_int l = loc[e.res+i];
+          res1[i] = l>=0 ? w+l : nullptr;
+        }
 
         // Evaluate
-        if (print_instructions_) print_arg(uout(), k, e, arg1);
-        if (e.data->eval(arg1, res1, iw, w)) return 1;
-        if (print_instructions_) print_res(uout(), k, e, res1);
+        if (print_instructions_) print_arg(uout(), k, algorithm_[k], arg1);
+        if (e.fcn(e.node, arg1, res1, iw, w)) return 1;
+        if (print_instructions_) print_res(uout(), k, algorithm_[k], res1);
       }
-      // Increase counter
-      k++;
     }
     return 0;
   }
@@ -564,37 +851,38 @@ namespace casadi {
     const bvec_t** arg1=arg+n_in_;
     bvec_t** res1=res+n_out_;
 
+    // Work vector offsets of arguments and results
+    const casadi_int* loc = get_ptr(exec_loc_);
+
     // Propagate sparsity forward
-    for (auto&& e : algorithm_) {
+    for (const MXExecEl& e : exec_) {
       if (e.op==OP_INPUT) {
         // Pass input seeds
-        casadi_int nnz=e.data.nnz();
-        casadi_int i=e.data->ind();
-        casadi_int nz_offset=e.data->offset();
-        const bvec_t* argi = arg[i];
-        bvec_t* w1 = w + workloc_[e.res.front()];
+        const bvec_t* argi = arg[e.ind];
+        bvec_t* w1 = w + loc[e.res];
         if (argi!=nullptr) {
-          std::copy(argi+nz_offset, argi+nz_offset+nnz, w1);
+          std::copy_n(argi+e.offset, e.nnz, w1);
         } else {
-          std::fill_n(w1, nnz, 0);
+          std::fill_n(w1, e.nnz, 0);
         }
       } else if (e.op==OP_OUTPUT) {
         // Get the output sensitivities
-        casadi_int nnz=e.data.dep().nnz();
-        casadi_int i=e.data->ind();
-        casadi_int nz_offset=e.data->offset();
-        bvec_t* resi = res[i];
-        bvec_t* w1 = w + workloc_[e.arg.front()];
-        if (resi!=nullptr) std::copy(w1, w1+nnz, resi+nz_offset);
+        bvec_t* resi = res[e.ind];
+        const bvec_t* w1 = w + loc[e.arg];
+        if (resi!=nullptr) std::copy_n(w1, e.nnz, resi+e.offset);
       } else {
         // Point pointers to the data corresponding to the element
-        for (casadi_int i=0; i<e.arg.size(); ++i)
-          arg1[i] = e.arg[i]>=0 ? w+workloc_[e.arg[i]] : nullptr;
-        for (casadi_int i=0; i<e.res.size(); ++i)
-          res1[i] = e.res[i]>=0 ? w+workloc_[e.res[i]] : nullptr;
+        for (casadi_int i=0; i<e.n_arg; ++i) {
+          casadi_int l = loc[e.arg+i];
+          arg1[i] = l>=0 ? w+l : nullptr;
+        }
+        for (casadi_int i=0; i<e.n_res; ++i) {
+          casadi_int l = loc[e.res+i];
+          res1[i] = l>=0 ? w+l : nullptr;
+        }
 
         // Propagate sparsity forwards
-        if (e.data->sp_forward(arg1, res1, iw, w)) return 1;
+        if (e.node->sp_forward(arg1, res1, iw, w)) return 1;
       }
     }
     return 0;
@@ -611,38 +899,39 @@ namespace casadi {
 
     std::fill_n(w, sz_w(), 0);
 
+    // Work vector offsets of arguments and results
+    const casadi_int* loc = get_ptr(exec_loc_);
+
     // Propagate sparsity backwards
-    for (auto it=algorithm_.rbegin(); it!=algorithm_.rend(); it++) {
-      if (it->op==OP_INPUT) {
+    for (auto it=exec_.rbegin(); it!=exec_.rend(); it++) {
+      const MXExecEl& e = *it;
+      if (e.op==OP_INPUT) {
         // Get the input sensitivities and clear it from the work vector
-        casadi_int nnz=it->data.nnz();
-        casadi_int i=it->data->ind();
-        casadi_int nz_offset=it->data->offset();
-        bvec_t* argi = arg[i];
-        bvec_t* w1 = w + workloc_[it->res.front()];
-        if (argi!=nullptr) for (casadi_int k=0; k<nnz; ++k) argi[nz_offset+k] |= w1[k];
-        std::fill_n(w1, nnz, 0);
-      } else if (it->op==OP_OUTPUT) {
+        bvec_t* argi = arg[e.ind];
+        bvec_t* w1 = w + loc[e.res];
+        if (argi!=nullptr) for (casadi_int k=0; k<e.nnz; ++k) argi[e.offset+k] |= w1[k];
+        std::fill_n(w1, e.nnz, 0);
+      } else if (e.op==OP_OUTPUT) {
         // Pass output seeds
-        casadi_int nnz=it->data.dep().nnz();
-        casadi_int i=it->data->ind();
-        casadi_int nz_offset=it->data->offset();
-        bvec_t* resi = res[i] ? res[i] + nz_offset : nullptr;
-        bvec_t* w1 = w + workloc_[it->arg.front()];
+        bvec_t* resi = res[e.ind] ? res[e.ind] + e.offset : nullptr;
+        bvec_t* w1 = w + loc[e.arg];
         if (resi!=nullptr) {
-          for (casadi_int k=0; k<nnz; ++k) w1[k] |= resi[k];
-          std::fill_n(resi, nnz, 0);
-
+          for (casadi_int k=0; k<e.nnz; ++k) w1[k] |= resi[k];
+          std::fill_n(resi, e.nnz, 0);
         }
       } else {
         // Point pointers to the data corresponding to the element
-        for (casadi_int i=0; i<it->arg.size(); ++i)
-          arg1[i] = it->arg[i]>=0 ? w+workloc_[it->arg[i]] : nullptr;
-        for (casadi_int i=0; i<it->res.size(); ++i)
-          res1[i] = it->res[i]>=0 ? w+workloc_[it->res[i]] : nullptr;
+        for (casadi_int i=0; i<e.n_arg; ++i) {
+          casadi_int l = loc[e.arg+i];
+          arg1[i] = l>=0 ? w+l : nullptr;
+        }
+        for (casadi_int i=0; i<e.n_res; ++i) {
+          casadi_int l = loc[e.res+i];
+          res1[i] = l>=0 ? w+l : nullptr;
+        }
 
         // Propagate sparsity backwards
-        if (it->data->sp_reverse(arg1, res1, iw, w)) return 1;
+        if (e.node->sp_reverse(arg1, res1, iw, w)) return 1;
       }
     }
     return 0;
@@ -1741,6 +2030,7 @@ namespace casadi {
 
   Dict MXFunction::get_stats(void* mem) const {
     Dict stats = XFunction::get_stats(mem);
+    if (!graph_stats_.empty()) stats["optimize_graph"] = graph_stats_;
 
     Function dep;
     for (auto&& e : algorithm_) {
@@ -1800,6 +2090,9 @@ namespace casadi {
     if (version >= 2) s.unpack("MXFunction::print_instructions", print_instructions_);
 
     XFunction<MXFunction, MX, MXNode>::delayed_deserialize_members(s);
+
+    // Flattened execution plan
+    init_exec();
   }
 
   ProtoFunction* MXFunction::deserialize(DeserializingStream& s) {
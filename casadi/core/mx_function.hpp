@@ -55,6 +55,34 @@ namespace casadi {
     /// Work vector indices of the results
     std::vector<casadi_int> res;
   };
+
+  /** \brief Numerical evaluation of an MX node, bound at initialization */
+  typedef int (*MXExecFcn)(const MXNode* node, const double** arg, double** res,
+                           casadi_int* iw, double* w);
+
+  /** \brief An instruction of the flattened execution plan of an MXFunction
+
+      Argument and result locations are stored contiguously for all instructions,
+      as offsets into the work vector (-1 for null). */
+  struct MXExecEl {
+    /// Operator index
+    casadi_int op;
+
+    /// Node, owned by the corresponding algorithm element
+    const MXNode* node;
+
+    /// Position and number of argument locations
+    casadi_int arg, n_arg;
+
+    /// Position and number of result locations
+    casadi_int res, n_res;
+
+    /// Input or output index, nonzero offset and number of nonzeros (OP_INPUT, OP_OUTPUT)
+    casadi_int ind, offset, nnz;
+
+    /// Numerical evaluation
+    MXExecFcn fcn;
+  };
 #endif // SWIG
 
   /** \brief  Internal node class for MXFunction
@@ -81,6 +109,12 @@ namespace casadi {
         \identifier{21} */
     std::vector<casadi_int> workloc_;
 
+    /** \brief Flattened execution plan, derived from algorithm_ and workloc_ */
+    std::vector<MXExecEl> exec_;
+
+    /** \brief Work vector offsets of the arguments and results in the execution plan */
+    std::vector<casadi_int> exec_loc_;
+
     /// Free variables
     std::vector<MX> free_vars_;
 
@@ -93,6 +127,9 @@ namespace casadi {
     /// Print instructions during evaluation
     bool print_instructions_;
 
+    /// Statistics of the graph optimization, if performed
+    Dict graph_stats_;
+
     /** \brief Constructor
 
         \identifier{22} */
@@ -145,6 +182,17 @@ namespace casadi {
         \identifier{29} */
     void init(const Dict& opts) override;
 
+    /** \brief Build the flattened execution plan from the algorithm */
+    void init_exec();
+
+    /** \brief Simplify an expression graph
+
+        Fuses nonzero index maps, cancels transpose pairs and splits of
+        concatenations, removes operations that leave their argument unchanged
+        and folds constant subexpressions */
+    static std::vector<MX> optimize_graph(const std::vector<MX>& ex, const Dict& opts,
+      Dict& stats);
+
     /** \brief Generate code for the declarations of the C function
 
         \identifier{2a} */
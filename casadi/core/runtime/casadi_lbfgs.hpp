@@ -0,0 +1,170 @@
+//
+//    MIT No Attribution
+//
+//    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl, KU Leuven.
+//
+//    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+//    software and associated documentation files (the "Software"), to deal in the Software
+//    without restriction, including without limitation the rights to use, copy, modify,
+//    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+//    permit persons to whom the Software is furnished to do so.
+//
+//    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// Compact limited-memory BFGS approximation B = J'*J, with J = sqrt(delta)*I + P*C'.
+// Column k of P and C is the rank-1 correction of the factor from the k-th stored
+// pair (s_k, y_k), as in the product form of the BFGS update (Brodlie et al.)
+
+// SYMBOL "lbfgs_jv"
+// jv = J*v
+template<typename T1>
+void casadi_lbfgs_jv(casadi_int nx, casadi_int n, const T1* P, const T1* C, T1 delta,
+    const T1* v, T1* jv) {
+  casadi_int k;
+  casadi_copy(v, nx, jv);
+  casadi_scal(nx, sqrt(delta), jv);
+  for (k=0; k<n; ++k) casadi_axpy(nx, casadi_dot(nx, C + k*nx, v), P + k*nx, jv);
+}
+
+// SYMBOL "lbfgs_jtv"
+// jtv = J'*v
+template<typename T1>
+void casadi_lbfgs_jtv(casadi_int nx, casadi_int n, const T1* P, const T1* C, T1 delta,
+    const T1* v, T1* jtv) {
+  casadi_int k;
+  casadi_copy(v, nx, jtv);
+  casadi_scal(nx, sqrt(delta), jtv);
+  for (k=0; k<n; ++k) casadi_axpy(nx, casadi_dot(nx, P + k*nx, v), C + k*nx, jtv);
+}
+
+// SYMBOL "lbfgs_factor"
+// Rebuild the factor from the n stored pairs, oldest first. Requires y_k'*s_k > 0
+template<typename T1>
+void casadi_lbfgs_factor(casadi_int nx, casadi_int n, const T1* S, const T1* Y, T1 delta,
+    T1* P, T1* C, T1* w) {
+  casadi_int k;
+  T1 *js, *bs, sbs, beta;
+  // Work vectors
+  js = w; w += nx;
+  bs = w; w += nx;
+  for (k=0; k<n; ++k) {
+    // J*s and B*s with the first k pairs
+    casadi_lbfgs_jv(nx, k, P, C, delta, S + k*nx, js);
+    casadi_lbfgs_jtv(nx, k, P, C, delta, js, bs);
+    sbs = casadi_dot(nx, js, js);
+    beta = sqrt(sbs / casadi_dot(nx, Y + k*nx, S + k*nx));
+    // J+ = J + (J*s)*(beta*y - B*s)'/(s'*B*s)
+    casadi_copy(js, nx, P + k*nx);
+    casadi_scal(nx, 1./sbs, P + k*nx);
+    casadi_copy(Y + k*nx, nx, C + k*nx);
+    casadi_scal(nx, beta, C + k*nx);
+    casadi_axpy(nx, -1., bs, C + k*nx);
+  }
+}
+
+// SYMBOL "lbfgs_update"
+// Store the pair (dx, glag - glag_old) with Powell damping, dropping the oldest pair if
+// all m are in use, and rebuild the factor. Returns 1, leaving the approximation
+// unchanged, if the step is zero or if y'*s is not positive after damping
+template<typename T1>
+int casadi_lbfgs_update(casadi_int nx, casadi_int m, casadi_int* n, T1* S, T1* Y, T1* delta,
+    T1* P, T1* C, const T1* dx, const T1* glag, const T1* glag_old, T1* w) {
+  T1 *yk, *js, *bs, sbs, ys, omega;
+  // Work vectors
+  yk = w; w += nx;
+  js = w; w += nx;
+  bs = w; w += nx;
+  // yk = glag - glag_old
+  casadi_copy(glag, nx, yk);
+  casadi_axpy(nx, -1., glag_old, yk);
+  // B*dx with the current approximation
+  casadi_lbfgs_jv(nx, *n, P, C, *delta, dx, js);
+  casadi_lbfgs_jtv(nx, *n, P, C, *delta, js, bs);
+  sbs = casadi_dot(nx, js, js);
+  if (sbs<=0) return 1;
+  // Powell damping: yk = omega * yk + (1 - omega) * B*dx
+  ys = casadi_dot(nx, yk, dx);
+  if (ys < 0.2*sbs) {
+    omega = 0.8*sbs/(sbs - ys);
+    casadi_scal(nx, omega, yk);
+    casadi_axpy(nx, 1 - omega, bs, yk);
+    ys = casadi_dot(nx, yk, dx);
+  }
+  // Rejected pair, e.g. due to rounding or NaN
+  if (!(ys>0)) return 1;
+  // Drop the oldest pair
+  if (*n==m) {
+    casadi_copy(S + nx, (m-1)*nx, S);
+    casadi_copy(Y + nx, (m-1)*nx, Y);
+    (*n)--;
+  }
+  casadi_copy(dx, nx, S + *n*nx);
+  casadi_copy(yk, nx, Y + *n*nx);
+  (*n)++;
+  // Scaling of the initial approximation, from the newest pair
+  *delta = casadi_dot(nx, yk, yk) / ys;
+  // Rebuild the factor, reusing js and bs
+  casadi_lbfgs_factor(nx, *n, S, Y, *delta, P, C, js);
+  return 0;
+}
+
+// SYMBOL "lbfgs_qp_h"
+// Hessian of the QP lifted with z = C'*dx: [sqrt(delta)*I, P]'*[sqrt(delta)*I, P],
+// with the sparsity pattern [diag(nx), dense(nx, m); dense(m, nx), dense(m, m)]
+template<typename T1>
+void casadi_lbfgs_qp_h(casadi_int nx, casadi_int m, const T1* P, T1 delta, T1* h) {
+  casadi_int i, k, l;
+  T1 sd;
+  sd = sqrt(delta);
+  for (i=0; i<nx; ++i) {
+    *h++ = delta;
+    for (k=0; k<m; ++k) *h++ = sd*P[i + k*nx];
+  }
+  for (k=0; k<m; ++k) {
+    for (i=0; i<nx; ++i) *h++ = sd*P[i + k*nx];
+    for (l=0; l<m; ++l) *h++ = casadi_dot(nx, P + l*nx, P + k*nx);
+  }
+}
+
+// SYMBOL "lbfgs_qp_a"
+// Constraint Jacobian of the lifted QP: [A, 0; C', -I],
+// with the sparsity pattern [sp_a, 0; dense(m, nx), diag(m)]
+template<typename T1>
+void casadi_lbfgs_qp_a(const casadi_int* sp_a, casadi_int m, const T1* a, const T1* C,
+    T1* a_qp) {
+  casadi_int nx, i, k, el;
+  const casadi_int* colind;
+  nx = sp_a[1];
+  colind = sp_a + 2;
+  for (i=0; i<nx; ++i) {
+    for (el=colind[i]; el<colind[i+1]; ++el) *a_qp++ = a[el];
+    for (k=0; k<m; ++k) *a_qp++ = C[i + k*nx];
+  }
+  for (k=0; k<m; ++k) *a_qp++ = -1;
+}
+
+// SYMBOL "lbfgs_qp_lift"
+// Primal-dual vector [x; g] of the QP to [x; z; g; C'*dx - z], filling the new entries
+template<typename T1>
+void casadi_lbfgs_qp_lift(casadi_int nx, casadi_int ng, casadi_int m, const T1* v,
+    T1 fill_z, T1 fill_c, T1* v_qp) {
+  casadi_copy(v, nx, v_qp);
+  casadi_fill(v_qp + nx, m, fill_z);
+  casadi_copy(v + nx, ng, v_qp + nx + m);
+  casadi_fill(v_qp + nx + m + ng, m, fill_c);
+}
+
+// SYMBOL "lbfgs_qp_unlift"
+// Primal-dual vector of the lifted QP to [x; g]
+template<typename T1>
+void casadi_lbfgs_qp_unlift(casadi_int nx, casadi_int ng, casadi_int m, const T1* v_qp,
+    T1* v) {
+  casadi_copy(v_qp, nx, v);
+  casadi_copy(v_qp + nx + m, ng, v + nx);
+}
@@ -17,36 +17,75 @@
 //    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
-// SYMBOL "ldl"
-// Calculate the nonzeros of the transposed L factor (strictly lower entries only)
-// as well as D for an LDL^T factorization
+// SYMBOL "ldl_rows"
+// Entries of column c of L^T (row c of L) in the rows r0, ..., r1-1, before scaling
+// with D. The columns r0, ..., r1-1 must form subtrees of the elimination tree and
+// have been calculated, which makes this independent of all other columns.
+// w must be zero on entry and is zero on exit
 // len[w] >= n
 template<typename T1>
-void casadi_ldl(const casadi_int* sp_a, const T1* a,
-                const casadi_int* sp_lt, T1* lt, T1* d, const casadi_int* p, T1* w) {
+void casadi_ldl_rows(const casadi_int* sp_a, const T1* a, const casadi_int* sp_lt, T1* lt,
+                     const casadi_int* p, T1* w, casadi_int c, casadi_int r0, casadi_int r1) {
   const casadi_int *lt_colind, *lt_row, *a_colind, *a_row;
-  casadi_int n, r, c, c1, k, k2;
+  casadi_int n, r, i, k, k0, k1, k2;
   // Extract sparsities
   n=sp_lt[1];
   lt_colind=sp_lt+2; lt_row=sp_lt+2+n+1;
   a_colind=sp_a+2; a_row=sp_a+2+n+1;
-  // Clear w
-  for (r=0; r<n; ++r) w[r] = 0;
-  // Sparse copy of A to L and D
-  for (c=0; c<n; ++c) {
-    c1 = p[c];
-    for (k=a_colind[c1]; k<a_colind[c1+1]; ++k) w[a_row[k]] = a[k];
-    for (k=lt_colind[c]; k<lt_colind[c+1]; ++k) lt[k] = w[p[lt_row[k]]];
-    d[c] = w[p[c]];
-    for (k=a_colind[c1]; k<a_colind[c1+1]; ++k) w[a_row[k]] = 0;
+  // Nonzeros in the rows r0..r1-1
+  for (k0=lt_colind[c]; k0<lt_colind[c+1] && lt_row[k0]<r0; ++k0) {}
+  for (k1=k0; k1<lt_colind[c+1] && lt_row[k1]<r1; ++k1) {}
+  if (k0==k1) return;
+  // Sparse copy of A
+  i = p[c];
+  for (k=a_colind[i]; k<a_colind[i+1]; ++k) w[a_row[k]] = a[k];
+  for (k=k0; k<k1; ++k) lt[k] = w[p[lt_row[k]]];
+  for (k=a_colind[i]; k<a_colind[i+1]; ++k) w[a_row[k]] = 0;
+  // Forward substitution
+  for (k=k0; k<k1; ++k) {
+    r = lt_row[k];
+    for (k2=lt_colind[r]; k2<lt_colind[r+1]; ++k2) {
+      lt[k] -= lt[k2] * w[lt_row[k2]];
+    }
+    w[r] = lt[k];
   }
+  // Clear w
+  for (k=k0; k<k1; ++k) w[lt_row[k]] = 0;
+}
+
+// SYMBOL "ldl_cols"
+// Columns c0, ..., c1-1 of casadi_ldl. The columns of L^T these depend on, i.e. their
+// descendants in the elimination tree, must have been calculated. If sub is not null,
+// the entries in the rows r with sub[r] nonzero have been calculated by casadi_ldl_rows.
+// w must be zero on entry and is zero on exit
+// len[w] >= n
+template<typename T1>
+void casadi_ldl_cols(const casadi_int* sp_a, const T1* a, const casadi_int* sp_lt, T1* lt,
+                     T1* d, const casadi_int* p, const casadi_int* sub, T1* w,
+                     casadi_int c0, casadi_int c1) {
+  const casadi_int *lt_colind, *lt_row, *a_colind, *a_row;
+  casadi_int n, r, c, i, k, k2;
+  // Extract sparsities
+  n=sp_lt[1];
+  lt_colind=sp_lt+2; lt_row=sp_lt+2+n+1;
+  a_colind=sp_a+2; a_row=sp_a+2+n+1;
   // Loop over columns of L
-  for (c=0; c<n; ++c) {
+  for (c=c0; c<c1; ++c) {
+    // Sparse copy of A to L and D
+    i = p[c];
+    for (k=a_colind[i]; k<a_colind[i+1]; ++k) w[a_row[k]] = a[k];
+    for (k=lt_colind[c]; k<lt_colind[c+1]; ++k) {
+      if (!sub || !sub[lt_row[k]]) lt[k] = w[p[lt_row[k]]];
+    }
+    d[c] = w[p[c]];
+    for (k=a_colind[i]; k<a_colind[i+1]; ++k) w[a_row[k]] = 0;
+    // Calculate l(r,c) with r<c
     for (k=lt_colind[c]; k<lt_colind[c+1]; ++k) {
       r = lt_row[k];
-      // Calculate l(r,c) with r<c
-      for (k2=lt_colind[r]; k2<lt_colind[r+1]; ++k2) {
-        lt[k] -= lt[k2] * w[lt_row[k2]];
+      if (!sub || !sub[r]) {
+        for (k2=lt_colind[r]; k2<lt_colind[r+1]; ++k2) {
+          lt[k] -= lt[k2] * w[lt_row[k2]];
+        }
       }
       w[r] = lt[k];
       lt[k] /= d[r];
@@ -58,6 +97,195 @@ void casadi_ldl(const casadi_int* sp_a, const T1* a,
   }
 }
 
+// SYMBOL "ldl"
+// Calculate the nonzeros of the transposed L factor (strictly lower entries only)
+// as well as D for an LDL^T factorization
+// len[w] >= n
+template<typename T1>
+void casadi_ldl(const casadi_int* sp_a, const T1* a,
+                const casadi_int* sp_lt, T1* lt, T1* d, const casadi_int* p, T1* w) {
+  casadi_int n, r;
+  n=sp_lt[1];
+  // Clear w
+  for (r=0; r<n; ++r) w[r] = 0;
+  // All columns
+  casadi_ldl_cols(sp_a, a, sp_lt, lt, d, p, (const casadi_int*)0, w, 0, n);
+}
+
+// SYMBOL "ldl_sn"
+// Supernodal variant of casadi_ldl, same sparsity pattern and result.
+// Consecutive columns with the same sparsity pattern below the diagonal (supernodes)
+// are factorized together as a dense panel, updated by the supernodes it depends on
+// with register-blocked dense kernels. Reads the lower triangle of A.
+// sn: [nsn, first column (nsn+1), offset (nsn+1), rows below each supernode,
+//      position in lt of the entry in the first column of the supernode for these rows]
+// len[iw] >= 2*n + 2*nsn, len[w] >= 3*n + max_J(nr_J*nc_J)
+template<typename T1>
+void casadi_ldl_sn(const casadi_int* sp_a, const T1* a, const casadi_int* sp_lt, T1* lt,
+                   T1* d, const casadi_int* p, const casadi_int* sn, casadi_int* iw, T1* w) {
+  const casadi_int *lt_colind, *lt_row, *a_colind, *a_row, *sn_col, *sn_ind, *sn_row, *sn_off;
+  casadi_int n, nsn, J, K, j0, j1, nc, ns, nr, nk, r, c, c1, c2, k, s, i, b, q;
+  casadi_int *sn_of, *loc, *mark, *next;
+  T1 *x, *t, *F, *f, *g, v, v0, v1, v2, v3;
+  const T1 *l0, *l1, *l2, *l3;
+  // Extract sparsities
+  n=sp_lt[1];
+  lt_colind=sp_lt+2; lt_row=sp_lt+2+n+1;
+  a_colind=sp_a+2; a_row=sp_a+2+n+1;
+  // Supernodes
+  nsn = sn[0];
+  sn_col = sn + 1;
+  sn_ind = sn_col + nsn + 1;
+  sn_row = sn_ind + nsn + 1;
+  sn_off = sn_row + sn_ind[nsn];
+  // Work vectors
+  sn_of = iw; iw += n;
+  loc = iw; iw += n;
+  mark = iw; iw += nsn;
+  next = iw; iw += nsn;
+  x = w; w += n;
+  t = w; w += 2*n;
+  F = w;
+  for (r=0; r<n; ++r) x[r] = 0;
+  for (J=0; J<nsn; ++J) {
+    mark[J] = -1;
+    next[J] = sn_ind[J];
+    for (r=sn_col[J]; r<sn_col[J+1]; ++r) sn_of[r] = J;
+  }
+  // Loop over supernodes
+  for (J=0; J<nsn; ++J) {
+    j0 = sn_col[J];
+    j1 = sn_col[J+1];
+    nc = j1 - j0;
+    ns = sn_ind[J+1] - sn_ind[J];
+    // Dense panel F, column-major, rows j0..j1-1 followed by the rows below
+    nr = nc + ns;
+    for (r=0; r<nc; ++r) loc[j0+r] = r;
+    for (r=0; r<ns; ++r) loc[sn_row[sn_ind[J]+r]] = nc + r;
+    for (c=0; c<nc; ++c) {
+      i = p[j0+c];
+      for (k=a_colind[i]; k<a_colind[i+1]; ++k) x[a_row[k]] = a[k];
+      for (r=c; r<nc; ++r) F[r + c*nr] = x[p[j0+r]];
+      for (r=0; r<ns; ++r) F[nc + r + c*nr] = x[p[sn_row[sn_ind[J]+r]]];
+      for (k=a_colind[i]; k<a_colind[i+1]; ++k) x[a_row[k]] = 0;
+    }
+    // Updates from the supernodes K with nonzeros in the rows j0..j1-1 of L
+    for (r=0; r<nc; ++r) {
+      for (k=lt_colind[j0+r]; k<lt_colind[j0+r+1]; ++k) {
+        K = sn_of[lt_row[k]];
+        if (K==J || mark[K]==J) continue;
+        mark[K] = J;
+        nk = sn_col[K+1] - sn_col[K];
+        // Skip rows of K above j0
+        for (s=next[K]; sn_row[s]<j0; ++s) {}
+        // F(R, C) -= L(R, K)*D(K)*L(C, K)', two columns of C at a time
+        for (; s+1<sn_ind[K+1] && sn_row[s+1]<j1; s+=2) {
+          l0 = lt + sn_off[s];
+          l1 = lt + sn_off[s+1];
+          for (b=0; b<nk; ++b) {
+            t[b] = l0[b] * d[sn_col[K]+b];
+            t[b+nk] = l1[b] * d[sn_col[K]+b];
+          }
+          f = F + (sn_row[s]-j0)*nr;
+          g = F + (sn_row[s+1]-j0)*nr;
+          for (c=s; c+1<sn_ind[K+1]; c+=2) {
+            l0 = lt + sn_off[c];
+            l1 = lt + sn_off[c+1];
+            v0 = v1 = v2 = v3 = 0;
+            for (b=0; b<nk; ++b) {
+              v0 += l0[b]*t[b];
+              v1 += l1[b]*t[b];
+              v2 += l0[b]*t[b+nk];
+              v3 += l1[b]*t[b+nk];
+            }
+            f[loc[sn_row[c]]] -= v0;
+            f[loc[sn_row[c+1]]] -= v1;
+            g[loc[sn_row[c]]] -= v2;
+            g[loc[sn_row[c+1]]] -= v3;
+          }
+          if (c<sn_ind[K+1]) {
+            l0 = lt + sn_off[c];
+            v0 = v2 = 0;
+            for (b=0; b<nk; ++b) {
+              v0 += l0[b]*t[b];
+              v2 += l0[b]*t[b+nk];
+            }
+            f[loc[sn_row[c]]] -= v0;
+            g[loc[sn_row[c]]] -= v2;
+          }
+        }
+        // Remaining column, four rows at a time
+        if (s<sn_ind[K+1] && sn_row[s]<j1) {
+          l0 = lt + sn_off[s];
+          for (b=0; b<nk; ++b) t[b] = l0[b] * d[sn_col[K]+b];
+          f = F + (sn_row[s]-j0)*nr;
+          for (c=s; c+3<sn_ind[K+1]; c+=4) {
+            l0 = lt + sn_off[c];
+            l1 = lt + sn_off[c+1];
+            l2 = lt + sn_off[c+2];
+            l3 = lt + sn_off[c+3];
+            v0 = v1 = v2 = v3 = 0;
+            for (b=0; b<nk; ++b) {
+              v0 += l0[b]*t[b];
+              v1 += l1[b]*t[b];
+              v2 += l2[b]*t[b];
+              v3 += l3[b]*t[b];
+            }
+            f[loc[sn_row[c]]] -= v0;
+            f[loc[sn_row[c+1]]] -= v1;
+            f[loc[sn_row[c+2]]] -= v2;
+            f[loc[sn_row[c+3]]] -= v3;
+          }
+          for (; c<sn_ind[K+1]; ++c) {
+            l0 = lt + sn_off[c];
+            v = 0;
+            for (b=0; b<nk; ++b) v += l0[b]*t[b];
+            f[loc[sn_row[c]]] -= v;
+          }
+          s++;
+        }
+        next[K] = s;
+      }
+    }
+    // Dense LDL^T of the panel, four columns at a time
+    for (c=0; c<nc; c+=4) {
+      q = nc-c < 4 ? nc-c : 4;
+      for (c1=c; c1<c+q; ++c1) {
+        d[j0+c1] = F[c1 + c1*nr];
+        for (r=c1+1; r<nr; ++r) F[r + c1*nr] /= d[j0+c1];
+        for (c2=c1+1; c2<c+q; ++c2) {
+          v = F[c2 + c1*nr] * d[j0+c1];
+          for (r=c2; r<nr; ++r) F[r + c2*nr] -= F[r + c1*nr] * v;
+        }
+      }
+      // Rank-q update of the remaining columns
+      l0 = F + c*nr;
+      for (c2=c+q; c2<nc; ++c2) {
+        f = F + c2*nr;
+        if (q==4) {
+          v0 = l0[c2]*d[j0+c];
+          v1 = l0[c2+nr]*d[j0+c+1];
+          v2 = l0[c2+2*nr]*d[j0+c+2];
+          v3 = l0[c2+3*nr]*d[j0+c+3];
+          for (r=c2; r<nr; ++r) {
+            f[r] -= l0[r]*v0 + l0[r+nr]*v1 + l0[r+2*nr]*v2 + l0[r+3*nr]*v3;
+          }
+        } else {
+          for (c1=0; c1<q; ++c1) {
+            v = l0[c2+c1*nr]*d[j0+c+c1];
+            for (r=c2; r<nr; ++r) f[r] -= l0[r+c1*nr]*v;
+          }
+        }
+      }
+    }
+    // Copy to L
+    for (c=0; c<nc; ++c) {
+      for (r=c+1; r<nc; ++r) lt[lt_colind[j0+r+1] - r + c] = F[r + c*nr];
+      for (r=0; r<ns; ++r) lt[sn_off[sn_ind[J]+r] + c] = F[nc + r + c*nr];
+    }
+  }
+}
+
 // SYMBOL "ldl_trs"
 // Solve for (I+R) with R an optionally transposed strictly upper triangular matrix.
 template<typename T1>
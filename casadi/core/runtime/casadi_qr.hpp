@@ -40,33 +40,27 @@ T1 casadi_house(T1* v, T1* beta, casadi_int nv) {
   return s;
 }
 
-// SYMBOL "qr"
-// Numeric QR factorization
-// Ref: Chapter 5, Direct Methods for Sparse Linear Systems by Tim Davis
-// len[x] = nrow
-// sp_v = [nrow, ncol, 0, 0, ...] len[3 + ncol + nnz_v]
-// len[v] nnz_v
-// sp_r = [nrow, ncol, 0, 0, ...] len[3 + ncol + nnz_r]
-// len[r] nnz_r
-// len[beta] ncol
+// SYMBOL "qr_cols"
+// Columns c0, ..., c1-1 of casadi_qr. The columns these depend on, i.e. their
+// descendants in the column elimination tree, must have been calculated.
+// x must be zero on entry and is zero on exit
 template<typename T1>
-void casadi_qr(const casadi_int* sp_a, const T1* nz_a, T1* x,
+void casadi_qr_cols(const casadi_int* sp_a, const T1* nz_a, T1* x,
                const casadi_int* sp_v, T1* nz_v, const casadi_int* sp_r, T1* nz_r, T1* beta,
-               const casadi_int* prinv, const casadi_int* pc) {
+               const casadi_int* prinv, const casadi_int* pc, casadi_int c0, casadi_int c1) {
    // Local variables
-   casadi_int ncol, nrow, r, c, k, k1;
+   casadi_int ncol, r, c, k, k1;
    T1 alpha;
    const casadi_int *a_colind, *a_row, *v_colind, *v_row, *r_colind, *r_row;
    // Extract sparsities
    ncol = sp_a[1];
    a_colind=sp_a+2; a_row=sp_a+2+ncol+1;
-   nrow = sp_v[0];
    v_colind=sp_v+2; v_row=sp_v+2+ncol+1;
    r_colind=sp_r+2; r_row=sp_r+2+ncol+1;
-   // Clear work vector
-   for (r=0; r<nrow; ++r) x[r] = 0;
+   // First entry of R
+   nz_r += r_colind[c0];
    // Loop over columns of R, A and V
-   for (c=0; c<ncol; ++c) {
+   for (c=c0; c<c1; ++c) {
      // Copy (permuted) column of A to x
      for (k=a_colind[pc[c]]; k<a_colind[pc[c]+1]; ++k) x[prinv[a_row[k]]] = nz_a[k];
      // Use the equality R = (I-betan*vn*vn')*...*(I-beta1*v1*v1')*A to get
@@ -94,6 +88,28 @@ void casadi_qr(const casadi_int* sp_a, const T1* nz_a, T1* x,
    }
  }
 
+// SYMBOL "qr"
+// Numeric QR factorization
+// Ref: Chapter 5, Direct Methods for Sparse Linear Systems by Tim Davis
+// len[x] = nrow
+// sp_v = [nrow, ncol, 0, 0, ...] len[3 + ncol + nnz_v]
+// len[v] nnz_v
+// sp_r = [nrow, ncol, 0, 0, ...] len[3 + ncol + nnz_r]
+// len[r] nnz_r
+// len[beta] ncol
+template<typename T1>
+void casadi_qr(const casadi_int* sp_a, const T1* nz_a, T1* x,
+               const casadi_int* sp_v, T1* nz_v, const casadi_int* sp_r, T1* nz_r, T1* beta,
+               const casadi_int* prinv, const casadi_int* pc) {
+   // Local variables
+   casadi_int nrow, r;
+   nrow = sp_v[0];
+   // Clear work vector
+   for (r=0; r<nrow; ++r) x[r] = 0;
+   // All columns
+   casadi_qr_cols(sp_a, nz_a, x, sp_v, nz_v, sp_r, nz_r, beta, prinv, pc, 0, sp_a[1]);
+ }
+
 // SYMBOL "qr_mv"
 // Multiply QR Q matrix from the right with a vector, with Q represented
 // by the Householder vectors V and beta
@@ -43,6 +43,8 @@ struct casadi_qrqp_prob {
   T1 min_lam;
   // Maximum number of iterations
   casadi_int max_iter;
+  // Maximum number of low-rank updates before refactorizing
+  casadi_int max_update;
   // Primal and dual error tolerance
   T1 constr_viol_tol, dual_inf_tol;
 };
@@ -55,6 +57,7 @@ void casadi_qrqp_setup(casadi_qrqp_prob<T1>* p) {
   p->inf = std::numeric_limits<T1>::infinity();
   p->min_lam = 0;
   p->max_iter = 1000;
+  p->max_update = 10;
   p->constr_viol_tol = 1e-8;
   p->dual_inf_tol = 1e-8;
 }
@@ -83,6 +86,15 @@ struct casadi_qrqp_data {
   casadi_int *iw, *neverzero, *neverlower, *neverupper, *lincomb;
   // Numeric QR factorization
   T1 *nz_at, *nz_kkt, *beta, *nz_v, *nz_r;
+  // Low-rank updates of the factorization: M = M0 - V*E', C = I - E'*inv(M0)*V
+  T1 *up_y, *up_z, *up_c, *up_lu, *up_t, *up_r;
+  casadi_int *up_ind, *up_dir, *up_piv;
+  // Active set of the factorized KKT matrix
+  casadi_int *fact_act;
+  // Number of updates since the last factorization, -1 if none
+  casadi_int n_up;
+  // Number of factorizations from scratch in the current solve
+  casadi_int n_fact;
   // Message buffer
   const char *msg;
   // Message index
@@ -93,7 +105,7 @@ struct casadi_qrqp_data {
   casadi_int sing;
   // Do we already have a search direction?
   int has_search_dir;
-  // Smallest diagonal value for the QR factorization
+  // Smallest diagonal value for the QR factorization, or smallest pivot of C if imina==-1
   T1 mina;
   casadi_int imina;
   // Primal and dual error, corresponding index
@@ -109,18 +121,61 @@ struct casadi_qrqp_data {
 // C-REPLACE "casadi_qrqp_data<T1>" "struct casadi_qrqp_data"
 
 
+// SYMBOL "qrqp_fact_work"
+// Storage for the KKT factorization, not included in casadi_qrqp_work so that
+// it can be kept between calls
+template<typename T1>
+void casadi_qrqp_fact_work(const casadi_qrqp_prob<T1>* p, casadi_int* sz_iw, casadi_int* sz_w) {
+  // Local variables
+  casadi_int nnz_kkt, nnz_v, nnz_r;
+  // Get matrix number of nonzeros
+  nnz_kkt = p->sp_kkt[2+p->sp_kkt[1]];
+  nnz_v = p->sp_v[2+p->sp_v[1]];
+  nnz_r = p->sp_r[2+p->sp_r[1]];
+  *sz_w += casadi_max(nnz_v+nnz_r, nnz_kkt); // [v,r] or trans(kkt)
+  *sz_w += p->qp->nz; // beta
+  *sz_w += 2*p->max_update*p->qp->nz; // up_y, up_z
+  *sz_w += 2*p->max_update*p->max_update; // up_c, up_lu
+  *sz_iw += 3*p->max_update; // up_ind, up_dir, up_piv
+  *sz_iw += p->qp->nz; // fact_act
+}
+
+// SYMBOL "qrqp_fact_init"
+// Point to the storage for the KKT factorization, after casadi_qrqp_init
+template<typename T1>
+void casadi_qrqp_fact_init(casadi_qrqp_data<T1>* d, casadi_int** iw, T1** w) {
+  // Local variables
+  casadi_int nnz_kkt, nnz_v, nnz_r;
+  const casadi_qrqp_prob<T1>* p = d->prob;
+  // Get matrix number of nonzeros
+  nnz_kkt = p->sp_kkt[2+p->sp_kkt[1]];
+  nnz_v = p->sp_v[2+p->sp_v[1]];
+  nnz_r = p->sp_r[2+p->sp_r[1]];
+  d->nz_v = *w; *w += casadi_max(nnz_v+nnz_r, nnz_kkt);
+  d->nz_r = d->nz_v + nnz_v;
+  d->beta = *w; *w += p->qp->nz;
+  d->up_y = *w; *w += p->max_update*p->qp->nz;
+  d->up_z = *w; *w += p->max_update*p->qp->nz;
+  d->up_c = *w; *w += p->max_update*p->max_update;
+  d->up_lu = *w; *w += p->max_update*p->max_update;
+  d->up_ind = *iw; *iw += p->max_update;
+  d->up_dir = *iw; *iw += p->max_update;
+  d->up_piv = *iw; *iw += p->max_update;
+  d->fact_act = *iw; *iw += p->qp->nz;
+  // No factorization yet
+  d->n_up = -1;
+}
+
 // SYMBOL "qrqp_work"
 template<typename T1>
 void casadi_qrqp_work(const casadi_qrqp_prob<T1>* p, casadi_int* sz_arg, casadi_int* sz_res,
     casadi_int* sz_iw, casadi_int* sz_w) {
   // Local variables
-  casadi_int nnz_a, nnz_kkt, nnz_v, nnz_r;
+  casadi_int nnz_a, nnz_kkt;
   casadi_qp_work(p->qp, sz_arg, sz_res, sz_iw, sz_w);
   // Get matrix number of nonzeros
   nnz_a = p->qp->sp_a[2+p->qp->sp_a[1]];
   nnz_kkt = p->sp_kkt[2+p->sp_kkt[1]];
-  nnz_v = p->sp_v[2+p->sp_v[1]];
-  nnz_r = p->sp_r[2+p->sp_r[1]];
   // Temporary work vectors
   *sz_w = casadi_max(*sz_w, p->qp->nz); // casadi_project, tau memory
   *sz_iw = casadi_max(*sz_iw, p->qp->nz); // casadi_trans, tau type, allzero
@@ -133,12 +188,12 @@ void casadi_qrqp_work(const casadi_qrqp_prob<T1>* p, casadi_int* sz_arg, casadi_
   *sz_w += p->qp->nz; // lam
   *sz_w += p->qp->nz; // dz
   *sz_w += p->qp->nz; // dlam
-  *sz_w += casadi_max(nnz_v+nnz_r, nnz_kkt); // [v,r] or trans(kkt)
-  *sz_w += p->qp->nz; // beta
   *sz_w += nnz_a; // trans(a)
   *sz_w += p->qp->nx; // infeas
   *sz_w += p->qp->nx; // tinfeas
   *sz_w += p->qp->nz; // sens
+  *sz_w += p->max_update; // up_t
+  *sz_w += p->qp->nz; // up_r
   *sz_iw += p->qp->nz; // neverzero
   *sz_iw += p->qp->nz; // neverupper
   *sz_iw += p->qp->nz; // neverlower
@@ -149,13 +204,11 @@ void casadi_qrqp_work(const casadi_qrqp_prob<T1>* p, casadi_int* sz_arg, casadi_
 template<typename T1>
 void casadi_qrqp_init(casadi_qrqp_data<T1>* d, casadi_int** iw, T1** w) {
   // Local variables
-  casadi_int nnz_a, nnz_kkt, nnz_v, nnz_r;
+  casadi_int nnz_a, nnz_kkt;
   const casadi_qrqp_prob<T1>* p = d->prob;
   // Get matrix number of nonzeros
   nnz_a = p->qp->sp_a[2+p->qp->sp_a[1]];
   nnz_kkt = p->sp_kkt[2+p->sp_kkt[1]];
-  nnz_v = p->sp_v[2+p->sp_v[1]];
-  nnz_r = p->sp_r[2+p->sp_r[1]];
   d->nz_kkt = *w; *w += nnz_kkt;
   d->z = *w; *w += p->qp->nz;
   d->lbz = *w; *w += p->qp->nz;
@@ -163,20 +216,18 @@ void casadi_qrqp_init(casadi_qrqp_data<T1>* d, casadi_int** iw, T1** w) {
   d->lam = *w; *w += p->qp->nz;
   d->dz = *w; *w += p->qp->nz;
   d->dlam = *w; *w += p->qp->nz;
-  d->nz_v = *w; *w += casadi_max(nnz_v+nnz_r, nnz_kkt);
-  d->beta = *w; *w += p->qp->nz;
   d->nz_at = *w; *w += nnz_a;
   d->infeas = *w; *w += p->qp->nx;
   d->tinfeas = *w; *w += p->qp->nx;
   d->sens = *w; *w += p->qp->nz;
+  d->up_t = *w; *w += p->max_update;
+  d->up_r = *w; *w += p->qp->nz;
   d->neverzero = *iw; *iw += p->qp->nz;
   d->neverupper = *iw; *iw += p->qp->nz;
   d->neverlower = *iw; *iw += p->qp->nz;
   d->lincomb = *iw; *iw += p->qp->nz;
   d->w = *w;
   d->iw = *iw;
-
-  d->nz_r = d->nz_v + nnz_v;
 }
 
 // SYMBOL "qrqp_reset"
@@ -216,8 +267,9 @@ int casadi_qrqp_reset(casadi_qrqp_data<T1>* d) {
   // No restoration index
   d->r_index = -2;
   d->r_sign = 0;
-  // Reset iteration counter
+  // Reset iteration and factorization counters
   d->iter = 0;
+  d->n_fact = 0;
   return 0;
 }
 
@@ -669,47 +721,230 @@ void casadi_qrqp_take_step(casadi_qrqp_data<T1>* d) {
   }
 }
 
-// SYMBOL "qrqp_flip_check"
+// SYMBOL "qrqp_up_lu"
 template<typename T1>
-int casadi_qrqp_flip_check(casadi_qrqp_data<T1>* d) {
+int casadi_qrqp_up_lu(casadi_qrqp_data<T1>* d) {
+  // Local variables
+  casadi_int i, j, k, r, n, m;
+  T1 t, cmax, *lu;
   const casadi_qrqp_prob<T1>* p = d->prob;
-  // Calculate the difference between unenforced and enforced column index
-  casadi_qrqp_kkt_vector(d, d->dlam, d->index);
-  // Calculate the difference between old and new column index
-  if (d->sign == 0) casadi_scal(p->qp->nz, -1., d->dlam);
-  // Try to find a linear combination of the new columns
-  casadi_qr_solve(d->dlam, 1, 0, p->sp_v, d->nz_v, p->sp_r, d->nz_r, d->beta,
-    p->prinv, p->pc, d->w);
-  // If dlam[index]!=1, new columns must be linearly independent
-  if (fabs(d->dlam[d->index]-1.) >= 1e-12) return 0;
-  // Next, find a linear combination of the new rows
-  casadi_clear(d->dz, p->qp->nz);
-  d->dz[d->index] = 1;
-  casadi_qr_solve(d->dz, 1, 1, p->sp_v, d->nz_v, p->sp_r, d->nz_r, d->beta,
-    p->prinv, p->pc, d->w);
-  // Normalize dlam, dz
-  casadi_scal(p->qp->nz, 1./sqrt(casadi_dot(p->qp->nz, d->dlam, d->dlam)), d->dlam);
-  casadi_scal(p->qp->nz, 1./sqrt(casadi_dot(p->qp->nz, d->dz, d->dz)), d->dz);
-  // KKT system will be singular
-  return 1;
+  n = d->n_up;
+  m = p->max_update;
+  lu = d->up_lu;
+  // LU factorization of C with partial pivoting, in place
+  cmax = 1.;
+  for (j=0; j<n; ++j) {
+    casadi_copy(d->up_c + j*m, n, lu + j*m);
+    for (i=0; i<n; ++i) cmax = fmax(cmax, fabs(lu[i+j*m]));
+  }
+  for (k=0; k<n; ++k) {
+    // Find the pivot
+    r = k;
+    for (i=k+1; i<n; ++i) if (fabs(lu[i+k*m]) > fabs(lu[r+k*m])) r = i;
+    // Nearly singular update, relative to the largest entry of C, refactorize instead
+    if (fabs(lu[r+k*m]) < 1e-4 * cmax) return 1;
+    d->up_piv[k] = r;
+    // Swap rows
+    if (r != k) {
+      for (j=0; j<n; ++j) {
+        t = lu[k+j*m];
+        lu[k+j*m] = lu[r+j*m];
+        lu[r+j*m] = t;
+      }
+    }
+    // Eliminate below the pivot
+    for (i=k+1; i<n; ++i) lu[i+k*m] /= lu[k+k*m];
+    for (j=k+1; j<n; ++j) {
+      for (i=k+1; i<n; ++i) lu[i+j*m] -= lu[i+k*m] * lu[k+j*m];
+    }
+  }
+  // Report the smallest pivot instead of the smallest diagonal entry of R, with index -1
+  d->mina = fabs(lu[0]);
+  for (k=1; k<n; ++k) if (fabs(lu[k+k*m]) < d->mina) d->mina = fabs(lu[k+k*m]);
+  d->imina = -1;
+  return 0;
+}
+
+// SYMBOL "qrqp_solve"
+template<typename T1>
+void casadi_qrqp_solve(casadi_qrqp_data<T1>* d, T1* x, casadi_int tr) {
+  // Local variables
+  casadi_int i, k, n, m;
+  T1 t, *lu, *s;
+  const casadi_qrqp_prob<T1>* p = d->prob;
+  // Solve with the factorized matrix M0
+  casadi_qr_solve(x, 1, tr, p->sp_v, d->nz_v, p->sp_r, d->nz_r, d->beta,
+                  p->prinv, p->pc, d->w);
+  // Correct for the low-rank updates (Sherman-Morrison-Woodbury)
+  n = d->n_up;
+  if (n <= 0) return;
+  m = p->max_update;
+  lu = d->up_lu;
+  s = d->up_t;
+  if (tr) {
+    // s = C' \ V'x
+    for (k=0; k<n; ++k) s[k] = d->up_dir[k] * casadi_qrqp_kkt_dot(d, x, d->up_ind[k]);
+    for (k=0; k<n; ++k) {
+      for (i=0; i<k; ++i) s[k] -= lu[i+k*m] * s[i];
+      s[k] /= lu[k+k*m];
+    }
+    for (k=n-1; k>=0; --k) {
+      for (i=k+1; i<n; ++i) s[k] -= lu[i+k*m] * s[i];
+    }
+    for (k=n-1; k>=0; --k) {
+      t = s[k];
+      s[k] = s[d->up_piv[k]];
+      s[d->up_piv[k]] = t;
+    }
+    // x += inv(M0')*E*s
+    for (k=0; k<n; ++k) casadi_axpy(p->qp->nz, s[k], d->up_z + k*p->qp->nz, x);
+  } else {
+    // s = C \ E'x
+    for (k=0; k<n; ++k) s[k] = x[d->up_ind[k]];
+    for (k=0; k<n; ++k) {
+      t = s[k];
+      s[k] = s[d->up_piv[k]];
+      s[d->up_piv[k]] = t;
+    }
+    for (k=0; k<n; ++k) {
+      for (i=k+1; i<n; ++i) s[i] -= lu[i+k*m] * s[k];
+    }
+    for (k=n-1; k>=0; --k) {
+      s[k] /= lu[k+k*m];
+      for (i=0; i<k; ++i) s[i] -= lu[i+k*m] * s[k];
+    }
+    // x += inv(M0)*V*s
+    for (k=0; k<n; ++k) casadi_axpy(p->qp->nz, s[k], d->up_y + k*p->qp->nz, x);
+  }
+}
+
+// SYMBOL "qrqp_up_residual"
+// Largest residual of the transposed KKT system, with the active set of the factorization,
+// relative to the right-hand side b
+template<typename T1>
+T1 casadi_qrqp_up_residual(casadi_qrqp_data<T1>* d, const T1* x, const T1* b) {
+  // Local variables
+  casadi_int i;
+  T1 r, bmax, t;
+  const casadi_qrqp_prob<T1>* p = d->prob;
+  r = 0.;
+  bmax = 1.;
+  for (i=0; i<p->qp->nz; ++i) {
+    // Scalar product of x with column i of the KKT matrix
+    t = casadi_qrqp_kkt_dot(d, x, i);
+    if (i<p->qp->nx) {
+      t = d->fact_act[i] ? x[i] : x[i] - t;
+    } else {
+      t = d->fact_act[i] ? t - x[i] : -x[i];
+    }
+    r = fmax(r, fabs(b[i] - t));
+    bmax = fmax(bmax, fabs(b[i]));
+  }
+  return r / bmax;
+}
+
+// SYMBOL "qrqp_update"
+template<typename T1>
+int casadi_qrqp_update(casadi_qrqp_data<T1>* d, casadi_int i) {
+  // Local variables
+  casadi_int j, k, m, nz;
+  T1 *y, *z;
+  const casadi_qrqp_prob<T1>* p = d->prob;
+  k = d->n_up;
+  m = p->max_update;
+  nz = p->qp->nz;
+  // Too many updates, refactorize instead
+  if (k >= m) return 1;
+  y = d->up_y + k*nz;
+  z = d->up_z + k*nz;
+  // Difference between the old and the new column i, premultiplied by inv(M0)
+  casadi_qrqp_kkt_vector(d, y, i);
+  if (d->fact_act[i]) casadi_scal(nz, -1., y);
+  casadi_qr_solve(y, 1, 0, p->sp_v, d->nz_v, p->sp_r, d->nz_r, d->beta,
+                  p->prinv, p->pc, d->w);
+  // Unit vector i, premultiplied by inv(M0')
+  casadi_clear(z, nz);
+  z[i] = 1.;
+  casadi_qr_solve(z, 1, 1, p->sp_v, d->nz_v, p->sp_r, d->nz_r, d->beta,
+                  p->prinv, p->pc, d->w);
+  // Append a row and a column to C = I - E'*inv(M0)*V
+  for (j=0; j<k; ++j) {
+    d->up_c[j + k*m] = -y[d->up_ind[j]];
+    d->up_c[k + j*m] = -d->up_y[i + j*nz];
+  }
+  d->up_c[k + k*m] = 1. - y[i];
+  d->up_ind[k] = i;
+  d->up_dir[k] = d->fact_act[i] ? 1 : -1;
+  d->fact_act[i] = !d->fact_act[i];
+  d->n_up = k + 1;
+  // Factorize C
+  return casadi_qrqp_up_lu(d);
 }
 
 // SYMBOL "qrqp_factorize"
 template<typename T1>
 void casadi_qrqp_factorize(casadi_qrqp_data<T1>* d) {
+  // Local variables
+  casadi_int i;
   const casadi_qrqp_prob<T1>* p = d->prob;
   // Do we already have a search direction due to lost singularity?
   if (d->has_search_dir) {
     d->sing = 1;
     return;
   }
+  // Update the existing factorization for the columns that changed, if possible
+  if (d->n_up >= 0) {
+    for (i=0; i<p->qp->nz; ++i) {
+      if ((d->lam[i]!=0.) != d->fact_act[i] && casadi_qrqp_update(d, i)) break;
+    }
+    if (i==p->qp->nz) {
+      d->sing = 0;
+      return;
+    }
+  }
   // Construct the KKT matrix
   casadi_qrqp_kkt(d);
+  d->n_fact++;
   // QR factorization
   casadi_qr(p->sp_kkt, d->nz_kkt, d->w, p->sp_v, d->nz_v, p->sp_r,
             d->nz_r, d->beta, p->prinv, p->pc);
   // Check singularity
   d->sing = casadi_qr_singular(&d->mina, &d->imina, d->nz_r, p->sp_r, p->pc, 1e-12);
+  // Active set of the factorization, a singular one is overwritten in singular_step
+  for (i=0; i<p->qp->nz; ++i) d->fact_act[i] = d->lam[i]!=0.;
+  d->n_up = d->sing ? -1 : 0;
+}
+
+// SYMBOL "qrqp_flip_check"
+template<typename T1>
+int casadi_qrqp_flip_check(casadi_qrqp_data<T1>* d) {
+  const casadi_qrqp_prob<T1>* p = d->prob;
+  // Calculate the difference between unenforced and enforced column index
+  casadi_qrqp_kkt_vector(d, d->dlam, d->index);
+  // Calculate the difference between old and new column index
+  if (d->sign == 0) casadi_scal(p->qp->nz, -1., d->dlam);
+  // Try to find a linear combination of the new columns
+  casadi_qrqp_solve(d, d->dlam, 0);
+  // Borderline with an updated factorization: decide with a factorization from scratch
+  if (d->n_up > 0 && fabs(d->dlam[d->index]-1.) < 1e-6) {
+    d->n_up = -1;
+    casadi_qrqp_factorize(d);
+    if (d->sing) return 0;
+    casadi_qrqp_kkt_vector(d, d->dlam, d->index);
+    if (d->sign == 0) casadi_scal(p->qp->nz, -1., d->dlam);
+    casadi_qrqp_solve(d, d->dlam, 0);
+  }
+  // If dlam[index]!=1, new columns must be linearly independent
+  if (fabs(d->dlam[d->index]-1.) >= 1e-12) return 0;
+  // Next, find a linear combination of the new rows
+  casadi_clear(d->dz, p->qp->nz);
+  d->dz[d->index] = 1;
+  casadi_qrqp_solve(d, d->dz, 1);
+  // Normalize dlam, dz
+  casadi_scal(p->qp->nz, 1./sqrt(casadi_dot(p->qp->nz, d->dlam, d->dlam)), d->dlam);
+  casadi_scal(p->qp->nz, 1./sqrt(casadi_dot(p->qp->nz, d->dz, d->dz)), d->dz);
+  // KKT system will be singular
+  return 1;
 }
 
 // SYMBOL "qrqp_expand_step"
@@ -924,7 +1159,6 @@ int casadi_qrqp_singular_step(casadi_qrqp_data<T1>* d) {
 // SYMBOL "qrqp_calc_step"
 template<typename T1>
 int casadi_qrqp_calc_step(casadi_qrqp_data<T1>* d) {
-  // Local variables
   const casadi_qrqp_prob<T1>* p = d->prob;
   // Reset returns
   d->r_index = -1;
@@ -934,8 +1168,16 @@ int casadi_qrqp_calc_step(casadi_qrqp_data<T1>* d) {
   // Negative KKT residual
   casadi_qrqp_kkt_residual(d, d->dz);
   // Solve to get step in z[:nx] and lam[nx:]
-  casadi_qr_solve(d->dz, 1, 1, p->sp_v, d->nz_v, p->sp_r, d->nz_r, d->beta,
-                  p->prinv, p->pc, d->w);
+  if (d->n_up > 0) casadi_copy(d->dz, p->qp->nz, d->up_r);
+  casadi_qrqp_solve(d, d->dz, 1);
+  // Inaccurate solve with an updated factorization: factorize from scratch and solve again
+  if (d->n_up > 0 && casadi_qrqp_up_residual(d, d->dz, d->up_r) > 1e-10) {
+    d->n_up = -1;
+    casadi_qrqp_factorize(d);
+    if (d->sing) return casadi_qrqp_singular_step(d);
+    casadi_qrqp_kkt_residual(d, d->dz);
+    casadi_qrqp_solve(d, d->dz, 1);
+  }
   // Have step in dz[:nx] and dlam[nx:]. Calculate complete dz and dlam
   casadi_qrqp_expand_step(d);
   // Successful return
@@ -1084,6 +1326,11 @@ int casadi_qrqp_prepare(casadi_qrqp_data<T1>* d) {
   casadi_qrqp_flip(d);
   // Form and factorize the KKT system
   casadi_qrqp_factorize(d);
+  // Confirm termination with a factorization from scratch, which also detects singularity
+  if (!d->sing && d->n_up > 0 && (d->index == -1 || (d->ipr < 0 && d->idu < 0))) {
+    d->n_up = -1;
+    casadi_qrqp_factorize(d);
+  }
   // Termination message
   if (!d->sing && d->index == -1) {
     d->status = QP_SUCCESS;
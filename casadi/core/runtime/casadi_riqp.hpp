@@ -0,0 +1,391 @@
+//
+//    MIT No Attribution
+//
+//    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl, KU Leuven.
+//
+//    Permission is hereby granted, free of charge, to any person obtaining a copy of this
+//    software and associated documentation files (the "Software"), to deal in the Software
+//    without restriction, including without limitation the rights to use, copy, modify,
+//    merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+//    permit persons to whom the Software is furnished to do so.
+//
+//    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// Riccati recursion for the KKT systems of casadi_ipqp, for QPs with the stage structure
+// of an optimal control problem. The variables are ordered by stage, z_k = [x_k; u_k],
+// k = 0, ..., N. The constraints of stage k are nx[k+1] dynamics rows,
+// A_k*x_k + B_k*u_k + E_k*x_{k+1}, with E_k diagonal, followed by ng[k] general rows,
+// C_k*x_k + D_k*u_k. The Hessian is block diagonal with the stages.
+// The general rows are eliminated using the interior point weights. Equality
+// constraints other than the dynamics and fixed variables are enforced with the
+// penalty weight 1/reg. The dynamics must be equality constraints.
+
+// SYMBOL "riqp_prob"
+template<typename T1>
+struct casadi_riqp_prob {
+  // Sparsity patterns of H and A
+  const casadi_int *sp_h, *sp_a;
+  // Horizon
+  casadi_int N;
+  // Number of states, controls and general constraints, length N+1
+  const casadi_int *nx, *nu, *ng;
+  // Offsets of the stages in the variables and in the constraints, length N+2
+  const casadi_int *off_z, *off_a;
+  // Regularization of equality constraints and fixed variables
+  T1 reg;
+  // Size of the work vector
+  casadi_int sz_w;
+};
+// C-REPLACE "casadi_riqp_prob<T1>" "struct casadi_riqp_prob"
+
+// SYMBOL "riqp_setup"
+template<typename T1>
+void casadi_riqp_setup(casadi_riqp_prob<T1>* p) {
+  casadi_int k, nz, nx1, sz_v;
+  p->reg = 1e-10;
+  p->sz_w = 0;
+  sz_v = 0;
+  for (k=0; k<=p->N; ++k) {
+    nz = p->nx[k] + p->nu[k];
+    nx1 = k<p->N ? p->nx[k+1] : 0;
+    p->sz_w += nz*nz; // Riccati factors
+    p->sz_w += nx1*nz + nx1; // Dynamics, inverse of E
+    p->sz_w += p->ng[k]*nz + p->ng[k]; // General constraints, weights
+    if (nx1*nz > sz_v) sz_v = nx1*nz;
+    if (nz + nx1 > sz_v) sz_v = nz + nx1;
+  }
+  p->sz_w += p->off_z[p->N+1]; // Cost-to-go and control parts
+  p->sz_w += p->off_z[p->N+1]; // Solution
+  p->sz_w += sz_v;
+}
+
+// SYMBOL "riqp_data"
+template<typename T1>
+struct casadi_riqp_data {
+  // Problem structure
+  const casadi_riqp_prob<T1>* prob;
+  // Riccati factors, dense stage blocks
+  T1* r;
+  // Dynamics E_k^{-1}*[A_k, B_k], transposed, and inverse of E_k
+  T1 *a, *e;
+  // General constraints [C_k, D_k], transposed, and their weights
+  T1 *c, *dg;
+  // Cost-to-go p_k and the control parts t_k
+  T1* pt;
+  // Solution of the unscaled system
+  T1* z;
+  // Work vector
+  T1* v;
+};
+// C-REPLACE "casadi_riqp_data<T1>" "struct casadi_riqp_data"
+
+// SYMBOL "riqp_init"
+template<typename T1>
+void casadi_riqp_init(casadi_riqp_data<T1>* d, T1** w) {
+  casadi_int k, nz, nx1, sz_r, sz_a, sz_e, sz_c, sz_dg;
+  const casadi_riqp_prob<T1>* p = d->prob;
+  sz_r = sz_a = sz_e = sz_c = sz_dg = 0;
+  for (k=0; k<=p->N; ++k) {
+    nz = p->nx[k] + p->nu[k];
+    nx1 = k<p->N ? p->nx[k+1] : 0;
+    sz_r += nz*nz;
+    sz_a += nx1*nz;
+    sz_e += nx1;
+    sz_c += p->ng[k]*nz;
+    sz_dg += p->ng[k];
+  }
+  d->r = *w; *w += sz_r;
+  d->a = *w; *w += sz_a;
+  d->e = *w; *w += sz_e;
+  d->c = *w; *w += sz_c;
+  d->dg = *w; *w += sz_dg;
+  d->pt = *w; *w += p->off_z[p->N+1];
+  d->z = *w; *w += p->off_z[p->N+1];
+  d->v = *w;
+  *w += p->sz_w - sz_r - sz_a - sz_e - sz_c - sz_dg - 2*p->off_z[p->N+1];
+}
+
+// SYMBOL "riqp_chol"
+// Cholesky factorization of the n-by-n block at a, leading dimension lda, lower part
+template<typename T1>
+int casadi_riqp_chol(casadi_int n, T1* a, casadi_int lda) {
+  casadi_int i, j, k;
+  T1 s;
+  for (j=0; j<n; ++j) {
+    s = a[j + j*lda];
+    for (k=0; k<j; ++k) s -= a[j + k*lda] * a[j + k*lda];
+    if (!(s > 0)) return 1;
+    a[j + j*lda] = s = sqrt(s);
+    for (i=j+1; i<n; ++i) {
+      for (k=0; k<j; ++k) a[i + j*lda] -= a[i + k*lda] * a[j + k*lda];
+      a[i + j*lda] /= s;
+    }
+  }
+  return 0;
+}
+
+// SYMBOL "riqp_factor"
+// Assemble the stage blocks of the KKT system of casadi_ipqp with scaling S and
+// diagonal D, and factorize with a backward Riccati recursion. Nonzero if failed
+template<typename T1>
+int casadi_riqp_factor(casadi_riqp_data<T1>* d, const T1* h, const T1* a,
+    const T1* S, const T1* D) {
+  casadi_int N, k, i, j, l, nx, nu, nz, nx1, ng, nz1, oz, oa, nxt;
+  const casadi_int *h_colind, *h_row, *a_colind, *a_row;
+  T1 *r, *ak, *ek, *ck, *dgk, *r1, *t, s;
+  const casadi_riqp_prob<T1>* p = d->prob;
+  N = p->N;
+  nxt = p->off_z[N+1];
+  h_colind = p->sp_h + 2; h_row = h_colind + nxt + 1;
+  a_colind = p->sp_a + 2; a_row = a_colind + nxt + 1;
+  // Assemble the stage blocks
+  r = d->r; ak = d->a; ek = d->e; ck = d->c; dgk = d->dg;
+  for (k=0; k<=N; ++k) {
+    nx = p->nx[k]; nz = nx + p->nu[k]; ng = p->ng[k];
+    nx1 = k<N ? p->nx[k+1] : 0;
+    oz = p->off_z[k]; oa = p->off_a[k];
+    casadi_clear(r, nz*nz);
+    casadi_clear(ak, nx1*nz);
+    casadi_clear(ck, ng*nz);
+    for (j=0; j<nz; ++j) {
+      // Hessian block
+      for (l=h_colind[oz+j]; l<h_colind[oz+j+1]; ++l) r[h_row[l] - oz + j*nz] += h[l];
+      // Weight of the bounds, penalty for fixed variables
+      if (S[oz+j]==0) {
+        r[j + j*nz] += 1/p->reg;
+      } else {
+        r[j + j*nz] += D[oz+j] / (S[oz+j]*S[oz+j]);
+      }
+      // Constraint rows
+      for (l=a_colind[oz+j]; l<a_colind[oz+j+1]; ++l) {
+        i = a_row[l] - oa;
+        if (i<0) {
+          // Diagonal of E_{k-1}
+          if (a[l]==0) return 1;
+          ek[j - nx] = 1/a[l];
+        } else if (i<nx1) {
+          ak[j + i*nz] = a[l];
+        } else {
+          ck[j + (i - nx1)*nz] = a[l];
+        }
+      }
+    }
+    r += nz*nz; ak += nx1*nz; ek += nx1; ck += ng*nz; dgk += ng;
+  }
+  // Backward Riccati recursion
+  r1 = 0;
+  nz1 = 0;
+  for (k=N; k>=0; --k) {
+    nx = p->nx[k]; nu = p->nu[k]; nz = nx + nu; ng = p->ng[k];
+    nx1 = k<N ? p->nx[k+1] : 0;
+    oa = p->off_a[k];
+    r -= nz*nz; ak -= nx1*nz; ek -= nx1; ck -= ng*nz;
+    dgk -= ng;
+    // Weights of the general constraints
+    for (i=0; i<ng; ++i) {
+      l = nxt + oa + nx1 + i;
+      if (S[l]==0) {
+        dgk[i] = 0;
+      } else {
+        s = D[l] / (S[l]*S[l]);
+        dgk[i] = 1 / (s > p->reg ? s : p->reg);
+      }
+    }
+    // Add C'*diag(dg)*C, lower triangular part
+    for (i=0; i<ng; ++i) {
+      for (l=0; l<nz; ++l) {
+        s = dgk[i] * ck[l + i*nz];
+        for (j=l; j<nz; ++j) r[j + l*nz] += ck[j + i*nz] * s;
+      }
+    }
+    if (k<N) {
+      // The dynamics must be equality constraints
+      for (i=0; i<nx1; ++i) {
+        l = nxt + oa + i;
+        if (S[l]==0 || D[l]!=0) return 1;
+      }
+      // Scale with the inverse of E, x_{k+1} = E^{-1}*b - a_k*z_k
+      for (i=0; i<nx1; ++i) {
+        for (j=0; j<nz; ++j) ak[j + i*nz] *= ek[i];
+      }
+      // Add a_k'*P_{k+1}*a_k, lower triangular part
+      t = d->v;
+      casadi_clear(t, nx1*nz);
+      for (j=0; j<nz; ++j) {
+        for (l=0; l<nx1; ++l) {
+          s = ak[j + l*nz];
+          for (i=0; i<nx1; ++i) t[i + j*nx1] += r1[i + l*nz1] * s;
+        }
+      }
+      for (j=0; j<nz; ++j) {
+        for (l=0; l<nx1; ++l) {
+          s = t[l + j*nx1];
+          for (i=j; i<nz; ++i) r[i + j*nz] += ak[i + l*nz] * s;
+        }
+      }
+    }
+    // Symmetrize
+    for (j=0; j<nz; ++j) {
+      for (i=j+1; i<nz; ++i) r[j + i*nz] = r[i + j*nz];
+    }
+    // Cholesky factorization of the control block
+    if (casadi_riqp_chol(nu, r + nx + nx*nz, nz)) return 1;
+    // Coupling block, overwritten with [W_xu]*L^{-T}
+    for (j=nx; j<nz; ++j) {
+      for (l=nx; l<j; ++l) {
+        for (i=0; i<nx; ++i) r[i + j*nz] -= r[i + l*nz] * r[j + l*nz];
+      }
+      for (i=0; i<nx; ++i) r[i + j*nz] /= r[j + j*nz];
+    }
+    // Cost-to-go, P_k = W_xx - [W_xu]*W_uu^{-1}*[W_ux]
+    for (l=nx; l<nz; ++l) {
+      for (j=0; j<nx; ++j) {
+        s = r[j + l*nz];
+        for (i=0; i<nx; ++i) r[i + j*nz] -= r[i + l*nz] * s;
+      }
+    }
+    r1 = r;
+    nz1 = nz;
+  }
+  // Factorize P_0
+  if (casadi_riqp_chol(p->nx[0], d->r, p->nx[0] + p->nu[0])) return 1;
+  return 0;
+}
+
+// SYMBOL "riqp_solve"
+// Solve the KKT system of casadi_ipqp with scaling S and diagonal D, in-place
+template<typename T1>
+void casadi_riqp_solve(casadi_riqp_data<T1>* d, const T1* S, const T1* D, T1* x) {
+  casadi_int N, k, i, j, l, nx, nu, nz, nx1, ng, nz1, oz, oa, nxt, na;
+  T1 *r, *ak, *ek, *ck, *dgk, *pt, *r1, *pt1, *v, *b, *y, s;
+  const casadi_riqp_prob<T1>* p = d->prob;
+  N = p->N;
+  nxt = p->off_z[N+1];
+  na = p->off_a[N+1];
+  // Right-hand side of the unscaled system
+  for (j=0; j<nxt; ++j) d->z[j] = S[j]==0 ? 0 : x[j] / S[j];
+  for (i=nxt; i<nxt+na; ++i) {
+    if (S[i]!=0) x[i] /= S[i];
+  }
+  // Pointers past the last stage
+  r = d->r; ak = d->a; ek = d->e; ck = d->c; dgk = d->dg;
+  for (k=0; k<=N; ++k) {
+    nz = p->nx[k] + p->nu[k];
+    nx1 = k<N ? p->nx[k+1] : 0;
+    r += nz*nz; ak += nx1*nz; ek += nx1; ck += p->ng[k]*nz; dgk += p->ng[k];
+  }
+  pt = d->pt + nxt;
+  // Backward sweep
+  r1 = pt1 = 0;
+  nz1 = 0;
+  v = d->v;
+  for (k=N; k>=0; --k) {
+    nx = p->nx[k]; nu = p->nu[k]; nz = nx + nu; ng = p->ng[k];
+    nx1 = k<N ? p->nx[k+1] : 0;
+    oz = p->off_z[k]; oa = p->off_a[k];
+    r -= nz*nz; ak -= nx1*nz; ek -= nx1; ck -= ng*nz; dgk -= ng; pt -= nz;
+    // Gradient, with the general constraints eliminated
+    b = x + nxt + oa + nx1;
+    casadi_copy(d->z + oz, nz, v);
+    for (i=0; i<ng; ++i) {
+      s = dgk[i] * b[i];
+      for (j=0; j<nz; ++j) v[j] += ck[j + i*nz] * s;
+    }
+    if (k<N) {
+      // p_{k+1} - P_{k+1}*E^{-1}*b
+      b = x + nxt + oa;
+      for (i=0; i<nx1; ++i) {
+        s = pt1[i];
+        for (l=0; l<nx1; ++l) s -= r1[i + l*nz1] * ek[l] * b[l];
+        v[nz + i] = s;
+      }
+      for (i=0; i<nx1; ++i) {
+        s = v[nz + i];
+        for (j=0; j<nz; ++j) v[j] -= ak[j + i*nz] * s;
+      }
+    }
+    // t_k = L^{-1}*v_u
+    for (j=nx; j<nz; ++j) {
+      s = v[j];
+      for (l=nx; l<j; ++l) s -= r[j + l*nz] * pt[l];
+      pt[j] = s / r[j + j*nz];
+    }
+    // p_k = v_x - [W_xu]*L^{-T}*t_k
+    for (i=0; i<nx; ++i) {
+      s = v[i];
+      for (l=nx; l<nz; ++l) s -= r[i + l*nz] * pt[l];
+      pt[i] = s;
+    }
+    r1 = r;
+    pt1 = pt;
+    nz1 = nz;
+  }
+  // Initial state, P_0*x_0 = p_0
+  nx = p->nx[0];
+  nz = nx + p->nu[0];
+  y = d->z;
+  for (i=0; i<nx; ++i) {
+    s = pt[i];
+    for (l=0; l<i; ++l) s -= r[i + l*nz] * y[l];
+    y[i] = s / r[i + i*nz];
+  }
+  for (i=nx; i-- > 0; ) {
+    s = y[i];
+    for (l=i+1; l<nx; ++l) s -= r[l + i*nz] * y[l];
+    y[i] = s / r[i + i*nz];
+  }
+  // Forward sweep
+  for (k=0; k<=N; ++k) {
+    nx = p->nx[k]; nu = p->nu[k]; nz = nx + nu; ng = p->ng[k];
+    nx1 = k<N ? p->nx[k+1] : 0;
+    oz = p->off_z[k]; oa = p->off_a[k];
+    y = d->z + oz;
+    // u_k = L^{-T}*(t_k - L^{-1}*[W_ux]*x_k)
+    for (j=nx; j<nz; ++j) {
+      s = pt[j];
+      for (i=0; i<nx; ++i) s -= r[i + j*nz] * y[i];
+      y[j] = s;
+    }
+    for (j=nz; j-- > nx; ) {
+      s = y[j];
+      for (l=j+1; l<nz; ++l) s -= r[l + j*nz] * y[l];
+      y[j] = s / r[j + j*nz];
+    }
+    // Multipliers of the general constraints
+    b = x + nxt + oa + nx1;
+    for (i=0; i<ng; ++i) {
+      if (dgk[i]==0) continue;
+      s = -b[i];
+      for (j=0; j<nz; ++j) s += ck[j + i*nz] * y[j];
+      b[i] = dgk[i] * s;
+    }
+    if (k<N) {
+      // Next state
+      b = x + nxt + oa;
+      for (i=0; i<nx1; ++i) {
+        s = ek[i] * b[i];
+        for (j=0; j<nz; ++j) s -= ak[j + i*nz] * y[j];
+        y[nz + i] = s;
+      }
+      // Multipliers of the dynamics, E^{-1}*(p_{k+1} - P_{k+1}*x_{k+1})
+      r1 = r + nz*nz;
+      pt1 = pt + nz;
+      nz1 = nx1 + p->nu[k+1];
+      for (i=0; i<nx1; ++i) {
+        s = pt1[i];
+        for (l=0; l<nx1; ++l) s -= r1[i + l*nz1] * y[nz + l];
+        b[i] = ek[i] * s;
+      }
+    }
+    r += nz*nz; ak += nx1*nz; ek += nx1; ck += ng*nz; dgk += ng; pt += nz;
+  }
+  // Scale the solution
+  for (j=0; j<nxt; ++j) x[j] = S[j]==0 ? x[j] / D[j] : d->z[j] / S[j];
+  for (i=nxt; i<nxt+na; ++i) x[i] = S[i]==0 ? -x[i] / D[i] : x[i] / S[i];
+}
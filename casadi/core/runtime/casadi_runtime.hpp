@@ -292,11 +292,13 @@ namespace casadi {
   #include "casadi_qrqp.hpp"
   #include "casadi_kkt.hpp"
   #include "casadi_ipqp.hpp"
+  #include "casadi_riqp.hpp"
   #include "casadi_oracle.hpp"
   #include "casadi_nlp.hpp"
   #include "casadi_sqpmethod.hpp"
   #include "casadi_feasiblesqpmethod.hpp"
   #include "casadi_bfgs.hpp"
+  #include "casadi_lbfgs.hpp"
   #include "casadi_regularize.hpp"
   #include "casadi_newton.hpp"
   #include "casadi_bound_consistency.hpp"
@@ -28,6 +28,8 @@ struct casadi_sqpmethod_prob {
   const casadi_int *sp_h, *sp_a, *sp_hr;
   casadi_int merit_memsize;
   casadi_int max_iter_ls;
+  // Number of pairs of a compact L-BFGS approximation, 0 if not used
+  casadi_int lbfgs_memory;
 };
 // C-REPLACE "casadi_sqpmethod_prob<T1>" "struct casadi_sqpmethod_prob"
 
@@ -57,6 +59,13 @@ struct casadi_sqpmethod_data {
   T1* temp_mem;
   // temp_sol
   T1* temp_sol;
+  // Compact L-BFGS: stored pairs and factor
+  T1 *lbfgs_s, *lbfgs_y, *lbfgs_p, *lbfgs_c;
+  // Compact L-BFGS: scaling and number of stored pairs
+  T1 lbfgs_delta;
+  casadi_int lbfgs_n;
+  // QP lifted with the compact L-BFGS factor
+  T1 *qp_a, *qp_g, *qp_lbz, *qp_ubz, *qp_x, *qp_lam;
 
   const T1** arg;
   T1** res;
@@ -71,11 +80,12 @@ template<typename T1>
 void casadi_sqpmethod_work(const casadi_sqpmethod_prob<T1>* p,
     casadi_int* sz_iw, casadi_int* sz_w, int elastic_mode, int so_corr) {
   // Local variables
-  casadi_int nnz_h, nnz_a, nx, ng;
+  casadi_int nnz_h, nnz_a, nx, ng, m;
   nnz_h = p->sp_h[2+p->sp_h[1]];
   nnz_a = p->sp_a[2+p->sp_a[1]];
   nx = p->nlp->nx;
   ng = p->nlp->ng;
+  m = p->lbfgs_memory;
 
   // Reset sz_w, sz_iw
   *sz_w = *sz_iw = 0;
@@ -114,6 +124,18 @@ void casadi_sqpmethod_work(const casadi_sqpmethod_prob<T1>* p,
   }
 
   if (so_corr) *sz_w += nx+nx+ng; // Temp memory for failing soc
+
+  if (m>0) {
+    // Compact L-BFGS
+    *sz_w += 4*nx*m; // lbfgs_s, lbfgs_y, lbfgs_p, lbfgs_c
+    // Lifted QP
+    *sz_w += nnz_a + (nx+1)*m; // qp_a
+    *sz_w += nx + m; // qp_g
+    *sz_w += nx + ng + 2*m; // qp_lbz
+    *sz_w += nx + ng + 2*m; // qp_ubz
+    *sz_w += nx + m; // qp_x
+    *sz_w += nx + ng + 2*m; // qp_lam
+  }
 }
 
 // SYMBOL "sqpmethod_init"
@@ -122,13 +144,14 @@ void casadi_sqpmethod_init(casadi_sqpmethod_data<T1>* d,
     const T1*** arg, T1*** res, casadi_int** iw, T1** w,
     int elastic_mode, int so_corr) {
   // Local variables
-  casadi_int nnz_h, nnz_a, nx, ng;
+  casadi_int nnz_h, nnz_a, nx, ng, m;
   const casadi_sqpmethod_prob<T1>* p = d->prob;
   // Get matrix number of nonzeros
   nnz_h = p->sp_h[2+p->sp_h[1]];
   nnz_a = p->sp_a[2+p->sp_a[1]];
   nx = p->nlp->nx;
   ng = p->nlp->ng;
+  m = p->lbfgs_memory;
   if (p->max_iter_ls>0 || so_corr) {
     d->z_cand = *w; *w += nx + ng;
   }
@@ -171,6 +194,20 @@ void casadi_sqpmethod_init(casadi_sqpmethod_data<T1>* d,
     // Jacobian
     d->Jk = *w; *w += nnz_a;
   }
+  if (m>0) {
+    // Compact L-BFGS
+    d->lbfgs_s = *w; *w += nx*m;
+    d->lbfgs_y = *w; *w += nx*m;
+    d->lbfgs_p = *w; *w += nx*m;
+    d->lbfgs_c = *w; *w += nx*m;
+    // Lifted QP
+    d->qp_a = *w; *w += nnz_a + (nx+1)*m;
+    d->qp_g = *w; *w += nx + m;
+    d->qp_lbz = *w; *w += nx + ng + 2*m;
+    d->qp_ubz = *w; *w += nx + ng + 2*m;
+    d->qp_x = *w; *w += nx + m;
+    d->qp_lam = *w; *w += nx + ng + 2*m;
+  }
   d->arg = *arg;
   d->res = *res;
   d->iw = *iw;
@@ -141,7 +141,18 @@ namespace casadi {
   SharedObject WeakRef::shared() const {
     SharedObject ret;
     if (alive()) {
+#ifdef CASADI_WITH_THREAD
+      // The last owning reference may have been released by another thread, with
+      // the object not yet destroyed: only take a reference if the count is nonzero
+      SharedObjectInternal* raw = (*this)->raw_;
+      casadi_int c = raw->count.load();
+      do {
+        if (c==0) return ret;
+      } while (!raw->count.compare_exchange_weak(c, c+1));
+      ret.assign(raw);
+#else // CASADI_WITH_THREAD
       ret.own((*this)->raw_);
+#endif // CASADI_WITH_THREAD
     }
     return ret;
   }
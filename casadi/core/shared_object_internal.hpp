@@ -38,6 +38,7 @@ namespace casadi {
   /// Internal class for the reference counting framework, see comments on the public class.
   class CASADI_EXPORT SharedObjectInternal {
     friend class SharedObject;
+    friend class WeakRef;
     friend class Memory;
     friend class UniversalNodeOwner;
   public:
@@ -80,6 +81,16 @@ namespace casadi {
       count--;
     }
 
+    /// Has a weak reference to the object been created
+    bool has_weak() const { return weak_ref_!=nullptr;}
+
+    /** \brief Mark the weak reference, if any, as expired
+
+        To be called by derived classes which need the expiry to happen
+        before the object is partially destroyed, e.g. while holding a lock.
+    */
+    void kill_weak();
+
     /// Get a shared object from the current internal object
     template<class B>
     B shared_from_this();
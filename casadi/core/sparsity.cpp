@@ -30,6 +30,14 @@
 #include "serializing_stream.hpp"
 #include <climits>
 
+#ifdef CASADI_WITH_THREAD
+#ifdef CASADI_WITH_THREAD_MINGW
+#include <mingw.mutex.h>
+#else // CASADI_WITH_THREAD_MINGW
+#include <mutex>
+#endif // CASADI_WITH_THREAD_MINGW
+#endif //CASADI_WITH_THREAD
+
 #define CASADI_THROW_ERROR(FNAME, WHAT) \
 throw CasadiException("Error in Sparsity::" FNAME " at " + CASADI_WHERE + ":\n"\
   + std::string(WHAT));
@@ -520,10 +528,39 @@ namespace casadi {
     }
   }
 
-  Sparsity::CachingMap& Sparsity::getCache() {
-    static CachingMap ret;
-    return ret;
+  /// \cond INTERNAL
+  // Partition of the sparsity pattern cache
+  struct SparsityCacheStripe {
+    Sparsity::CachingMap cache;
+#ifdef CASADI_WITH_THREAD
+    std::recursive_mutex mtx;
+#endif // CASADI_WITH_THREAD
+  };
+
+  // Allocated once and never freed, patterns may be released during static destruction
+  static SparsityCacheStripe& cache_stripe(std::size_t h) {
+    static SparsityCacheStripe* stripes = new SparsityCacheStripe[Sparsity::cache_n_stripe];
+    return stripes[h % Sparsity::cache_n_stripe];
   }
+  /// \endcond
+
+  Sparsity::CachingMap& Sparsity::getCache(std::size_t h) {
+    return cache_stripe(h).cache;
+  }
+
+#ifdef CASADI_WITH_THREAD
+  SparsityCacheLock::SparsityCacheLock(std::size_t h) : stripe_(h % Sparsity::cache_n_stripe) {
+    cache_stripe(stripe_).mtx.lock();
+  }
+
+  SparsityCacheLock::~SparsityCacheLock() {
+    cache_stripe(stripe_).mtx.unlock();
+  }
+#else // CASADI_WITH_THREAD
+  SparsityCacheLock::SparsityCacheLock(std::size_t h) {}
+
+  SparsityCacheLock::~SparsityCacheLock() {}
+#endif // CASADI_WITH_THREAD
 
   const Sparsity& Sparsity::getScalar() {
     static ScalarSparsity ret;
@@ -765,6 +802,18 @@ namespace casadi {
     return (*this)->largest_first();
   }
 
+  std::vector<casadi_int> Sparsity::smallest_last() const {
+    return (*this)->smallest_last();
+  }
+
+  std::vector<casadi_int> Sparsity::incidence_degree() const {
+    return (*this)->incidence_degree();
+  }
+
+  std::vector<casadi_int> Sparsity::dynamic_largest_first() const {
+    return (*this)->dynamic_largest_first();
+  }
+
   Sparsity Sparsity::pmult(const std::vector<casadi_int>& p, bool permute_rows,
                             bool permute_columns, bool invert_permutation) const {
     return (*this)->pmult(p, permute_rows, permute_columns, invert_permutation);
@@ -872,8 +921,13 @@ namespace casadi {
     // Hash the pattern
     std::size_t h = hash_sparsity(nrow, ncol, colind, row);
 
-    // Get a reference to the cache
-    CachingMap& cache = getCache();
+    // Keep the current pattern until the lock below has been released, since
+    // releasing it may require locking a different partition of the cache
+    Sparsity prev = *this;
+
+    // Lock and get a reference to the cache partition
+    SparsityCacheLock lock(h);
+    CachingMap& cache = getCache(h);
 
     // Record the current number of buckets (for garbage collection below)
     casadi_int bucket_count_before = cache.bucket_count();
@@ -890,11 +944,14 @@ namespace casadi {
         // Get a weak reference to the cached sparsity pattern
         WeakRef& wref = i->second;
 
+        // Get an owning reference to the cached pattern, if it still exists
+        SharedObject ref_obj = wref.shared();
+
         // Check if the pattern still exists
-        if (wref.alive()) {
+        if (!ref_obj.is_null()) {
 
           // Get an owning reference to the cached pattern
-          Sparsity ref = shared_cast<Sparsity>(wref.shared());
+          Sparsity ref = shared_cast<Sparsity>(ref_obj);
 
           // Check if the pattern matches
           if (ref.is_equal(nrow, ncol, colind, row)) {
@@ -913,10 +970,11 @@ namespace casadi {
           CachingMap::iterator j=i;
           j++; // Start at the next matching key
           for (; j!=eq.second; ++j) {
-            if (j->second.alive()) {
+            SharedObject ref_obj = j->second.shared();
+            if (!ref_obj.is_null()) {
 
               // Recover cached sparsity
-              Sparsity ref = shared_cast<Sparsity>(j->second.shared());
+              Sparsity ref = shared_cast<Sparsity>(ref_obj);
 
               // Match found if sparsity matches
               if (ref.is_equal(nrow, ncol, colind, row)) {
@@ -873,8 +873,11 @@ namespace casadi {
 #ifndef SWIG
     typedef std::unordered_multimap<std::size_t, WeakRef> CachingMap;
 
-    /// Cached sparsity patterns
-    static CachingMap& getCache();
+    /// Number of partitions of the sparsity pattern cache, each with its own lock
+    static const casadi_int cache_n_stripe = 64;
+
+    /// Cached sparsity patterns, partition containing a given hash
+    static CachingMap& getCache(std::size_t h);
 
     /// (Dense) scalar
     static const Sparsity& getScalar();
@@ -1043,7 +1046,9 @@ namespace casadi {
           A. H. GEBREMEDHIN, F. MANNE, A. POTHEN
           SIAM Rev., 47(4), 629–705 (2006)
 
-        Ordering options: None (0), largest first (1)
+        Ordering options: None (0), largest first (1), smallest last (2),
+        incidence degree (3), dynamic largest first (4) or the one of these
+        resulting in the fewest colors (-1)
 
         \identifier{dc} */
     Sparsity star_coloring(casadi_int ordering = 1,
@@ -1057,7 +1062,7 @@ namespace casadi {
           A. H. GEBREMEDHIN, A. TARAFDAR, F. MANNE, A. POTHEN
           SIAM J. SCI. COMPUT. Vol. 29, No. 3, pp. 1042–1072 (2007)
 
-        Ordering options: None (0), largest first (1)
+        Ordering options: as for star_coloring
 
         \identifier{dd} */
     Sparsity star_coloring2(casadi_int ordering = 1,
@@ -1068,6 +1073,29 @@ namespace casadi {
         \identifier{de} */
     std::vector<casadi_int> largest_first() const;
 
+    /** \brief Order the columns by repeatedly removing a column of smallest degree
+
+        The columns are removed from the adjacency graph of a symmetric pattern
+        one at a time and ordered in reverse order of removal.
+        Matula & Beck, J. ACM 30(3), 417-427 (1983)
+
+        \identifier{28i} */
+    std::vector<casadi_int> smallest_last() const;
+
+    /** \brief Order the columns by decreasing number of already ordered neighbors
+
+        Adjacency graph of a symmetric pattern, ties broken by largest degree
+
+        \identifier{28j} */
+    std::vector<casadi_int> incidence_degree() const;
+
+    /** \brief Order the columns by decreasing degree among the columns not yet ordered
+
+        Adjacency graph of a symmetric pattern
+
+        \identifier{28k} */
+    std::vector<casadi_int> dynamic_largest_first() const;
+
     /** \brief Permute rows and/or columns
 
         Multiply the sparsity with a permutation matrix from the left and/or from the right
@@ -30,6 +30,7 @@
 #include <climits>
 #include <cstdlib>
 #include <cmath>
+#include <queue>
 
 namespace casadi {
   void SparsityInternal::etree(const casadi_int* sp, casadi_int* parent,
@@ -124,6 +125,95 @@ namespace casadi {
     }
   }
 
+  void SparsityInternal::etree_partition(const std::vector<casadi_int>& parent,
+      const std::vector<double>& work, casadi_int n_thread, std::vector<casadi_int>& par,
+      std::vector<casadi_int>& par_ind, std::vector<casadi_int>& ser) {
+    casadi_int n = parent.size();
+    casadi_int c, i;
+    // Work, size and first column of each subtree, children as linked lists
+    std::vector<double> sub_work(work);
+    std::vector<casadi_int> sub_size(n, 1), first(n), head(n, -1), next(n, -1);
+    for (c=0; c<n; ++c) first[c] = c;
+    for (c=0; c<n; ++c) {
+      if (parent[c]>=0) {
+        casadi_assert(parent[c]>c, "Elimination tree not postordered");
+        sub_work[parent[c]] += sub_work[c];
+        sub_size[parent[c]] += sub_size[c];
+        first[parent[c]] = std::min(first[parent[c]], first[c]);
+      }
+      casadi_assert(first[c]+sub_size[c]==c+1, "Elimination tree not postordered");
+    }
+    for (c=n-1; c>=0; --c) {
+      if (parent[c]>=0) {
+        next[c] = head[parent[c]];
+        head[parent[c]] = c;
+      }
+    }
+    // Subtrees, heaviest first
+    std::priority_queue<std::pair<double, casadi_int> > subtrees;
+    double total = 0, sum = 0, serial = 0;
+    for (c=0; c<n; ++c) {
+      total += work[c];
+      if (parent[c]<0) {
+        subtrees.push(std::make_pair(sub_work[c], c));
+        sum += sub_work[c];
+      }
+    }
+    // Split the heaviest subtree as long as it is heavier than the average
+    std::vector<casadi_int> split;
+    double best = total;
+    casadi_int n_split = -1;
+    while (!subtrees.empty()) {
+      double t = serial + std::max(subtrees.top().first, sum/static_cast<double>(n_thread));
+      if (t<best) {
+        best = t;
+        n_split = split.size();
+      }
+      if (subtrees.top().first*static_cast<double>(n_thread)<=sum) break;
+      c = subtrees.top().second;
+      subtrees.pop();
+      serial += work[c];
+      sum -= work[c];
+      for (i=head[c]; i>=0; i=next[i]) subtrees.push(std::make_pair(sub_work[i], i));
+      split.push_back(c);
+    }
+    // Remaining columns
+    std::vector<bool> is_split(n, false);
+    if (n_split<0) {
+      // No gain, all columns serial
+      n_split = split.size();
+      is_split.assign(n, true);
+    }
+    for (i=0; i<n_split; ++i) is_split[split[i]] = true;
+    // Subtrees, increasing column order, grouped into chunks
+    double chunk_work = 0, target = (total-serial)/static_cast<double>(4*n_thread);
+    par.clear();
+    par_ind.assign(1, 0);
+    ser.clear();
+    for (c=0; c<n; ++c) {
+      if (is_split[c]) {
+        // Remaining column
+        if (!ser.empty() && ser.back()==c) {
+          ser.back() = c + 1;
+        } else {
+          ser.push_back(c);
+          ser.push_back(c + 1);
+        }
+      } else if (parent[c]<0 || is_split[parent[c]]) {
+        // Root of a subtree
+        par.push_back(first[c]);
+        par.push_back(c + 1);
+        chunk_work += sub_work[c];
+        if (chunk_work>=target) {
+          par_ind.push_back(par.size()/2);
+          chunk_work = 0;
+        }
+      }
+    }
+    casadi_int n_par = par.size()/2;
+    if (par_ind.back()!=n_par) par_ind.push_back(n_par);
+  }
+
   casadi_int SparsityInternal::
   leaf(casadi_int i, casadi_int j, const casadi_int* first, casadi_int* maxfirst,
        casadi_int* prevleaf, casadi_int* ancestor, casadi_int* jleaf) {
@@ -446,6 +536,63 @@ namespace casadi {
     }
   }
 
+  std::vector<casadi_int> SparsityInternal::
+  ldl_supernodes(const casadi_int* sp_lt, casadi_int& sz_w) {
+    // Extract sparsity
+    casadi_int n = sp_lt[1];
+    const casadi_int *colind = sp_lt+2, *row = sp_lt+2+n+1;
+    // Local variables
+    casadi_int i, j, k, J, nc, ns;
+    // Number of nonzeros in each column of L and parent in the elimination tree
+    std::vector<casadi_int> cnt(n, 0), parent(n, -1);
+    for (i=0; i<n; ++i) {
+      for (k=colind[i]; k<colind[i+1]; ++k) {
+        j = row[k];
+        if (cnt[j]++==0) parent[j] = i;
+      }
+    }
+    // First column of each supernode
+    std::vector<casadi_int> sn_col(1, 0);
+    for (j=1; j<n; ++j) {
+      if (parent[j-1]!=j || cnt[j-1]!=cnt[j]+1) sn_col.push_back(j);
+    }
+    if (n>0) sn_col.push_back(n);
+    casadi_int nsn = sn_col.size()-1;
+    // Supernode of each column
+    std::vector<casadi_int> sn_of(n);
+    for (J=0; J<nsn; ++J) {
+      for (j=sn_col[J]; j<sn_col[J+1]; ++j) sn_of[j] = J;
+    }
+    // Rows below each supernode, size of the largest dense panel
+    std::vector<casadi_int> sn_ind(nsn+1, 0);
+    sz_w = 0;
+    for (J=0; J<nsn; ++J) {
+      nc = sn_col[J+1] - sn_col[J];
+      ns = cnt[sn_col[J]] - (nc-1);
+      sn_ind[J+1] = sn_ind[J] + ns;
+      sz_w = std::max(sz_w, (nc+ns)*nc);
+    }
+    sz_w += 3*n;
+    // Assemble the return vector
+    std::vector<casadi_int> sn(1 + 2*(nsn+1) + 2*sn_ind[nsn]);
+    sn[0] = nsn;
+    std::copy(sn_col.begin(), sn_col.end(), sn.begin()+1);
+    std::copy(sn_ind.begin(), sn_ind.end(), sn.begin()+1+nsn+1);
+    casadi_int *sn_row = get_ptr(sn)+1+2*(nsn+1), *sn_off = sn_row+sn_ind[nsn];
+    // Row i and position of L(i, j0) in L^T for each supernode, increasing i
+    std::vector<casadi_int> next(sn_ind.begin(), sn_ind.end()-1);
+    for (i=0; i<n; ++i) {
+      for (k=colind[i]; k<colind[i+1]; ++k) {
+        J = sn_of[row[k]];
+        if (row[k]==sn_col[J] && i>=sn_col[J+1]) {
+          sn_row[next[J]] = i;
+          sn_off[next[J]++] = k;
+        }
+      }
+    }
+    return sn;
+  }
+
   SparsityInternal::
   SparsityInternal(casadi_int nrow, casadi_int ncol,
       const casadi_int* colind, const casadi_int* row) :
@@ -454,9 +601,81 @@ namespace casadi {
     sp_[1] = ncol;
     std::copy(colind, colind+ncol+1, sp_.begin()+2);
     std::copy(row, row+colind[ncol], sp_.begin()+2+ncol+1);
+    classify();
+  }
+
+  void SparsityInternal::classify() {
+    const casadi_int* colind = this->colind();
+    const casadi_int* row = this->row();
+    casadi_int n = size2();
+    kind_ = SparsityKind::GENERAL;
+    lower_ = upper_ = block_ = 0;
+
+    // Dense, not square
+    if (!is_square()) {
+      if (nnz()==numel() && nnz()>0) kind_ = SparsityKind::DENSE;
+      return;
+    }
+    if (n==0) return;
+
+    // Banded: every column contiguous and containing the diagonal
+    bool banded = true;
+    for (casadi_int c=0; c<n && banded; ++c) {
+      casadi_int nc = colind[c+1]-colind[c];
+      if (nc==0) {
+        banded = false;
+      } else {
+        casadi_int first = row[colind[c]], last = row[colind[c+1]-1];
+        banded = first<=c && last>=c && last-first+1==nc;
+        upper_ = std::max(upper_, c-first);
+        lower_ = std::max(lower_, last-c);
+      }
+    }
+    if (banded) {
+      // ... and no entry within the bandwidths missing
+      casadi_int nnz_band = 0;
+      for (casadi_int c=0; c<n; ++c) {
+        nnz_band += std::min(c+lower_, n-1) - std::max(c-upper_, casadi_int(0)) + 1;
+      }
+      if (nnz_band==nnz()) {
+        kind_ = SparsityKind::BANDED;
+        return;
+      }
+    }
+    lower_ = upper_ = 0;
+
+    // Dense diagonal blocks of equal size
+    casadi_int b = colind[1];
+    if (b<=1 || b>=n || n%b!=0) return;
+    for (casadi_int c=0; c<n; ++c) {
+      casadi_int start = c-c%b;
+      if (colind[c+1]-colind[c]!=b || row[colind[c]]!=start
+          || row[colind[c+1]-1]!=start+b-1) return;
+    }
+    kind_ = SparsityKind::BLOCK_DIAGONAL;
+    block_ = b;
+  }
+
+  /// Square pattern with all entries within bandwidths lower and upper of the diagonal
+  static Sparsity band_pattern(casadi_int n, casadi_int lower, casadi_int upper) {
+    std::vector<casadi_int> colind(n+1, 0), row;
+    for (casadi_int c=0; c<n; ++c) {
+      for (casadi_int r=std::max(c-upper, casadi_int(0)); r<=std::min(c+lower, n-1); ++r) {
+        row.push_back(r);
+      }
+      colind[c+1] = row.size();
+    }
+    return Sparsity(n, n, colind, row);
   }
 
   SparsityInternal::~SparsityInternal() {
+#ifdef CASADI_WITH_THREAD
+    // Expire the cache entry before it can be revived by Sparsity::assign_cached
+    if (has_weak()) {
+      SparsityCacheLock lock(hash());
+      kill_weak();
+    }
+#endif // CASADI_WITH_THREAD
     delete btf_;
   }
 
@@ -503,6 +722,45 @@ namespace casadi {
 
   Sparsity SparsityInternal::transpose(
       std::vector<casadi_int>& mapping, bool invert_mapping) const {
+    if (kind_==SparsityKind::DENSE) {
+      // Nonzero r+c*size1() of the original is nonzero c+r*size2() of the transpose
+      casadi_int n1 = size1(), n2 = size2();
+      mapping.resize(nnz());
+      for (casadi_int c=0; c<n2; ++c) {
+        for (casadi_int r=0; r<n1; ++r) {
+          if (invert_mapping) {
+            mapping[r+c*n1] = c+r*n2;
+          } else {
+            mapping[c+r*n2] = r+c*n1;
+          }
+        }
+      }
+      return Sparsity::dense(n2, n1);
+    } else if (kind_!=SparsityKind::GENERAL) {
+      // Pattern of the transpose
+      Sparsity ret;
+      if (kind_==SparsityKind::BLOCK_DIAGONAL || lower_==upper_) {
+        ret = shared_from_this<Sparsity>();
+      } else {
+        ret = band_pattern(size1(), upper_, lower_);
+      }
+      // Entry (r, c) of the transpose is nonzero k of the original
+      const casadi_int *colind = this->colind(), *t_colind = ret.colind(), *t_row = ret.row();
+      mapping.resize(nnz());
+      for (casadi_int c=0; c<size2(); ++c) {
+        for (casadi_int el=t_colind[c]; el<t_colind[c+1]; ++el) {
+          casadi_int r = t_row[el];
+          casadi_int k = colind[r] + c - first_row(r);
+          if (invert_mapping) {
+            mapping[k] = el;
+          } else {
+            mapping[el] = k;
+          }
+        }
+      }
+      return ret;
+    }
+
     // Get the sparsity of the transpose in sparse triplet form
     std::vector<casadi_int> trans_col = get_row();
     std::vector<casadi_int> trans_row = get_col();
@@ -1739,6 +1997,16 @@ namespace casadi {
     // Quick return if second factor is diagonal
     if (y.is_diag()) return shared_from_this<Sparsity>();
 
+    // Product of bands or of block diagonals with the same block size
+    const SparsityInternal& y_int = *y.get();
+    if (kind_==SparsityKind::BANDED && y_int.kind_==SparsityKind::BANDED) {
+      return band_pattern(d1, std::min(lower_+y_int.lower_, d1-1),
+        std::min(upper_+y_int.upper_, d1-1));
+    } else if (kind_==SparsityKind::BLOCK_DIAGONAL && y_int.kind_==SparsityKind::BLOCK_DIAGONAL
+        && block_==y_int.block_) {
+      return shared_from_this<Sparsity>();
+    }
+
     // Direct access to the vectors
     const casadi_int* x_row = row();
     const casadi_int* x_colind = colind();
@@ -1799,6 +2067,10 @@ namespace casadi {
   }
 
   bool SparsityInternal::is_diag() const {
+    // Quick return if structure known
+    if (kind_==SparsityKind::BANDED) return lower_==0 && upper_==0;
+    if (kind_!=SparsityKind::GENERAL) return false;
+
     const casadi_int* colind = this->colind();
     const casadi_int* row = this->row();
 
@@ -1829,6 +2101,9 @@ namespace casadi {
   }
 
   bool SparsityInternal::is_symmetric() const {
+    // Quick return if structure known
+    if (kind_==SparsityKind::BANDED) return lower_==upper_;
+    if (kind_==SparsityKind::BLOCK_DIAGONAL) return true;
     return is_transpose(*this);
   }
 
@@ -2349,6 +2624,30 @@ namespace casadi {
       return y;
     }
 
+    // Union and intersection of structured patterns, if the mapping is not needed
+    if (!with_mapping && f0x_is_zero==function0_is_zero) {
+      casadi_assert(size2()==y.size2() && size1()==y.size1(),
+        "Dimension mismatch : " + str(size()) + " versus " + str(y.size()) + ".");
+      const SparsityInternal& y_int = *y.get();
+      if (f0x_is_zero) {
+        // Intersection
+        if (is_dense()) return y;
+        if (y.is_dense()) return shared_from_this<Sparsity>();
+        if (kind_==SparsityKind::BANDED && y_int.kind_==SparsityKind::BANDED) {
+          return band_pattern(size1(), std::min(lower_, y_int.lower_),
+            std::min(upper_, y_int.upper_));
+        }
+      } else {
+        // Union
+        if (is_dense()) return shared_from_this<Sparsity>();
+        if (y.is_dense()) return y;
+        if (kind_==SparsityKind::BANDED && y_int.kind_==SparsityKind::BANDED) {
+          return band_pattern(size1(), std::max(lower_, y_int.lower_),
+            std::max(upper_, y_int.upper_));
+        }
+      }
+    }
+
     if (f0x_is_zero) {
       if (function0_is_zero) {
         return combineGen<with_mapping, true, true>(y, mapping);
@@ -3039,21 +3338,30 @@ namespace casadi {
       casadi_message("StarColoring requires a square matrix, got " + dim() + ".");
     }
 
-    // TODO(Joel): What we need here, is a distance-2 smallest last ordering
+    // Try all orderings, keep the one with the fewest colors
+    if (ordering<0) {
+      Sparsity best;
+      for (casadi_int ord=0; ord<=4; ++ord) {
+        Sparsity r = star_coloring2(ord, best.is_null() ? cutoff : best.size2()-1);
+        if (!r.is_null()) best = r;
+        if (!best.is_null() && best.size2()==0) break;
+      }
+      return best;
+    }
+
     // Reorder, if necessary
     const casadi_int* colind = this->colind();
     const casadi_int* row = this->row();
     if (ordering!=0) {
-      casadi_assert_dev(ordering==1);
-
       // Ordering
-      std::vector<casadi_int> ord = largest_first();
+      std::vector<casadi_int> ord = coloring_ordering(ordering);
 
       // Create a new sparsity pattern
       Sparsity sp_permuted = pmult(ord, true, true, true);
 
       // Star coloring for the permuted matrix
-      Sparsity ret_permuted = sp_permuted.star_coloring2(0);
+      Sparsity ret_permuted = sp_permuted.star_coloring2(0, cutoff);
+      if (ret_permuted.is_null()) return ret_permuted;
 
       // Permute result back
       return ret_permuted.pmult(ord, true, false, false);
@@ -3292,18 +3600,28 @@ namespace casadi {
       casadi_message("StarColoring requires a square matrix, got " + dim() + ".");
     }
 
+    // Try all orderings, keep the one with the fewest colors
+    if (ordering<0) {
+      Sparsity best;
+      for (casadi_int ord=0; ord<=4; ++ord) {
+        Sparsity r = star_coloring(ord, best.is_null() ? cutoff : best.size2()-1);
+        if (!r.is_null()) best = r;
+        if (!best.is_null() && best.size2()==0) break;
+      }
+      return best;
+    }
+
     // Reorder, if necessary
     if (ordering!=0) {
-      casadi_assert_dev(ordering==1);
-
       // Ordering
-      std::vector<casadi_int> ord = largest_first();
+      std::vector<casadi_int> ord = coloring_ordering(ordering);
 
       // Create a new sparsity pattern
       Sparsity sp_permuted = pmult(ord, true, true, true);
 
       // Star coloring for the permuted matrix
-      Sparsity ret_permuted = sp_permuted.star_coloring(0);
+      Sparsity ret_permuted = sp_permuted.star_coloring(0, cutoff);
+      if (ret_permuted.is_null()) return ret_permuted;
 
       // Permute result back
       return ret_permuted.pmult(ord, true, false, false);
@@ -3434,6 +3752,146 @@ namespace casadi {
     return reverse_ordering;
   }
 
+  /// Vertices bucketed by an integer key, with O(1) insertion, removal and key updates
+  class VertexBuckets {
+  public:
+    VertexBuckets(casadi_int n, casadi_int max_key)
+      : head_(max_key+1, -1), next_(n, -1), prev_(n, -1), key_(n, -1) {}
+    casadi_int key(casadi_int v) const { return key_[v];}
+    casadi_int first(casadi_int k) const { return head_[k];}
+    void insert(casadi_int v, casadi_int k) {
+      key_[v] = k;
+      prev_[v] = -1;
+      next_[v] = head_[k];
+      if (head_[k]>=0) prev_[head_[k]] = v;
+      head_[k] = v;
+    }
+    void remove(casadi_int v) {
+      if (prev_[v]>=0) {
+        next_[prev_[v]] = next_[v];
+      } else {
+        head_[key_[v]] = next_[v];
+      }
+      if (next_[v]>=0) prev_[next_[v]] = prev_[v];
+    }
+    void move(casadi_int v, casadi_int k) {
+      remove(v);
+      insert(v, k);
+    }
+  private:
+    std::vector<casadi_int> head_, next_, prev_, key_;
+  };
+
+  std::vector<casadi_int> SparsityInternal::smallest_last() const {
+    const casadi_int* colind = this->colind();
+    const casadi_int* row = this->row();
+    casadi_int n = size2();
+
+    // Degrees in the adjacency graph, self-loops excluded
+    std::vector<casadi_int> degree(n, 0);
+    casadi_int max_degree = 0;
+    for (casadi_int v=0; v<n; ++v) {
+      for (casadi_int el=colind[v]; el<colind[v+1]; ++el) if (row[el]!=v) degree[v]++;
+      max_degree = std::max(max_degree, degree[v]);
+    }
+    VertexBuckets b(n, max_degree);
+    for (casadi_int v=n-1; v>=0; --v) b.insert(v, degree[v]);
+
+    // Repeatedly remove a vertex of minimum degree, order in reverse
+    std::vector<casadi_int> ordering(n);
+    std::vector<bool> removed(n, false);
+    casadi_int min_degree = 0;
+    for (casadi_int k=n-1; k>=0; --k) {
+      while (b.first(min_degree)<0) min_degree++;
+      casadi_int v = b.first(min_degree);
+      b.remove(v);
+      removed[v] = true;
+      ordering[k] = v;
+      for (casadi_int el=colind[v]; el<colind[v+1]; ++el) {
+        casadi_int w = row[el];
+        if (removed[w]) continue;
+        b.move(w, b.key(w)-1);
+        min_degree = std::min(min_degree, b.key(w));
+      }
+    }
+    return ordering;
+  }
+
+  std::vector<casadi_int> SparsityInternal::incidence_degree() const {
+    const casadi_int* colind = this->colind();
+    const casadi_int* row = this->row();
+    casadi_int n = size2();
+
+    // Ties are broken in favor of large degrees
+    std::vector<casadi_int> lf = largest_first();
+    VertexBuckets b(n, n);
+    for (auto it=lf.rbegin(); it!=lf.rend(); ++it) b.insert(*it, 0);
+
+    // Repeatedly pick a vertex with the most already ordered neighbors
+    std::vector<casadi_int> ordering(n);
+    std::vector<bool> ordered(n, false);
+    casadi_int max_incidence = 0;
+    for (casadi_int k=0; k<n; ++k) {
+      while (b.first(max_incidence)<0) max_incidence--;
+      casadi_int v = b.first(max_incidence);
+      b.remove(v);
+      ordered[v] = true;
+      ordering[k] = v;
+      for (casadi_int el=colind[v]; el<colind[v+1]; ++el) {
+        casadi_int w = row[el];
+        if (ordered[w]) continue;
+        b.move(w, b.key(w)+1);
+        max_incidence = std::max(max_incidence, b.key(w));
+      }
+    }
+    return ordering;
+  }
+
+  std::vector<casadi_int> SparsityInternal::dynamic_largest_first() const {
+    const casadi_int* colind = this->colind();
+    const casadi_int* row = this->row();
+    casadi_int n = size2();
+
+    // Degrees in the adjacency graph, self-loops excluded
+    std::vector<casadi_int> degree(n, 0);
+    casadi_int max_degree = 0;
+    for (casadi_int v=0; v<n; ++v) {
+      for (casadi_int el=colind[v]; el<colind[v+1]; ++el) if (row[el]!=v) degree[v]++;
+      max_degree = std::max(max_degree, degree[v]);
+    }
+    VertexBuckets b(n, max_degree);
+    for (casadi_int v=n-1; v>=0; --v) b.insert(v, degree[v]);
+
+    // Repeatedly pick a vertex of maximum degree among the vertices not yet ordered
+    std::vector<casadi_int> ordering(n);
+    std::vector<bool> ordered(n, false);
+    for (casadi_int k=0; k<n; ++k) {
+      while (b.first(max_degree)<0) max_degree--;
+      casadi_int v = b.first(max_degree);
+      b.remove(v);
+      ordered[v] = true;
+      ordering[k] = v;
+      for (casadi_int el=colind[v]; el<colind[v+1]; ++el) {
+        casadi_int w = row[el];
+        if (!ordered[w]) b.move(w, b.key(w)-1);
+      }
+    }
+    return ordering;
+  }
+
+  std::vector<casadi_int> SparsityInternal::coloring_ordering(casadi_int ordering) const {
+    switch (ordering) {
+      case 1: return largest_first();
+      case 2: return smallest_last();
+      case 3: return incidence_degree();
+      case 4: return dynamic_largest_first();
+      default: break;
+    }
+    casadi_error("Unknown coloring ordering " + str(ordering) + ". Expected "
+      "none (0), largest first (1), smallest last (2), incidence degree (3), "
+      "dynamic largest first (4) or best of all (-1).");
+  }
+
   Sparsity SparsityInternal::pmult(const std::vector<casadi_int>& p, bool permute_rows,
                                    bool permute_columns, bool invert_permutation) const {
     // Invert p, possibly
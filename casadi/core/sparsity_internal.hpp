@@ -33,6 +33,14 @@
 
 namespace casadi {
 
+  /** \brief Structure recognized in a sparsity pattern
+
+      BANDED: square, every entry within lower_ rows below and upper_ rows above
+      the diagonal is structurally nonzero (diagonal and square dense included)
+      BLOCK_DIAGONAL: square, dense diagonal blocks of size block_
+      DENSE: dense but not square */
+  enum class SparsityKind {GENERAL, BANDED, BLOCK_DIAGONAL, DENSE};
+
   class CASADI_EXPORT SparsityInternal : public SharedObjectInternal {
   private:
     /** \brief Sparsity pattern in compressed column storage (CCS) format
@@ -63,6 +71,23 @@ namespace casadi {
         \identifier{23j} */
     mutable Btf* btf_;
 
+    /** \brief Structure of the pattern, classified at construction
+
+        Enables O(1) answers and direct construction of the result in
+        transpose, mtimes and combine */
+    SparsityKind kind_;
+
+    /// Bandwidths below and above the diagonal (BANDED), block size (BLOCK_DIAGONAL)
+    casadi_int lower_, upper_, block_;
+
+    /// Classify the pattern
+    void classify();
+
+    /// First row of column c, for BANDED and BLOCK_DIAGONAL patterns
+    casadi_int first_row(casadi_int c) const {
+      return kind_==SparsityKind::BANDED ? std::max(c-upper_, casadi_int(0)) : c-c%block_;
+    }
+
   public:
     /// Construct a sparsity pattern from arrays
     SparsityInternal(casadi_int nrow, casadi_int ncol,
@@ -99,6 +124,9 @@ namespace casadi {
     /// Number of structural non-zeros
     inline casadi_int nnz() const { return colind()[size2()];}
 
+    /// Structure recognized at construction
+    SparsityKind kind() const { return kind_;}
+
     /** \brief Get the diagonal of the matrix/create a diagonal matrix
      *
      * \param[out] mapping will contain the nonzero mapping
@@ -176,6 +204,21 @@ namespace casadi {
         \identifier{eq} */
     static void postorder(const casadi_int* parent, casadi_int n, casadi_int* post, casadi_int* w);
 
+    /** \brief Partition a postordered elimination tree for a parallel factorization
+
+      * Selects disjoint subtrees, each a contiguous range of columns, to be factorized
+      * concurrently by n_thread threads, the remaining columns being factorized
+      * afterwards in increasing order. Starting from the roots, the heaviest subtree is
+      * replaced by its children as long as this reduces the estimated time, i.e. the
+      * work of the remaining columns plus max(heaviest subtree, total/n_thread).
+      * work[c] is the cost of column c.
+      * The ranges [par[2*k], par[2*k+1]) of subtrees par_ind[i], ..., par_ind[i+1]-1
+      * form chunk i, ser holds the ranges of the remaining columns.
+      */
+    static void etree_partition(const std::vector<casadi_int>& parent,
+      const std::vector<double>& work, casadi_int n_thread, std::vector<casadi_int>& par,
+      std::vector<casadi_int>& par_ind, std::vector<casadi_int>& ser);
+
     /** \brief Needed by casadi_qr_colind
 
       * Ref: Chapter 4, Direct Methods for Sparse Linear Systems by Tim Davis
@@ -276,6 +319,16 @@ namespace casadi {
     static void ldl_row(const casadi_int* sp, const casadi_int* parent,
       casadi_int* l_colind, casadi_int* l_row, casadi_int *w);
 
+    /** \brief Supernode partition of an LDL^T factorization, for casadi_ldl_sn
+
+      * Groups consecutive columns of L with nested sparsity patterns, i.e. chains
+      * in the elimination tree where each column has one nonzero more than its parent.
+      * sp_lt is the sparsity pattern of L^T as returned by ldl.
+      * sz_w is the real work vector size needed by casadi_ldl_sn, the integer
+      * work vector size is 2*n+2*sn[0]
+      */
+    static std::vector<casadi_int> ldl_supernodes(const casadi_int* sp_lt, casadi_int& sz_w);
+
     /// Transpose the matrix
     Sparsity T() const;
 
@@ -723,6 +776,18 @@ namespace casadi {
     /// Order the columns by decreasing degree
     std::vector<casadi_int> largest_first() const;
 
+    /// Smallest last ordering of the columns
+    std::vector<casadi_int> smallest_last() const;
+
+    /// Incidence degree ordering of the columns
+    std::vector<casadi_int> incidence_degree() const;
+
+    /// Dynamic largest first ordering of the columns
+    std::vector<casadi_int> dynamic_largest_first() const;
+
+    /// Ordering preceding a star coloring, see Sparsity::star_coloring
+    std::vector<casadi_int> coloring_ordering(casadi_int ordering) const;
+
     /// Permute rows and/or columns
     Sparsity pmult(const std::vector<casadi_int>& p, bool permute_rows=true, bool permute_cols=true,
                    bool invert_permutation=false) const;
@@ -745,6 +810,25 @@ namespace casadi {
     void spsolve(bvec_t* X, bvec_t* B, bool tr) const;
 };
 
+/** \brief Scoped lock of the partition of the sparsity pattern cache containing a hash
+
+    Patterns in the cache are looked up, inserted and expired while holding the lock.
+    The lock is recursive, since releasing a pattern may destroy another one in the
+    same partition. Without CASADI_WITH_THREAD, this is a no-op.
+*/
+class CASADI_EXPORT SparsityCacheLock {
+public:
+  explicit SparsityCacheLock(std::size_t h);
+  ~SparsityCacheLock();
+private:
+  // Not copyable
+  SparsityCacheLock(const SparsityCacheLock&);
+  SparsityCacheLock& operator=(const SparsityCacheLock&);
+#ifdef CASADI_WITH_THREAD
+  casadi_int stripe_;
+#endif // CASADI_WITH_THREAD
+};
+
 } // namespace casadi
 /// \endcond
 
@@ -40,6 +40,10 @@ namespace casadi {
 
 
   // Allocate storage for the caching
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+  std::mutex IntegerSX::mutex_;
+  std::mutex RealtypeSX::mutex_;
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
   CACHING_MAP<casadi_int, IntegerSX*> IntegerSX::cached_constants_;
   CACHING_MAP<double, RealtypeSX*> RealtypeSX::cached_constants_;
 
@@ -69,13 +73,21 @@ namespace casadi {
       else if (intval == 1)        node = casadi_limits<SXElem>::one.node;
       else if (intval == 2)        node = casadi_limits<SXElem>::two.node;
       else if (intval == -1)       node = casadi_limits<SXElem>::minus_one.node;
-      else                        node = IntegerSX::create(intval);
+      else {
+        // Counted by the cache
+        node = IntegerSX::create(intval);
+        return;
+      }
       node->count++;
     } else {
       if (isnan(val))              node = casadi_limits<SXElem>::nan.node;
       else if (isinf(val))         node = val > 0 ? casadi_limits<SXElem>::inf.node :
                                       casadi_limits<SXElem>::minus_inf.node;
-      else                        node = RealtypeSX::create(val);
+      else {
+        // Counted by the cache
+        node = RealtypeSX::create(val);
+        return;
+      }
       node->count++;
     }
   }
@@ -109,20 +121,17 @@ namespace casadi {
   }
 
   SXNode* SXElem::assignNoDelete(const SXElem& scalar) {
-    // Return value
-    SXNode* ret = node;
-
     // quick return if the old and new pointers point to the same object
-    if (node == scalar.node) return ret;
+    if (node == scalar.node) return nullptr;
 
     // decrease the counter but do not delete if this was the last pointer
-    --node->count;
+    SXNode* ret = --node->count == 0 ? node : nullptr;
 
     // save the new pointer
     node = scalar.node;
     node->count++;
 
-    // Return a pointer to the old node
+    // Return a pointer to the old node, if no longer referenced
     return ret;
   }
 
@@ -540,7 +549,7 @@ namespace casadi {
   const SXElem casadi_limits<SXElem>::zero(ZeroSX::singleton(), false);
   // node corresponding to a constant 1
   const SXElem casadi_limits<SXElem>::one(OneSX::singleton(), false);
-  // node corresponding to a constant 2
+  // node corresponding to a constant 2, kept alive by the reference from create
   const SXElem casadi_limits<SXElem>::two(IntegerSX::create(2), false);
   // node corresponding to a constant -1
   const SXElem casadi_limits<SXElem>::minus_one(MinusOneSX::singleton(), false);
@@ -248,7 +248,8 @@ namespace casadi {
 
     /** \brief Assign the node to something, without invoking the deletion of the node,
 
-     * if the count reaches 0
+     * if the count reaches 0. Returns the old node if this was its last reference,
+     * otherwise null.
 
         \identifier{111} */
     SXNode* assignNoDelete(const SXElem& scalar);
@@ -24,12 +24,20 @@
 
 
 #include "sx_function.hpp"
+#include "edge_pushing.hpp"
+#include "tape_ad.hpp"
 #include <limits>
 #include <stack>
 #include <deque>
+#include <queue>
 #include <sstream>
 #include <iomanip>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
 #include "sx_node.hpp"
+#include "binary_sx.hpp"
+#include "unary_sx.hpp"
 #include "casadi_common.hpp"
 #include "sparsity_internal.hpp"
 #include "casadi_interrupt.hpp"
@@ -47,6 +55,8 @@ namespace casadi {
     // Default (persistent) options
     just_in_time_opencl_ = false;
     just_in_time_sparsity_ = false;
+    bytecode_ = false;
+    numeric_ad_ = false;
   }
 
   SXFunction::~SXFunction() {
@@ -65,6 +75,9 @@ namespace casadi {
                    + str(free_vars_) + " are free.");
     }
 
+    // Evaluate the compiled bytecode, if available
+    if (bytecode_) return eval_bytecode(arg, res, w);
+
     // NOTE: The implementation of this function is very delicate. Small changes in the
     // class structure can cause large performance losses. For this reason,
     // the preprocessor macros are used below
@@ -84,6 +97,386 @@ namespace casadi {
     return 0;
   }
 
+  namespace {
+    // Instructions of the SXElem bytecode
+    enum ByteCodeOp {
+      // Generic unary or binary operation, cf. ScalarAtomic
+      BC_GENERIC,
+      // Generic binary operation with the first or second operand constant
+      BC_GENERIC_CW, BC_GENERIC_WC,
+      // Common operations with dedicated instructions
+      BC_ADD, BC_SUB, BC_MUL, BC_DIV, BC_NEG, BC_SQ, BC_TWICE,
+      // Binary operations with a constant operand
+      BC_ADD_WC, BC_SUB_WC, BC_SUB_CW, BC_MUL_WC, BC_DIV_WC, BC_DIV_CW,
+      // Multiplication followed by addition
+      BC_FMA,
+      // Binary operations with the first operand read from a function input
+      BC_ADD_IW, BC_SUB_IW, BC_SUB_WI, BC_MUL_IW,
+      // Constant, function input and output
+      BC_CONST, BC_INPUT, BC_OUTPUT,
+      // End of the bytecode
+      BC_END
+    };
+  } // namespace
+
+  void SXFunction::init_bytecode() {
+    // Number of instructions
+    casadi_int n = algorithm_.size();
+
+    // For each instruction, the instructions defining its operands
+    std::vector<casadi_int> dep0(n, -1), dep1(n, -1);
+
+    // Number of times the result of each instruction is used
+    std::vector<casadi_int> nuse(n, 0);
+
+    // Last instruction that wrote to each element of the work vector
+    std::vector<casadi_int> last(worksize_, -1);
+    for (casadi_int k=0; k<n; ++k) {
+      const AlgEl& a = algorithm_[k];
+      if (a.op==OP_OUTPUT) {
+        dep0[k] = last[a.i1];
+        nuse[dep0[k]]++;
+        continue;
+      }
+      casadi_int ndeps = casadi_math<double>::ndeps(a.op);
+      if (a.op!=OP_INPUT && ndeps>=1) nuse[dep0[k] = last[a.i1]]++;
+      if (a.op!=OP_INPUT && ndeps==2) nuse[dep1[k] = last[a.i2]]++;
+      last[a.i0] = k;
+    }
+
+    // Instruction kind
+    enum {KEEP, HOIST, FUSE};
+    std::vector<char> kind(n, KEEP);
+
+    // Constants that are only used as an operand of binary operations are hoisted,
+    // i.e. stored in the instruction instead of the work vector
+    std::vector<char> all_fusable(n, true);
+    for (casadi_int k=0; k<n; ++k) {
+      const AlgEl& a = algorithm_[k];
+      if (a.op==OP_OUTPUT) {
+        all_fusable[dep0[k]] = false;
+      } else if (casadi_math<double>::ndeps(a.op)==1) {
+        all_fusable[dep0[k]] = false;
+      } else if (casadi_math<double>::ndeps(a.op)==2) {
+        bool c0 = algorithm_[dep0[k]].op==OP_CONST, c1 = algorithm_[dep1[k]].op==OP_CONST;
+        if (c0 && c1) all_fusable[dep0[k]] = all_fusable[dep1[k]] = false;
+      }
+    }
+    for (casadi_int k=0; k<n; ++k) {
+      if (algorithm_[k].op==OP_CONST && all_fusable[k]) kind[k] = HOIST;
+    }
+
+    // Function inputs used exactly once by an addition, subtraction or multiplication
+    // are read directly by that instruction
+    for (casadi_int k=0; k<n; ++k) {
+      const AlgEl& a = algorithm_[k];
+      if (a.op!=OP_ADD && a.op!=OP_SUB && a.op!=OP_MUL) continue;
+      if (kind[dep0[k]]!=KEEP || kind[dep1[k]]!=KEEP || dep0[k]==dep1[k]) continue;
+      if (algorithm_[dep0[k]].op==OP_INPUT && nuse[dep0[k]]==1) {
+        kind[dep0[k]] = FUSE;
+      } else if (algorithm_[dep1[k]].op==OP_INPUT && nuse[dep1[k]]==1) {
+        kind[dep1[k]] = FUSE;
+      }
+    }
+
+    // Multiplications used exactly once, by an addition shortly afterwards, are fused
+    // into a multiply-add instruction at the position of the addition, provided that
+    // the operands of the multiplication have not been overwritten in between
+    const casadi_int fma_window = 8;
+    for (casadi_int k=0; k<n; ++k) {
+      const AlgEl& a = algorithm_[k];
+      if (a.op!=OP_ADD) continue;
+      if (kind[dep0[k]]!=KEEP || kind[dep1[k]]!=KEEP || dep0[k]==dep1[k]) continue;
+      for (casadi_int c=0; c<2; ++c) {
+        casadi_int m = c==0 ? dep0[k] : dep1[k];
+        const AlgEl& am = algorithm_[m];
+        if (am.op!=OP_MUL || nuse[m]!=1 || k-m>fma_window) continue;
+        if (kind[dep0[m]]!=KEEP || kind[dep1[m]]!=KEEP) continue;
+        // Make sure that the operands of the multiplication are not overwritten
+        bool ok = true;
+        for (casadi_int j=m+1; j<k && ok; ++j) {
+          const AlgEl& aj = algorithm_[j];
+          if (aj.op==OP_OUTPUT || kind[j]!=KEEP) continue;
+          if (aj.i0==am.i1 || aj.i0==am.i2) ok = false;
+        }
+        if (ok) {
+          kind[m] = FUSE;
+          break;
+        }
+      }
+    }
+
+    // Generate the bytecode
+    bytecode_alg_.clear();
+    bytecode_alg_.reserve(n+1);
+    for (casadi_int k=0; k<n; ++k) {
+      if (kind[k]!=KEEP) continue;
+      const AlgEl& a = algorithm_[k];
+      ByteCodeEl e;
+      e.sub = a.op;
+      e.i0 = a.i0;
+      e.i1 = e.i2 = e.i3 = 0;
+      e.d = 0;
+      casadi_int ndeps = casadi_math<double>::ndeps(a.op);
+      switch (a.op) {
+      case OP_CONST:
+        e.op = BC_CONST;
+        e.d = a.d;
+        break;
+      case OP_PARAMETER:
+        // Never evaluated: functions with free variables cannot be evaluated numerically
+        e.op = BC_CONST;
+        e.d = nan;
+        break;
+      case OP_INPUT:
+        e.op = BC_INPUT;
+        e.i1 = a.i1;
+        e.i2 = a.i2;
+        break;
+      case OP_OUTPUT:
+        e.op = BC_OUTPUT;
+        e.i1 = a.i1;
+        e.i2 = a.i2;
+        break;
+      default:
+        e.i1 = a.i1;
+        e.i2 = a.i2;
+        if (ndeps==1) {
+          switch (a.op) {
+          case OP_NEG: e.op = BC_NEG; break;
+          case OP_SQ: e.op = BC_SQ; break;
+          case OP_TWICE: e.op = BC_TWICE; break;
+          default: e.op = BC_GENERIC;
+          }
+        } else if (kind[dep0[k]]==HOIST) {
+          // Constant first operand
+          e.d = algorithm_[dep0[k]].d;
+          e.i1 = a.i2;
+          switch (a.op) {
+          case OP_ADD: e.op = BC_ADD_WC; break;
+          case OP_SUB: e.op = BC_SUB_CW; break;
+          case OP_MUL: e.op = BC_MUL_WC; break;
+          case OP_DIV: e.op = BC_DIV_CW; break;
+          default: e.op = BC_GENERIC_CW;
+          }
+        } else if (kind[dep1[k]]==HOIST) {
+          // Constant second operand
+          e.d = algorithm_[dep1[k]].d;
+          switch (a.op) {
+          case OP_ADD: e.op = BC_ADD_WC; break;
+          case OP_SUB: e.op = BC_SUB_WC; break;
+          case OP_MUL: e.op = BC_MUL_WC; break;
+          case OP_DIV: e.op = BC_DIV_WC; break;
+          default: e.op = BC_GENERIC_WC;
+          }
+        } else if (kind[dep0[k]]==FUSE && algorithm_[dep0[k]].op==OP_INPUT) {
+          // Function input as first operand, stored in (i1, i3)
+          const AlgEl& ai = algorithm_[dep0[k]];
+          e.i1 = ai.i1;
+          e.i3 = ai.i2;
+          switch (a.op) {
+          case OP_ADD: e.op = BC_ADD_IW; break;
+          case OP_SUB: e.op = BC_SUB_IW; break;
+          default: e.op = BC_MUL_IW;
+          }
+        } else if (kind[dep1[k]]==FUSE && algorithm_[dep1[k]].op==OP_INPUT) {
+          // Function input as second operand, stored in (i1, i3)
+          const AlgEl& ai = algorithm_[dep1[k]];
+          e.i2 = a.i1;
+          e.i1 = ai.i1;
+          e.i3 = ai.i2;
+          switch (a.op) {
+          case OP_ADD: e.op = BC_ADD_IW; break;
+          case OP_SUB: e.op = BC_SUB_WI; break;
+          default: e.op = BC_MUL_IW;
+          }
+        } else if (kind[dep0[k]]==FUSE || kind[dep1[k]]==FUSE) {
+          // Multiply-add: w[i0] = w[i1]*w[i2] + w[i3]
+          bool first = kind[dep0[k]]==FUSE;
+          const AlgEl& am = algorithm_[first ? dep0[k] : dep1[k]];
+          e.op = BC_FMA;
+          e.i1 = am.i1;
+          e.i2 = am.i2;
+          e.i3 = first ? a.i2 : a.i1;
+        } else {
+          switch (a.op) {
+          case OP_ADD: e.op = BC_ADD; break;
+          case OP_SUB: e.op = BC_SUB; break;
+          case OP_MUL: e.op = BC_MUL; break;
+          case OP_DIV: e.op = BC_DIV; break;
+          default: e.op = BC_GENERIC;
+          }
+        }
+      }
+      bytecode_alg_.push_back(e);
+    }
+
+    // Terminate the bytecode
+    ByteCodeEl e_end;
+    e_end.op = BC_END;
+    e_end.sub = 0;
+    e_end.i0 = e_end.i1 = e_end.i2 = e_end.i3 = 0;
+    e_end.d = 0;
+    bytecode_alg_.push_back(e_end);
+
+    if (verbose_) {
+      casadi_message("Compiled " + str(n) + " elementary operations into "
+        + str(bytecode_alg_.size()-1) + " bytecode instructions");
+    }
+  }
+
+// Threaded dispatch using computed goto (GCC extension) if available
+#if defined(__GNUC__)
+#define CASADI_BYTECODE_THREADED
+#endif
+
+  int SXFunction::eval_bytecode(const double** arg, double** res, double* w) const {
+    // Current instruction
+    const ByteCodeEl* e = get_ptr(bytecode_alg_);
+
+    // Input value, or zero if not provided
+    #define CASADI_BC_IN(i, nz) (arg[i] ? arg[i][nz] : 0)
+
+#ifdef CASADI_BYTECODE_THREADED
+    // Dispatch table, same order as ByteCodeOp
+    static const void* const dispatch[] = {
+      &&L_BC_GENERIC, &&L_BC_GENERIC_CW, &&L_BC_GENERIC_WC,
+      &&L_BC_ADD, &&L_BC_SUB, &&L_BC_MUL, &&L_BC_DIV, &&L_BC_NEG, &&L_BC_SQ, &&L_BC_TWICE,
+      &&L_BC_ADD_WC, &&L_BC_SUB_WC, &&L_BC_SUB_CW, &&L_BC_MUL_WC, &&L_BC_DIV_WC,
+      &&L_BC_DIV_CW, &&L_BC_FMA, &&L_BC_ADD_IW, &&L_BC_SUB_IW, &&L_BC_SUB_WI, &&L_BC_MUL_IW,
+      &&L_BC_CONST, &&L_BC_INPUT, &&L_BC_OUTPUT, &&L_BC_END};
+    #define CASADI_BC_LABEL(L) L_##L
+    #define CASADI_BC_NEXT goto *dispatch[(++e)->op]
+    goto *dispatch[e->op];
+#else // CASADI_BYTECODE_THREADED
+    #define CASADI_BC_LABEL(L) case L
+    #define CASADI_BC_NEXT break
+    for (;; ++e) {
+      switch (e->op) {
+#endif // CASADI_BYTECODE_THREADED
+    CASADI_BC_LABEL(BC_GENERIC):
+      switch (e->sub) {
+        CASADI_MATH_FUN_BUILTIN(w[e->i1], w[e->i2], w[e->i0])
+      }
+      CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_GENERIC_CW):
+      switch (e->sub) {
+        CASADI_MATH_FUN_BUILTIN(e->d, w[e->i1], w[e->i0])
+      }
+      CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_GENERIC_WC):
+      switch (e->sub) {
+        CASADI_MATH_FUN_BUILTIN(w[e->i1], e->d, w[e->i0])
+      }
+      CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_ADD): w[e->i0] = w[e->i1] + w[e->i2]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_SUB): w[e->i0] = w[e->i1] - w[e->i2]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_MUL): w[e->i0] = w[e->i1] * w[e->i2]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_DIV): w[e->i0] = w[e->i1] / w[e->i2]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_NEG): w[e->i0] = -w[e->i1]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_SQ): w[e->i0] = w[e->i1] * w[e->i1]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_TWICE): w[e->i0] = 2.*w[e->i1]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_ADD_WC): w[e->i0] = w[e->i1] + e->d; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_SUB_WC): w[e->i0] = w[e->i1] - e->d; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_SUB_CW): w[e->i0] = e->d - w[e->i1]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_MUL_WC): w[e->i0] = w[e->i1] * e->d; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_DIV_WC): w[e->i0] = w[e->i1] / e->d; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_DIV_CW): w[e->i0] = e->d / w[e->i1]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_FMA):
+      {
+        // Rounded as the separate operations
+        double t = w[e->i1] * w[e->i2];
+        w[e->i0] = t + w[e->i3];
+      }
+      CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_ADD_IW):
+      w[e->i0] = CASADI_BC_IN(e->i1, e->i3) + w[e->i2]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_SUB_IW):
+      w[e->i0] = CASADI_BC_IN(e->i1, e->i3) - w[e->i2]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_SUB_WI):
+      w[e->i0] = w[e->i2] - CASADI_BC_IN(e->i1, e->i3); CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_MUL_IW):
+      w[e->i0] = CASADI_BC_IN(e->i1, e->i3) * w[e->i2]; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_CONST): w[e->i0] = e->d; CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_INPUT): w[e->i0] = CASADI_BC_IN(e->i1, e->i2); CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_OUTPUT):
+      if (res[e->i0]!=nullptr) res[e->i0][e->i2] = w[e->i1];
+      CASADI_BC_NEXT;
+    CASADI_BC_LABEL(BC_END):
+      return 0;
+#ifndef CASADI_BYTECODE_THREADED
+      default:
+        casadi_error("Unknown bytecode instruction " + str(e->op));
+      }
+    }
+#endif // CASADI_BYTECODE_THREADED
+    #undef CASADI_BC_IN
+    #undef CASADI_BC_LABEL
+    #undef CASADI_BC_NEXT
+  }
+
+  const casadi_int SXFunction::batch_width;
+
+  int SXFunction::eval_batch(const double** arg, double** res, casadi_int* iw, double* w,
+      casadi_int n) const {
+    if (verbose_) casadi_message(name_ + "::eval_batch");
+    const casadi_int B = batch_width;
+
+    // Groups of B points, with work vector element i of point k+j stored in w[i*B+j]
+    casadi_int k;
+    for (k=0; k+B<=n; k+=B) {
+      for (auto&& e : algorithm_) {
+        double* f = w + e.i0*B;
+        const double *x = w + e.i1*B, *y = w + e.i2*B;
+        switch (e.op) {
+        case OP_CONST:
+          for (casadi_int j=0; j<B; ++j) f[j] = e.d;
+          break;
+        case OP_INPUT:
+          if (arg[e.i1]==nullptr) {
+            for (casadi_int j=0; j<B; ++j) f[j] = 0;
+          } else {
+            casadi_int nnz = sparsity_in_[e.i1].nnz();
+            const double* a = arg[e.i1] + k*nnz + e.i2;
+            for (casadi_int j=0; j<B; ++j) f[j] = a[j*nnz];
+          }
+          break;
+        case OP_OUTPUT:
+          if (res[e.i0]!=nullptr) {
+            casadi_int nnz = sparsity_out_[e.i0].nnz();
+            double* r = res[e.i0] + k*nnz + e.i2;
+            for (casadi_int j=0; j<B; ++j) r[j*nnz] = x[j];
+          }
+          break;
+        case OP_ADD: for (casadi_int j=0; j<B; ++j) f[j] = x[j] + y[j]; break;
+        case OP_SUB: for (casadi_int j=0; j<B; ++j) f[j] = x[j] - y[j]; break;
+        case OP_MUL: for (casadi_int j=0; j<B; ++j) f[j] = x[j] * y[j]; break;
+        case OP_DIV: for (casadi_int j=0; j<B; ++j) f[j] = x[j] / y[j]; break;
+        case OP_NEG: for (casadi_int j=0; j<B; ++j) f[j] = -x[j]; break;
+        case OP_SQ: for (casadi_int j=0; j<B; ++j) f[j] = x[j] * x[j]; break;
+        default:
+          casadi_math<double>::fun(e.op, x, y, f, B);
+        }
+      }
+    }
+
+    // Remaining points
+    if (k<n) {
+      const double** arg1 = arg + n_in_;
+      double** res1 = res + n_out_;
+      for (; k<n; ++k) {
+        for (casadi_int i=0; i<n_in_; ++i) {
+          arg1[i] = arg[i] ? arg[i] + k*nnz_in(i) : nullptr;
+        }
+        for (casadi_int i=0; i<n_out_; ++i) {
+          res1[i] = res[i] ? res[i] + k*nnz_out(i) : nullptr;
+        }
+        if (eval(arg1, res1, iw, w, nullptr)) return 1;
+      }
+    }
+    return 0;
+  }
+
   bool SXFunction::is_smooth() const {
     // Go through all nodes and check if any node is non-smooth
     for (auto&& a : algorithm_) {
@@ -145,6 +538,8 @@ namespace casadi {
   }
 
   void SXFunction::codegen_body(CodeGenerator& g) const {
+    // Large bodies are cut into separately compiled parts, unless embedded in other code
+    bool outline = g.shard_size()>0 && g.buffer.tellp()==0;
 
     // Run the algorithm
     for (auto&& a : algorithm_) {
@@ -169,6 +564,9 @@ namespace casadi {
         }
       }
       g  << ";\n";
+
+      if (outline && static_cast<casadi_int>(g.buffer.tellp()) > g.shard_size()) g.outline();
+      g.stream();
     }
   }
 
@@ -187,9 +585,35 @@ namespace casadi {
       {"live_variables",
        {OT_BOOL,
         "Reuse variables in the work vector"}},
+      {"schedule",
+       {OT_STRING,
+        "Order of the instructions: 'depth_first' (default), 'locality' (subexpressions "
+        "needing the most work vector elements first, elements reused lowest index first, "
+        "for a small live set) or 'latency' (list scheduling that interleaves independent "
+        "chains of operations, such that results are not used immediately)"}},
+      {"bytecode",
+       {OT_BOOL,
+        "Evaluate numerically using a compiled bytecode with fused instructions "
+        "(multiply-add, constant and input operands), constants hoisted out of the "
+        "work vector and threaded dispatch where supported by the compiler"}},
+      {"numeric_ad",
+       {OT_BOOL,
+        "Calculate forward, reverse and Jacobian derivatives numerically by sweeping "
+        "the algorithm with a tape of partial derivatives, instead of constructing "
+        "new expression graphs"}},
       {"cse",
        {OT_BOOL,
         "Perform common subexpression elimination (complexity is N*log(N) in graph size)"}},
+      {"peephole",
+       {OT_BOOL,
+        "Simplify the expressions before sorting them: fold constant operations, merge "
+        "repeated constants, remove identity operations such as x*1 and -(-x) and replace "
+        "operations by cheaper ones such as x+x by twice(x) and division by a constant "
+        "by multiplication. Statistics are available in stats()"}},
+      {"peephole_exact",
+       {OT_BOOL,
+        "Restrict the peephole simplification to rewrites that are exact in IEEE "
+        "arithmetic, e.g. not x*0 -> 0, x/3 -> x*(1/3) or pow(x,2) -> sq(x) (Default: true)"}},
       {"allow_free",
        {OT_BOOL,
         "Allow construction with free variables (Default: false)"}},
@@ -205,9 +629,335 @@ namespace casadi {
     opts["live_variables"] = live_variables_;
     opts["just_in_time_sparsity"] = just_in_time_sparsity_;
     opts["just_in_time_opencl"] = just_in_time_opencl_;
+    opts["bytecode"] = bytecode_;
+    opts["numeric_ad"] = numeric_ad_;
     return opts;
   }
 
+  // Is an expression a constant with a value, including the sign of zero?
+  static bool is_value(const SXElem& x, double v) {
+    if (!x.is_constant()) return false;
+    double xv = static_cast<double>(x);
+    return xv==v && std::signbit(xv)==std::signbit(v);
+  }
+
+  // Is a constant zero, of any sign?
+  static bool is_zero_value(const SXElem& x) {
+    return x.is_constant() && static_cast<double>(x)==0;
+  }
+
+  // Is the reciprocal of a constant exact, i.e. is it a power of two with a normal reciprocal?
+  static bool has_exact_inverse(double c) {
+    if (c==0 || !std::isfinite(c)) return false;
+    int e;
+    return std::fabs(std::frexp(c, &e))==0.5 && std::isnormal(1/c);
+  }
+
+  /** \brief Rewrites operations with simplified dependencies for SXFunction::peephole */
+  class Peephole {
+  public:
+    explicit Peephole(bool exact) : exact_(exact) {}
+
+    // Canonical node for a constant, by bit pattern
+    SXElem constant(const SXElem& c) {
+      double v = static_cast<double>(c);
+      uint64_t bits;
+      std::memcpy(&bits, &v, sizeof(v));
+      auto it = constants_.insert(std::make_pair(bits, c));
+      if (!it.second && it.first->second.get()!=c.get()) n_merged++;
+      return it.first->second;
+    }
+
+    // Build an operation, reusing orig (if any) when no rewrite applies
+    SXElem build(casadi_int op, const SXElem& x, const SXElem& y, const SXElem* orig=nullptr) {
+      bool unary = casadi_math<double>::ndeps(op)==1;
+      // Constant folding
+      if (x.is_constant() && (unary || y.is_constant())) {
+        n_folded++;
+        return constant(unary ? UnarySX::create(op, x) : BinarySX::create(op, x, y));
+      }
+      switch (op) {
+        case OP_ADD:
+          // x+(-0) is x, x+0 is x except for x==-0
+          if (is_value(y, -0.) || (!exact_ && is_value(y, 0))) return identity(x);
+          if (is_value(x, -0.) || (!exact_ && is_value(x, 0))) return identity(y);
+          if (y.is_op(OP_NEG)) return reduce(OP_SUB, x, y.dep());
+          if (x.is_op(OP_NEG)) return reduce(OP_SUB, y, x.dep());
+          if (x.get()==y.get()) return reduce(OP_TWICE, x);
+          break;
+        case OP_SUB:
+          // x-0 is x, x-(-0) is x except for x==-0
+          if (is_value(y, 0) || (!exact_ && is_value(y, -0.))) return identity(x);
+          if (is_value(x, -0.) || (!exact_ && is_value(x, 0))) return reduce(OP_NEG, y);
+          if (y.is_op(OP_NEG)) return reduce(OP_ADD, x, y.dep());
+          if (!exact_ && x.get()==y.get()) return identity(constant(0));
+          break;
+        case OP_MUL:
+          if (is_value(y, 1)) return identity(x);
+          if (is_value(x, 1)) return identity(y);
+          if (is_value(y, -1)) return reduce(OP_NEG, x);
+          if (is_value(x, -1)) return reduce(OP_NEG, y);
+          if (is_value(y, 2)) return reduce(OP_TWICE, x);
+          if (is_value(x, 2)) return reduce(OP_TWICE, y);
+          if (x.is_op(OP_NEG) && y.is_op(OP_NEG)) return reduce(OP_MUL, x.dep(), y.dep());
+          if (x.get()==y.get()) return reduce(OP_SQ, x);
+          // Not for x==inf or x==nan
+          if (!exact_ && (is_zero_value(x) || is_zero_value(y))) return identity(constant(0));
+          break;
+        case OP_DIV:
+          if (is_value(y, 1)) return identity(x);
+          if (is_value(y, -1)) return reduce(OP_NEG, x);
+          if (is_value(x, 1)) return reduce(OP_INV, y);
+          if (y.is_constant()) {
+            // Division by a constant: multiply by its reciprocal, rounded unless a power of two
+            double c = static_cast<double>(y);
+            if (has_exact_inverse(c) || (!exact_ && c!=0 && std::isfinite(1/c))) {
+              return reduce(OP_MUL, x, constant(1/c));
+            }
+          }
+          if (!exact_ && is_zero_value(x)) return identity(constant(0));
+          break;
+        case OP_NEG:
+          if (x.is_op(OP_NEG)) return identity(x.dep());
+          break;
+        case OP_FABS:
+          if (x.is_op(OP_FABS)) return identity(x);
+          if (x.is_op(OP_NEG)) return reduce(OP_FABS, x.dep());
+          break;
+        case OP_SQ:
+          if (x.is_op(OP_NEG) || x.is_op(OP_FABS)) return reduce(OP_SQ, x.dep());
+          // Not for x<0
+          if (!exact_ && x.is_op(OP_SQRT)) return identity(x.dep());
+          break;
+        case OP_SQRT:
+          // Not on overflow of sq(x)
+          if (!exact_ && x.is_op(OP_SQ)) return reduce(OP_FABS, x.dep());
+          break;
+        case OP_EXP:
+          if (!exact_ && x.is_op(OP_LOG)) return identity(x.dep());
+          break;
+        case OP_LOG:
+          if (!exact_ && x.is_op(OP_EXP)) return identity(x.dep());
+          break;
+        case OP_INV:
+          if (!exact_ && x.is_op(OP_INV)) return identity(x.dep());
+          break;
+        case OP_POW:
+        case OP_CONSTPOW:
+          // pow(x,+-0) is one for any x
+          if (is_zero_value(y)) return identity(constant(1));
+          if (is_value(y, 1)) return identity(x);
+          // Not bitwise identical unless pow is correctly rounded, which libm does not promise
+          if (!exact_ && is_value(y, 2)) return reduce(OP_SQ, x);
+          // Not for x==-0 or x==-inf
+          if (!exact_ && is_value(y, 0.5)) return reduce(OP_SQRT, x);
+          if (!exact_ && is_value(y, -1)) return reduce(OP_INV, x);
+          break;
+        default: break;
+      }
+      // Unchanged dependencies: keep the original node
+      if (orig && orig->dep(0).get()==x.get() && (unary || orig->dep(1).get()==y.get())) {
+        return *orig;
+      }
+      return unary ? UnarySX::create(op, x) : BinarySX::create(op, x, y);
+    }
+
+    // Statistics
+    casadi_int n_folded = 0, n_merged = 0, n_identity = 0, n_reduced = 0;
+
+  private:
+    // Operation removed, x remains
+    SXElem identity(const SXElem& x) {
+      n_identity++;
+      return x;
+    }
+
+    // Operation replaced by a cheaper one
+    SXElem reduce(casadi_int op, const SXElem& x, const SXElem& y) {
+      n_reduced++;
+      return build(op, x, y);
+    }
+    SXElem reduce(casadi_int op, const SXElem& x) { return reduce(op, x, x);}
+
+    // Only rewrites that are exact in IEEE arithmetic
+    bool exact_;
+
+    // Constants, by bit pattern
+    std::unordered_map<uint64_t, SXElem> constants_;
+  };
+
+  std::vector<SX> SXFunction::peephole(const std::vector<SX>& e, bool exact, Dict& stats) {
+    // Sort the graph
+    Function f("f", std::vector<SX>{}, e, {{"live_variables", false},
+      {"max_io", 0}, {"cse", false}, {"allow_free", true}});
+    const SXFunction* ff = f.get<SXFunction>();
+
+    std::vector<SX> ret;
+    for (auto&& ei : e) ret.push_back(SX::zeros(ei.sparsity()));
+
+    // Rebuild the expressions in topological order, without on-the-fly simplifications
+    Peephole p(exact);
+    std::vector<SXElem> w(ff->worksize_);
+    auto c_it = ff->constants_.begin();
+    auto p_it = ff->free_vars_.begin();
+    auto o_it = ff->operations_.begin();
+    for (auto&& a : ff->algorithm_) {
+      switch (a.op) {
+      case OP_OUTPUT:
+        ret.at(a.i0).nonzeros().at(a.i2) = w[a.i1];
+        break;
+      case OP_CONST:
+        w[a.i0] = p.constant(*c_it++);
+        break;
+      case OP_PARAMETER:
+        w[a.i0] = *p_it++;
+        break;
+      default:
+        {
+          const SXElem& orig = *o_it++;
+          bool unary = casadi_math<double>::ndeps(a.op)==1;
+          w[a.i0] = p.build(a.op, w[a.i1], w[unary ? a.i1 : a.i2], &orig);
+        }
+      }
+    }
+
+    stats = Dict{{"exact", exact},
+                 {"n_operations_before", static_cast<casadi_int>(ff->operations_.size())},
+                 {"n_constants_before", static_cast<casadi_int>(ff->constants_.size())},
+                 {"constants_folded", p.n_folded},
+                 {"constants_merged", p.n_merged},
+                 {"identities_removed", p.n_identity},
+                 {"strength_reduced", p.n_reduced}};
+    return ret;
+  }
+
+  // Sort depth-first again, visiting the dependency that needs the most work vector
+  // elements first (Sethi-Ullman numbering, approximate for shared subexpressions).
+  // nodes is a topological order, with the temporaries of the nodes set to -1
+  static void sort_locality(const std::vector<SX>& out, std::vector<SXNode*>& nodes) {
+    std::unordered_map<const SXNode*, casadi_int> need;
+    need.reserve(nodes.size());
+    for (SXNode* n : nodes) {
+      if (!n) continue;
+      if (n->n_dep()==0) {
+        need[n] = 1;
+      } else if (n->n_dep()==1) {
+        need[n] = need[n->dep(0).get()];
+      } else {
+        casadi_int a = need[n->dep(0).get()], b = need[n->dep(1).get()];
+        need[n] = a==b ? a+1 : std::max(a, b);
+      }
+    }
+    for (SXNode* n : nodes) {
+      if (n) n->temp = 0;
+    }
+    nodes.clear();
+    std::stack<SXNode*> s;
+    for (auto&& e : out) {
+      for (auto&& nz : e.nonzeros()) {
+        s.push(nz.get());
+        while (!s.empty()) {
+          SXNode* t = s.top();
+          if (t->temp>=0) {
+            casadi_int next_dep = t->temp++;
+            if (next_dep < t->n_dep()) {
+              if (t->n_dep()==2 && need[t->dep(1).get()] > need[t->dep(0).get()]) {
+                next_dep = 1 - next_dep;
+              }
+              s.push(t->dep(next_dep).get());
+            } else {
+              nodes.push_back(t);
+              t->temp = -1;
+              s.pop();
+            }
+          } else {
+            s.pop();
+          }
+        }
+        // Output instruction
+        nodes.push_back(nullptr);
+      }
+    }
+  }
+
+  // List scheduling: among the instructions whose dependencies have been scheduled, take
+  // the first in the original order that does not use the result of one of the last few
+  // instructions, falling back to the first one. Independent chains are interleaved while
+  // the original order is otherwise kept.
+  static void sort_latency(const std::vector<SX>& out, std::vector<SXNode*>& nodes) {
+    // Instructions whose results are not used directly, ready instructions considered
+    const casadi_int latency = 4, n_candidates = 8;
+    // Position of the nodes in the order
+    for (casadi_int i=0; i<nodes.size(); ++i) {
+      if (nodes[i]) nodes[i]->temp = static_cast<int>(i);
+    }
+    // Dependencies: the operands, or for an output instruction the node and the previous
+    // output instruction, such that the outputs keep their order
+    std::vector<std::vector<casadi_int> > dep(nodes.size()), users(nodes.size());
+    auto it_out = out.begin();
+    casadi_int nz = 0, prev_out = -1;
+    for (casadi_int i=0; i<nodes.size(); ++i) {
+      if (nodes[i]) {
+        for (casadi_int c=0; c<nodes[i]->n_dep(); ++c) dep[i].push_back(nodes[i]->dep(c)->temp);
+      } else {
+        while (nz>=it_out->nnz()) {
+          ++it_out;
+          nz = 0;
+        }
+        dep[i].push_back(it_out->nonzeros().at(nz++)->temp);
+        if (prev_out>=0) dep[i].push_back(prev_out);
+        prev_out = i;
+      }
+      for (casadi_int d : dep[i]) users[d].push_back(i);
+    }
+    // Number of dependencies not yet scheduled, ready instructions by position
+    std::vector<casadi_int> n_wait(nodes.size());
+    std::priority_queue<casadi_int, std::vector<casadi_int>, std::greater<casadi_int> > ready;
+    for (casadi_int i=0; i<nodes.size(); ++i) {
+      n_wait[i] = dep[i].size();
+      if (n_wait[i]==0) ready.push(i);
+    }
+    // Time at which each instruction is scheduled
+    std::vector<casadi_int> time(nodes.size(), -1);
+    std::vector<SXNode*> ret;
+    ret.reserve(nodes.size());
+    std::vector<casadi_int> cand;
+    while (!ready.empty()) {
+      // First candidate not using a recent result
+      cand.clear();
+      casadi_int sel = -1;
+      while (!ready.empty() && cand.size()<n_candidates) {
+        casadi_int i = ready.top();
+        ready.pop();
+        bool recent = false;
+        for (casadi_int d : dep[i]) {
+          if (static_cast<casadi_int>(ret.size()) - time[d] <= latency) recent = true;
+        }
+        if (!recent) {
+          sel = i;
+          break;
+        }
+        cand.push_back(i);
+      }
+      if (sel<0) {
+        sel = cand.front();
+        cand.erase(cand.begin());
+      }
+      for (casadi_int i : cand) ready.push(i);
+      // Schedule
+      time[sel] = ret.size();
+      ret.push_back(nodes[sel]);
+      for (casadi_int u : users[sel]) {
+        if (--n_wait[u]==0) ready.push(u);
+      }
+    }
+    casadi_assert_dev(ret.size()==nodes.size());
+    for (SXNode* n : ret) {
+      if (n) n->temp = -1;
+    }
+    nodes = ret;
+  }
+
   void SXFunction::init(const Dict& opts) {
     // Call the init function of the base class
     XFunction<SXFunction, SX, SXNode>::init(opts);
@@ -218,6 +968,8 @@ namespace casadi {
 
     bool cse_opt = false;
     bool allow_free = false;
+    bool peephole_opt = false, peephole_exact = true;
+    std::string schedule = "depth_first";
 
     // Read options
     for (auto&& op : opts) {
@@ -225,17 +977,32 @@ namespace casadi {
         default_in_ = op.second;
       } else if (op.first=="live_variables") {
         live_variables_ = op.second;
+      } else if (op.first=="schedule") {
+        schedule = op.second.to_string();
+        casadi_assert(schedule=="depth_first" || schedule=="locality" || schedule=="latency",
+          "Unknown schedule '" + schedule + "'. Options are 'depth_first', 'locality' and "
+          "'latency'");
       } else if (op.first=="just_in_time_opencl") {
         just_in_time_opencl_ = op.second;
       } else if (op.first=="just_in_time_sparsity") {
         just_in_time_sparsity_ = op.second;
+      } else if (op.first=="bytecode") {
+        bytecode_ = op.second;
+      } else if (op.first=="numeric_ad") {
+        numeric_ad_ = op.second;
       } else if (op.first=="cse") {
         cse_opt = op.second;
+      } else if (op.first=="peephole") {
+        peephole_opt = op.second;
+      } else if (op.first=="peephole_exact") {
+        peephole_exact = op.second;
       } else if (op.first=="allow_free") {
         allow_free = op.second;
       }
     }
 
+    peephole_stats_.clear();
+    if (peephole_opt) out_ = peephole(out_, peephole_exact, peephole_stats_);
     if (cse_opt) out_ = cse(out_);
 
     // Check/set default inputs
@@ -246,120 +1013,143 @@ namespace casadi {
                             "Option 'default_in' has incorrect length");
     }
 
-    // Stack used to sort the computational graph
-    std::stack<SXNode*> s;
-
     // All nodes
     std::vector<SXNode*> nodes;
 
-    // Add the list of nodes
-    casadi_int ind=0;
-    for (auto it = out_.begin(); it != out_.end(); ++it, ++ind) {
-      casadi_int nz=0;
-      for (auto itc = (*it)->begin(); itc != (*it)->end(); ++itc, ++nz) {
-        // Add outputs to the list
-        s.push(itc->get());
-        sort_depth_first(s, nodes);
-
-        // A null pointer means an output instruction
-        nodes.push_back(static_cast<SXNode*>(nullptr));
+    // Input instructions
+    std::vector<std::pair<int, SXNode*> > symb_loc;
+
+    // Number of times each node is used
+    std::vector<casadi_int> refcount;
+
+    {
+      // The temporaries of the nodes may be shared between threads
+      SXTempLock temp_lock;
+
+      // Stack used to sort the computational graph
+      std::stack<SXNode*> s;
+
+      // Add the list of nodes
+      casadi_int ind=0;
+      for (auto it = out_.begin(); it != out_.end(); ++it, ++ind) {
+        casadi_int nz=0;
+        for (auto itc = (*it)->begin(); itc != (*it)->end(); ++itc, ++nz) {
+          // Add outputs to the list
+          s.push(itc->get());
+          sort_depth_first(s, nodes);
+
+          // A null pointer means an output instruction
+          nodes.push_back(static_cast<SXNode*>(nullptr));
+        }
       }
-    }
 
-    casadi_assert(nodes.size() <= std::numeric_limits<int>::max(), "Integer overflow");
-    // Set the temporary variables to be the corresponding place in the sorted graph
-    for (casadi_int i=0; i<nodes.size(); ++i) {
-      if (nodes[i]) {
-        nodes[i]->temp = static_cast<int>(i);
+      // Alternative instruction schedules
+      if (schedule=="locality") {
+        sort_locality(out_, nodes);
+      } else if (schedule=="latency") {
+        sort_latency(out_, nodes);
       }
-    }
 
-    // Sort the nodes by type
-    constants_.clear();
-    operations_.clear();
-    for (std::vector<SXNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
-      SXNode* t = *it;
-      if (t) {
-        if (t->is_constant())
-          constants_.push_back(SXElem::create(t));
-        else if (!t->is_symbolic())
-          operations_.push_back(SXElem::create(t));
+      casadi_assert(nodes.size() <= std::numeric_limits<int>::max(), "Integer overflow");
+      // Set the temporary variables to be the corresponding place in the sorted graph
+      for (casadi_int i=0; i<nodes.size(); ++i) {
+        if (nodes[i]) {
+          nodes[i]->temp = static_cast<int>(i);
+        }
       }
-    }
 
-    // Input instructions
-    std::vector<std::pair<int, SXNode*> > symb_loc;
+      // Sort the nodes by type
+      constants_.clear();
+      operations_.clear();
+      for (std::vector<SXNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        SXNode* t = *it;
+        if (t) {
+          if (t->is_constant())
+            constants_.push_back(SXElem::create(t));
+          else if (!t->is_symbolic())
+            operations_.push_back(SXElem::create(t));
+        }
+      }
 
-    // Current output and nonzero, start with the first one
-    int curr_oind, curr_nz=0;
-    casadi_assert(out_.size() <= std::numeric_limits<int>::max(), "Integer overflow");
-    for (curr_oind=0; curr_oind<out_.size(); ++curr_oind) {
-      if (out_[curr_oind].nnz()!=0) {
-        break;
+      // Current output and nonzero, start with the first one
+      int curr_oind, curr_nz=0;
+      casadi_assert(out_.size() <= std::numeric_limits<int>::max(), "Integer overflow");
+      for (curr_oind=0; curr_oind<out_.size(); ++curr_oind) {
+        if (out_[curr_oind].nnz()!=0) {
+          break;
+        }
       }
-    }
 
-    // Count the number of times each node is used
-    std::vector<casadi_int> refcount(nodes.size(), 0);
+      // Count the number of times each node is used
+      refcount.resize(nodes.size(), 0);
 
-    // Get the sequence of instructions for the virtual machine
-    algorithm_.resize(0);
-    algorithm_.reserve(nodes.size());
-    for (std::vector<SXNode*>::iterator it=nodes.begin(); it!=nodes.end(); ++it) {
-      // Current node
-      SXNode* n = *it;
+      // Get the sequence of instructions for the virtual machine
+      algorithm_.resize(0);
+      algorithm_.reserve(nodes.size());
+      for (std::vector<SXNode*>::iterator it=nodes.begin(); it!=nodes.end(); ++it) {
+        // Current node
+        SXNode* n = *it;
 
-      // New element in the algorithm
-      AlgEl ae;
+        // New element in the algorithm
+        AlgEl ae;
 
-      // Get operation
-      ae.op = n==nullptr ? static_cast<int>(OP_OUTPUT) : static_cast<int>(n->op());
+        // Get operation
+        ae.op = n==nullptr ? static_cast<int>(OP_OUTPUT) : static_cast<int>(n->op());
 
-      // Get instruction
-      switch (ae.op) {
-      case OP_CONST: // constant
-        ae.d = n->to_double();
-        ae.i0 = n->temp;
-        break;
-      case OP_PARAMETER: // a parameter or input
-        symb_loc.push_back(std::make_pair(algorithm_.size(), n));
-        ae.i0 = n->temp;
-        ae.d = 0; // value not used, but set here to avoid uninitialized data in serialization
-        break;
-      case OP_OUTPUT: // output instruction
-        ae.i0 = curr_oind;
-        ae.i1 = out_[curr_oind]->at(curr_nz)->temp;
-        ae.i2 = curr_nz;
-
-        // Go to the next nonzero
-        casadi_assert(curr_nz < std::numeric_limits<int>::max(), "Integer overflow");
-        curr_nz++;
-        if (curr_nz>=out_[curr_oind].nnz()) {
-          curr_nz=0;
-          casadi_assert(curr_oind < std::numeric_limits<int>::max(), "Integer overflow");
-          curr_oind++;
-          for (; curr_oind<out_.size(); ++curr_oind) {
-            if (out_[curr_oind].nnz()!=0) {
-              break;
+        // Get instruction
+        switch (ae.op) {
+        case OP_CONST: // constant
+          ae.d = n->to_double();
+          ae.i0 = n->temp;
+          break;
+        case OP_PARAMETER: // a parameter or input
+          symb_loc.push_back(std::make_pair(algorithm_.size(), n));
+          ae.i0 = n->temp;
+          ae.d = 0; // value not used, but set here to avoid uninitialized data in serialization
+          break;
+        case OP_OUTPUT: // output instruction
+          ae.i0 = curr_oind;
+          ae.i1 = out_[curr_oind]->at(curr_nz)->temp;
+          ae.i2 = curr_nz;
+
+          // Go to the next nonzero
+          casadi_assert(curr_nz < std::numeric_limits<int>::max(), "Integer overflow");
+          curr_nz++;
+          if (curr_nz>=out_[curr_oind].nnz()) {
+            curr_nz=0;
+            casadi_assert(curr_oind < std::numeric_limits<int>::max(), "Integer overflow");
+            curr_oind++;
+            for (; curr_oind<out_.size(); ++curr_oind) {
+              if (out_[curr_oind].nnz()!=0) {
+                break;
+              }
             }
           }
+          break;
+        default:       // Unary or binary operation
+          ae.i0 = n->temp;
+          ae.i1 = n->dep(0).get()->temp;
+          ae.i2 = n->dep(1).get()->temp;
         }
-        break;
-      default:       // Unary or binary operation
-        ae.i0 = n->temp;
-        ae.i1 = n->dep(0).get()->temp;
-        ae.i2 = n->dep(1).get()->temp;
-      }
 
-      // Number of dependencies
-      casadi_int ndeps = casadi_math<double>::ndeps(ae.op);
+        // Number of dependencies
+        casadi_int ndeps = casadi_math<double>::ndeps(ae.op);
 
-      // Increase count of dependencies
-      for (casadi_int c=0; c<ndeps; ++c) {
-        refcount.at(c==0 ? ae.i1 : ae.i2)++;
+        // Increase count of dependencies
+        for (casadi_int c=0; c<ndeps; ++c) {
+          refcount.at(c==0 ? ae.i1 : ae.i2)++;
+        }
+        // Add to algorithm
+        algorithm_.push_back(ae);
+      }
+
+      // Reset the temporary variables before releasing the lock, other threads
+      // may sort graphs that share nodes with this one
+      for (casadi_int i=0; i<nodes.size(); ++i) {
+        if (nodes[i]) {
+          nodes[i]->temp = 0;
+        }
       }
-      // Add to algorithm
-      algorithm_.push_back(ae);
     }
 
     // Place in the work vector for each of the nodes in the tree (overwrites the reference counter)
@@ -368,6 +1158,10 @@ namespace casadi {
     // Stack with unused elements in the work vector
     std::stack<int> unused;
 
+    // Unused elements by index, for reusing the lowest one first
+    std::priority_queue<int, std::vector<int>, std::greater<int> > unused_lowest;
+    bool lowest_first = schedule=="locality";
+
     // Work vector size
     int worksize = 0;
 
@@ -382,12 +1176,22 @@ namespace casadi {
       for (casadi_int c=ndeps-1; c>=0; --c) {
         casadi_int ch_ind = c==0 ? a.i1 : a.i2;
         casadi_int remaining = --refcount.at(ch_ind);
-        if (remaining==0) unused.push(place[ch_ind]);
+        if (remaining==0) {
+          if (lowest_first) {
+            unused_lowest.push(place[ch_ind]);
+          } else {
+            unused.push(place[ch_ind]);
+          }
+        }
       }
 
       // Find a place to store the variable
       if (a.op!=OP_OUTPUT) {
-        if (live_variables_ && !unused.empty()) {
+        if (live_variables_ && lowest_first && !unused_lowest.empty()) {
+          // Reuse the unused variable with the lowest index
+          a.i0 = place[a.i0] = unused_lowest.top();
+          unused_lowest.pop();
+        } else if (live_variables_ && !unused.empty()) {
           // Try to reuse a variable from the stack if possible (last in, first out)
           a.i0 = place[a.i0] = unused.top();
           unused.pop();
@@ -427,12 +1231,8 @@ namespace casadi {
     // Allocate work vectors (symbolic/numeric)
     alloc_w(worksize_);
 
-    // Reset the temporary variables
-    for (casadi_int i=0; i<nodes.size(); ++i) {
-      if (nodes[i]) {
-        nodes[i]->temp = 0;
-      }
-    }
+    // The temporaries of the nodes may be shared between threads
+    SXTempLock temp_lock;
 
     // Now mark each input's place in the algorithm
     for (auto it=symb_loc.begin(); it!=symb_loc.end(); ++it) {
@@ -479,6 +1279,18 @@ namespace casadi {
       "Set option 'allow_free' to allow free variables.");
     }
 
+    // Complete the peephole statistics with the instructions that remain
+    if (peephole_opt) {
+      peephole_stats_["n_operations_after"] = static_cast<casadi_int>(operations_.size());
+      peephole_stats_["n_constants_after"] = static_cast<casadi_int>(constants_.size());
+      if (verbose_) {
+        casadi_message(name_ + "::init: peephole simplification reduced "
+          + str(peephole_stats_["n_operations_before"]) + " operations to "
+          + str(operations_.size()) + " and " + str(peephole_stats_["n_constants_before"])
+          + " constants to " + str(constants_.size()));
+      }
+    }
+
     // Initialize just-in-time compilation for numeric evaluation using OpenCL
     if (just_in_time_opencl_) {
       casadi_error("OpenCL is not supported in this version of CasADi");
@@ -489,6 +1301,9 @@ namespace casadi {
       casadi_error("OpenCL is not supported in this version of CasADi");
     }
 
+    // Compile bytecode for numeric evaluation
+    if (bytecode_) init_bytecode();
+
     // Print
     if (verbose_) casadi_message(str(algorithm_.size()) + " elementary operations");
   }
@@ -798,6 +1613,213 @@ namespace casadi {
     }
   }
 
+  void SXFunction::eval_tape(const double** arg, double* w, TapeEl<double>* tape) const {
+    for (auto&& a : algorithm_) {
+      switch (a.op) {
+      case OP_INPUT:
+        w[a.i0] = arg[a.i1]==nullptr ? 0 : arg[a.i1][a.i2];
+        break;
+      case OP_OUTPUT:
+        break;
+      case OP_CONST:
+        w[a.i0] = a.d;
+        break;
+      case OP_PARAMETER:
+        casadi_error("Cannot evaluate \"" + name_ + "\" since variables "
+          + str(free_vars_) + " are free.");
+      default:
+        casadi_math<double>::derF(a.op, w[a.i1], w[a.i2], w[a.i0], tape++->d);
+      }
+    }
+  }
+
+  void SXFunction::tape_forward(const double** fseed, double** fsens,
+      const TapeEl<double>* tape, double* w) const {
+    for (auto&& a : algorithm_) {
+      switch (a.op) {
+      case OP_INPUT:
+        w[a.i0] = fseed[a.i1]==nullptr ? 0 : fseed[a.i1][a.i2];
+        break;
+      case OP_OUTPUT:
+        if (fsens[a.i0]) fsens[a.i0][a.i2] = w[a.i1];
+        break;
+      case OP_CONST:
+      case OP_PARAMETER:
+        w[a.i0] = 0;
+        break;
+      case OP_IF_ELSE_ZERO:
+        w[a.i0] = if_else_zero(tape++->d[1], w[a.i2]);
+        break;
+      CASADI_MATH_BINARY_BUILTIN // Binary operation
+        w[a.i0] = tape->d[0] * w[a.i1] + tape->d[1] * w[a.i2];
+        tape++;
+        break;
+      default: // Unary operation
+        w[a.i0] = tape++->d[0] * w[a.i1];
+      }
+    }
+  }
+
+  void SXFunction::tape_reverse(const double** aseed, double** asens,
+      const TapeEl<double>* tape, double* w) const {
+    // Clear sensitivities and work vector
+    for (casadi_int i=0; i<n_in_; ++i) if (asens[i]) casadi_clear(asens[i], nnz_in(i));
+    casadi_clear(w, worksize_);
+    // Reverse sweep
+    tape += operations_.size();
+    double seed;
+    for (auto it = algorithm_.rbegin(); it!=algorithm_.rend(); ++it) {
+      switch (it->op) {
+      case OP_INPUT:
+        if (asens[it->i1]) asens[it->i1][it->i2] += w[it->i0];
+        w[it->i0] = 0;
+        break;
+      case OP_OUTPUT:
+        if (aseed[it->i0]) w[it->i1] += aseed[it->i0][it->i2];
+        break;
+      case OP_CONST:
+      case OP_PARAMETER:
+        w[it->i0] = 0;
+        break;
+      case OP_IF_ELSE_ZERO:
+        seed = w[it->i0];
+        w[it->i0] = 0;
+        w[it->i2] += if_else_zero((--tape)->d[1], seed);
+        break;
+      CASADI_MATH_BINARY_BUILTIN // Binary operation
+        seed = w[it->i0];
+        w[it->i0] = 0;
+        --tape;
+        w[it->i1] += tape->d[0] * seed;
+        w[it->i2] += tape->d[1] * seed;
+        break;
+      default: // Unary operation
+        seed = w[it->i0];
+        w[it->i0] = 0;
+        w[it->i1] += (--tape)->d[0] * seed;
+      }
+    }
+  }
+
+  Function SXFunction::get_forward(casadi_int nfwd, const std::string& name,
+      const std::vector<std::string>& inames,
+      const std::vector<std::string>& onames,
+      const Dict& opts) const {
+    if (!numeric_ad_ || has_free()) {
+      return XFunction::get_forward(nfwd, name, inames, onames, opts);
+    }
+    return TapeAD::create(name, self(), TapeMode::FORWARD, nfwd, inames, onames, opts);
+  }
+
+  Function SXFunction::get_reverse(casadi_int nadj, const std::string& name,
+      const std::vector<std::string>& inames,
+      const std::vector<std::string>& onames,
+      const Dict& opts) const {
+    if (!numeric_ad_ || has_free()) {
+      return XFunction::get_reverse(nadj, name, inames, onames, opts);
+    }
+    return TapeAD::create(name, self(), TapeMode::REVERSE, nadj, inames, onames, opts);
+  }
+
+  Function SXFunction::get_jacobian(const std::string& name,
+      const std::vector<std::string>& inames,
+      const std::vector<std::string>& onames,
+      const Dict& opts) const {
+    if (!numeric_ad_ || has_free()) {
+      return XFunction::get_jacobian(name, inames, onames, opts);
+    }
+    return TapeAD::create(name, self(), TapeMode::JACOBIAN, 0, inames, onames, opts);
+  }
+
+  SX SXFunction::hess(casadi_int iind, casadi_int oind) const {
+    casadi_assert(sparsity_out_.at(oind).is_scalar(),
+      "Can only take Hessian of scalar expression.");
+
+    // Second order adjoints with respect to all input nonzeros
+    std::vector<const SXElem*> arg(n_in_);
+    for (casadi_int i=0; i<n_in_; ++i) arg[i] = get_ptr(in_[i].nonzeros());
+    std::vector<casadi_int> hrow, hcol;
+    std::vector<SXElem> hnz;
+    edge_pushing(*this, oind, get_ptr(arg), op_derivatives(*this), false, hrow, hcol, hnz);
+
+    // Keep the entries for input iind, with rows and columns of the input matrix
+    casadi_int offset = 0;
+    for (casadi_int i=0; i<iind; ++i) offset += nnz_in(i);
+    std::vector<casadi_int> ind = sparsity_in_.at(iind).find();
+    std::vector<casadi_int> r, c;
+    std::vector<SXElem> nz;
+    for (casadi_int k=0; k<hnz.size(); ++k) {
+      casadi_int r0 = hrow[k] - offset, c0 = hcol[k] - offset;
+      if (c0<0 || r0>=ind.size()) continue;
+      r.push_back(ind[r0]);
+      c.push_back(ind[c0]);
+      nz.push_back(hnz[k]);
+    }
+
+    // Symmetric Hessian from its lower triangular part
+    SX H = SX::triplet(r, c, SX(nz), numel_in(iind), numel_in(iind));
+    return H + tril(H, false).T();
+  }
+
+  Function SXFunction::factory(const std::string& name,
+      const std::vector<std::string>& s_in,
+      const std::vector<std::string>& s_out,
+      const Function::AuxOut& aux,
+      const Dict& opts) const {
+    // Hessian blocks evaluated numerically by edge-pushing?
+    auto it = opts.find("hessian_method");
+    if (it==opts.end() || it->second.to_string()!="edge_pushing_numeric") {
+      return XFunction::factory(name, s_in, s_out, aux, opts);
+    }
+    Dict lag_opts = opts;
+    lag_opts.erase("hessian_method");
+
+    // Parse the requested Hessian blocks
+    std::vector<std::string> s_lag;
+    std::vector<casadi_int> oind, iind1, iind2;
+    std::vector<std::vector<std::string> > attr(s_out.size());
+    for (casadi_int k=0; k<s_out.size(); ++k) {
+      std::vector<std::string> p;
+      std::string s = s_out[k];
+      while (Factory<SX>::has_prefix(s)) {
+        std::pair<std::string, std::string> ss = Factory<SX>::split_prefix(s);
+        p.push_back(ss.first);
+        s = ss.second;
+      }
+      p.push_back(s);
+      auto h = std::find(p.begin(), p.end(), "hess");
+      casadi_assert(h!=p.end() && p.end()-h==4, "Cannot process factory output \"" + s_out[k]
+        + "\": Only Hessian blocks can be evaluated numerically by edge-pushing.");
+      attr[k].assign(p.begin(), h);
+      // Expression being differentiated
+      auto f_it = std::find(s_lag.begin(), s_lag.end(), h[1]);
+      oind.push_back(f_it - s_lag.begin());
+      if (f_it==s_lag.end()) s_lag.push_back(h[1]);
+      // Arguments
+      for (casadi_int i=2; i<4; ++i) {
+        auto x_it = std::find(s_in.begin(), s_in.end(), h[i]);
+        casadi_assert(x_it!=s_in.end(), "Cannot process factory output \"" + s_out[k]
+          + "\": \"" + h[i] + "\" must be a factory input.");
+        (i==2 ? iind1 : iind2).push_back(x_it - s_in.begin());
+      }
+    }
+
+    // Expressions being differentiated, as functions of the factory inputs
+    Function lag = XFunction::factory(name + "_lag", s_in, s_lag, aux, lag_opts);
+
+    // Options of the generated function also available for the Hessian
+    Dict final_options = generate_options("clone");
+    extract_from_dict_inplace(lag_opts, "final_options", final_options);
+    Function ret;
+    ret.own(new EdgePushing(name, lag, s_out, oind, iind1, iind2, attr));
+    Dict ret_opts;
+    for (auto&& op : final_options) {
+      if (op.first!="jit" && ret->get_options().find(op.first)) ret_opts[op.first] = op.second;
+    }
+    ret->construct(ret_opts);
+    return ret;
+  }
+
   int SXFunction::
   sp_forward(const bvec_t** arg, bvec_t** res, casadi_int* iw, bvec_t* w, void* mem) const {
     // Fall back when forward mode not allowed
@@ -975,7 +1997,7 @@ namespace casadi {
 
   SXFunction::SXFunction(DeserializingStream& s) :
     XFunction<SXFunction, SX, SXNode>(s) {
-    s.version("SXFunction", 1);
+    int version = s.version("SXFunction", 1, 3);
     size_t n_instructions;
     s.unpack("SXFunction::n_instr", n_instructions);
 
@@ -999,13 +2021,24 @@ namespace casadi {
     just_in_time_sparsity_ = false;
 
     s.unpack("SXFunction::live_variables", live_variables_);
+    bytecode_ = false;
+    if (version>=2) s.unpack("SXFunction::bytecode", bytecode_);
+    if (bytecode_) init_bytecode();
+    numeric_ad_ = false;
+    if (version>=3) s.unpack("SXFunction::numeric_ad", numeric_ad_);
 
     XFunction<SXFunction, SX, SXNode>::delayed_deserialize_members(s);
   }
 
+  Dict SXFunction::get_stats(void* mem) const {
+    Dict stats = XFunction::get_stats(mem);
+    if (!peephole_stats_.empty()) stats["peephole"] = peephole_stats_;
+    return stats;
+  }
+
   void SXFunction::serialize_body(SerializingStream &s) const {
     XFunction<SXFunction, SX, SXNode>::serialize_body(s);
-    s.version("SXFunction", 1);
+    s.version("SXFunction", 3);
     s.pack("SXFunction::n_instr", algorithm_.size());
 
     s.pack("SXFunction::worksize", worksize_);
@@ -1023,6 +2056,8 @@ namespace casadi {
     }
 
     s.pack("SXFunction::live_variables", live_variables_);
+    s.pack("SXFunction::bytecode", bytecode_);
+    s.pack("SXFunction::numeric_ad", numeric_ad_);
 
     XFunction<SXFunction, SX, SXNode>::delayed_serialize_members(s);
   }
@@ -43,6 +43,18 @@ namespace casadi {
     };
   };
 
+  /** \brief  An instruction of the compiled SXElem bytecode
+
+      Unlike ScalarAtomic, an instruction may represent several fused
+      atomic operations, e.g. a multiplication followed by an addition,
+      or a binary operation with a constant or function input operand. */
+  struct ByteCodeEl {
+    int op;     /// Bytecode instruction index
+    int sub;    /// Operator index, for generic instructions
+    int i0, i1, i2, i3;
+    double d;   /// Constant operand
+  };
+
 /** \brief  Internal node class for SXFunction
 
     Do not use any internal class directly - always use the public Function
@@ -72,6 +84,29 @@ class CASADI_EXPORT SXFunction :
       \identifier{ue} */
   int eval(const double** arg, double** res, casadi_int* iw, double* w, void* mem) const override;
 
+  /** \brief  Evaluate numerically using the compiled bytecode
+  */
+  int eval_bytecode(const double** arg, double** res, double* w) const;
+
+  /** \brief  Evaluate numerically at n independent points
+
+      The inputs and outputs of point k are found at offsets k*nnz_in(i) and
+      k*nnz_out(i), respectively. Groups of batch_width points are evaluated
+      simultaneously, sweeping the algorithm once over a structure-of-arrays work
+      vector of length batch_width*sz_w(). Remaining points are evaluated one by one.
+      As for Map, arg and res must have room for n_in_+sz_arg() and n_out_+sz_res()
+      elements, respectively.
+  */
+  int eval_batch(const double** arg, double** res, casadi_int* iw, double* w,
+                 casadi_int n) const;
+
+  /** \brief  Can eval_batch be used in place of repeated numeric evaluation?
+  */
+  bool has_eval_batch() const { return !jit_ && free_vars_.empty();}
+
+  /// Number of points evaluated simultaneously in eval_batch
+  static const casadi_int batch_width = 8;
+
   /** \brief  evaluate symbolically while also propagating directional derivatives
 
       \identifier{uf} */
@@ -95,6 +130,22 @@ class CASADI_EXPORT SXFunction :
   void ad_reverse(const std::vector<std::vector<SX> >& aseed,
                             std::vector<std::vector<SX> >& asens) const;
 
+  ///@{
+  /** \brief Numeric derivatives by tape sweeps, if numeric_ad is set */
+  Function get_forward(casadi_int nfwd, const std::string& name,
+                       const std::vector<std::string>& inames,
+                       const std::vector<std::string>& onames,
+                       const Dict& opts) const override;
+  Function get_reverse(casadi_int nadj, const std::string& name,
+                       const std::vector<std::string>& inames,
+                       const std::vector<std::string>& onames,
+                       const Dict& opts) const override;
+  Function get_jacobian(const std::string& name,
+                        const std::vector<std::string>& inames,
+                        const std::vector<std::string>& onames,
+                        const Dict& opts) const override;
+  ///@}
+
   /** \brief  Check if smooth
 
       \identifier{ui} */
@@ -144,10 +195,20 @@ class CASADI_EXPORT SXFunction :
     return ret;
   }
 
-  /** \brief Hessian (forward over adjoint) via source code transformation
+  /** \brief Hessian of a scalar output by edge-pushing
+
+      Second order adjoints are propagated directly over the algorithm,
+      without forming the gradient expression or coloring the Hessian.
 
       \identifier{up} */
-  SX hess(casadi_int iind=0, casadi_int oind=0);
+  SX hess(casadi_int iind=0, casadi_int oind=0) const;
+
+  /** \brief Factory, with support for numeric edge-pushing Hessians */
+  Function factory(const std::string& name,
+                   const std::vector<std::string>& s_in,
+                   const std::vector<std::string>& s_out,
+                   const Function::AuxOut& aux,
+                   const Dict& opts) const override;
 
   /** \brief Get the number of atomic operations
 
@@ -214,6 +275,26 @@ class CASADI_EXPORT SXFunction :
     T d[2];
   };
 
+  /** \brief  Evaluate numerically, recording the partial derivatives of each operation
+
+      tape must have room for operations_.size() elements, w for worksize_ elements.
+  */
+  void eval_tape(const double** arg, double* w, TapeEl<double>* tape) const;
+
+  /** \brief  Forward directional derivatives by a sweep over a recorded tape
+
+      Null seeds are treated as zero, null sensitivities are not calculated.
+  */
+  void tape_forward(const double** fseed, double** fsens,
+                    const TapeEl<double>* tape, double* w) const;
+
+  /** \brief  Reverse directional derivatives by a sweep over a recorded tape
+
+      Null seeds are treated as zero, null sensitivities are not calculated.
+  */
+  void tape_reverse(const double** aseed, double** asens,
+                    const TapeEl<double>* tape, double* w) const;
+
   /** \brief  all binary nodes of the tree in the order of execution
 
       \identifier{uz} */
@@ -234,6 +315,9 @@ class CASADI_EXPORT SXFunction :
   /// Default input values
   std::vector<double> default_in_;
 
+  /// Compiled bytecode, used for numeric evaluation if bytecode_ is set
+  std::vector<ByteCodeEl> bytecode_alg_;
+
     /** \brief Serialize an object without type information
 
         \identifier{v0} */
@@ -260,6 +344,22 @@ class CASADI_EXPORT SXFunction :
       \identifier{v3} */
   void init(const Dict& opts) override;
 
+  /** \brief  Compile algorithm_ into bytecode_alg_
+  */
+  void init_bytecode();
+
+  /** \brief Algebraic peephole simplification of expressions
+
+      Folds constant operations, merges constants with the same bit pattern,
+      removes identity operations such as x*1 and -(-x) and replaces operations
+      by cheaper ones, e.g. pow(x,2) by sq(x) and x/4 by x*0.25. If exact is set,
+      only rewrites that give bitwise identical results for all arguments,
+      including infinities and signed zeros, are performed. */
+  static std::vector<SX> peephole(const std::vector<SX>& e, bool exact, Dict& stats);
+
+  /** \brief Get all statistics */
+  Dict get_stats(void* mem) const override;
+
   /** \brief Generate code for the declarations of the C function
 
       \identifier{v4} */
@@ -281,6 +381,9 @@ class CASADI_EXPORT SXFunction :
       \identifier{v7} */
   int sp_reverse(bvec_t** arg, bvec_t** res, casadi_int* iw, bvec_t* w, void* mem) const override;
 
+  /** \brief Seeds can be propagated concurrently, the algorithm calls no functions */
+  bool has_sp_threads() const override { return true;}
+
   /** *\brief get SX expression associated with instructions
 
        \identifier{v8} */
@@ -306,6 +409,15 @@ class CASADI_EXPORT SXFunction :
   /// Live variables?
   bool live_variables_;
 
+  /// Numeric evaluation using compiled bytecode?
+  bool bytecode_;
+
+  /// Numeric derivatives by sweeping the algorithm with a tape?
+  bool numeric_ad_;
+
+  /// Statistics of the peephole simplification, if performed
+  Dict peephole_stats_;
+
 protected:
   /** \brief Deserializing constructor
 
@@ -27,6 +27,8 @@
 
 #include "sx_function.hpp"
 #include <array>
+#include <cstring>
+#include <unordered_map>
 
 namespace casadi {
 
@@ -794,31 +796,6 @@ namespace casadi {
     return false;
   }
 
-  class IncrementalSerializer {
-    public:
-
-    IncrementalSerializer() : serializer(ss) {
-    }
-
-    std::string pack(const SXElem& a) {
-      serializer.pack(a);
-      // Serialization goes wrong if serialized SXNodes get destroyed
-      ref.push_back(a);
-      std::string ret = ss.str();
-      ss.str("");
-      ss.clear();
-      //uout() << a << ":" << ret << std::endl;
-      return ret;
-    }
-
-    private:
-      std::stringstream ss;
-      // List of references to keep alive
-      std::vector<SXElem> ref;
-      SerializingStream serializer;
-  };
-
-
   template<>
   std::vector<SX> CASADI_EXPORT SX::cse(const std::vector<SX>& e) {
 
@@ -837,17 +814,18 @@ namespace casadi {
     std::vector<SXElem> w(ff->worksize_);
 
     std::vector<const SXElem*> arg(f.sz_arg());
-    /*for (casadi_int i=0;i<args.size();++i) {
-      arg[i] = get_ptr(args.at(i).nonzeros());
-    }*/
 
     std::vector<SXElem*> res(f.sz_res());
     for (casadi_int i=0;i<e.size();++i) {
       res[i] = get_ptr(ret.at(i).nonzeros());
     }
 
-    std::unordered_map<std::string, SXElem > cache;
-    IncrementalSerializer s;
+    // Operations, by operation and dependency nodes, the latter being unique already
+    std::unordered_map<SXNodeKey, SXElem, SXNodeKeyHash> cache;
+    cache.reserve(ff->algorithm_.size());
+
+    // Constants, by bit pattern
+    std::unordered_map<uint64_t, SXElem> constants;
 
     // Iterator to stack of constants
     std::vector<SXElem>::const_iterator c_it = ff->constants_.begin();
@@ -860,18 +838,15 @@ namespace casadi {
       switch (a.op) {
       case OP_INPUT:
         w[a.i0] = arg[a.i1]==nullptr ? 0 : arg[a.i1][a.i2];
-        if (arg[a.i1]!=nullptr) cache[s.pack(w[a.i0])] = w[a.i0];
         break;
       case OP_OUTPUT:
         if (res[a.i0]!=nullptr) res[a.i0][a.i2] = w[a.i1];
         break;
       case OP_CONST:
         w[a.i0] = *c_it++;
-        cache[s.pack(w[a.i0])] = w[a.i0];
         break;
       case OP_PARAMETER:
         w[a.i0] = *p_it++;
-        cache[s.pack(w[a.i0])] = w[a.i0];
         break;
       default:
         {
@@ -884,13 +859,21 @@ namespace casadi {
             CASADI_MATH_FUN_BUILTIN(w[a.i1], w[a.i2], f)
           }
 
-          std::string key = s.pack(f);
-
-          auto itk = cache.find(key);
-          if (itk==cache.end()) {
-            cache[key] = f;
-          } else {
-            f = itk->second;
+          if (f.is_constant()) {
+            // Simplified to a constant
+            double v = static_cast<double>(f);
+            uint64_t bits;
+            std::memcpy(&bits, &v, sizeof(v));
+            auto itc = constants.insert(std::make_pair(bits, f));
+            if (!itc.second) f = itc.first->second;
+          } else if (f.n_dep()>0) {
+            SXNodeKey key = SXNodeKey::of(f.get());
+            // Same node up to the order of the arguments of a commutative operation
+            if (key.dep1!=nullptr && key.dep1<key.dep0 && operation_checker<CommChecker>(key.op)) {
+              std::swap(key.dep0, key.dep1);
+            }
+            auto itk = cache.insert(std::make_pair(key, f));
+            if (!itk.second) f = itk.first->second;
           }
 
           // Finally save the function value
@@ -911,16 +894,34 @@ namespace casadi {
     return h.get<SXFunction>()->jac(opts_remainder).at(0);
   }
 
+  // Hessian by edge-pushing, without forming the gradient
+  static SX hessian_edge_pushing(const SX &ex, const SX &arg, const Dict& opts) {
+    Dict h_opts;
+    extract_from_dict(opts, "helper_options", h_opts);
+    h_opts["allow_free"] = true;
+    Function h("hess_helper", {arg}, {ex}, h_opts);
+    return h.get<SXFunction>()->hess();
+  }
+
   template<>
   SX CASADI_EXPORT SX::hessian(const SX &ex, const SX &arg, SX &g, const Dict& opts) {
     Dict all_opts = opts;
-    if (!opts.count("symmetric")) all_opts["symmetric"] = true;
+    bool edge_pushing = false;
+    extract_from_dict_inplace(all_opts, "edge_pushing", edge_pushing);
     g = gradient(ex, arg);
+    if (edge_pushing) return hessian_edge_pushing(ex, arg, all_opts);
+    if (!opts.count("symmetric")) all_opts["symmetric"] = true;
     return jacobian(g, arg, all_opts);
   }
 
   template<>
   SX CASADI_EXPORT SX::hessian(const SX &ex, const SX &arg, const Dict& opts) {
+    auto it = opts.find("edge_pushing");
+    if (it != opts.end() && it->second.to_bool()) {
+      Dict all_opts = opts;
+      all_opts.erase("edge_pushing");
+      return hessian_edge_pushing(ex, arg, all_opts);
+    }
     SX g;
     return hessian(ex, arg, g, opts);
   }
@@ -1169,6 +1170,8 @@ namespace casadi {
     }
     // Consistency check
     casadi_assert(vdef.size() < std::numeric_limits<int>::max(), "Integer overflow");
+    // The temporaries of the nodes may be shared between threads
+    SXTempLock temp_lock;
     // Mark the above expressions
     for (casadi_int i=0; i<vdef.size(); ++i) {
       vdef[i].set_temp(static_cast<int>(i)+1);
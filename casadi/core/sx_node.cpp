@@ -32,6 +32,16 @@
 
 #include <limits>
 #include <stack>
+#include <unordered_map>
+
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+#ifdef CASADI_WITH_THREAD_MINGW
+#include <mingw.mutex.h>
+#else // CASADI_WITH_THREAD_MINGW
+#include <mutex>
+#endif // CASADI_WITH_THREAD_MINGW
+#include <atomic>
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
 
 namespace casadi {
 
@@ -154,7 +164,7 @@ namespace casadi {
 
   void SXNode::safe_delete(SXNode* n) {
     // Quick return if more owners
-    if (n->count>0) return;
+    if (n==nullptr || n->count>0) return;
     // Delete straight away if it doesn't have any dependencies
     if (!n->n_dep()) {
       delete n;
@@ -168,14 +178,16 @@ namespace casadi {
     while (!deletion_stack.empty()) {
       // Top element
       SXNode *t = deletion_stack.top();
+      // Unregister while the dependencies are still in place
+      SXHashCons::erase(t);
       // Check if the top element has dependencies with dependencies
       bool added_to_stack = false;
       for (casadi_int c2=0; c2<t->n_dep(); ++c2) { // for all dependencies of the dependency
         // Get the node of the dependency of the top element
         // and remove it from the smart pointer
         SXNode *n2 = t->dep(c2).assignNoDelete(casadi_limits<SXElem>::nan);
-        // Check if this is the only reference to the element
-        if (n2->count == 0) {
+        // Check if this was the only reference to the element
+        if (n2) {
           // Check if unary or binary
           if (!n2->n_dep()) {
             // Delete straight away if not binary
@@ -197,6 +209,73 @@ namespace casadi {
 
   casadi_int SXNode::eq_depth_ = 1;
 
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+  // Allocated once and never freed, like the nodes it protects
+  static std::recursive_mutex& sx_temp_mutex() {
+    static std::recursive_mutex* m = new std::recursive_mutex();
+    return *m;
+  }
+
+  SXTempLock::SXTempLock() {
+    sx_temp_mutex().lock();
+  }
+
+  SXTempLock::~SXTempLock() {
+    sx_temp_mutex().unlock();
+  }
+#else // CASADI_WITH_THREADSAFE_SYMBOLICS
+  SXTempLock::SXTempLock() {}
+
+  SXTempLock::~SXTempLock() {}
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+
+  typedef std::unordered_map<SXNodeKey, SXNode*, SXNodeKeyHash> SXHashConsTable;
+
+  // Allocated once and never freed, since nodes may outlive static objects
+  static SXHashConsTable& hash_cons_table() {
+    static SXHashConsTable* t = new SXHashConsTable();
+    return *t;
+  }
+
+  // Whether any node has been registered, to skip lookups on destruction otherwise
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+  static std::atomic<bool> hash_cons_used(false);
+
+  static std::mutex& hash_cons_mutex() {
+    static std::mutex* m = new std::mutex();
+    return *m;
+  }
+#define CASADI_HASH_CONS_LOCK std::lock_guard<std::mutex> lock(hash_cons_mutex());
+#else // CASADI_WITH_THREADSAFE_SYMBOLICS
+  static bool hash_cons_used = false;
+#define CASADI_HASH_CONS_LOCK
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+
+  SXNode* SXHashCons::find(const SXNodeKey& key) {
+    CASADI_HASH_CONS_LOCK
+    SXHashConsTable& t = hash_cons_table();
+    auto it = t.find(key);
+    // Nodes with a zero count are being destroyed and may not be revived
+    if (it!=t.end() && it->second->try_count_up()) return it->second;
+    return nullptr;
+  }
+
+  void SXHashCons::insert(SXNode* n) {
+    CASADI_HASH_CONS_LOCK
+    hash_cons_used = true;
+    hash_cons_table()[SXNodeKey::of(n)] = n;
+  }
+
+  void SXHashCons::erase(const SXNode* n) {
+    if (!hash_cons_used) return;
+    CASADI_HASH_CONS_LOCK
+    SXHashConsTable& t = hash_cons_table();
+    auto it = t.find(SXNodeKey::of(n));
+    if (it!=t.end() && it->second==n) t.erase(it);
+  }
+
+#undef CASADI_HASH_CONS_LOCK
+
   void SXNode::serialize_node(SerializingStream& s) const {
     casadi_error("'serialize_node' not defined for class " + class_name());
   }
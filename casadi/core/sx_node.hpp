@@ -26,11 +26,16 @@
 #ifndef CASADI_SX_NODE_HPP
 #define CASADI_SX_NODE_HPP
 
+#include <functional>
 #include <iostream>
 #include <math.h>
 #include <sstream>
 #include <string>
 
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+#include <atomic>
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+
 /** \brief  Scalar expression (which also works as a smart pointer class to this class)
 
     \identifier{9s} */
@@ -161,13 +166,36 @@ namespace casadi {
     static casadi_int eq_depth_;
 
     /** Temporary variables to be used in user algorithms like sorting,
-        the user is responsible of making sure that use is thread-safe
-        The variable is initialized to zero
+        the user is responsible of making sure that use is thread-safe,
+        e.g. using SXTempLock. The variable is initialized to zero
     */
     mutable int temp;
 
     // Reference counter -- counts the number of parents of the node
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+    std::atomic<unsigned int> count;
+#else // CASADI_WITH_THREADSAFE_SYMBOLICS
     unsigned int count;
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+
+    /** \brief Increase the reference counter, unless it has reached zero
+
+        A node with a zero count is being destroyed or about to be destroyed
+        and may not be revived, e.g. when found in a cache.
+    */
+    bool try_count_up() {
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+      unsigned int c = count.load();
+      do {
+        if (c==0) return false;
+      } while (!count.compare_exchange_weak(c, c+1));
+      return true;
+#else // CASADI_WITH_THREADSAFE_SYMBOLICS
+      if (count==0) return false;
+      count++;
+      return true;
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
+    }
 
     /** \brief Serialize an object
 
@@ -183,6 +211,73 @@ namespace casadi {
 
   };
 
+  /** \brief Scoped lock for algorithms using the temporaries of SX nodes
+
+      Nodes, in particular constants, may be shared between expression graphs
+      used by different threads. With CASADI_WITH_THREADSAFE_SYMBOLICS, this is a
+      global recursive lock, otherwise it is a no-op.
+  */
+  class CASADI_EXPORT SXTempLock {
+  public:
+    SXTempLock();
+    ~SXTempLock();
+  private:
+    // Not copyable
+    SXTempLock(const SXTempLock&);
+    SXTempLock& operator=(const SXTempLock&);
+  };
+
+  /** \brief Structure of an operation node: operation and dependency nodes */
+  struct SXNodeKey {
+    casadi_int op;
+    const SXNode* dep0;
+    const SXNode* dep1;
+
+    /// Key of an existing node
+    static SXNodeKey of(const SXNode* n) {
+      casadi_int ndep = n->n_dep();
+      return {n->op(), ndep>0 ? n->dep(0).get() : nullptr, ndep>1 ? n->dep(1).get() : nullptr};
+    }
+
+    bool operator==(const SXNodeKey& k) const {
+      return op==k.op && dep0==k.dep0 && dep1==k.dep1;
+    }
+  };
+
+  /** \brief Hash function for SXNodeKey */
+  struct SXNodeKeyHash {
+    std::size_t operator()(const SXNodeKey& k) const {
+      std::size_t seed = std::hash<casadi_int>()(k.op);
+      seed ^= std::hash<const void*>()(k.dep0) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      seed ^= std::hash<const void*>()(k.dep1) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      return seed;
+    }
+  };
+
+  /** \brief Global hash-consing table of unary and binary operation nodes
+
+      Used when creating nodes with GlobalOptions::hash_consing enabled. The table
+      does not own the nodes, which remove themselves before being destroyed.
+  */
+  class CASADI_EXPORT SXHashCons {
+  public:
+    /** \brief Live node with a given structure
+
+        \return The node with its reference counter increased, or null if none
+    */
+    static SXNode* find(const SXNodeKey& key);
+
+    /// Register a node, replacing any previous node with the same structure
+    static void insert(SXNode* n);
+
+    /// Remove a node that is about to be destroyed, if registered
+    static void erase(const SXNode* n);
+
+  private:
+    /// No instances are allowed
+    SXHashCons();
+  };
+
 } // namespace casadi
 /// \endcond
 #endif // CASADI_SX_NODE_HPP
@@ -0,0 +1,273 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "tape_ad.hpp"
+
+namespace casadi {
+
+  TapeAD::TapeAD(const std::string& name, const Function& f, TapeMode mode, casadi_int n)
+    : FunctionInternal(name), f_(f), mode_(mode), n_(n) {
+  }
+
+  Function TapeAD::create(const std::string& name, const Function& f, TapeMode mode,
+      casadi_int n, const std::vector<std::string>& inames,
+      const std::vector<std::string>& onames, const Dict& opts) {
+    Function ret;
+    ret.own(new TapeAD(name, f, mode, n));
+    ret->name_in_ = inames;
+    ret->name_out_ = onames;
+    // Drop options that only apply to the function being differentiated
+    Dict ret_opts;
+    for (auto&& op : opts) {
+      if (ret->get_options().find(op.first)) ret_opts[op.first] = op.second;
+    }
+    ret->construct(ret_opts);
+    return ret;
+  }
+
+  TapeAD::~TapeAD() {
+    clear_mem();
+  }
+
+  bool TapeAD::is_a(const std::string& type, bool recursive) const {
+    return type=="TapeAD"
+      || (recursive && FunctionInternal::is_a(type, recursive));
+  }
+
+  const Function& TapeAD::get_function(const std::string &name) const {
+    casadi_assert(has_function(name),
+      "No function \"" + name + "\" in " + name_ + ". " +
+      "Available functions: " + join(get_function()) + ".");
+    return f_;
+  }
+
+  size_t TapeAD::get_n_in() {
+    switch (mode_) {
+    case TapeMode::FORWARD: return f_.n_in() + f_.n_out() + f_.n_in();
+    case TapeMode::REVERSE: return f_.n_in() + f_.n_out() + f_.n_out();
+    default: return f_.n_in() + f_.n_out();
+    }
+  }
+
+  size_t TapeAD::get_n_out() {
+    switch (mode_) {
+    case TapeMode::FORWARD: return f_.n_out();
+    case TapeMode::REVERSE: return f_.n_in();
+    default: return f_.n_out() * f_.n_in();
+    }
+  }
+
+  Sparsity TapeAD::get_sparsity_in(casadi_int i) {
+    casadi_int n_in = f_.n_in(), n_out = f_.n_out();
+    if (i<n_in) {
+      // Non-differentiated input
+      return f_.sparsity_in(i);
+    } else if (i<n_in+n_out) {
+      // Non-differentiated output, not used
+      return Sparsity(f_.size_out(i-n_in));
+    } else if (mode_==TapeMode::FORWARD) {
+      // Forward seeds
+      return repmat(f_.sparsity_in(i-n_in-n_out), 1, n_);
+    } else {
+      // Adjoint seeds
+      return repmat(f_.sparsity_out(i-n_in-n_out), 1, n_);
+    }
+  }
+
+  Sparsity TapeAD::get_sparsity_out(casadi_int i) {
+    switch (mode_) {
+    case TapeMode::FORWARD: return repmat(f_.sparsity_out(i), 1, n_);
+    case TapeMode::REVERSE: return repmat(f_.sparsity_in(i), 1, n_);
+    default: break;
+    }
+    // Jacobian block
+    casadi_int oind = i / f_.n_in(), iind = i % f_.n_in();
+    if (!f_.is_diff_out(oind) || !f_.is_diff_in(iind)) {
+      return Sparsity(f_.numel_out(oind), f_.numel_in(iind));
+    }
+    return f_.jac_sparsity(oind, iind);
+  }
+
+  double TapeAD::get_default_in(casadi_int ind) const {
+    if (ind<f_.n_in()) {
+      return f_.default_in(ind);
+    } else {
+      return 0;
+    }
+  }
+
+  void TapeAD::init(const Dict& opts) {
+    casadi_assert(f_.is_a("SXFunction"), "Tape-based derivatives require an SXFunction");
+    const SXFunction& f = *f_.get<SXFunction>();
+    casadi_assert(!f.has_free(), "Cannot create \"" + name_ + "\" since variables "
+      + str(f.get_free()) + " are free.");
+
+    // Call the initialization method of the base class
+    FunctionInternal::init(opts);
+
+    // Column coloring of the compact Jacobian
+    if (mode_==TapeMode::JACOBIAN) {
+      jac_sp_.resize(n_out_);
+      std::vector<std::vector<Sparsity> > blocks(f.n_out_, std::vector<Sparsity>(f.n_in_));
+      for (casadi_int oind=0; oind<f.n_out_; ++oind) {
+        for (casadi_int iind=0; iind<f.n_in_; ++iind) {
+          Sparsity& sp = blocks[oind][iind];
+          if (f.is_diff_out_[oind] && f.is_diff_in_[iind]) {
+            sp = f_.jac_sparsity(oind, iind, true);
+          } else {
+            sp = Sparsity(f.nnz_out(oind), f.nnz_in(iind));
+          }
+          jac_sp_[oind*f.n_in_ + iind] = sp;
+        }
+      }
+      Sparsity J = Sparsity::blockcat(blocks);
+      coloring_ = J.uni_coloring(J.T());
+      if (verbose_) {
+        casadi_message(name_ + ": " + str(coloring_.size2()) + " forward sweeps for "
+          + str(J.size2()) + " input nonzeros");
+      }
+    }
+
+    // Seed and sensitivity pointers for one direction
+    alloc_arg(f.n_in_ + f.n_out_, true);
+    alloc_res(f.n_in_ + f.n_out_, true);
+
+    // Tape and work vector
+    alloc_w(2*f.operations_.size() + f.worksize_, true);
+
+    // Compressed Jacobian seeds and sensitivities
+    if (mode_==TapeMode::JACOBIAN) alloc_w(f.nnz_in() + f.nnz_out(), true);
+  }
+
+  int TapeAD::eval(const double** arg, double** res, casadi_int* iw, double* w,
+      void* mem) const {
+    const SXFunction& f = *f_.get<SXFunction>();
+    casadi_int n_in = f.n_in_, n_out = f.n_out_;
+
+    // Seeds and sensitivities for one direction
+    const double** seed = arg + n_in_;
+    double** sens = res + n_out_;
+
+    // Record the tape
+    SXFunction::TapeEl<double>* tape = reinterpret_cast<SXFunction::TapeEl<double>*>(w);
+    w += 2*f.operations_.size();
+    f.eval_tape(arg, w, tape);
+    double* fw = w;
+    w += f.worksize_;
+
+    if (mode_==TapeMode::FORWARD) {
+      for (casadi_int d=0; d<n_; ++d) {
+        for (casadi_int i=0; i<n_in; ++i) {
+          const double* s = arg[n_in + n_out + i];
+          seed[i] = s && f.is_diff_in_[i] ? s + d*f.nnz_in(i) : nullptr;
+        }
+        for (casadi_int i=0; i<n_out; ++i) {
+          sens[i] = res[i] ? res[i] + d*f.nnz_out(i) : nullptr;
+        }
+        f.tape_forward(seed, sens, tape, fw);
+      }
+      // Non-differentiable outputs
+      for (casadi_int i=0; i<n_out; ++i) {
+        if (res[i] && !f.is_diff_out_[i]) casadi_clear(res[i], n_*f.nnz_out(i));
+      }
+    } else if (mode_==TapeMode::REVERSE) {
+      for (casadi_int d=0; d<n_; ++d) {
+        for (casadi_int i=0; i<n_out; ++i) {
+          const double* s = arg[n_in + n_out + i];
+          seed[i] = s && f.is_diff_out_[i] ? s + d*f.nnz_out(i) : nullptr;
+        }
+        for (casadi_int i=0; i<n_in; ++i) {
+          sens[i] = res[i] ? res[i] + d*f.nnz_in(i) : nullptr;
+        }
+        f.tape_reverse(seed, sens, tape, fw);
+      }
+      // Non-differentiable inputs
+      for (casadi_int i=0; i<n_in; ++i) {
+        if (res[i] && !f.is_diff_in_[i]) casadi_clear(res[i], n_*f.nnz_in(i));
+      }
+    } else {
+      // Compressed seeds and sensitivities
+      double* cseed = w;
+      w += f.nnz_in();
+      double* csens = w;
+      w += f.nnz_out();
+      // Input nonzero offsets
+      std::vector<casadi_int> offset(n_in + 1, 0);
+      for (casadi_int i=0; i<n_in; ++i) offset[i+1] = offset[i] + f.nnz_in(i);
+      // Non-differentiable inputs are not seeded, their columns share colors
+      for (casadi_int i=0; i<n_in; ++i) {
+        seed[i] = f.is_diff_in_[i] ? cseed + offset[i] : nullptr;
+      }
+      for (casadi_int i=0; i<n_out; ++i) {
+        sens[i] = csens;
+        csens += f.nnz_out(i);
+      }
+      // Forward sweep for each color
+      const casadi_int *c_colind = coloring_.colind(), *c_row = coloring_.row();
+      casadi_clear(cseed, f.nnz_in());
+      for (casadi_int c=0; c<coloring_.size2(); ++c) {
+        for (casadi_int k=c_colind[c]; k<c_colind[c+1]; ++k) cseed[c_row[k]] = 1;
+        f.tape_forward(seed, sens, tape, fw);
+        // Scatter to the Jacobian blocks
+        for (casadi_int k=c_colind[c]; k<c_colind[c+1]; ++k) {
+          casadi_int j = c_row[k];
+          cseed[j] = 0;
+          casadi_int iind = std::upper_bound(offset.begin(), offset.end(), j)
+            - offset.begin() - 1;
+          j -= offset[iind];
+          for (casadi_int oind=0; oind<n_out; ++oind) {
+            double* r = res[oind*n_in + iind];
+            if (!r) continue;
+            const Sparsity& sp = jac_sp_[oind*n_in + iind];
+            const casadi_int *colind = sp.colind(), *row = sp.row();
+            for (casadi_int el=colind[j]; el<colind[j+1]; ++el) r[el] = sens[oind][row[el]];
+          }
+        }
+      }
+    }
+    return 0;
+  }
+
+  void TapeAD::serialize_body(SerializingStream &s) const {
+    FunctionInternal::serialize_body(s);
+    s.version("TapeAD", 1);
+    s.pack("TapeAD::f", f_);
+    s.pack("TapeAD::mode", static_cast<casadi_int>(mode_));
+    s.pack("TapeAD::n", n_);
+    s.pack("TapeAD::jac_sp", jac_sp_);
+    s.pack("TapeAD::coloring", coloring_);
+  }
+
+  TapeAD::TapeAD(DeserializingStream& s) : FunctionInternal(s) {
+    s.version("TapeAD", 1);
+    s.unpack("TapeAD::f", f_);
+    casadi_int mode;
+    s.unpack("TapeAD::mode", mode);
+    mode_ = static_cast<TapeMode>(mode);
+    s.unpack("TapeAD::n", n_);
+    s.unpack("TapeAD::jac_sp", jac_sp_);
+    s.unpack("TapeAD::coloring", coloring_);
+  }
+
+} // namespace casadi
@@ -0,0 +1,134 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef CASADI_TAPE_AD_HPP
+#define CASADI_TAPE_AD_HPP
+
+#include "sx_function.hpp"
+
+/// \cond INTERNAL
+
+namespace casadi {
+
+  /// Kind of derivative calculated by TapeAD
+  enum class TapeMode {FORWARD, REVERSE, JACOBIAN};
+
+  /** \brief Derivatives of an SXFunction by numeric sweeps over its algorithm
+
+      At each call, the algorithm of the SXFunction is evaluated once while
+      recording the partial derivatives of every operation on a tape. Forward
+      or reverse directional derivatives are then obtained by sweeping the tape,
+      the Jacobian by forward sweeps with seeds compressed by a column coloring.
+      No expressions are constructed, the setup cost is that of the sparsity
+      pattern only (Jacobian) or nothing at all (directional derivatives).
+  */
+  class CASADI_EXPORT TapeAD : public FunctionInternal {
+  public:
+    /** \brief Constructor
+
+        n is the number of directional derivatives, unused for the Jacobian.
+    */
+    TapeAD(const std::string& name, const Function& f, TapeMode mode, casadi_int n);
+
+    /** \brief Create, keeping the options that apply to a FunctionInternal */
+    static Function create(const std::string& name, const Function& f, TapeMode mode,
+      casadi_int n, const std::vector<std::string>& inames,
+      const std::vector<std::string>& onames, const Dict& opts);
+
+    /** \brief Destructor */
+    ~TapeAD() override;
+
+    /** \brief Get type name */
+    std::string class_name() const override {return "TapeAD";}
+
+    /** \brief Check if the function is of a particular type */
+    bool is_a(const std::string& type, bool recursive) const override;
+
+    // Get list of dependency functions
+    std::vector<std::string> get_function() const override { return {"f"};}
+
+    // Get a dependency function
+    const Function& get_function(const std::string &name) const override;
+
+    // Check if a particular dependency exists
+    bool has_function(const std::string& fname) const override { return fname=="f";}
+
+    /// @{
+    /** \brief Sparsities of function inputs and outputs */
+    Sparsity get_sparsity_in(casadi_int i) override;
+    Sparsity get_sparsity_out(casadi_int i) override;
+    /// @}
+
+    /** \brief Get default input value */
+    double get_default_in(casadi_int ind) const override;
+
+    ///@{
+    /** \brief Number of function inputs and outputs */
+    size_t get_n_in() override;
+    size_t get_n_out() override;
+    ///@}
+
+    /** \brief  Initialize */
+    void init(const Dict& opts) override;
+
+    /// Evaluate numerically
+    int eval(const double** arg, double** res, casadi_int* iw, double* w, void* mem) const override;
+
+    /** Obtain information about node */
+    Dict info() const override { return {{"f", f_}}; }
+
+    /** \brief Serialize an object without type information */
+    void serialize_body(SerializingStream &s) const override;
+
+    /** \brief String used to identify the immediate FunctionInternal subclass */
+    std::string serialize_base_function() const override { return "TapeAD"; }
+
+    /** \brief Deserialize without type information */
+    static ProtoFunction* deserialize(DeserializingStream& s) { return new TapeAD(s); }
+
+  protected:
+    /** \brief Deserializing constructor */
+    explicit TapeAD(DeserializingStream& s);
+
+    // Function being differentiated
+    Function f_;
+
+    // Kind of derivative
+    TapeMode mode_;
+
+    // Number of directional derivatives
+    casadi_int n_;
+
+    // Jacobian: compact block sparsity patterns, row major
+    std::vector<Sparsity> jac_sp_;
+
+    // Jacobian: input nonzeros seeded in each forward sweep
+    Sparsity coloring_;
+  };
+
+} // namespace casadi
+
+/// \endcond
+
+#endif // CASADI_TAPE_AD_HPP
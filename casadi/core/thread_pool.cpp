@@ -0,0 +1,201 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#include "thread_pool.hpp"
+#include "global_options.hpp"
+
+#include <exception>
+#include <vector>
+
+#ifdef CASADI_WITH_THREAD
+#include <atomic>
+#include <deque>
+#include <memory>
+#ifdef CASADI_WITH_THREAD_MINGW
+#include <mingw.thread.h>
+#include <mingw.mutex.h>
+#include <mingw.condition_variable.h>
+#else // CASADI_WITH_THREAD_MINGW
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif // CASADI_WITH_THREAD_MINGW
+#endif // CASADI_WITH_THREAD
+
+namespace casadi {
+
+#ifdef CASADI_WITH_THREAD
+  namespace {
+
+    // A parallel loop submitted to the pool
+    struct ThreadPoolJob {
+      // Task to be evaluated for each chunk
+      const std::function<void(casadi_int, casadi_int)>* task;
+      // Number of participating threads
+      casadi_int n_thread;
+      // Next chunk and end of the range of chunks, for each participating thread
+      std::unique_ptr<std::atomic<casadi_int>[]> next;
+      std::vector<casadi_int> end;
+      // Number of threads that have joined
+      casadi_int n_joined;
+      // Number of chunks that have not been completed
+      std::atomic<casadi_int> n_left;
+      // First exception raised by a task
+      std::exception_ptr error;
+      // Signal completion to the calling thread
+      std::mutex mtx;
+      std::condition_variable cv;
+
+      ThreadPoolJob(casadi_int n_chunk, casadi_int n_thread,
+          const std::function<void(casadi_int, casadi_int)>& task)
+          : task(&task), n_thread(n_thread), next(new std::atomic<casadi_int>[n_thread]),
+          end(n_thread), n_joined(1), n_left(n_chunk) {
+        for (casadi_int t=0; t<n_thread; ++t) {
+          next[t] = (t*n_chunk)/n_thread;
+          end[t] = ((t+1)*n_chunk)/n_thread;
+        }
+      }
+
+      // Process the own range of chunks, then steal from the other threads
+      void participate(casadi_int thread) {
+        for (casadi_int k=0; k<n_thread; ++k) {
+          casadi_int t = (thread + k) % n_thread;
+          for (;;) {
+            casadi_int chunk = next[t]++;
+            if (chunk>=end[t]) break;
+            try {
+              (*task)(chunk, thread);
+            } catch (...) {
+              std::lock_guard<std::mutex> lock(mtx);
+              if (!error) error = std::current_exception();
+            }
+            if (--n_left==0) {
+              std::lock_guard<std::mutex> lock(mtx);
+              cv.notify_all();
+            }
+          }
+        }
+      }
+    };
+
+    class ThreadPoolInternal {
+    public:
+      // Submit a job and participate until all chunks have been processed
+      void run(const std::shared_ptr<ThreadPoolJob>& job) {
+        {
+          std::lock_guard<std::mutex> lock(mtx_);
+          // Start additional worker threads, if needed
+          for (; n_workers_ + 1 < job->n_thread; ++n_workers_) {
+            // Never joined, cf. thread_pool()
+            std::thread([this]() { work(); }).detach();
+          }
+          jobs_.push_back(job);
+        }
+        cv_.notify_all();
+
+        // The calling thread is thread 0
+        job->participate(0);
+
+        // No more chunks to be picked up
+        {
+          std::lock_guard<std::mutex> lock(mtx_);
+          for (auto it=jobs_.begin(); it!=jobs_.end(); ++it) {
+            if (*it==job) {
+              jobs_.erase(it);
+              break;
+            }
+          }
+        }
+
+        // Wait for chunks still being processed by other threads
+        std::unique_lock<std::mutex> lock(job->mtx);
+        job->cv.wait(lock, [&job]() { return job->n_left==0;});
+        if (job->error) std::rethrow_exception(job->error);
+      }
+
+    private:
+      // Worker thread main loop
+      void work() {
+        for (;;) {
+          std::shared_ptr<ThreadPoolJob> job;
+          casadi_int thread;
+          {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this]() { return !jobs_.empty();});
+            job = jobs_.front();
+            thread = job->n_joined++;
+            // Remove job from queue once all threads have joined
+            if (job->n_joined>=job->n_thread) jobs_.pop_front();
+          }
+          job->participate(thread);
+        }
+      }
+
+      // Jobs that can be joined
+      std::deque<std::shared_ptr<ThreadPoolJob> > jobs_;
+      // Number of worker threads
+      casadi_int n_workers_ = 0;
+      // Protects jobs_ and n_workers_
+      std::mutex mtx_;
+      // Signals new jobs
+      std::condition_variable cv_;
+    };
+
+    ThreadPoolInternal& thread_pool() {
+      // Intentionally never destroyed: worker threads are blocked waiting for work
+      // when the process exits
+      static ThreadPoolInternal* pool = new ThreadPoolInternal();
+      return *pool;
+    }
+
+  } // namespace
+#endif // CASADI_WITH_THREAD
+
+  casadi_int ThreadPool::max_num_threads() {
+    if (GlobalOptions::max_num_threads>0) return GlobalOptions::max_num_threads;
+#ifdef CASADI_WITH_THREAD
+    casadi_int n = std::thread::hardware_concurrency();
+    return n>0 ? n : 1;
+#else // CASADI_WITH_THREAD
+    return 1;
+#endif // CASADI_WITH_THREAD
+  }
+
+  void ThreadPool::run(casadi_int n_chunk, casadi_int n_thread,
+      const std::function<void(casadi_int, casadi_int)>& task) {
+    // Number of participating threads
+    n_thread = std::min(std::min(n_thread, n_chunk), max_num_threads());
+#ifdef CASADI_WITH_THREAD
+    if (n_thread>1) {
+      thread_pool().run(std::make_shared<ThreadPoolJob>(n_chunk, n_thread, task));
+      return;
+    }
+#endif // CASADI_WITH_THREAD
+    // Serial evaluation
+    for (casadi_int chunk=0; chunk<n_chunk; ++chunk) task(chunk, 0);
+  }
+
+} // namespace casadi
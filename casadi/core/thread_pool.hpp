@@ -0,0 +1,74 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#ifndef CASADI_THREAD_POOL_HPP
+#define CASADI_THREAD_POOL_HPP
+
+#include "casadi_common.hpp"
+#include <functional>
+
+/// \cond INTERNAL
+namespace casadi {
+
+  /** \brief Process-wide pool of persistent worker threads
+
+      A parallel loop is split into chunks, which are distributed in contiguous ranges
+      over the participating threads, the calling thread being one of them. A thread
+      that has finished its own range steals chunks from the ranges of the others.
+      Worker threads are started on demand, at most max_num_threads()-1 of them, and
+      are kept alive for the lifetime of the process.
+
+      Without CASADI_WITH_THREAD, all chunks are processed by the calling thread.
+  */
+  class CASADI_EXPORT ThreadPool {
+  public:
+    /** \brief Evaluate task(chunk, thread) for chunk = 0, ..., n_chunk-1
+
+        At most n_thread threads participate. The thread index, 0 for the calling
+        thread and less than n_thread for all participants, is unique within the
+        loop and can be used to select thread-local work memory.
+        An exception thrown by a task is rethrown in the calling thread once
+        all chunks have been processed.
+    */
+    static void run(casadi_int n_chunk, casadi_int n_thread,
+                    const std::function<void(casadi_int, casadi_int)>& task);
+
+    /** \brief Maximum number of threads participating in a loop
+
+        Given by GlobalOptions::max_num_threads, if set, or else the
+        number of concurrent threads supported by the hardware.
+    */
+    static casadi_int max_num_threads();
+
+  private:
+    /// No instances are allowed
+    ThreadPool();
+  };
+
+} // namespace casadi
+/// \endcond
+
+#endif // CASADI_THREAD_POOL_HPP
@@ -28,6 +28,7 @@
 
 #include "sx_node.hpp"
 #include "serializing_stream.hpp"
+#include "global_options.hpp"
 
 /// \cond INTERNAL
 
@@ -59,6 +60,17 @@ class UnarySX : public SXNode {
         double ret_val;
         casadi_math<double>::fun(op, dep_val, dep_val, ret_val);
         return ret_val;
+      } else if (GlobalOptions::hash_consing) {
+        // Reuse a structurally identical node, if any
+        SXNode* n = SXHashCons::find({op, dep.get(), nullptr});
+        if (n) {
+          SXElem ret = SXElem::create(n);
+          n->count--;
+          return ret;
+        }
+        n = new UnarySX(op, dep);
+        SXHashCons::insert(n);
+        return SXElem::create(n);
       } else {
         // Expression containing free variables
         return SXElem::create(new UnarySX(op, dep));
@@ -69,6 +81,7 @@ class UnarySX : public SXNode {
 
         \identifier{dw} */
     ~UnarySX() override {
+      SXHashCons::erase(this);
       safe_delete(dep_.assignNoDelete(casadi_limits<SXElem>::nan));
     }
 
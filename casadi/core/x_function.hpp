@@ -30,6 +30,8 @@
 #include "function_internal.hpp"
 #include "factory.hpp"
 #include "serializing_stream.hpp"
+#include "thread_pool.hpp"
+#include "sx_node.hpp"
 
 // To reuse variables we need to be able to sort by sparsity pattern
 #include <unordered_map>
@@ -334,14 +336,18 @@ namespace casadi {
     }
     // Check for duplicate entries among the input expressions
     bool has_duplicates = false;
-    for (auto&& i : in_) {
-      if (i.has_duplicates()) {
-        has_duplicates = true;
-        break;
+    {
+      // The check marks the nodes, which may be shared between threads
+      SXTempLock temp_lock;
+      for (auto&& i : in_) {
+        if (i.has_duplicates()) {
+          has_duplicates = true;
+          break;
+        }
       }
+      // Reset temporaries
+      for (auto&& i : in_) i.reset_input();
     }
-    // Reset temporaries
-    for (auto&& i : in_) i.reset_input();
     // Generate error
     if (has_duplicates) {
       std::stringstream s;
@@ -482,15 +488,6 @@ namespace casadi {
       casadi_int max_nfdir = max_num_dir_;
       casadi_int max_nadir = max_num_dir_;
 
-      // Current forward and adjoint direction
-      casadi_int offset_nfdir = 0, offset_nadir = 0;
-
-      // Evaluation result (known)
-      std::vector<MatType> res(out_);
-
-      // Forward and adjoint seeds and sensitivities
-      std::vector<std::vector<MatType> > fseed, aseed, fsens, asens;
-
       // Get the sparsity of the Jacobian block
       Sparsity jsp = jac_sparsity(0, 0, true, symmetric).T();
       const casadi_int* jsp_colind = jsp.colind();
@@ -512,15 +509,6 @@ namespace casadi {
         jsp_trans = jsp.transpose(mapping);
       }
 
-      // The nonzeros of the sensitivity matrix
-      std::vector<casadi_int> nzmap, nzmap2;
-
-      // Additions to the jacobian matrix
-      std::vector<casadi_int> adds, adds2;
-
-      // Temporary vector
-      std::vector<casadi_int> tmp;
-
       // Progress
       casadi_int progress = -10;
 
@@ -530,25 +518,43 @@ namespace casadi {
       casadi_int nsweep_adj = nadir/max_nadir;   // Number of sweeps needed for the adjoint mode
       if (nadir%max_nadir>0) nsweep_adj++;
       casadi_int nsweep = std::max(nsweep_fwd, nsweep_adj);
+
+      // Number of threads, expressions can only be constructed concurrently for SX
+#ifdef CASADI_WITH_THREADSAFE_SYMBOLICS
+      casadi_int n_thread = 1;
+      if (std::is_same<MatType, SX>::value) n_thread = num_threads(jac_threads_, nsweep);
+#else // CASADI_WITH_THREADSAFE_SYMBOLICS
+      casadi_int n_thread = 1;
+#endif // CASADI_WITH_THREADSAFE_SYMBOLICS
       if (verbose_) {
         casadi_message(str(nsweep) + " sweeps needed for " + str(nfdir) + " forward and "
-                       + str(nadir) + " reverse directions");
+                       + str(nadir) + " reverse directions"
+                       + (n_thread>1 ? " (" + str(n_thread) + " threads)" : ""));
       }
 
-      // Sparsity of the seeds
-      std::vector<casadi_int> seed_col, seed_row;
+      // Assignments to the nonzeros of the Jacobian
+      typedef std::vector<std::pair<std::vector<casadi_int>, MatType> > JacAdds;
 
-      // Evaluate until everything has been determined
-      for (casadi_int s=0; s<nsweep; ++s) {
-        // Print progress
-        if (verbose_) {
-          casadi_int progress_new = (s*100)/nsweep;
-          // Print when entering a new decade
-          if (progress_new / 10 > progress / 10) {
-            progress = progress_new;
-            casadi_message(str(progress) + " %");
-          }
-        }
+      // Differentiate the directions of sweep s, independently of the other sweeps
+      auto sweep = [&](casadi_int s, JacAdds& jadds) {
+        // First forward and adjoint direction of the sweep
+        casadi_int offset_nfdir = std::min(s*max_nfdir, nfdir);
+        casadi_int offset_nadir = std::min(s*max_nadir, nadir);
+
+        // Forward and adjoint seeds and sensitivities
+        std::vector<std::vector<MatType> > fseed, aseed, fsens, asens;
+
+        // The nonzeros of the sensitivity matrix
+        std::vector<casadi_int> nzmap, nzmap2;
+
+        // Additions to the jacobian matrix
+        std::vector<casadi_int> adds, adds2;
+
+        // Temporary vector
+        std::vector<casadi_int> tmp;
+
+        // Sparsity of the seeds
+        std::vector<casadi_int> seed_col, seed_row;
 
         // Number of forward and adjoint directions in the current "batch"
         casadi_int nfdir_batch = std::min(nfdir - offset_nfdir, max_nfdir);
@@ -738,7 +744,8 @@ namespace casadi {
           tmp.resize(sz);
 
           // Add contribution to the Jacobian
-          ret.at(0).nz(adds) = fsens[d][oind].nz(tmp);
+          const MatType& fs = fsens[d][oind];
+          jadds.push_back(std::make_pair(adds, fs.nz(tmp)));
 
           if (symmetric) {
             // Get entries in fsens[d][oind] with nonnegative indices
@@ -754,7 +761,7 @@ namespace casadi {
             tmp.resize(sz);
 
             // Add contribution to the Jacobian
-            ret.at(0).nz(adds2) = fsens[d][oind].nz(tmp);
+            jadds.push_back(std::make_pair(adds2, fs.nz(tmp)));
           }
         }
 
@@ -770,6 +777,8 @@ namespace casadi {
           asens[d][iind].sparsity().get_nz(nzmap);
 
           // For all the output nonzeros treated in the sweep
+          adds.clear();
+          tmp.clear();
           for (casadi_int el = D2.colind(offset_nadir+d); el<D2.colind(offset_nadir+d+1); ++el) {
 
             // Get the output nonzero
@@ -786,14 +795,43 @@ namespace casadi {
               if (anz<0) continue;
 
               // Get the input seed
-              ret.at(0).nz(elJ) = asens[d][iind].nz(anz);
+              adds.push_back(elJ);
+              tmp.push_back(anz);
             }
           }
+
+          // Add contribution to the Jacobian
+          const MatType& as = asens[d][iind];
+          jadds.push_back(std::make_pair(adds, as.nz(tmp)));
         }
+      };
 
-        // Update direction offsets
-        offset_nfdir += nfdir_batch;
-        offset_nadir += nadir_batch;
+      // Evaluate until everything has been determined
+      if (n_thread==1) {
+        JacAdds jadds;
+        for (casadi_int s=0; s<nsweep; ++s) {
+          // Print progress
+          if (verbose_) {
+            casadi_int progress_new = (s*100)/nsweep;
+            // Print when entering a new decade
+            if (progress_new / 10 > progress / 10) {
+              progress = progress_new;
+              casadi_message(str(progress) + " %");
+            }
+          }
+          sweep(s, jadds);
+          for (auto&& e : jadds) ret.at(0).nz(e.first) = e.second;
+          jadds.clear();
+        }
+      } else {
+        // Merge the sweeps in order, as in the serial case
+        std::vector<JacAdds> jadds(nsweep);
+        ThreadPool::run(nsweep, n_thread, [&](casadi_int s, casadi_int) {
+          sweep(s, jadds[s]);
+        });
+        for (auto&& j : jadds) {
+          for (auto&& e : j) ret.at(0).nz(e.first) = e.second;
+        }
       }
 
       // Return
@@ -1149,8 +1187,21 @@ namespace casadi {
     extract_from_dict_inplace(f_options, "final_options", final_options);
     final_options["allow_duplicate_io_names"] = true;
 
+    // Method for calculating Hessian blocks
+    std::string hessian_method = "forward_over_reverse";
+    auto hm_it = f_options.find("hessian_method");
+    if (hm_it != f_options.end()) {
+      hessian_method = hm_it->second.to_string();
+      f_options.erase(hm_it);
+    }
+    casadi_assert(hessian_method=="forward_over_reverse" || MatType::type_name()=="SX",
+      "Hessian method \"" + hessian_method + "\" requires an SXFunction");
+    casadi_assert(hessian_method=="forward_over_reverse" || hessian_method=="edge_pushing",
+      "Unknown Hessian method \"" + hessian_method + "\"");
+
     // Create an expression factory
     Factory<MatType> f;
+    f.edge_pushing_ = hessian_method=="edge_pushing";
     for (casadi_int i=0; i<in_.size(); ++i) f.add_input(name_in_[i], in_[i], is_diff_in_[i]);
     for (casadi_int i=0; i<out_.size(); ++i) f.add_output(name_out_[i], out_[i], is_diff_out_[i]);
     f.add_dual(aux);
@@ -25,6 +25,8 @@
 
 #include "linsol_ldl.hpp"
 #include "casadi/core/global_options.hpp"
+#include "casadi/core/sparsity_internal.hpp"
+#include "casadi/core/thread_pool.hpp"
 
 namespace casadi {
 
@@ -60,7 +62,16 @@ namespace casadi {
        "Incomplete factorization, without any fill-in"}},
       {"preordering",
        {OT_BOOL,
-       "Approximate minimal degree (AMD) preordering"}}
+       "Approximate minimal degree (AMD) preordering"}},
+      {"supernodal",
+       {OT_BOOL,
+       "Factorize columns with the same sparsity pattern together as dense blocks"}},
+      {"threads",
+       {OT_INT,
+       "Number of threads for factorizing independent subtrees of the elimination tree. "
+       "Zero or negative means as many as possible, cf. GlobalOptions::setMaxNumThreads. "
+       "Not combined with 'supernodal'. The result does not depend on this setting. "
+       "Default: 1"}}
      }
   };
 
@@ -71,6 +82,9 @@ namespace casadi {
     // Default options
     incomplete_ = false;
     amd_ = true;
+    supernodal_ = false;
+    sz_w_sn_ = 0;
+    casadi_int threads = 1;
 
     // Read user options
     for (auto&& op : opts) {
@@ -78,6 +92,10 @@ namespace casadi {
         incomplete_ = op.second;
       } else if (op.first=="amd") {
         amd_ = op.second;
+      } else if (op.first=="supernodal") {
+        supernodal_ = op.second;
+      } else if (op.first=="threads") {
+        threads = op.second;
       }
     }
 
@@ -97,6 +115,58 @@ namespace casadi {
       // Regular LDL^T
       sp_Lt_ = sp_.ldl(p_, amd_);
     }
+
+    // Number of threads
+    n_thread_ = threads==1 ? 1 : FunctionInternal::num_threads(threads, nrow());
+    casadi_assert(!supernodal_ || n_thread_==1,
+      "Options 'supernodal' and 'threads' cannot be combined");
+
+    // Postorder the elimination tree, making supernodes and subtrees contiguous
+    if (supernodal_ || n_thread_>1) {
+      casadi_assert(!incomplete_,
+        "Supernodal or parallel factorization requires 'incomplete' false");
+      casadi_int n = nrow();
+      std::vector<casadi_int> tmp, post(n), w(3*n);
+      std::vector<casadi_int> parent = sp_.sub(p_, p_, tmp).etree();
+      SparsityInternal::postorder(get_ptr(parent), n, get_ptr(post), get_ptr(w));
+      p_ = vector_slice(p_, post);
+      sp_Lt_ = sp_.sub(p_, p_, tmp).ldl(tmp, false);
+    }
+
+    // Independent subtrees for a parallel factorization
+    if (n_thread_>1) {
+      std::vector<casadi_int> tmp;
+      etree_ = sp_.sub(p_, p_, tmp).etree();
+      // Flops for each column
+      const casadi_int *lt_colind = sp_Lt_.colind(), *lt_row = sp_Lt_.row();
+      std::vector<double> work(nrow(), 1);
+      for (casadi_int c=0; c<nrow(); ++c) {
+        for (casadi_int k=lt_colind[c]; k<lt_colind[c+1]; ++k) {
+          casadi_int r = lt_row[k];
+          work[c] += 1 + lt_colind[r+1] - lt_colind[r];
+        }
+      }
+      SparsityInternal::etree_partition(etree_, work, n_thread_, par_, par_ind_, ser_);
+      if (par_.empty()) n_thread_ = 1;
+      // Rows calculated in the parallel phase
+      sub_.assign(nrow(), 0);
+      for (casadi_int k=0; k<par_.size(); k+=2) {
+        for (casadi_int c=par_[k]; c<par_[k+1]; ++c) sub_[c] = 1;
+      }
+      if (verbose_) {
+        casadi_message(name_ + ": " + str(par_.size()/2) + " subtrees in "
+          + str(par_ind_.size()-1) + " chunks for " + str(n_thread_) + " threads");
+      }
+    }
+
+    // Supernode partition
+    if (supernodal_) {
+      sn_ = SparsityInternal::ldl_supernodes(sp_Lt_, sz_w_sn_);
+      if (verbose_) {
+        casadi_message(name_ + ": " + str(sn_[0]) + " supernodes for "
+          + str(nrow()) + " columns");
+      }
+    }
   }
 
   int LinsolLdl::init_mem(void* mem) const {
@@ -107,7 +177,11 @@ namespace casadi {
     casadi_int nrow = this->nrow();
     m->d.resize(nrow);
     m->l.resize(sp_Lt_.nnz());
-    m->w.resize(nrow);
+    m->w.resize(n_thread_*nrow);
+    if (supernodal_) {
+      m->w.resize(std::max(nrow, sz_w_sn_));
+      m->iw.resize(2*nrow + 2*sn_[0]);
+    }
 
     return 0;
   }
@@ -118,7 +192,33 @@ namespace casadi {
 
   int LinsolLdl::nfact(void* mem, const double* A) const {
     auto m = static_cast<LinsolLdlMemory*>(mem);
-    casadi_ldl(sp_, A, sp_Lt_, get_ptr(m->l), get_ptr(m->d), get_ptr(p_), get_ptr(m->w));
+    if (supernodal_) {
+      casadi_ldl_sn(sp_, A, sp_Lt_, get_ptr(m->l), get_ptr(m->d), get_ptr(p_), get_ptr(sn_),
+        get_ptr(m->iw), get_ptr(m->w));
+    } else if (n_thread_>1) {
+      casadi_int nrow = this->nrow();
+      double *l = get_ptr(m->l), *d = get_ptr(m->d), *w = get_ptr(m->w);
+      casadi_clear(w, n_thread_*nrow);
+      // Independent subtrees, each thread with its own work vector
+      ThreadPool::run(par_ind_.size()-1, n_thread_, [&](casadi_int i, casadi_int t) {
+        double* wt = w + t*nrow;
+        for (casadi_int k=par_ind_[i]; k<par_ind_[i+1]; ++k) {
+          casadi_int c0 = par_[2*k], c1 = par_[2*k+1];
+          casadi_ldl_cols(sp_, A, sp_Lt_, l, d, get_ptr(p_), nullptr, wt, c0, c1);
+          // Rows of the subtree in the remaining columns, all ancestors of its root
+          for (casadi_int c=etree_[c1-1]; c>=0; c=etree_[c]) {
+            casadi_ldl_rows(sp_, A, sp_Lt_, l, get_ptr(p_), wt, c, c0, c1);
+          }
+        }
+      });
+      // Remaining columns
+      for (casadi_int k=0; k<ser_.size(); k+=2) {
+        casadi_ldl_cols(sp_, A, sp_Lt_, l, d, get_ptr(p_), get_ptr(sub_), w,
+          ser_[k], ser_[k+1]);
+      }
+    } else {
+      casadi_ldl(sp_, A, sp_Lt_, get_ptr(m->l), get_ptr(m->d), get_ptr(p_), get_ptr(m->w));
+    }
     for (double d : m->d) {
       if (d==0) casadi_warning("LDL factorization has zeros in D");
     }
@@ -159,12 +259,18 @@ namespace casadi {
     // Place in block to avoid conflicts caused by local variables
     g << "{\n";
     g.comment("FIXME(@jaeandersson): Memory allocation can be avoided");
+    casadi_int sz_w = supernodal_ ? std::max(nrow(), sz_w_sn_) : nrow();
     g << "casadi_real lt[" << sp_Lt_.nnz() << "], "
          "d[" << nrow() << "], "
-         "w[" << nrow() << "];\n";
+         "w[" << sz_w << "];\n";
 
     // Factorize
-    g << g.ldl(sp, A, sp_Lt, "lt", "d", p, "w") << "\n";
+    if (supernodal_) {
+      g << "casadi_int iw[" << 2*nrow() + 2*sn_[0] << "];\n";
+      g << g.ldl_sn(sp, A, sp_Lt, "lt", "d", p, g.constant(sn_), "iw", "w") << "\n";
+    } else {
+      g << g.ldl(sp, A, sp_Lt, "lt", "d", p, "w") << "\n";
+    }
 
     // Solve
     g << g.ldl_solve(x, nrhs, sp_Lt, "lt", "d", p, "w") << "\n";
@@ -174,16 +280,43 @@ namespace casadi {
   }
 
   LinsolLdl::LinsolLdl(DeserializingStream& s) : LinsolInternal(s) {
-    s.version("LinsolLdl", 1);
+    int version = s.version("LinsolLdl", 1, 3);
     s.unpack("LinsolLdl::p", p_);
     s.unpack("LinsolLdl::sp_Lt", sp_Lt_);
+    if (version>=2) {
+      s.unpack("LinsolLdl::supernodal", supernodal_);
+      s.unpack("LinsolLdl::sn", sn_);
+      s.unpack("LinsolLdl::sz_w_sn", sz_w_sn_);
+    } else {
+      supernodal_ = false;
+      sz_w_sn_ = 0;
+    }
+    if (version>=3) {
+      s.unpack("LinsolLdl::n_thread", n_thread_);
+      s.unpack("LinsolLdl::par", par_);
+      s.unpack("LinsolLdl::par_ind", par_ind_);
+      s.unpack("LinsolLdl::ser", ser_);
+      s.unpack("LinsolLdl::etree", etree_);
+      s.unpack("LinsolLdl::sub", sub_);
+    } else {
+      n_thread_ = 1;
+    }
   }
 
   void LinsolLdl::serialize_body(SerializingStream &s) const {
     LinsolInternal::serialize_body(s);
-    s.version("LinsolLdl", 1);
+    s.version("LinsolLdl", 3);
     s.pack("LinsolLdl::p", p_);
     s.pack("LinsolLdl::sp_Lt", sp_Lt_);
+    s.pack("LinsolLdl::supernodal", supernodal_);
+    s.pack("LinsolLdl::sn", sn_);
+    s.pack("LinsolLdl::sz_w_sn", sz_w_sn_);
+    s.pack("LinsolLdl::n_thread", n_thread_);
+    s.pack("LinsolLdl::par", par_);
+    s.pack("LinsolLdl::par_ind", par_ind_);
+    s.pack("LinsolLdl::ser", ser_);
+    s.pack("LinsolLdl::etree", etree_);
+    s.pack("LinsolLdl::sub", sub_);
   }
 
 } // namespace casadi
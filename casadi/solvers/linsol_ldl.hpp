@@ -42,6 +42,7 @@
 namespace casadi {
   struct CASADI_LINSOL_LDL_EXPORT LinsolLdlMemory : public LinsolMemory {
     std::vector<double> l, d, w;
+    std::vector<casadi_int> iw;
   };
 
   /** \brief \pluginbrief{LinsolInternal,ldl}
@@ -112,9 +113,20 @@ namespace casadi {
     std::vector<casadi_int> p_;
     Sparsity sp_Lt_;
 
+    // Supernode partition, real work vector size of the supernodal factorization
+    std::vector<casadi_int> sn_;
+    casadi_int sz_w_sn_;
+
+    // Parallel factorization: number of threads, subtree ranges in chunks, remaining ranges
+    casadi_int n_thread_;
+    std::vector<casadi_int> par_, par_ind_, ser_;
+
+    // Elimination tree, flags for the rows calculated by the parallel phase
+    std::vector<casadi_int> etree_, sub_;
+
     ///@{
     // Options
-    bool incomplete_, amd_;
+    bool incomplete_, amd_, supernodal_;
     ///@}
 
     /** \brief Serialize an object without type information */
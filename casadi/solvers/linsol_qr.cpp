@@ -25,6 +25,8 @@
 
 #include "linsol_qr.hpp"
 #include "casadi/core/global_options.hpp"
+#include "casadi/core/sparsity_internal.hpp"
+#include "casadi/core/thread_pool.hpp"
 
 namespace casadi {
 
@@ -60,7 +62,13 @@ namespace casadi {
         "Minimum R entry before singularity is declared [1e-12]"}},
       {"cache",
        {OT_DOUBLE,
-        "Amount of factorisations to remember (thread-local) [0]"}}
+        "Amount of factorisations to remember (thread-local) [0]"}},
+      {"threads",
+       {OT_INT,
+        "Number of threads for factorizing independent subtrees of the column "
+        "elimination tree. Zero or negative means as many as possible, "
+        "cf. GlobalOptions::setMaxNumThreads. The result does not depend on this setting. "
+        "Default: 1"}}
      }
   };
 
@@ -71,16 +79,50 @@ namespace casadi {
     // Read options
     eps_ = 1e-12;
     n_cache_ = 0;
+    casadi_int threads = 1;
     for (auto&& op : opts) {
       if (op.first=="eps") {
         eps_ = op.second;
       } else if (op.first=="cache") {
         n_cache_ = op.second;
+      } else if (op.first=="threads") {
+        threads = op.second;
       }
     }
 
     // Symbolic factorization
     sp_.qr_sparse(sp_v_, sp_r_, prinv_, pc_);
+
+    // Independent subtrees for a parallel factorization
+    n_thread_ = threads==1 ? 1 : FunctionInternal::num_threads(threads, ncol());
+    if (n_thread_>1) {
+      // Postorder the column elimination tree, making the subtrees contiguous
+      casadi_int n = ncol();
+      std::vector<casadi_int> tmp, post(n), w(3*n);
+      std::vector<casadi_int> parent = sp_.sub(range(nrow()), pc_, tmp).etree(true);
+      SparsityInternal::postorder(get_ptr(parent), n, get_ptr(post), get_ptr(w));
+      pc_ = vector_slice(pc_, post);
+      Sparsity Aperm = sp_.sub(range(nrow()), pc_, tmp);
+      Aperm.qr_sparse(sp_v_, sp_r_, prinv_, tmp, false);
+      parent = Aperm.etree(true);
+      // Flops for each column
+      const casadi_int *v_colind = sp_v_.colind();
+      const casadi_int *r_colind = sp_r_.colind(), *r_row = sp_r_.row();
+      std::vector<double> work(n);
+      for (casadi_int c=0; c<n; ++c) {
+        work[c] = v_colind[c+1] - v_colind[c];
+        for (casadi_int k=r_colind[c]; k<r_colind[c+1]; ++k) {
+          casadi_int r = r_row[k];
+          if (r<c) work[c] += 2*(v_colind[r+1] - v_colind[r]);
+        }
+      }
+      SparsityInternal::etree_partition(parent, work, n_thread_, par_, par_ind_, ser_);
+      if (par_.empty()) n_thread_ = 1;
+      if (verbose_) {
+        casadi_message(name_ + ": " + str(par_.size()/2) + " subtrees in "
+          + str(par_ind_.size()-1) + " chunks for " + str(n_thread_) + " threads");
+      }
+    }
   }
 
   void LinsolQr::finalize() {
@@ -96,7 +138,7 @@ namespace casadi {
     m->v.resize(sp_v_.nnz());
     m->r.resize(sp_r_.nnz());
     m->beta.resize(ncol());
-    m->w.resize(nrow() + ncol());
+    m->w.resize(std::max(nrow() + ncol(), n_thread_*sp_v_.size1()));
 
     m->cache.resize(cache_stride_*n_cache_);
     m->cache_loc.resize(n_cache_, -1);
@@ -126,9 +168,28 @@ namespace casadi {
     }
 
     // Cache miss -> compute result
-    casadi_qr(sp_, A, get_ptr(m->w),
-              sp_v_, get_ptr(m->v), sp_r_, get_ptr(m->r),
-              get_ptr(m->beta), get_ptr(prinv_), get_ptr(pc_));
+    if (n_thread_>1) {
+      casadi_int nrow_ext = sp_v_.size1();
+      double *v = get_ptr(m->v), *r = get_ptr(m->r), *beta = get_ptr(m->beta);
+      double *w = get_ptr(m->w);
+      casadi_clear(w, n_thread_*nrow_ext);
+      // Independent subtrees, each thread with its own work vector
+      ThreadPool::run(par_ind_.size()-1, n_thread_, [&](casadi_int i, casadi_int t) {
+        for (casadi_int k=par_ind_[i]; k<par_ind_[i+1]; ++k) {
+          casadi_qr_cols(sp_, A, w + t*nrow_ext, sp_v_, v, sp_r_, r, beta,
+            get_ptr(prinv_), get_ptr(pc_), par_[2*k], par_[2*k+1]);
+        }
+      });
+      // Remaining columns
+      for (casadi_int k=0; k<ser_.size(); k+=2) {
+        casadi_qr_cols(sp_, A, w, sp_v_, v, sp_r_, r, beta,
+          get_ptr(prinv_), get_ptr(pc_), ser_[k], ser_[k+1]);
+      }
+    } else {
+      casadi_qr(sp_, A, get_ptr(m->w),
+                sp_v_, get_ptr(m->v), sp_r_, get_ptr(m->r),
+                get_ptr(m->beta), get_ptr(prinv_), get_ptr(pc_));
+    }
     // Check singularity
     double rmin;
     casadi_int irmin, nullity;
@@ -218,7 +279,7 @@ namespace casadi {
   }
 
   LinsolQr::LinsolQr(DeserializingStream& s) : LinsolInternal(s) {
-    int version = s.version("LinsolQr", 1, 2);
+    int version = s.version("LinsolQr", 1, 3);
     s.unpack("LinsolQr::prinv", prinv_);
     s.unpack("LinsolQr::pc", pc_);
     s.unpack("LinsolQr::sp_v", sp_v_);
@@ -229,17 +290,29 @@ namespace casadi {
     } else {
       n_cache_ = 1;
     }
+    if (version>2) {
+      s.unpack("LinsolQr::n_thread", n_thread_);
+      s.unpack("LinsolQr::par", par_);
+      s.unpack("LinsolQr::par_ind", par_ind_);
+      s.unpack("LinsolQr::ser", ser_);
+    } else {
+      n_thread_ = 1;
+    }
   }
 
   void LinsolQr::serialize_body(SerializingStream &s) const {
     LinsolInternal::serialize_body(s);
-    s.version("LinsolQr", 2);
+    s.version("LinsolQr", 3);
     s.pack("LinsolQr::prinv", prinv_);
     s.pack("LinsolQr::pc", pc_);
     s.pack("LinsolQr::sp_v", sp_v_);
     s.pack("LinsolQr::sp_r", sp_r_);
     s.pack("LinsolQr::eps", eps_);
     s.pack("LinsolQr::n_cache", n_cache_);
+    s.pack("LinsolQr::n_thread", n_thread_);
+    s.pack("LinsolQr::par", par_);
+    s.pack("LinsolQr::par_ind", par_ind_);
+    s.pack("LinsolQr::ser", ser_);
   }
 
 } // namespace casadi
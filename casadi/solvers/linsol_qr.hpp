@@ -118,6 +118,10 @@ namespace casadi {
     casadi_int n_cache_;
     casadi_int cache_stride_;
 
+    /// Parallel factorization: number of threads, subtree ranges in chunks, remaining ranges
+    casadi_int n_thread_;
+    std::vector<casadi_int> par_, par_ind_, ser_;
+
     /** \brief Serialize an object without type information */
     void serialize_body(SerializingStream &s) const override;
 
@@ -79,7 +79,14 @@ namespace casadi {
         "Printed numbers are 0-based indices into the vector of [simple bounds;linear bounds]"}},
       {"min_lam",
        {OT_DOUBLE,
-        "Smallest multiplier treated as inactive for the initial active set [0]."}}
+        "Smallest multiplier treated as inactive for the initial active set [0]."}},
+      {"max_update",
+       {OT_INT,
+        "Maximum number of low-rank updates of the KKT factorization "
+        "before refactorizing [10]. Nearly singular or inaccurate updates "
+        "trigger a factorization from scratch, as does termination. "
+        "After an update, the iteration log shows "
+        "the smallest pivot of the update matrix as min_R, with con -1."}}
      }
   };
 
@@ -115,6 +122,8 @@ namespace casadi {
         p_.dual_inf_tol = op.second;
       } else if (op.first=="min_lam") {
         p_.min_lam = op.second;
+      } else if (op.first=="max_update") {
+        p_.max_update = op.second;
       } else if (op.first=="print_iter") {
         print_iter_ = op.second;
       } else if (op.first=="print_header") {
@@ -126,6 +135,8 @@ namespace casadi {
       }
     }
 
+    casadi_assert(p_.max_update>=0, "Option 'max_update' must be nonnegative");
+
     // Allocate memory
     casadi_int sz_arg, sz_res, sz_w, sz_iw;
     casadi_qrqp_work(&p_, &sz_arg, &sz_res, &sz_iw, &sz_w);
@@ -159,7 +170,15 @@ namespace casadi {
     m->d.prob = &p_;
     m->d.qp = &m->d_qp;
 
+    // Number of updates of the factorization from the previous call
+    casadi_int n_up = m->d.n_up;
     casadi_qrqp_init(&m->d, &iw, &w);
+
+    // Keep the KKT factorization in the memory object, not in the work vectors
+    casadi_int* fact_iw = get_ptr(m->fact_iw);
+    double* fact_w = get_ptr(m->fact_w);
+    casadi_qrqp_fact_init(&m->d, &fact_iw, &fact_w);
+    m->d.n_up = n_up;
   }
 
   void Qrqp::set_qrqp_prob() {
@@ -177,6 +196,14 @@ namespace casadi {
     if (Conic::init_mem(mem)) return 1;
     auto m = static_cast<QrqpMemory*>(mem);
     m->return_status = "";
+    // No factorization yet
+    casadi_int sz_iw = 0, sz_w = 0;
+    casadi_qrqp_fact_work(&p_, &sz_iw, &sz_w);
+    m->fact_iw.resize(sz_iw);
+    m->fact_w.resize(sz_w);
+    m->fact_h.resize(H_.nnz());
+    m->fact_a.resize(A_.nnz());
+    m->d.n_up = -1;
     return 0;
   }
 
@@ -200,6 +227,15 @@ namespace casadi {
     casadi_copy(d_qp.lam_x0, nx_, d.lam);
     casadi_copy(d_qp.lam_a0, na_, d.lam+nx_);
 
+    // Reuse the factorization from the previous call if H and A are unchanged
+    if (d.n_up < 0
+        || !std::equal(m->fact_h.begin(), m->fact_h.end(), d_qp.h)
+        || !std::equal(m->fact_a.begin(), m->fact_a.end(), d_qp.a)) {
+      d.n_up = -1;
+      casadi_copy(d_qp.h, H_.nnz(), get_ptr(m->fact_h));
+      casadi_copy(d_qp.a, A_.nnz(), get_ptr(m->fact_a));
+    }
+
     // Reset solver
     if (casadi_qrqp_reset(&d)) return 1;
     while (true) {
@@ -256,6 +292,7 @@ namespace casadi {
     // Return
     if (verbose_) casadi_warning(m->return_status);
     m->d_qp.success = d.status == QP_SUCCESS;
+    m->d_qp.iter_count = d.iter;
     return 0;
   }
 
@@ -282,6 +319,7 @@ namespace casadi {
     // Copy options
     g << "p.max_iter = " << p_.max_iter << ";\n";
     g << "p.min_lam = " << p_.min_lam << ";\n";
+    g << "p.max_update = " << p_.max_update << ";\n";
     g << "p.constr_viol_tol = " << p_.constr_viol_tol << ";\n";
     g << "p.dual_inf_tol = " << p_.dual_inf_tol << ";\n";
 
@@ -290,6 +328,17 @@ namespace casadi {
     g << "d.qp = &d_qp;\n";
     g << "casadi_qrqp_init(&d, &iw, &w);\n";
 
+    // The KKT factorization is not kept between calls of the generated code
+    casadi_int sz_fact_iw = 0, sz_fact_w = 0;
+    casadi_qrqp_fact_work(&p_, &sz_fact_iw, &sz_fact_w);
+    g.local("fact_iw[" + str(sz_fact_iw) + "]", "casadi_int");
+    g.local("fact_w[" + str(sz_fact_w) + "]", "casadi_real");
+    g.local("fact_iw_ptr", "casadi_int", "*");
+    g.local("fact_w_ptr", "casadi_real", "*");
+    g << "fact_iw_ptr = fact_iw;\n";
+    g << "fact_w_ptr = fact_w;\n";
+    g << "casadi_qrqp_fact_init(&d, &fact_iw_ptr, &fact_w_ptr);\n";
+
     g.comment("Pass bounds on z");
     g.copy_default(g.arg(CONIC_LBX), nx_, "d.lbz", "-casadi_inf", false);
     g.copy_default(g.arg(CONIC_LBA), na_, "d.lbz+" + str(nx_), "-casadi_inf", false);
@@ -348,11 +397,12 @@ namespace casadi {
     Dict stats = Conic::get_stats(mem);
     auto m = static_cast<QrqpMemory*>(mem);
     stats["return_status"] = m->return_status;
+    stats["n_factorizations"] = m->d.n_fact;
     return stats;
   }
 
   Qrqp::Qrqp(DeserializingStream& s) : Conic(s) {
-    s.version("Qrqp", 1);
+    int version = s.version("Qrqp", 1, 2);
     s.unpack("Qrqp::AT", AT_);
     s.unpack("Qrqp::kkt", kkt_);
     s.unpack("Qrqp::sp_v", sp_v_);
@@ -368,12 +418,13 @@ namespace casadi {
     s.unpack("Qrqp::min_lam", p_.min_lam);
     s.unpack("Qrqp::constr_viol_tol", p_.constr_viol_tol);
     s.unpack("Qrqp::dual_inf_tol", p_.dual_inf_tol);
+    if (version >= 2) s.unpack("Qrqp::max_update", p_.max_update);
   }
 
   void Qrqp::serialize_body(SerializingStream &s) const {
     Conic::serialize_body(s);
 
-    s.version("Qrqp", 1);
+    s.version("Qrqp", 2);
     s.pack("Qrqp::AT", AT_);
     s.pack("Qrqp::kkt", kkt_);
     s.pack("Qrqp::sp_v", sp_v_);
@@ -388,6 +439,7 @@ namespace casadi {
     s.pack("Qrqp::min_lam", p_.min_lam);
     s.pack("Qrqp::constr_viol_tol", p_.constr_viol_tol);
     s.pack("Qrqp::dual_inf_tol", p_.dual_inf_tol);
+    s.pack("Qrqp::max_update", p_.max_update);
   }
 
 } // namespace casadi
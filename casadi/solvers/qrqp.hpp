@@ -44,6 +44,11 @@ namespace casadi {
   struct CASADI_CONIC_QRQP_EXPORT QrqpMemory : public ConicMemory {
     // Problem data structure
     casadi_qrqp_data<double> d;
+    // KKT factorization, kept across calls
+    std::vector<double> fact_w;
+    std::vector<casadi_int> fact_iw;
+    // H and A of the factorization
+    std::vector<double> fact_h, fact_a;
     const char* return_status;
   };
 
@@ -0,0 +1,447 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+
+#include "riqp.hpp"
+
+namespace casadi {
+
+  extern "C"
+  int CASADI_CONIC_RIQP_EXPORT
+  casadi_register_conic_riqp(Conic::Plugin* plugin) {
+    plugin->creator = Riqp::creator;
+    plugin->name = "riqp";
+    plugin->doc = Riqp::meta_doc.c_str();
+    plugin->version = CASADI_VERSION;
+    plugin->options = &Riqp::options_;
+    plugin->deserialize = &Riqp::deserialize;
+    return 0;
+  }
+
+  extern "C"
+  void CASADI_CONIC_RIQP_EXPORT casadi_load_conic_riqp() {
+    Conic::registerPlugin(casadi_register_conic_riqp);
+  }
+
+  Riqp::Riqp(const std::string& name, const std::map<std::string, Sparsity> &st)
+    : Conic(name, st) {
+  }
+
+  Riqp::~Riqp() {
+    clear_mem();
+  }
+
+  const Options Riqp::options_
+  = {{&Conic::options_},
+     {{"N",
+       {OT_INT,
+        "OCP horizon"}},
+      {"nx",
+       {OT_INTVECTOR,
+        "Number of states, length N+1"}},
+      {"nu",
+       {OT_INTVECTOR,
+        "Number of controls, length N or N+1"}},
+      {"ng",
+       {OT_INTVECTOR,
+        "Number of general constraints, length N+1"}},
+      {"max_iter",
+       {OT_INT,
+        "Maximum number of iterations [100]."}},
+      {"pr_tol",
+       {OT_DOUBLE,
+        "Primal tolerance [1e-8]."}},
+      {"du_tol",
+       {OT_DOUBLE,
+        "Dual tolerance [1e-8]."}},
+      {"co_tol",
+       {OT_DOUBLE,
+        "Complementarity tolerance [1e-8]."}},
+      {"mu_tol",
+       {OT_DOUBLE,
+        "Tolerance for the barrier parameter [1e-8]."}},
+      {"reg",
+       {OT_DOUBLE,
+        "Regularization of the equality constraints other than the dynamics "
+        "and of the fixed variables [1e-10]."}},
+      {"print_header",
+       {OT_BOOL,
+        "Print header [true]."}},
+      {"print_iter",
+       {OT_BOOL,
+        "Print iterations [true]."}},
+      {"print_info",
+       {OT_BOOL,
+        "Print info [true]."}}
+     }
+  };
+
+  void Riqp::init(const Dict& opts) {
+    // Initialize the base classes
+    Conic::init(opts);
+    // Read the problem structure
+    casadi_int struct_cnt = 0;
+    for (auto&& op : opts) {
+      if (op.first=="N") {
+        N_ = op.second;
+        struct_cnt++;
+      } else if (op.first=="nx") {
+        nxs_ = op.second;
+        struct_cnt++;
+      } else if (op.first=="nu") {
+        nus_ = op.second;
+        struct_cnt++;
+      } else if (op.first=="ng") {
+        ngs_ = op.second;
+        struct_cnt++;
+      }
+    }
+    casadi_assert(struct_cnt==4,
+      "Options 'N', 'nx', 'nu' and 'ng' are required for the structure.");
+    casadi_assert(N_>=0, "Option 'N' must be non-negative.");
+    if (nus_.size()==N_) nus_.push_back(0);
+    casadi_assert(nxs_.size()==N_+1,
+      "Option 'nx' must have length N+1 (" + str(N_+1) + "), got " + str(nxs_.size()) + ".");
+    casadi_assert(nus_.size()==N_+1,
+      "Option 'nu' must have length N or N+1, got " + str(nus_.size()) + ".");
+    casadi_assert(ngs_.size()==N_+1,
+      "Option 'ng' must have length N+1 (" + str(N_+1) + "), got " + str(ngs_.size()) + ".");
+    for (casadi_int k=0; k<=N_; ++k) {
+      casadi_assert(nxs_[k]>=0 && nus_[k]>=0 && ngs_[k]>=0,
+        "Stage dimensions must be non-negative.");
+    }
+    // Offsets of the stages
+    off_z_.resize(N_+2);
+    off_a_.resize(N_+2);
+    off_z_[0] = off_a_[0] = 0;
+    for (casadi_int k=0; k<=N_; ++k) {
+      off_z_[k+1] = off_z_[k] + nxs_[k] + nus_[k];
+      off_a_[k+1] = off_a_[k] + (k<N_ ? nxs_[k+1] : 0) + ngs_[k];
+    }
+    casadi_assert(off_z_[N_+1]==nx_,
+      "Structure mismatch: sum(nx)+sum(nu) = " + str(off_z_[N_+1])
+      + ", but the QP has " + str(nx_) + " variables.");
+    casadi_assert(off_a_[N_+1]==na_,
+      "Structure mismatch: sum(nx[1:])+sum(ng) = " + str(off_a_[N_+1])
+      + ", but the QP has " + str(na_) + " constraints.");
+    // Check the sparsity patterns against the structure
+    const casadi_int *h_colind = H_.colind(), *h_row = H_.row();
+    const casadi_int *a_colind = A_.colind(), *a_row = A_.row();
+    casadi_int k = 0, n_e = 0;
+    for (casadi_int c=0; c<nx_; ++c) {
+      // Stage of the variable
+      while (off_z_[k+1]<=c) k++;
+      for (casadi_int el=h_colind[c]; el<h_colind[c+1]; ++el) {
+        casadi_assert(h_row[el]>=off_z_[k] && h_row[el]<off_z_[k+1],
+          "Hessian entry (" + str(h_row[el]) + ", " + str(c) + ") couples stages. "
+          "The Hessian must be block diagonal with the stages.");
+      }
+      for (casadi_int el=a_colind[c]; el<a_colind[c+1]; ++el) {
+        casadi_int r = a_row[el];
+        if (r>=off_a_[k] && r<off_a_[k+1]) continue;
+        casadi_assert(k>0 && c-off_z_[k]<nxs_[k] && r-off_a_[k-1]==c-off_z_[k],
+          "Constraint entry (" + str(r) + ", " + str(c) + ") does not match the stage "
+          "structure. Stage k may only couple to x_{k+1} through a diagonal matrix.");
+        n_e++;
+      }
+    }
+    casadi_int n_dyn = 0;
+    for (casadi_int i=1; i<=N_; ++i) n_dyn += nxs_[i];
+    casadi_assert(n_e==n_dyn,
+      "The coupling of stage k to x_{k+1} must be a structurally full diagonal.");
+    // Setup memory structure
+    set_riqp_prob();
+    // Default options
+    print_iter_ = true;
+    print_header_ = true;
+    print_info_ = true;
+    // Read user options
+    for (auto&& op : opts) {
+      if (op.first=="max_iter") {
+        p_.max_iter = op.second;
+      } else if (op.first=="pr_tol") {
+        p_.pr_tol = op.second;
+      } else if (op.first=="du_tol") {
+        p_.du_tol = op.second;
+      } else if (op.first=="co_tol") {
+        p_.co_tol = op.second;
+      } else if (op.first=="mu_tol") {
+        p_.mu_tol = op.second;
+      } else if (op.first=="reg") {
+        p_ric_.reg = op.second;
+      } else if (op.first=="print_iter") {
+        print_iter_ = op.second;
+      } else if (op.first=="print_header") {
+        print_header_ = op.second;
+      } else if (op.first=="print_info") {
+        print_info_ = op.second;
+      }
+    }
+    casadi_assert(p_ric_.reg>0, "Option 'reg' must be positive.");
+    // Memory for IP solver and Riccati recursion
+    alloc_w(casadi_ipqp_sz_w(&p_) + p_ric_.sz_w, true);
+    // Print summary
+    if (print_header_) {
+      print("-------------------------------------------\n");
+      print("This is casadi::Riqp\n");
+      print("Horizon:                         %12d\n", N_);
+      print("Number of variables:             %12d\n", nx_);
+      print("Number of constraints:           %12d\n", na_);
+      print("Number of nonzeros in H:         %12d\n", H_.nnz());
+      print("Number of nonzeros in A:         %12d\n", A_.nnz());
+    }
+  }
+
+  void Riqp::set_riqp_prob() {
+    casadi_ipqp_setup(&p_, nx_, na_);
+    p_ric_.sp_h = H_;
+    p_ric_.sp_a = A_;
+    p_ric_.N = N_;
+    p_ric_.nx = get_ptr(nxs_);
+    p_ric_.nu = get_ptr(nus_);
+    p_ric_.ng = get_ptr(ngs_);
+    p_ric_.off_z = get_ptr(off_z_);
+    p_ric_.off_a = get_ptr(off_a_);
+    casadi_riqp_setup(&p_ric_);
+  }
+
+  int Riqp::init_mem(void* mem) const {
+    if (Conic::init_mem(mem)) return 1;
+    auto m = static_cast<RiqpMemory*>(mem);
+    m->return_status = "";
+    return 0;
+  }
+
+  int Riqp::
+  solve(const double** arg, double** res, casadi_int* iw, double* w, void* mem) const {
+    auto m = static_cast<RiqpMemory*>(mem);
+    // Message buffer
+    char buf[121];
+    // Setup IP solver
+    casadi_ipqp_data<double> d;
+    d.prob = &p_;
+    casadi_ipqp_init(&d, &iw, &w);
+    // Setup Riccati recursion
+    casadi_riqp_data<double> d_ric;
+    d_ric.prob = &p_ric_;
+    casadi_riqp_init(&d_ric, &w);
+    casadi_ipqp_bounds(&d, arg[CONIC_G],
+      arg[CONIC_LBX], arg[CONIC_UBX], arg[CONIC_LBA], arg[CONIC_UBA]);
+    casadi_ipqp_guess(&d, arg[CONIC_X0], arg[CONIC_LAM_X0], arg[CONIC_LAM_A0]);
+    // Reverse communication loop
+    while (casadi_ipqp(&d)) {
+      switch (d.task) {
+      case IPQP_MV:
+        // Matrix-vector multiplication
+        casadi_mv(arg[CONIC_H], H_, d.z, d.rz, 0);
+        casadi_mv(arg[CONIC_A], A_, d.lam + p_.nx, d.rz, 1);
+        casadi_mv(arg[CONIC_A], A_, d.z, d.rz + p_.nx, 0);
+        break;
+      case IPQP_PROGRESS:
+        // Print progress
+        if (print_iter_) {
+          if (d.iter % 10 == 0) {
+            // Print header
+            if (casadi_ipqp_print_header(&d, buf, sizeof(buf))) break;
+            uout() << buf << "\n";
+          }
+          // Print iteration
+          if (casadi_ipqp_print_iteration(&d, buf, sizeof(buf))) break;
+          uout() << buf << "\n";
+          // User interrupt?
+          InterruptHandler::check();
+        }
+        break;
+      case IPQP_FACTOR:
+        // Riccati factorization
+        if (casadi_riqp_factor(&d_ric, arg[CONIC_H], arg[CONIC_A], d.S, d.D))
+          d.status = IPQP_FACTOR_ERROR;
+        break;
+      case IPQP_SOLVE:
+        // Forward and backward sweeps
+        casadi_riqp_solve(&d_ric, d.S, d.D, d.linsys);
+        break;
+      }
+    }
+    // Read return status
+    m->return_status = casadi_ipqp_return_status(d.status);
+    if (d.status == IPQP_MAX_ITER)
+      m->d_qp.unified_return_status = SOLVER_RET_LIMITED;
+    // Get solution
+    casadi_ipqp_solution(&d, res[CONIC_X], res[CONIC_LAM_X], res[CONIC_LAM_A]);
+    if (res[CONIC_COST]) {
+      *res[CONIC_COST] = .5 * casadi_bilin(arg[CONIC_H], H_, d.z, d.z)
+        + casadi_dot(p_.nx, d.z, d.g);
+    }
+    // Return
+    if (verbose_) casadi_warning(m->return_status);
+    m->d_qp.success = d.status == IPQP_SUCCESS;
+    return 0;
+  }
+
+  Dict Riqp::get_stats(void* mem) const {
+    Dict stats = Conic::get_stats(mem);
+    auto m = static_cast<RiqpMemory*>(mem);
+    stats["return_status"] = m->return_status;
+    return stats;
+  }
+
+  void Riqp::codegen_body(CodeGenerator& g) const {
+    g.add_auxiliary(CodeGenerator::AUX_RIQP);
+    g.add_auxiliary(CodeGenerator::AUX_BILIN);
+    g.add_auxiliary(CodeGenerator::AUX_DOT);
+    if (print_iter_) g.add_auxiliary(CodeGenerator::AUX_PRINTF);
+    g.local("d", "struct casadi_ipqp_data");
+    g.local("p", "struct casadi_ipqp_prob");
+    g.local("d_ric", "struct casadi_riqp_data");
+    g.local("p_ric", "struct casadi_riqp_prob");
+    if (print_iter_) g.local("buf[121]", "char");
+
+    // Setup memory structures
+    g << "casadi_ipqp_setup(&p, " << nx_ << ", " << na_ << ");\n";
+    g << "p_ric.sp_h = " << g.sparsity(H_) << ";\n";
+    g << "p_ric.sp_a = " << g.sparsity(A_) << ";\n";
+    g << "p_ric.N = " << N_ << ";\n";
+    g << "p_ric.nx = " << g.constant(nxs_) << ";\n";
+    g << "p_ric.nu = " << g.constant(nus_) << ";\n";
+    g << "p_ric.ng = " << g.constant(ngs_) << ";\n";
+    g << "p_ric.off_z = " << g.constant(off_z_) << ";\n";
+    g << "p_ric.off_a = " << g.constant(off_a_) << ";\n";
+    g << "casadi_riqp_setup(&p_ric);\n";
+
+    // Copy options
+    g << "p.max_iter = " << p_.max_iter << ";\n";
+    g << "p.pr_tol = " << g.constant(p_.pr_tol) << ";\n";
+    g << "p.du_tol = " << g.constant(p_.du_tol) << ";\n";
+    g << "p.co_tol = " << g.constant(p_.co_tol) << ";\n";
+    g << "p.mu_tol = " << g.constant(p_.mu_tol) << ";\n";
+    g << "p_ric.reg = " << g.constant(p_ric_.reg) << ";\n";
+
+    // Setup data structures
+    g << "d.prob = &p;\n";
+    g << "casadi_ipqp_init(&d, &iw, &w);\n";
+    g << "d_ric.prob = &p_ric;\n";
+    g << "casadi_riqp_init(&d_ric, &w);\n";
+    g << "d.g = " << g.arg(CONIC_G) << ";\n";
+
+    g.comment("Pass bounds on z");
+    g.copy_default(g.arg(CONIC_LBX), nx_, "d.lbz", "-casadi_inf", false);
+    g.copy_default(g.arg(CONIC_LBA), na_, "d.lbz+" + str(nx_), "-casadi_inf", false);
+    g.copy_default(g.arg(CONIC_UBX), nx_, "d.ubz", "casadi_inf", false);
+    g.copy_default(g.arg(CONIC_UBA), na_, "d.ubz+" + str(nx_), "casadi_inf", false);
+
+    g.comment("Pass initial guess");
+    g << "casadi_ipqp_guess(&d, " << g.arg(CONIC_X0) << ", "
+      << g.arg(CONIC_LAM_X0) << ", " << g.arg(CONIC_LAM_A0) << ");\n";
+
+    g.comment("Solve QP");
+    g << "while (casadi_ipqp(&d)) {\n";
+    g << "switch (d.task) {\n";
+    g << "case IPQP_MV:\n";
+    g << g.mv(g.arg(CONIC_H), H_, "d.z", "d.rz", false) << "\n";
+    g << g.mv(g.arg(CONIC_A), A_, "d.lam+" + str(nx_), "d.rz", true) << "\n";
+    g << g.mv(g.arg(CONIC_A), A_, "d.z", "d.rz+" + str(nx_), false) << "\n";
+    g << "break;\n";
+    g << "case IPQP_PROGRESS:\n";
+    if (print_iter_) {
+      g << "if (d.iter % 10 == 0) {\n";
+      g << "if (casadi_ipqp_print_header(&d, buf, sizeof(buf))) break;\n";
+      g << g.printf("%s\\n", "buf") << "\n";
+      g << "}\n";
+      g << "if (casadi_ipqp_print_iteration(&d, buf, sizeof(buf))) break;\n";
+      g << g.printf("%s\\n", "buf") << "\n";
+    }
+    g << "break;\n";
+    g << "case IPQP_FACTOR:\n";
+    g << "if (casadi_riqp_factor(&d_ric, " << g.arg(CONIC_H) << ", " << g.arg(CONIC_A)
+      << ", d.S, d.D)) d.status = IPQP_FACTOR_ERROR;\n";
+    g << "break;\n";
+    g << "case IPQP_SOLVE:\n";
+    g << "casadi_riqp_solve(&d_ric, d.S, d.D, d.linsys);\n";
+    g << "break;\n";
+    g << "}\n";
+    g << "}\n";
+
+    g.comment("Get solution");
+    g << "casadi_ipqp_solution(&d, " << g.res(CONIC_X) << ", "
+      << g.res(CONIC_LAM_X) << ", " << g.res(CONIC_LAM_A) << ");\n";
+    g << "if (" << g.res(CONIC_COST) << ") {\n";
+    g << g.res(CONIC_COST) << "[0] = 0.5*" << g.bilin(g.arg(CONIC_H), H_, "d.z", "d.z")
+      << "+" << g.dot(nx_, "d.z", "d.g") << ";\n";
+    g << "}\n";
+
+    g << "if (d.status == IPQP_SUCCESS) {\n";
+    g << "return 0;\n";
+    g << "} else {\n";
+    if (error_on_fail_) {
+      g << "return -1000;\n";
+    } else {
+      g << "return -1;\n";
+    }
+    g << "}\n";
+  }
+
+  Riqp::Riqp(DeserializingStream& s) : Conic(s) {
+    s.version("Riqp", 1);
+    s.unpack("Riqp::N", N_);
+    s.unpack("Riqp::nxs", nxs_);
+    s.unpack("Riqp::nus", nus_);
+    s.unpack("Riqp::ngs", ngs_);
+    s.unpack("Riqp::off_z", off_z_);
+    s.unpack("Riqp::off_a", off_a_);
+    s.unpack("Riqp::print_iter", print_iter_);
+    s.unpack("Riqp::print_header", print_header_);
+    s.unpack("Riqp::print_info", print_info_);
+    set_riqp_prob();
+    s.unpack("Riqp::max_iter", p_.max_iter);
+    s.unpack("Riqp::pr_tol", p_.pr_tol);
+    s.unpack("Riqp::du_tol", p_.du_tol);
+    s.unpack("Riqp::co_tol", p_.co_tol);
+    s.unpack("Riqp::mu_tol", p_.mu_tol);
+    s.unpack("Riqp::reg", p_ric_.reg);
+  }
+
+  void Riqp::serialize_body(SerializingStream &s) const {
+    Conic::serialize_body(s);
+
+    s.version("Riqp", 1);
+    s.pack("Riqp::N", N_);
+    s.pack("Riqp::nxs", nxs_);
+    s.pack("Riqp::nus", nus_);
+    s.pack("Riqp::ngs", ngs_);
+    s.pack("Riqp::off_z", off_z_);
+    s.pack("Riqp::off_a", off_a_);
+    s.pack("Riqp::print_iter", print_iter_);
+    s.pack("Riqp::print_header", print_header_);
+    s.pack("Riqp::print_info", print_info_);
+    s.pack("Riqp::max_iter", p_.max_iter);
+    s.pack("Riqp::pr_tol", p_.pr_tol);
+    s.pack("Riqp::du_tol", p_.du_tol);
+    s.pack("Riqp::co_tol", p_.co_tol);
+    s.pack("Riqp::mu_tol", p_.mu_tol);
+    s.pack("Riqp::reg", p_ric_.reg);
+  }
+
+} // namespace casadi
@@ -0,0 +1,138 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifndef CASADI_RIQP_HPP
+#define CASADI_RIQP_HPP
+
+#include "casadi/core/conic_impl.hpp"
+#include <casadi/solvers/casadi_conic_riqp_export.h>
+
+/** \defgroup plugin_Conic_riqp Title
+    \par
+
+ Solves QPs with the stage structure of an optimal control problem using the
+ Mehrotra predictor-corrector interior point method of ipqp, with the linear
+ systems solved by a Riccati recursion. The cost is linear in the horizon N.
+
+ The variables are ordered by stage, [x_0; u_0; x_1; u_1; ...; x_N; u_N],
+ and the constraints as [dynamics_0; general_0; dynamics_1; ...; general_N].
+ The dynamics of stage k, A_k*x_k + B_k*u_k + E_k*x_{k+1}, with E_k diagonal,
+ must be equality constraints. The Hessian must be block diagonal with the stages.
+ */
+
+/** \pluginsection{Conic,riqp} */
+
+/// \cond INTERNAL
+namespace casadi {
+  struct CASADI_CONIC_RIQP_EXPORT RiqpMemory : public ConicMemory {
+    const char* return_status;
+  };
+
+  /** \brief \pluginbrief{Conic,riqp}
+
+      @copydoc Conic_doc
+      @copydoc plugin_Conic_riqp
+  */
+  class CASADI_CONIC_RIQP_EXPORT Riqp : public Conic {
+  public:
+    /** \brief  Create a new Solver */
+    explicit Riqp(const std::string& name,
+                  const std::map<std::string, Sparsity> &st);
+
+    /** \brief  Create a new QP Solver */
+    static Conic* creator(const std::string& name,
+                          const std::map<std::string, Sparsity>& st) {
+      return new Riqp(name, st);
+    }
+
+    /** \brief  Destructor */
+    ~Riqp() override;
+
+    // Get name of the plugin
+    const char* plugin_name() const override { return "riqp";}
+
+    // Get name of the class
+    std::string class_name() const override { return "Riqp";}
+
+    /** \brief Create memory block */
+    void* alloc_mem() const override { return new RiqpMemory();}
+
+    /** \brief Initalize memory block */
+    int init_mem(void* mem) const override;
+
+    /** \brief Free memory block */
+    void free_mem(void *mem) const override { delete static_cast<RiqpMemory*>(mem);}
+
+    ///@{
+    /** \brief Options */
+    static const Options options_;
+    const Options& get_options() const override { return options_;}
+    ///@}
+
+    /** \brief Initialize */
+    void init(const Dict& opts) override;
+
+    /** \brief Solve the QP */
+    int solve(const double** arg, double** res,
+             casadi_int* iw, double* w, void* mem) const override;
+
+    /// Get all statistics
+    Dict get_stats(void* mem) const override;
+
+    /** \brief Generate code for the function body */
+    void codegen_body(CodeGenerator& g) const override;
+
+    /// A documentation string
+    static const std::string meta_doc;
+    // Memory structures
+    casadi_ipqp_prob<double> p_;
+    casadi_riqp_prob<double> p_ric_;
+    // Horizon
+    casadi_int N_;
+    // Stage dimensions
+    std::vector<casadi_int> nxs_, nus_, ngs_;
+    // Offsets of the stages in the variables and in the constraints
+    std::vector<casadi_int> off_z_, off_a_;
+    ///@{
+    // Options
+    bool print_iter_, print_header_, print_info_;
+    ///@}
+
+    void serialize_body(SerializingStream &s) const override;
+
+    /** \brief Deserialize with type disambiguation */
+    static ProtoFunction* deserialize(DeserializingStream& s) { return new Riqp(s); }
+
+  protected:
+     /** \brief Deserializing constructor */
+    explicit Riqp(DeserializingStream& s);
+
+  private:
+    void set_riqp_prob();
+  };
+
+} // namespace casadi
+/// \endcond
+#endif // CASADI_RIQP_HPP
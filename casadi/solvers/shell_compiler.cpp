@@ -27,6 +27,7 @@
 #include "casadi/core/casadi_misc.hpp"
 #include "casadi/core/casadi_meta.hpp"
 #include "casadi/core/casadi_logger.hpp"
+#include "casadi/core/thread_pool.hpp"
 #include <fstream>
 
 // Set default object file suffix
@@ -65,6 +66,9 @@ namespace casadi {
     if (cleanup_) {
       if (remove(bin_name_.c_str())) casadi_warning("Failed to remove " + bin_name_);
       if (remove(obj_name_.c_str())) casadi_warning("Failed to remove " + obj_name_);
+      for (const std::string& s : extra_obj_names_) {
+        if (remove(s.c_str())) casadi_warning("Failed to remove " + s);
+      }
       for (const std::string& s : extra_suffixes_) {
         std::string name = base_name_+s;
         remove(name.c_str());
@@ -125,6 +129,14 @@ namespace casadi {
         "This is desired for thread-safety. "
         "This behaviour may defeat caching compiler wrappers. "
         "Default: true"}},
+      {"extra_sources",
+       {OT_STRINGVECTOR,
+        "Additional source files, compiled separately and linked into the same library. "
+        "Default: None"}},
+      {"jobs",
+       {OT_INT,
+        "Maximum number of source files compiled concurrently. "
+        "Default: number of hardware threads"}},
      }
   };
 
@@ -141,6 +153,8 @@ namespace casadi {
 
     std::vector<std::string> compiler_flags;
     std::vector<std::string> linker_flags;
+    std::vector<std::string> extra_sources;
+    casadi_int jobs = ThreadPool::max_num_threads();
     std::string suffix = OBJECT_FILE_SUFFIX;
 
 #ifdef _WIN32
@@ -188,6 +202,10 @@ namespace casadi {
         bare_name = op.second.to_string();
       } else if (op.first=="temp_suffix") {
         temp_suffix = op.second;
+      } else if (op.first=="extra_sources") {
+        extra_sources = op.second;
+      } else if (op.first=="jobs") {
+        jobs = op.second;
       }
     }
 
@@ -211,32 +229,50 @@ namespace casadi {
     }
 #endif // _WIN32
 
-    // Construct the compiler command
-    std::stringstream cccmd;
-    cccmd << compiler;
-    for (auto i=compiler_flags.begin(); i!=compiler_flags.end(); ++i) {
-      cccmd << " " << *i;
+    // Object files of additional sources
+    for (casadi_int i=0; i<extra_sources.size(); ++i) {
+      extra_obj_names_.push_back(base_name_ + "_" + str(i+1) + suffix);
     }
-    cccmd << " " << compiler_setup;
 
-    // C/C++ source file
-    cccmd << " " << name_;
+    // Construct the compiler commands
+    std::vector<std::string> sources = {name_}, objects = {obj_name_};
+    sources.insert(sources.end(), extra_sources.begin(), extra_sources.end());
+    objects.insert(objects.end(), extra_obj_names_.begin(), extra_obj_names_.end());
+    std::vector<std::string> cccmd(sources.size());
+    for (casadi_int i=0; i<sources.size(); ++i) {
+      std::stringstream ss;
+      ss << compiler;
+      for (auto j=compiler_flags.begin(); j!=compiler_flags.end(); ++j) {
+        ss << " " << *j;
+      }
+      ss << " " << compiler_setup;
 
-    // Temporary object file
-    cccmd << " " + compiler_output_flag << obj_name_;
+      // C/C++ source file
+      ss << " " << sources[i];
+
+      // Temporary object file
+      ss << " " + compiler_output_flag << objects[i];
+      cccmd[i] = ss.str();
+    }
 
-    // Compile into an object
-    if (verbose_) casadi_message("calling \"" + cccmd.str() + "\"");
-    if (system(cccmd.str().c_str())) {
-      casadi_error("Compilation failed. Tried \"" + cccmd.str() + "\"");
+    // Compile into objects, concurrently if several
+    if (verbose_) {
+      for (const std::string& c : cccmd) casadi_message("calling \"" + c + "\"");
     }
+    ThreadPool::run(cccmd.size(), std::max(jobs, casadi_int(1)),
+      [&](casadi_int i, casadi_int thread) {
+        if (system(cccmd[i].c_str())) {
+          casadi_error("Compilation failed. Tried \"" + cccmd[i] + "\"");
+        }
+      });
 
     // Link step
     std::stringstream ldcmd;
     ldcmd << linker;
 
-    // Temporary file
-    ldcmd << " " << obj_name_ << " " + linker_output_flag + bin_name_;
+    // Temporary files
+    for (const std::string& o : objects) ldcmd << " " << o;
+    ldcmd << " " + linker_output_flag + bin_name_;
 
     // Add flags
     for (auto i=linker_flags.begin(); i!=linker_flags.end(); ++i) {
@@ -73,7 +73,10 @@ const Options Sqpmethod::options_
       "Options to be passed to the QP solver"}},
     {"hessian_approximation",
       {OT_STRING,
-      "limited-memory|exact"}},
+      "limited-memory|limited-memory-compact|exact. "
+      "limited-memory-compact keeps lbfgs_memory pairs of steps and gradient differences "
+      "instead of a Hessian with the sparsity of the exact one, and adds lbfgs_memory "
+      "variables and equality constraints to the QP"}},
     {"max_iter",
       {OT_INT,
       "Maximum number of SQP iterations"}},
@@ -100,7 +103,8 @@ const Options Sqpmethod::options_
       "Size of memory to store history of merit function values"}},
     {"lbfgs_memory",
       {OT_INT,
-      "Size of L-BFGS memory."}},
+      "Size of L-BFGS memory: number of iterations between resets of the off-diagonal "
+      "entries, or number of stored pairs for limited-memory-compact."}},
     {"print_header",
       {OT_BOOL,
       "Print the header with problem statistics"}},
@@ -263,6 +267,12 @@ void Sqpmethod::init(const Dict& opts) {
 
   // Use exact Hessian?
   exact_hessian_ = hessian_approximation =="exact";
+  lbfgs_compact_ = hessian_approximation =="limited-memory-compact";
+  casadi_assert(exact_hessian_ || lbfgs_compact_ || hessian_approximation=="limited-memory",
+    "Unknown Hessian approximation '" + hessian_approximation + "'");
+  casadi_assert(exact_hessian_ || lbfgs_memory_>0, "'lbfgs_memory' must be positive");
+  casadi_assert(!lbfgs_compact_ || !elastic_mode_,
+    "Elastic mode is not supported with hessian_approximation 'limited-memory-compact'");
 
   convexify_ = false;
 
@@ -292,12 +302,19 @@ void Sqpmethod::init(const Dict& opts) {
       opts["verbose"] = verbose_;
       Hsp_ = Convexify::setup(convexify_data_, Hsp_, opts);
     }
+  } else if (lbfgs_compact_) {
+    // QP in (dx, z), z = C'*dx, with the Hessian [sqrt(delta)*I, P]'*[sqrt(delta)*I, P]
+    casadi_int nl = lbfgs_memory_;
+    Hsp_ = Sparsity::blockcat({{Sparsity::diag(nx_), Sparsity::dense(nx_, nl)},
+                               {Sparsity::dense(nl, nx_), Sparsity::dense(nl, nl)}});
+    Asp_qp_ = Sparsity::blockcat({{Asp_, Sparsity(ng_, nl)},
+                                  {Sparsity::dense(nl, nx_), Sparsity::diag(nl)}});
   } else {
     Hsp_ = Sparsity::dense(nx_, nx_);
   }
 
   casadi_assert(!qpsol_plugin.empty(), "'qpsol' option has not been set");
-  qpsol_ = conic("qpsol", qpsol_plugin, {{"h", Hsp_}, {"a", Asp_}},
+  qpsol_ = conic("qpsol", qpsol_plugin, {{"h", Hsp_}, {"a", lbfgs_compact_ ? Asp_qp_ : Asp_}},
                   qpsol_options);
   alloc(qpsol_);
 
@@ -324,7 +341,9 @@ void Sqpmethod::init(const Dict& opts) {
 
 
   // BFGS?
-  if (!exact_hessian_) {
+  if (lbfgs_compact_) {
+    alloc_w(3*nx_); // casadi_lbfgs_update
+  } else if (!exact_hessian_) {
     alloc_w(2*nx_); // casadi_bfgs
   }
 
@@ -334,6 +353,9 @@ void Sqpmethod::init(const Dict& opts) {
     print("This is casadi::Sqpmethod.\n");
     if (exact_hessian_) {
       print("Using exact Hessian\n");
+    } else if (lbfgs_compact_) {
+      print("Using compact limited memory BFGS Hessian approximation, %d pairs\n",
+        lbfgs_memory_);
     } else {
       print("Using limited memory BFGS Hessian approximation\n");
     }
@@ -362,6 +384,7 @@ void Sqpmethod::set_sqpmethod_prob() {
   p_.sp_a = Asp_;
   p_.merit_memsize = merit_memsize_;
   p_.max_iter_ls = max_iter_ls_;
+  p_.lbfgs_memory = lbfgs_compact_ ? lbfgs_memory_ : 0;
   p_.nlp = &p_nlp_;
 }
 
@@ -522,6 +545,24 @@ int Sqpmethod::solve(void* mem) const {
         ScopedTiming tic(m->fstats.at("convexify"));
         if (convexify_eval(&convexify_data_.config, d->Bk, d->Bk, m->iw, m->w)) return 1;
       }
+    } else if (lbfgs_compact_) {
+      ScopedTiming tic(m->fstats.at("BFGS"));
+      if (m->iter_count==0) {
+        // Initialize L-BFGS, B = I
+        d->lbfgs_n = 0;
+        d->lbfgs_delta = 1;
+        casadi_clear(d->lbfgs_p, nx_*lbfgs_memory_);
+        casadi_clear(d->lbfgs_c, nx_*lbfgs_memory_);
+      } else {
+        // Store the last step and rebuild the factor, skip a rejected pair
+        if (casadi_lbfgs_update(nx_, lbfgs_memory_, &d->lbfgs_n, d->lbfgs_s, d->lbfgs_y,
+            &d->lbfgs_delta, d->lbfgs_p, d->lbfgs_c, d->dx, d->gLag, d->gLag_old, m->w)) {
+          if (print_status_) print("WARNING(sqpmethod): L-BFGS pair rejected, keeping the "
+            "current approximation\n");
+        }
+      }
+      // Hessian of the lifted QP
+      casadi_lbfgs_qp_h(nx_, lbfgs_memory_, d->lbfgs_p, d->lbfgs_delta, d->Bk);
     } else if (m->iter_count==0) {
       ScopedTiming tic(m->fstats.at("BFGS"));
       // Initialize BFGS
@@ -585,10 +626,12 @@ int Sqpmethod::solve(void* mem) const {
       }
     }
 
-    // Detecting indefiniteness
-    double gain = casadi_bilin(d->Bk, Hsp_, d->dx, d->dx);
-    if (gain < 0) {
-      if (print_status_) print("WARNING(sqpmethod): Indefinite Hessian detected\n");
+    // Detecting indefiniteness, the compact L-BFGS approximation is positive definite
+    if (!lbfgs_compact_) {
+      double gain = casadi_bilin(d->Bk, Hsp_, d->dx, d->dx);
+      if (gain < 0) {
+        if (print_status_) print("WARNING(sqpmethod): Indefinite Hessian detected\n");
+      }
     }
 
     // Pre calculatations for second order corrections and linesearch
@@ -846,24 +889,50 @@ int Sqpmethod::solve_QP(SqpmethodMemory* m, const double* H, const double* g,
     const double* lbdz, const double* ubdz, const double* A,
     double* x_opt, double* dlam, int mode) const {
   ScopedTiming tic(m->fstats.at("QP"));
+  auto d = &m->d;
+  // Number of variables of the QP
+  casadi_int nx_qp = nx_;
+  // Outputs, for a lifted QP
+  double *x_opt_qp = x_opt, *dlam_qp = dlam;
+  if (lbfgs_compact_) {
+    // Lifted QP in (dx, z), z = C'*dx
+    casadi_int nl = lbfgs_memory_;
+    nx_qp += nl;
+    casadi_lbfgs_qp_a(Asp_, nl, A, d->lbfgs_c, d->qp_a);
+    casadi_copy(g, nx_, d->qp_g);
+    casadi_clear(d->qp_g + nx_, nl);
+    casadi_lbfgs_qp_lift(nx_, ng_, nl, lbdz, -inf, 0., d->qp_lbz);
+    casadi_lbfgs_qp_lift(nx_, ng_, nl, ubdz, inf, 0., d->qp_ubz);
+    casadi_lbfgs_qp_lift(nx_, ng_, nl, dlam, 0., 0., d->qp_lam);
+    casadi_copy(x_opt, nx_, d->qp_x);
+    casadi_clear(d->qp_x + nx_, nl);
+    casadi_mv_dense(d->lbfgs_c, nx_, nl, x_opt, d->qp_x + nx_, true);
+    g = d->qp_g;
+    lbdz = d->qp_lbz;
+    ubdz = d->qp_ubz;
+    A = d->qp_a;
+    x_opt_qp = d->qp_x;
+    dlam_qp = d->qp_lam;
+  }
+
   // Inputs
   std::fill_n(m->arg, qpsol_.n_in(), nullptr);
   m->arg[CONIC_H] = H;
   m->arg[CONIC_G] = g;
-  m->arg[CONIC_X0] = x_opt;
-  m->arg[CONIC_LAM_X0] = dlam;
-  m->arg[CONIC_LAM_A0] = dlam + nx_;
+  m->arg[CONIC_X0] = x_opt_qp;
+  m->arg[CONIC_LAM_X0] = dlam_qp;
+  m->arg[CONIC_LAM_A0] = dlam_qp + nx_qp;
   m->arg[CONIC_LBX] = lbdz;
   m->arg[CONIC_UBX] = ubdz;
   m->arg[CONIC_A] = A;
-  m->arg[CONIC_LBA] = lbdz+nx_;
-  m->arg[CONIC_UBA] = ubdz+nx_;
+  m->arg[CONIC_LBA] = lbdz+nx_qp;
+  m->arg[CONIC_UBA] = ubdz+nx_qp;
 
   // Outputs
   std::fill_n(m->res, qpsol_.n_out(), nullptr);
-  m->res[CONIC_X] = x_opt;
-  m->res[CONIC_LAM_X] = dlam;
-  m->res[CONIC_LAM_A] = dlam + nx_;
+  m->res[CONIC_X] = x_opt_qp;
+  m->res[CONIC_LAM_X] = dlam_qp;
+  m->res[CONIC_LAM_A] = dlam_qp + nx_qp;
   double cost;
   m->res[CONIC_COST] = &cost;
 
@@ -871,6 +940,12 @@ int Sqpmethod::solve_QP(SqpmethodMemory* m, const double* H, const double* g,
   qpsol_(m->arg, m->res, m->iw, m->w, m->mem_qp);
   auto m_qpsol = static_cast<ConicMemory*>(qpsol_->memory(m->mem_qp));
 
+  // Solution of the lifted QP
+  if (lbfgs_compact_) {
+    casadi_copy(d->qp_x, nx_, x_opt);
+    casadi_lbfgs_qp_unlift(nx_, ng_, lbfgs_memory_, d->qp_lam, dlam);
+  }
+
   // Check if the QP was infeasible for elastic mode
   if (!m_qpsol->d_qp.success) {
     if ((elastic_mode_ && m_qpsol->d_qp.unified_return_status == SOLVER_RET_INFEASIBLE)
@@ -1031,7 +1106,12 @@ void Sqpmethod::codegen_declarations(CodeGenerator& g) const {
     g.add_dependency(get_function("nlp_grad"));
   g.add_dependency(qpsol_);
   if (elastic_mode_) g.add_dependency(qpsol_ela_);
-  if (!exact_hessian_) g.add_auxiliary(CodeGenerator::AUX_BFGS);
+  if (lbfgs_compact_) {
+    g.add_auxiliary(CodeGenerator::AUX_LBFGS);
+    g.add_auxiliary(CodeGenerator::AUX_MV_DENSE);
+  } else if (!exact_hessian_) {
+    g.add_auxiliary(CodeGenerator::AUX_BFGS);
+  }
 }
 
 void Sqpmethod::codegen_body(CodeGenerator& g) const {
@@ -1048,6 +1128,7 @@ void Sqpmethod::codegen_body(CodeGenerator& g) const {
   g << "p.sp_a = " << g.sparsity(Asp_) << ";\n";
   g << "p.merit_memsize = " << merit_memsize_ << ";\n";
   g << "p.max_iter_ls = " << max_iter_ls_ << ";\n";
+  g << "p.lbfgs_memory = " << p_.lbfgs_memory << ";\n";
   g << "p.nlp = &p_nlp;\n";
   g << "casadi_sqpmethod_init(d, &arg, &res, &iw, &w, "
     << elastic_mode_ << ", " << so_corr_ << ");\n";
@@ -1127,6 +1208,27 @@ void Sqpmethod::codegen_body(CodeGenerator& g) const {
       std::string ret = g.convexify_eval(convexify_data_, "d->Bk", "d->Bk", "d->iw", "d->w");
       g << "if (" << ret << ") return 1;\n";
     }
+  } else if (lbfgs_compact_) {
+    g << "if (iter_count==0) {\n";
+    g.comment("Initialize L-BFGS, B = I");
+    g << "d->lbfgs_n = 0;\n";
+    g << "d->lbfgs_delta = 1;\n";
+    g << g.clear("d->lbfgs_p", nx_*lbfgs_memory_) << "\n";
+    g << g.clear("d->lbfgs_c", nx_*lbfgs_memory_) << "\n";
+    g << "} else {\n";
+    g.comment("Store the last step and rebuild the factor, skip a rejected pair");
+    g << "if (casadi_lbfgs_update(" << nx_ << ", " << lbfgs_memory_ << ", &d->lbfgs_n, "
+      << "d->lbfgs_s, d->lbfgs_y, &d->lbfgs_delta, d->lbfgs_p, d->lbfgs_c, "
+      << "d->dx, d->gLag, d->gLag_old, d->w)) {\n";
+    if (print_status_) {
+      g << g.printf("WARNING(sqpmethod): L-BFGS pair rejected, keeping the "
+                    "current approximation\\n") << "\n";
+    }
+    g << "}\n";
+    g << "}\n";
+    g.comment("Hessian of the lifted QP");
+    g << "casadi_lbfgs_qp_h(" << nx_ << ", " << lbfgs_memory_
+      << ", d->lbfgs_p, d->lbfgs_delta, d->Bk);\n";
   } else {
     g << "if (iter_count==0) {\n";
     g.comment("Initialize BFGS");
@@ -1411,24 +1513,55 @@ void Sqpmethod::codegen_body(CodeGenerator& g) const {
 void Sqpmethod::codegen_qp_solve(CodeGenerator& cg, const std::string&  H, const std::string& g,
     const std::string&  lbdz, const std::string& ubdz,
     const std::string&  A, const std::string& x_opt, const std::string&  dlam, int mode) const {
+  if (lbfgs_compact_) {
+    cg.comment("Lifted QP in (dx, z), z = C'*dx");
+    casadi_int nl = lbfgs_memory_;
+    cg << "casadi_lbfgs_qp_a(" << cg.sparsity(Asp_) << ", " << nl << ", " << A
+       << ", d->lbfgs_c, d->qp_a);\n";
+    cg << cg.copy(g, nx_, "d->qp_g") << "\n";
+    cg << cg.clear("d->qp_g+" + str(nx_), nl) << "\n";
+    cg << "casadi_lbfgs_qp_lift(" << nx_ << ", " << ng_ << ", " << nl << ", " << lbdz << ", "
+       << cg.constant(-inf) << ", 0., d->qp_lbz);\n";
+    cg << "casadi_lbfgs_qp_lift(" << nx_ << ", " << ng_ << ", " << nl << ", " << ubdz << ", "
+       << cg.constant(inf) << ", 0., d->qp_ubz);\n";
+    cg << "casadi_lbfgs_qp_lift(" << nx_ << ", " << ng_ << ", " << nl << ", " << dlam
+       << ", 0., 0., d->qp_lam);\n";
+    cg << cg.copy(x_opt, nx_, "d->qp_x") << "\n";
+    cg << cg.clear("d->qp_x+" + str(nx_), nl) << "\n";
+    cg << "casadi_mv_dense(d->lbfgs_c, " << nx_ << ", " << nl << ", " << x_opt
+       << ", d->qp_x+" << nx_ << ", 1);\n";
+  }
+  casadi_int nx_qp = lbfgs_compact_ ? nx_ + lbfgs_memory_ : nx_;
+  std::string g_qp = lbfgs_compact_ ? "d->qp_g" : g;
+  std::string lbdz_qp = lbfgs_compact_ ? "d->qp_lbz" : lbdz;
+  std::string ubdz_qp = lbfgs_compact_ ? "d->qp_ubz" : ubdz;
+  std::string A_qp = lbfgs_compact_ ? "d->qp_a" : A;
+  std::string x_opt_qp = lbfgs_compact_ ? "d->qp_x" : x_opt;
+  std::string dlam_qp = lbfgs_compact_ ? "d->qp_lam" : dlam;
   for (casadi_int i=0;i<qpsol_.n_in();++i) cg << "d->arg[" << i << "] = 0;\n";
   cg << "d->arg[" << CONIC_H << "] = " << H << ";\n";
-  cg << "d->arg[" << CONIC_G << "] = " << g << ";\n";
-  cg << "d->arg[" << CONIC_X0 << "] = " << x_opt << ";\n";
-  cg << "d->arg[" << CONIC_LAM_X0 << "] = " << dlam << ";\n";
-  cg << "d->arg[" << CONIC_LAM_A0 << "] = " << dlam << "+" << nx_ << ";\n";
-  cg << "d->arg[" << CONIC_LBX << "] = " << lbdz << ";\n";
-  cg << "d->arg[" << CONIC_UBX << "] = " << ubdz << ";\n";
-  cg << "d->arg[" << CONIC_A << "] = " << A << ";\n";
-  cg << "d->arg[" << CONIC_LBA << "] = " << lbdz << "+" << nx_ << ";\n";
-  cg << "d->arg[" << CONIC_UBA << "] = " << ubdz << "+" << nx_ << ";\n";
+  cg << "d->arg[" << CONIC_G << "] = " << g_qp << ";\n";
+  cg << "d->arg[" << CONIC_X0 << "] = " << x_opt_qp << ";\n";
+  cg << "d->arg[" << CONIC_LAM_X0 << "] = " << dlam_qp << ";\n";
+  cg << "d->arg[" << CONIC_LAM_A0 << "] = " << dlam_qp << "+" << nx_qp << ";\n";
+  cg << "d->arg[" << CONIC_LBX << "] = " << lbdz_qp << ";\n";
+  cg << "d->arg[" << CONIC_UBX << "] = " << ubdz_qp << ";\n";
+  cg << "d->arg[" << CONIC_A << "] = " << A_qp << ";\n";
+  cg << "d->arg[" << CONIC_LBA << "] = " << lbdz_qp << "+" << nx_qp << ";\n";
+  cg << "d->arg[" << CONIC_UBA << "] = " << ubdz_qp << "+" << nx_qp << ";\n";
   for (casadi_int i=0;i<qpsol_.n_out();++i) cg << "d->res[" << i << "] = 0;\n";
-  cg << "d->res[" << CONIC_X << "] = " << x_opt << ";\n";
-  cg << "d->res[" << CONIC_LAM_X << "] = " << dlam << ";\n";
-  cg << "d->res[" << CONIC_LAM_A << "] = " << dlam << "+" << nx_ << ";\n";
+  cg << "d->res[" << CONIC_X << "] = " << x_opt_qp << ";\n";
+  cg << "d->res[" << CONIC_LAM_X << "] = " << dlam_qp << ";\n";
+  cg << "d->res[" << CONIC_LAM_A << "] = " << dlam_qp << "+" << nx_qp << ";\n";
   std::string flag = cg(qpsol_, "d->arg", "d->res", "d->iw", "d->w");
   cg << "ret = " << flag << ";\n";
   cg << "if (ret == -1000) return -1000;\n"; // equivalent to raise Exception
+  if (lbfgs_compact_) {
+    cg.comment("Solution of the lifted QP");
+    cg << cg.copy("d->qp_x", nx_, x_opt) << "\n";
+    cg << "casadi_lbfgs_qp_unlift(" << nx_ << ", " << ng_ << ", " << lbfgs_memory_
+       << ", d->qp_lam, " << dlam << ");\n";
+  }
 }
 
 void Sqpmethod::codegen_qp_ela_solve(CodeGenerator& cg, const std::string&  H,
@@ -1537,7 +1670,7 @@ Dict Sqpmethod::get_stats(void* mem) const {
 }
 
 Sqpmethod::Sqpmethod(DeserializingStream& s) : Nlpsol(s) {
-  int version = s.version("Sqpmethod", 1, 3);
+  int version = s.version("Sqpmethod", 1, 4);
   s.unpack("Sqpmethod::qpsol", qpsol_);
   if (version>=3) {
     s.unpack("Sqpmethod::qpsol_ela", qpsol_ela_);
@@ -1546,6 +1679,11 @@ Sqpmethod::Sqpmethod(DeserializingStream& s) : Nlpsol(s) {
   s.unpack("Sqpmethod::max_iter", max_iter_);
   s.unpack("Sqpmethod::min_iter", min_iter_);
   s.unpack("Sqpmethod::lbfgs_memory", lbfgs_memory_);
+  if (version>=4) {
+    s.unpack("Sqpmethod::lbfgs_compact", lbfgs_compact_);
+  } else {
+    lbfgs_compact_ = false;
+  }
   s.unpack("Sqpmethod::tol_pr_", tol_pr_);
   s.unpack("Sqpmethod::tol_du_", tol_du_);
   s.unpack("Sqpmethod::min_step_size_", min_step_size_);
@@ -1580,6 +1718,7 @@ Sqpmethod::Sqpmethod(DeserializingStream& s) : Nlpsol(s) {
     s.unpack("Sqpmethod::Hrsp", Hrsp);
   }
   s.unpack("Sqpmethod::Asp", Asp_);
+  if (version>=4) s.unpack("Sqpmethod::Asp_qp", Asp_qp_);
   if (version==1) {
     double convexify_margin;
     s.unpack("Sqpmethod::convexify_margin", convexify_margin);
@@ -1611,13 +1750,14 @@ Sqpmethod::Sqpmethod(DeserializingStream& s) : Nlpsol(s) {
 
 void Sqpmethod::serialize_body(SerializingStream &s) const {
   Nlpsol::serialize_body(s);
-  s.version("Sqpmethod", 3);
+  s.version("Sqpmethod", 4);
   s.pack("Sqpmethod::qpsol", qpsol_);
   s.pack("Sqpmethod::qpsol_ela", qpsol_ela_);
   s.pack("Sqpmethod::exact_hessian", exact_hessian_);
   s.pack("Sqpmethod::max_iter", max_iter_);
   s.pack("Sqpmethod::min_iter", min_iter_);
   s.pack("Sqpmethod::lbfgs_memory", lbfgs_memory_);
+  s.pack("Sqpmethod::lbfgs_compact", lbfgs_compact_);
   s.pack("Sqpmethod::tol_pr_", tol_pr_);
   s.pack("Sqpmethod::tol_du_", tol_du_);
   s.pack("Sqpmethod::min_step_size_", min_step_size_);
@@ -1640,6 +1780,7 @@ void Sqpmethod::serialize_body(SerializingStream &s) const {
 
   s.pack("Sqpmethod::Hsp", Hsp_);
   s.pack("Sqpmethod::Asp", Asp_);
+  s.pack("Sqpmethod::Asp_qp", Asp_qp_);
   s.pack("Sqpmethod::convexify", convexify_);
   if (convexify_) Convexify::serialize(s, "Sqpmethod::", convexify_data_);
 }
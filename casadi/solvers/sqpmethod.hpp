@@ -130,6 +130,9 @@ namespace casadi {
     /// Memory size of L-BFGS method
     casadi_int lbfgs_memory_;
 
+    /// Compact L-BFGS, with the QP lifted by the factor of the Hessian approximation
+    bool lbfgs_compact_;
+
     /// Tolerance of primal and dual infeasibility
     double tol_pr_, tol_du_;
 
@@ -162,6 +165,9 @@ namespace casadi {
     // Jacobian sparsity
     Sparsity Asp_;
 
+    // Jacobian sparsity of the QP, if lifted
+    Sparsity Asp_qp_;
+
     /// Data for convexification
     ConvexifyData convexify_data_;
 
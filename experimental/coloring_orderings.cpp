@@ -0,0 +1,91 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for the orderings preceding a star coloring.
+// For each pattern, reports the number of colors and the runtime of star_coloring and
+// star_coloring2 with every ordering. Rectangular (Jacobian) patterns J are replaced by
+// the pattern of J'*J, nonsymmetric square patterns A by that of A+A'.
+// Usage: coloring_orderings [file.mtx ...], e.g. test/data/apoa1-2.mtx
+
+// Pattern of a Hessian of a multiple shooting discretization: dense blocks on a chain
+Sparsity shooting_hessian(casadi_int n_block, casadi_int block_size) {
+  std::vector<Sparsity> blocks(n_block, Sparsity::dense(block_size, block_size));
+  Sparsity H = diagcat(blocks);
+  Sparsity coupling = Sparsity::band(n_block*block_size, block_size);
+  return H + coupling + coupling.T();
+}
+
+// Pattern of a 2D Laplacian on an n-by-n grid
+Sparsity laplacian2d(casadi_int n) {
+  Sparsity T = Sparsity::banded(n, 1);
+  return kron(T, Sparsity::diag(n)) + kron(Sparsity::diag(n), T);
+}
+
+// Symmetric pattern whose star coloring corresponds to the given pattern
+Sparsity symmetric_pattern(const Sparsity& sp) {
+  if (!sp.is_square()) return mtimes(sp.T(), sp);
+  if (!sp.is_symmetric()) return sp + sp.T();
+  return sp;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<std::pair<std::string, Sparsity> > patterns;
+  patterns.emplace_back("shooting_hessian", shooting_hessian(200, 12));
+  patterns.emplace_back("laplacian2d", laplacian2d(100));
+  patterns.emplace_back("arrowhead", Sparsity::diag(2000) + Sparsity::triplet(2000, 2000,
+    range(2000), std::vector<casadi_int>(2000, 0)));
+  for (int i=1; i<argc; ++i) patterns.emplace_back(argv[i], Sparsity::from_file(argv[i]));
+
+  const std::vector<std::string> names = {"best", "none", "largest_first", "smallest_last",
+    "incidence_degree", "dynamic_largest_first"};
+  for (auto&& p : patterns) {
+    Sparsity sp = symmetric_pattern(p.second);
+    std::cout << p.first << ": " << sp.dim() << ", " << sp.nnz() << " nonzeros" << std::endl;
+    for (casadi_int ordering=-1; ordering<=4; ++ordering) {
+      std::cout << "  " << std::setw(22) << std::left << names[ordering+1];
+      for (casadi_int alg=0; alg<2; ++alg) {
+        auto t0 = std::chrono::steady_clock::now();
+        Sparsity D = alg==0 ? sp.star_coloring(ordering) : sp.star_coloring2(ordering);
+        auto t1 = std::chrono::steady_clock::now();
+        double dt = std::chrono::duration<double>(t1-t0).count();
+        std::cout << (alg==0 ? "star_coloring: " : "  star_coloring2: ")
+                  << std::setw(5) << std::right << D.size2() << " colors in "
+                  << std::fixed << std::setprecision(4) << dt << " s" << std::left;
+      }
+      std::cout << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for the parallel subtree factorization of the ldl and qr linear solvers.
+// Factorizes the same matrices with the option threads set to 1, 2, 4, ... and
+// compares the solutions with the serial ones:
+//  - ocp: KKT system of an optimal control problem (N=40, nx=30, nu=10)
+//  - scenarios: 16 smaller KKT systems coupled by a few rows
+//  - mtx: symmetrized pattern of a Matrix Market file, e.g. test/data/apoa1-2.mtx,
+//    made diagonally dominant
+// Usage: linsol_threads [max_threads] [mtx file]
+
+// Deterministic pseudo-random matrix
+DM pseudo_rand(casadi_int n, casadi_int m, casadi_int seed) {
+  DM r(n, m);
+  for (casadi_int j=0; j<m; ++j) {
+    for (casadi_int i=0; i<n; ++i) r(i, j) = 0.5 + 0.5*sin(1.3*seed + 0.7*i + 2.1*j + i*j);
+  }
+  return r;
+}
+
+// KKT system of an optimal control problem with N intervals
+DM ocp_kkt(casadi_int N, casadi_int nx, casadi_int nu, casadi_int seed) {
+  casadi_int nv = N*(nx+nu) + nx;
+  DM H = 2*DM::eye(nv);
+  DM G(N*nx, nv);
+  for (casadi_int k=0; k<N; ++k) {
+    casadi_int o = k*(nx+nu);
+    DM M = pseudo_rand(nx, nx+nu, seed + k);
+    H(Slice(o, o+nx+nu), Slice(o, o+nx+nu)) = mtimes(M.T(), M) + DM::eye(nx+nu);
+    G(Slice(k*nx, (k+1)*nx), Slice(o, o+nx+nu)) = pseudo_rand(nx, nx+nu, seed - k);
+    G(Slice(k*nx, (k+1)*nx), Slice(o+nx+nu, o+2*nx+nu)) = -DM::eye(nx);
+  }
+  return sparsify(densify(blockcat(H, G.T(), G, -1e-6*DM::eye(N*nx))));
+}
+
+// Independent KKT systems, coupled by a few rows
+DM scenario_kkt(casadi_int n_scen) {
+  std::vector<DM> blocks;
+  for (casadi_int i=0; i<n_scen; ++i) blocks.push_back(ocp_kkt(20, 10, 5, i));
+  DM D = diagcat(blocks);
+  DM B = pseudo_rand(5, D.size1(), n_scen);
+  return blockcat(D, B.T(), B, -DM::eye(5));
+}
+
+// Symmetric, diagonally dominant matrix with the pattern of a Matrix Market file
+DM mtx_matrix(const std::string& file) {
+  Sparsity A = Sparsity::from_file(file);
+  A = A + A.T() + Sparsity::diag(A.size1());
+  DM H(A, -1.0);
+  const casadi_int *colind = A.colind(), *row = A.row();
+  std::vector<double>& nz = H.nonzeros();
+  for (casadi_int c=0; c<A.size2(); ++c) {
+    for (casadi_int k=colind[c]; k<colind[c+1]; ++k) {
+      if (row[k]==c) nz[k] = 1 + colind[c+1] - colind[c];
+    }
+  }
+  return H;
+}
+
+// Time the numeric factorization for an increasing number of threads
+void run(const std::string& label, const DM& K, const std::string& solver,
+    casadi_int max_threads) {
+  DM b = pseudo_rand(K.size1(), 1, 0);
+  DM x_serial;
+  for (casadi_int n_thread=1; n_thread<=max_threads; n_thread*=2) {
+    Linsol L("L", solver, K.sparsity(), {{"threads", n_thread}});
+    L.nfact(K);
+    casadi_int n_rep = 3;
+    auto t0 = std::chrono::steady_clock::now();
+    for (casadi_int r=0; r<n_rep; ++r) L.nfact(K);
+    auto t1 = std::chrono::steady_clock::now();
+    double dt = std::chrono::duration<double>(t1-t0).count()/n_rep;
+    DM x = L.solve(K, b);
+    if (n_thread==1) x_serial = x;
+    std::cout << label << " " << solver << ", " << n_thread << " threads: nfact " << dt
+              << " s, residual " << norm_inf(mtimes(K, x) - b)
+              << ", difference to serial " << norm_inf(x - x_serial) << std::endl;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  casadi_int max_threads = argc>1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+  if (max_threads<1) max_threads = 1;
+  GlobalOptions::setMaxNumThreads(max_threads);
+
+  DM ocp = ocp_kkt(40, 30, 10, 1);
+  run("ocp", ocp, "ldl", max_threads);
+  run("ocp", ocp, "qr", max_threads);
+  DM scen = scenario_kkt(16);
+  run("scenarios", scen, "ldl", max_threads);
+  run("scenarios", scen, "qr", max_threads);
+  if (argc>2) {
+    DM A = mtx_matrix(argv[2]);
+    run("mtx", A, "ldl", max_threads);
+    run("mtx", A, "qr", max_threads);
+  }
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for reverse mode derivatives of mapaccum with checkpointing.
+// A pendulum is integrated with N RK4 steps, the gradient of the accumulated cost with
+// respect to the initial state and the controls is calculated with the unrolled mapaccum,
+// which stores all intermediate states, and with the binomial and equidistant schedules
+// for a range of checkpoints. Reports the work vector size and the evaluation time.
+// Usage: mapaccum_checkpoint [N] [n_eval]
+
+// One RK4 step of a pendulum, with the accumulated cost as second state
+Function pendulum_step() {
+  SX x = SX::sym("x", 3), u = SX::sym("u");
+  double dt = 0.01;
+  auto ode = [&](const SX& x) {
+    return vertcat(x(1), -9.81*sin(x(0)) - 0.1*x(1) + u, x(0)*x(0) + 0.01*u*u);
+  };
+  SX k1 = ode(x);
+  SX k2 = ode(x + dt/2*k1);
+  SX k3 = ode(x + dt/2*k2);
+  SX k4 = ode(x + dt*k3);
+  SX xn = x + dt/6*(k1 + 2*k2 + 2*k3 + k4);
+  return Function("f", {x, u}, {xn, xn(0)}, {"x", "u"}, {"xn", "y"});
+}
+
+int main(int argc, char* argv[]) {
+  casadi_int N = argc>1 ? atoi(argv[1]) : 100000;
+  casadi_int n_eval = argc>2 ? atoi(argv[2]) : 3;
+  Function f = pendulum_step();
+
+  // Schedules: name, checkpoints (-1: all states stored)
+  casadi_int sqrt_n = static_cast<casadi_int>(std::sqrt(static_cast<double>(N)));
+  std::vector<std::pair<std::string, casadi_int> > schedules = {{"store_all", -1},
+    {"binomial", 10}, {"binomial", 100}, {"binomial", 1000}, {"equidistant", sqrt_n}};
+
+  // Adjoint of the final accumulated cost
+  DM x0 = DM({1, 0, 0}), U = DM::zeros(1, N);
+  DM seed_x = DM::zeros(3, N), seed_y = DM::zeros(1, N);
+  seed_x(2, N-1) = 1;
+  std::vector<DM> arg = {x0, U, DM(), DM(), seed_x, seed_y}, res, res_ref;
+
+  for (auto&& s : schedules) {
+    Dict opts;
+    if (s.second>=0) opts = {{"checkpoints", s.second}, {"checkpoint_schedule", s.first}};
+    Function F = f.mapaccum("F", N, 1, opts);
+    auto t0 = std::chrono::steady_clock::now();
+    Function R = F.reverse(1);
+    auto t1 = std::chrono::steady_clock::now();
+    for (casadi_int i=0; i<n_eval; ++i) res = R(arg);
+    auto t2 = std::chrono::steady_clock::now();
+    std::cout << s.first;
+    if (s.second>=0) std::cout << " (" << s.second << " checkpoints)";
+    std::cout << ": work vector " << R.sz_w()*sizeof(double)/1024. << " kB, construction "
+              << std::chrono::duration<double>(t1-t0).count() << " s, evaluation "
+              << std::chrono::duration<double>(t2-t1).count()/n_eval << " s";
+    if (s.second<0) {
+      res_ref = res;
+    } else {
+      double err = 0;
+      for (casadi_int i=0; i<res.size(); ++i) {
+        err = std::max(err, static_cast<double>(norm_inf(res[i] - res_ref[i])));
+      }
+      std::cout << ", max deviation " << err;
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for the MXFunction option "optimize_graph" on NLPs formulated with Opti.
+// For each problem, the constraint function and its Jacobian are created with and without
+// the graph optimization, reporting the number of operations, the evaluation time and
+// what the optimization removed.
+// Usage: mx_optimize_graph [N] [n_eval]
+
+// Race car: minimum time, multiple shooting with RK4 integration
+Opti race_car(casadi_int N) {
+  Opti opti;
+  MX X = opti.variable(2, N+1);
+  MX U = opti.variable(1, N);
+  MX T = opti.variable();
+  MX pos = X(0, Slice()), speed = X(1, Slice());
+  opti.minimize(T);
+  auto f = [](const MX& x, const MX& u) {
+    return vertcat(x(1), u - x(1));
+  };
+  MX dt = T/N;
+  for (casadi_int k=0; k<N; ++k) {
+    MX xk = X(Slice(), k), uk = U(Slice(), k);
+    MX k1 = f(xk, uk);
+    MX k2 = f(xk + dt/2*k1, uk);
+    MX k3 = f(xk + dt/2*k2, uk);
+    MX k4 = f(xk + dt*k3, uk);
+    opti.subject_to(X(Slice(), k+1) == xk + dt/6*(k1 + 2*k2 + 2*k3 + k4));
+  }
+  opti.subject_to(speed <= 1 - sin(2*pi*pos)/2);
+  opti.subject_to(-1 <= U <= 1);
+  opti.subject_to(pos(0) == 0);
+  opti.subject_to(speed(0) == 0);
+  opti.subject_to(pos(N) == 1);
+  opti.subject_to(T >= 0);
+  return opti;
+}
+
+// Quadrotor-like chain: matrix-valued states, transposes and reshapes in the dynamics
+Opti matrix_chain(casadi_int N) {
+  Opti opti;
+  casadi_int n = 3;
+  MX A = DM::rand(n, n), B = DM::rand(n, 1);
+  MX X = opti.variable(n*n, N+1);
+  MX U = opti.variable(n, N);
+  MX J = 0;
+  for (casadi_int k=0; k<N; ++k) {
+    MX Xk = reshape(X(Slice(), k), n, n);
+    MX Xn = mtimes(A, Xk) + mtimes(Xk.T().T(), A.T()) + mtimes(B, U(Slice(), k).T());
+    opti.subject_to(X(Slice(), k+1) == vec(Xn));
+    J += sumsqr(vertsplit(vertcat(U(Slice(), k), Xk(Slice(), 0)), {0, n, 2*n})[0])
+      + trace(mtimes(Xk.T(), Xk));
+  }
+  opti.subject_to(X(Slice(), 0) == vec(DM::eye(n)));
+  opti.minimize(J);
+  return opti;
+}
+
+// Evaluation time per call
+double time_eval(const Function& f, const std::vector<DM>& arg, casadi_int n_eval,
+    std::vector<DM>& res) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (casadi_int i=0; i<n_eval; ++i) res = f(arg);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(t1-t0).count()/n_eval;
+}
+
+int main(int argc, char* argv[]) {
+  casadi_int N = argc>1 ? atoi(argv[1]) : 100;
+  casadi_int n_eval = argc>2 ? atoi(argv[2]) : 1000;
+
+  std::vector<std::pair<std::string, Opti> > problems = {
+    {"race_car", race_car(N)}, {"matrix_chain", matrix_chain(N)}};
+  for (auto&& p : problems) {
+    MX x = p.second.x(), g = p.second.g(), f = p.second.f();
+    std::vector<std::pair<std::string, std::vector<MX> > > funcs = {
+      {"nlp", {f, g}}, {"jac_g", {jacobian(g, x)}}};
+    for (auto&& fcn : funcs) {
+      std::cout << p.first << "/" << fcn.first << ":" << std::endl;
+      std::vector<DM> arg = {DM::rand(x.size())}, res, res_ref;
+      for (bool opt : {false, true}) {
+        auto t0 = std::chrono::steady_clock::now();
+        Function F("F", {x}, fcn.second, {{"optimize_graph", opt}});
+        auto t1 = std::chrono::steady_clock::now();
+        double t_eval = time_eval(F, arg, n_eval, opt ? res : res_ref);
+        std::cout << "  optimize_graph=" << opt << ": " << F.n_instructions()
+                  << " instructions, construction " << std::chrono::duration<double>(t1-t0).count()
+                  << " s, evaluation " << t_eval*1e6 << " us" << std::endl;
+        if (opt) {
+          Dict stats = F.stats();
+          std::cout << "  " << stats.at("optimize_graph") << std::endl;
+          double err = 0;
+          for (casadi_int i=0; i<res.size(); ++i) {
+            err = std::max(err, static_cast<double>(norm_inf(res[i] - res_ref[i])));
+          }
+          std::cout << "  max deviation " << err << std::endl;
+        }
+      }
+    }
+  }
+  return 0;
+}
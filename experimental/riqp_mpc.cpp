@@ -0,0 +1,134 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for the Riccati-based QP solver riqp against ipqp on long-horizon MPC
+// problems with nx states, nu controls, box bounds and 2 general constraints per stage.
+// ipqp solves the sparse KKT system with the given linear solver (ipqp default: ldl).
+// Usage: riqp_mpc [nx] [nu] [linear_solver]
+
+// QP with the stage structure expected by riqp
+struct MpcQp {
+  DM H, A, g, lbx, ubx, lba, uba;
+  Dict opts;
+};
+
+MpcQp mpc_qp(casadi_int N, casadi_int nx, casadi_int nu, casadi_int ng) {
+  casadi_int nz = nx + nu;
+  casadi_int n = N*nz + nx;
+  casadi_int m = N*(nx+ng) + ng;
+  // Stage matrices: chain of integrators, sparse inputs and constraints
+  DM Ad = DM::zeros(nx, nx), Bd = DM::zeros(nx, nu), Cd = DM::zeros(ng, nz);
+  for (casadi_int i=0; i<nx; ++i) {
+    Ad(i, i) = 1;
+    if (i+1<nx) Ad(i, i+1) = 0.1;
+    for (casadi_int j=0; j<nu; ++j) Bd(i, j) = 0.05*((i+j)%3) + (i==nx-1-j ? 0.1 : 0.);
+  }
+  for (casadi_int i=0; i<ng; ++i) {
+    for (casadi_int j=0; j<nz; ++j) Cd(i, j) = (i+2*j)%4==0 ? 1 : 0;
+  }
+  // Variables [x_0; u_0; ...; x_N], constraints [dynamics_0; general_0; ...; general_N]
+  DM H = DM::zeros(n, n), A = DM::zeros(m, n);
+  MpcQp qp;
+  qp.lba = DM::zeros(m);
+  qp.uba = DM::zeros(m);
+  casadi_int r = 0;
+  for (casadi_int k=0; k<=N; ++k) {
+    casadi_int o = k*nz;
+    casadi_int nzk = k<N ? nz : nx;
+    for (casadi_int i=0; i<nzk; ++i) H(o+i, o+i) = i<nx ? (k==N ? 10. : 1.) : 0.1;
+    if (k<N) {
+      for (casadi_int i=0; i<nx; ++i) {
+        for (casadi_int j=0; j<nx; ++j) if (Ad(i, j).scalar()!=0) A(r+i, o+j) = Ad(i, j);
+        for (casadi_int j=0; j<nu; ++j) if (Bd(i, j).scalar()!=0) A(r+i, o+nx+j) = Bd(i, j);
+        A(r+i, o+nz+i) = -1;
+      }
+      r += nx;
+    }
+    for (casadi_int i=0; i<ng; ++i) {
+      for (casadi_int j=0; j<nzk; ++j) if (Cd(i, j).scalar()!=0) A(r+i, o+j) = Cd(i, j);
+      qp.lba(r+i) = -0.8;
+      qp.uba(r+i) = 0.8;
+    }
+    r += ng;
+  }
+  qp.H = sparsify(H);
+  qp.A = sparsify(A);
+  qp.g = DM::zeros(n);
+  qp.lbx = -DM::ones(n);
+  qp.ubx = DM::ones(n);
+  for (casadi_int i=0; i<nx; ++i) qp.lbx(i) = qp.ubx(i) = i%2 ? -0.2 : 0.2;
+  qp.opts = Dict{{"N", N}, {"nx", std::vector<casadi_int>(N+1, nx)},
+    {"nu", std::vector<casadi_int>(N, nu)}, {"ng", std::vector<casadi_int>(N+1, ng)}};
+  return qp;
+}
+
+// Average time of a solver call in ms
+double time_solver(const Function& solver, const DMDict& in, casadi_int n_rep, DMDict& out) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (casadi_int i=0; i<n_rep; ++i) out = solver(in);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(t1-t0).count()/n_rep*1e3;
+}
+
+int main(int argc, char* argv[]) {
+  casadi_int nx = argc>1 ? atoi(argv[1]) : 8;
+  casadi_int nu = argc>2 ? atoi(argv[2]) : 3;
+  std::string linear_solver = argc>3 ? argv[3] : "ldl";
+  Dict opts = {{"print_iter", false}, {"print_header", false}, {"error_on_fail", false}};
+
+  for (casadi_int N : {10, 50, 100, 200, 400}) {
+    MpcQp qp = mpc_qp(N, nx, nu, 2);
+    DMDict in = {{"h", qp.H}, {"a", qp.A}, {"g", qp.g}, {"lbx", qp.lbx}, {"ubx", qp.ubx},
+                 {"lba", qp.lba}, {"uba", qp.uba}};
+    SpDict st = {{"h", qp.H.sparsity()}, {"a", qp.A.sparsity()}};
+    Dict riqp_opts = opts;
+    for (auto&& e : qp.opts) riqp_opts[e.first] = e.second;
+    Dict ipqp_opts = opts;
+    ipqp_opts["linear_solver"] = linear_solver;
+    Function riqp = conic("riqp", "riqp", st, riqp_opts);
+    Function ipqp = conic("ipqp", "ipqp", st, ipqp_opts);
+    casadi_int n_rep = N<=100 ? 5 : 2;
+    DMDict r1, r2;
+    double t1 = time_solver(riqp, in, n_rep, r1);
+    double t2 = time_solver(ipqp, in, n_rep, r2);
+    std::cout << "N=" << N << ": riqp " << t1 << " ms (" << riqp.stats().at("return_status")
+              << "), ipqp with " << linear_solver << " " << t2 << " ms ("
+              << ipqp.stats().at("return_status") << "), difference in x "
+              << norm_inf(r1.at("x") - r2.at("x")) << std::endl;
+  }
+  return 0;
+}
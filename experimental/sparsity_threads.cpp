@@ -0,0 +1,83 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for constructing sparsity patterns concurrently.
+// Each thread repeatedly builds a mix of patterns: some are shared among all threads
+// (contention on the same cache entries), some are unique to the thread.
+// Usage: sparsity_threads [max_threads] [n_iter]
+
+// Build patterns, return a checksum
+casadi_int build_patterns(casadi_int thread, casadi_int n_iter) {
+  casadi_int ret = 0;
+  for (casadi_int k=0; k<n_iter; ++k) {
+    // Shared among threads
+    Sparsity sp1 = Sparsity::banded(20 + k % 50, 2);
+    Sparsity sp2 = Sparsity::lower(10 + k % 30);
+    // Unique to the thread
+    Sparsity sp3 = Sparsity::diag(100 + thread*1000 + k % 500);
+    Sparsity sp4 = Sparsity::triplet(10, 10, {thread % 10, k % 10}, {k % 10, 3});
+    // Derived patterns
+    Sparsity sp5 = sp1 + sp1.T();
+    Sparsity sp6 = mtimes(sp2, sp2.T());
+    ret += sp3.nnz() + sp4.nnz() + sp5.nnz() + sp6.nnz();
+  }
+  return ret;
+}
+
+int main(int argc, char* argv[]) {
+  casadi_int max_threads = argc>1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+  casadi_int n_iter = argc>2 ? atoi(argv[2]) : 20000;
+  if (max_threads<1) max_threads = 1;
+
+  for (casadi_int n_thread=1; n_thread<=max_threads; n_thread*=2) {
+    std::vector<casadi_int> checksum(n_thread);
+    std::vector<std::thread> threads;
+    auto t0 = std::chrono::steady_clock::now();
+    for (casadi_int t=0; t<n_thread; ++t) {
+      threads.emplace_back([&checksum, t, n_iter]() {
+        checksum[t] = build_patterns(t, n_iter);
+      });
+    }
+    for (auto& th : threads) th.join();
+    auto t1 = std::chrono::steady_clock::now();
+    double dt = std::chrono::duration<double>(t1-t0).count();
+    // Verify against serial evaluation
+    for (casadi_int t=0; t<n_thread; ++t) {
+      casadi_assert(checksum[t]==build_patterns(t, n_iter), "Checksum mismatch");
+    }
+    std::cout << n_thread << " threads: " << dt << " s, "
+              << (n_thread*n_iter*6)/dt << " patterns/s" << std::endl;
+  }
+  return 0;
+}
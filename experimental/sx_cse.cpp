@@ -0,0 +1,140 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+#include <casadi/core/serializing_stream.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for common subexpression elimination of SX graphs.
+// Compares the string-keyed elimination used previously, in which every node is
+// serialized, with the structural hash-consing of SX::cse and with hash-consing
+// during construction (GlobalOptions::hash_consing).
+// Usage: sx_cse [n]
+
+// Model in which every subexpression is constructed twice
+SX build_model(const SX& x, casadi_int n) {
+  std::vector<SX> r;
+  for (casadi_int k=0; k<2; ++k) {
+    SX s = 0;
+    for (casadi_int i=0; i<n; ++i) {
+      SX xi = x(i % x.nnz());
+      s = 0.5*s + sin(xi)*cos(s) - 3*xi*xi + static_cast<double>(i % 17);
+      r.push_back(s/(1+xi*xi));
+    }
+  }
+  return vertcat(r);
+}
+
+// Previous implementation: serialize every node, look up the strings
+SX cse_serialized(const SX& x, const SX& e) {
+  Function f("f", {x}, {e}, {{"live_variables", false}, {"max_io", 0}});
+  std::vector<SXElem> x_nz = x.nonzeros(), ret(e.nnz());
+  std::vector<SXElem> w(f.n_instructions());
+  std::unordered_map<std::string, SXElem> cache;
+  std::stringstream ss;
+  SerializingStream s(ss);
+  std::vector<SXElem> ref;
+  auto pack = [&](const SXElem& a) {
+    s.pack(a);
+    ref.push_back(a);
+    std::string key = ss.str();
+    ss.str("");
+    ss.clear();
+    return key;
+  };
+  for (casadi_int k=0; k<f.n_instructions(); ++k) {
+    casadi_int op = f.instruction_id(k);
+    std::vector<casadi_int> i = f.instruction_input(k), o = f.instruction_output(k);
+    if (op==OP_INPUT) {
+      w[o[0]] = x_nz[i[1]];
+      cache[pack(w[o[0]])] = w[o[0]];
+    } else if (op==OP_OUTPUT) {
+      ret[o[1]] = w[i[0]];
+    } else if (op==OP_CONST) {
+      w[o[0]] = f.instruction_constant(k);
+      cache[pack(w[o[0]])] = w[o[0]];
+    } else {
+      SXElem r = i.size()==2 ? SXElem::binary(op, w[i[0]], w[i[1]]) : SXElem::unary(op, w[i[0]]);
+      auto it = cache.insert(std::make_pair(pack(r), r));
+      w[o[0]] = it.first->second;
+    }
+  }
+  return SX(e.sparsity(), ret);
+}
+
+// Compare with the result of the original model
+void check(const DM& r, const DM& ref) {
+  casadi_assert(static_cast<double>(norm_inf(r-ref)) <= 1e-10*static_cast<double>(norm_inf(ref)),
+    "Mismatch");
+}
+
+// Number of operations after eliminating duplicates
+casadi_int n_operations(const SX& x, const SX& e) {
+  return Function("f", {x}, {e}).n_nodes();
+}
+
+int main(int argc, char* argv[]) {
+  casadi_int n = argc>1 ? atoi(argv[1]) : 20000;
+  SX x = SX::sym("x", 10);
+  DM x0 = DM::rand(10);
+
+  auto t0 = std::chrono::steady_clock::now();
+  SX e = build_model(x, n);
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "construction: " << std::chrono::duration<double>(t1-t0).count() << " s, "
+            << n_operations(x, e) << " operations" << std::endl;
+  DM ref = Function("f", {x}, {e})(x0).at(0);
+
+  t0 = std::chrono::steady_clock::now();
+  SX e1 = cse_serialized(x, e);
+  t1 = std::chrono::steady_clock::now();
+  std::cout << "serialized keys: " << std::chrono::duration<double>(t1-t0).count() << " s, "
+            << n_operations(x, e1) << " operations" << std::endl;
+  check(Function("f", {x}, {e1})(x0).at(0), ref);
+
+  t0 = std::chrono::steady_clock::now();
+  SX e2 = SX::cse(std::vector<SX>{e}).at(0);
+  t1 = std::chrono::steady_clock::now();
+  std::cout << "hash-consing pass: " << std::chrono::duration<double>(t1-t0).count() << " s, "
+            << n_operations(x, e2) << " operations" << std::endl;
+  check(Function("f", {x}, {e2})(x0).at(0), ref);
+
+  GlobalOptions::setHashConsing(true);
+  t0 = std::chrono::steady_clock::now();
+  SX e3 = build_model(x, n);
+  t1 = std::chrono::steady_clock::now();
+  GlobalOptions::setHashConsing(false);
+  std::cout << "hash-consing construction: " << std::chrono::duration<double>(t1-t0).count()
+            << " s, " << n_operations(x, e3) << " operations" << std::endl;
+  check(Function("f", {x}, {e3})(x0).at(0), ref);
+  return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ *    This file is part of CasADi.
+ *
+ *    CasADi -- A symbolic framework for dynamic optimization.
+ *    Copyright (C) 2010-2023 Joel Andersson, Joris Gillis, Moritz Diehl,
+ *                            KU Leuven. All rights reserved.
+ *    Copyright (C) 2011-2014 Greg Horn
+ *
+ *    CasADi is free software; you can redistribute it and/or
+ *    modify it under the terms of the GNU Lesser General Public
+ *    License as published by the Free Software Foundation; either
+ *    version 3 of the License, or (at your option) any later version.
+ *
+ *    CasADi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with CasADi; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <casadi/casadi.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace casadi;
+
+// Benchmark for the instruction schedules of SXFunction (option "schedule").
+// For each test graph and schedule, reports the work vector size and the evaluation time
+// in the interpreter and in generated C code, compiled with the system compiler.
+// Usage: sx_schedule [n] [n_eval] [compiler]
+
+// Hessian of a chained Rosenbrock function
+std::pair<SX, SX> hessian_rosenbrock(casadi_int n) {
+  SX x = SX::sym("x", n);
+  SX f = 0;
+  for (casadi_int i=0; i+1<n; ++i) {
+    SX xi = x(i), xn = x(i+1);
+    f += 100*sq(xn - sq(xi)) + sq(1 - xi);
+  }
+  return {x, hessian(f, x)};
+}
+
+// Unrolled RK4 integration of a chain of coupled oscillators
+std::pair<SX, SX> rk4_chain(casadi_int n) {
+  casadi_int nx = 16, N = n/16;
+  SX x0 = SX::sym("x0", nx);
+  auto ode = [&](const SX& x) {
+    std::vector<SX> r;
+    for (casadi_int i=0; i<nx; ++i) {
+      SX xl = x(i>0 ? i-1 : nx-1), xr = x(i+1<nx ? i+1 : 0);
+      r.push_back(sin(xl) - 2*x(i) + cos(xr));
+    }
+    return vertcat(r);
+  };
+  SX x = x0, dt = 0.01;
+  for (casadi_int k=0; k<N; ++k) {
+    SX k1 = ode(x);
+    SX k2 = ode(x + dt/2*k1);
+    SX k3 = ode(x + dt/2*k2);
+    SX k4 = ode(x + dt*k3);
+    x = x + dt/6*(k1 + 2*k2 + 2*k3 + k4);
+  }
+  return {x0, x};
+}
+
+// Independent recurrences, each a long chain of dependent operations
+std::pair<SX, SX> independent_chains(casadi_int n) {
+  casadi_int n_chain = 64;
+  SX x = SX::sym("x", n_chain);
+  std::vector<SX> r;
+  for (casadi_int c=0; c<n_chain; ++c) {
+    SX s = x(c);
+    for (casadi_int k=0; k<n/n_chain/4; ++k) s = sqrt(1 + s*s) * 0.5 + 0.1;
+    r.push_back(s);
+  }
+  return {x, vertcat(r)};
+}
+
+// Evaluation time per call
+double time_eval(const Function& f, const std::vector<DM>& arg, casadi_int n_eval,
+    std::vector<DM>& res) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (casadi_int i=0; i<n_eval; ++i) res = f(arg);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(t1-t0).count()/n_eval;
+}
+
+int main(int argc, char* argv[]) {
+  casadi_int n = argc>1 ? atoi(argv[1]) : 2000;
+  casadi_int n_eval = argc>2 ? atoi(argv[2]) : 100;
+  std::string compiler = argc>3 ? argv[3] : "gcc -O2";
+
+  std::vector<std::pair<std::string, std::pair<SX, SX> > > problems = {
+    {"hessian_rosenbrock", hessian_rosenbrock(n)},
+    {"rk4_chain", rk4_chain(n)},
+    {"independent_chains", independent_chains(10*n)}};
+  for (auto&& p : problems) {
+    const SX& x = p.second.first;
+    const SX& e = p.second.second;
+    std::cout << p.first << ":" << std::endl;
+    std::vector<DM> arg = {DM::rand(x.size())}, res, res_ref;
+    for (std::string schedule : {"depth_first", "locality", "latency"}) {
+      Function f("f_" + schedule, {x}, {e}, {{"schedule", schedule}});
+      double t_interp = time_eval(f, arg, n_eval, res);
+      if (schedule=="depth_first") res_ref = res;
+      // Generated C code
+      std::string cname = f.generate();
+      std::string lib = "./" + f.name() + ".so";
+      if (system((compiler + " -shared -fPIC " + cname + " -o " + lib).c_str())) {
+        casadi_error("Compilation failed");
+      }
+      Function fc = external(f.name(), lib);
+      std::vector<DM> res_c;
+      double t_c = time_eval(fc, arg, n_eval, res_c);
+      std::cout << "  " << schedule << ": " << f.n_instructions() << " instructions, work vector "
+                << f.sz_w() << ", interpreter " << t_interp*1e6 << " us, generated C "
+                << t_c*1e6 << " us, max deviation "
+                << std::max(static_cast<double>(norm_inf(res[0] - res_ref[0])),
+                            static_cast<double>(norm_inf(res_c[0] - res_ref[0]))) << std::endl;
+    }
+  }
+  return 0;
+}
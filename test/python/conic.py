@@ -949,6 +949,99 @@ class ConicTests(casadiTestCase):
         F,_ = self.check_codegen(solver,{},std="c99",opts={"verbose_runtime":True})
         #with self.assertOutput(["last_tau","Converged"],[]): # Printing, but not captured by python stdout
         #    F()
+
+  @requires_conic("qrqp")
+  def test_qrqp_warmstart(self):
+    # Sequence of MPC-like problems with the same H and A
+    N = 15
+    X = SX.sym("X", 2, N+1)
+    U = SX.sym("U", 1, N)
+    x = veccat(X, U)
+    g = vertcat(*[X[:,k+1]-vertcat(X[0,k]+0.1*X[1,k], X[1,k]+0.1*U[k]) for k in range(N)])
+    H = DM.eye(x.numel())
+    A = evalf(jacobian(g, x))
+    solver_in = {"h": H, "a": A, "lba": 0, "uba": 0}
+    st = {"h": H.sparsity(), "a": A.sparsity()}
+    opts = {"print_iter": False, "print_header": False, "print_info": False}
+    solver = conic("solver", "qrqp", st, opts)
+    solver_noup = conic("solver", "qrqp", st, dict(opts, max_update=0))
+
+    lbx = -DM.ones(x.numel())
+    ubx = DM.ones(x.numel())
+    lam_x0 = DM.zeros(x.numel())
+    lam_a0 = DM.zeros(g.numel())
+    n_fact = n_fact_noup = 0
+    for k in range(10):
+      lbx[:2] = ubx[:2] = vertcat(0.5*cos(0.3*k), 0.2*sin(0.3*k))
+      solver_in["g"] = 3*sin(0.2*k + 0.4*DM(range(x.numel())))
+      solver_in["lbx"] = lbx
+      solver_in["ubx"] = ubx
+      solver_in["lam_x0"] = lam_x0
+      solver_in["lam_a0"] = lam_a0
+      sol = solver(**solver_in)
+      self.assertTrue(solver.stats()["success"])
+      sol_noup = solver_noup(**solver_in)
+      self.assertTrue(solver_noup.stats()["success"])
+      # Cold start with a fresh solver, factorization from scratch
+      solver_ref = conic("solver", "qrqp", st, opts)
+      sol_ref = solver_ref(**dict(solver_in, lam_x0=0, lam_a0=0))
+      self.assertTrue(solver_ref.stats()["success"])
+      if k > 0:
+        self.assertTrue(solver.stats()["iter_count"] < solver_ref.stats()["iter_count"])
+        # Same warm start, the updates replace factorizations from scratch
+        self.assertTrue(solver.stats()["n_factorizations"]
+                        <= solver_noup.stats()["n_factorizations"])
+        n_fact += solver.stats()["n_factorizations"]
+        n_fact_noup += solver_noup.stats()["n_factorizations"]
+      for s in [sol, sol_noup]:
+        self.checkarray(s["x"], sol_ref["x"], digits=8)
+        self.checkarray(s["lam_x"], sol_ref["lam_x"], digits=8)
+        self.checkarray(s["lam_a"], sol_ref["lam_a"], digits=8)
+      lam_x0 = sol["lam_x"]
+      lam_a0 = sol["lam_a"]
+    self.assertTrue(n_fact < n_fact_noup)
+
+    # Changing A invalidates the stored factorization
+    solver_in["a"] = 1.1*solver_in["a"]
+    sol = solver(**solver_in)
+    self.assertTrue(solver.stats()["n_factorizations"] >= 1)
+    solver_ref = conic("solver", "qrqp", st, opts)
+    sol_ref = solver_ref(**dict(solver_in, lam_x0=0, lam_a0=0))
+    self.checkarray(sol["x"], sol_ref["x"], digits=8)
+
+  @requires_conic("qrqp")
+  def test_qrqp_update_random(self):
+    # Low-rank updates must give the same results as factorizations from scratch
+    numpy.random.seed(1)
+    opts = {"print_iter": False, "print_header": False, "print_info": False,
+            "error_on_fail": False}
+    n_fact = n_fact_noup = 0
+    for k in range(50):
+      nx = numpy.random.randint(5, 15)
+      na = numpy.random.randint(2, 6)
+      M = numpy.random.randn(nx, nx)
+      H = DM(numpy.dot(M.T, M) + 0.1*numpy.eye(nx))
+      A = DM(numpy.random.randn(na, nx))
+      g = DM(5*numpy.random.randn(nx))
+      # Feasible constraint bounds
+      z = mtimes(A, DM(numpy.random.rand(nx)-0.5))
+      w = DM(numpy.random.rand(na))
+      solver_in = {"h": H, "g": g, "a": A, "lba": z-w, "uba": z+w}
+      st = {"h": H.sparsity(), "a": A.sparsity()}
+      solver = conic("solver", "qrqp", st, opts)
+      solver_noup = conic("solver", "qrqp", st, dict(opts, max_update=0))
+      sol = solver(**solver_in)
+      sol_noup = solver_noup(**solver_in)
+      self.assertEqual(solver.stats()["success"], solver_noup.stats()["success"])
+      self.checkarray(sol["x"], sol_noup["x"], digits=8)
+      self.checkarray(sol["lam_a"], sol_noup["lam_a"], digits=8)
+      self.checkarray(sol["cost"], sol_noup["cost"], digits=8)
+      n_fact += solver.stats()["n_factorizations"]
+      n_fact_noup += solver_noup.stats()["n_factorizations"]
+    self.assertTrue(n_fact < n_fact_noup)
+
+    self.check_codegen(solver, solver_in, std="c99")
+    self.check_serialize(solver, solver_in)
     
     
 
@@ -1211,6 +1304,107 @@ class ConicTests(casadiTestCase):
     print("codegen starts here")   
     self.check_codegen(solver,dict(a=A,h=H,lba=lbg,uba=ubg,g=g,lbx=lbx,ubx=ubx,x0=sol["x"],lam_a0=sol["lam_a"],lam_x0=sol["lam_x"]),std="c99",extralibs=["hpipm","blasfeo"],extra_options=fatrop_flags)
         
+  @requires_conic("riqp")
+  def test_riqp(self):
+    A = sparsify(DM([[1,0.2,1,-1,0,0,0,0,0,0,0,0],
+                     [-0.1,0.4,0,0,-1,0,0,0,0,0,0,0],
+                     [0.3,0.2,0,0,0,-1,0,0,0,0,0,0],
+                     [2,0,0.3,0,0,0,0,0,0,0,0,0],
+                     [1,1,0.4,0,0,0,0,0,0,0,0,0],
+                     [0,0,0,1,4,2,1,0.3,-1,0,0,0],
+                     [0,0,0,3,1,0,1,0.2,0,-1,0,0],
+                     [0,0,0,1,1,1,1,1,0,0,0,0],
+                     [0,0,0,0,0,0,0,0,2,4,0,-1],
+                     [0,0,0,0,0,0,0,0,2,3,1,0],
+                     [0,0,0,0,0,0,0,0,0,0,0,3]]))
+    H = sparsify(DM([[7,0,0.2,0,0,0,0,0,0,0,0,0],
+                     [0,7,0.3,0,0,0,0,0,0,0,0,0],
+                     [0.2,0.3,1,0,0,0,0,0,0,0,0,0],
+                     [0,0,0,3,0,0,0,1,0,0,0,0],
+                     [0,0,0,0,2,0.1,0,0.7,0,0,0,0],
+                     [0,0,0,0,0.1,1,0,1,0,0,0,0],
+                     [0,0,0,0,0,0,1,0.1,0,0,0,0],
+                     [0,0,0,1,0.7,1,0.1,2,0,0,0,0],
+                     [0,0,0,0,0,0,0,0,6,0,1,0],
+                     [0,0,0,0,0,0,0,0,0,6,0,0],
+                     [0,0,0,0,0,0,0,0,1,0,4,0],
+                     [0,0,0,0,0,0,0,0,0,0,0,9]]))
+    g = DM([1,1,0.2,0.4,1,0.5,0.3,1,0.6,1,1,0.7])
+    lbg = DM([0,0,0,-2,-2,0,0,-2,0,-2,-2])
+    ubg = DM([0,0,0,2,2,0,0,2,0,2,2])
+    lbx = DM([0.5,0.2]+[-1]*10)
+    ubx = DM([0.5,0.2]+[1]*10)
+    inputs = dict(a=A,h=H,lba=lbg,uba=ubg,g=g,lbx=lbx,ubx=ubx)
+
+    opts = {"N":3,"nx":[2,3,2,1],"nu":[1,2,1],"ng":[2,1,1,1],"print_iter":False}
+    solver = conic('solver', 'riqp', {"a": A.sparsity(), "h": H.sparsity()}, opts)
+    solver_ref = conic('solver', 'ipqp', {"a": A.sparsity(), "h": H.sparsity()},
+                       {"print_iter":False, "linear_solver":"qr"})
+    sol = solver(**inputs)
+    sol_ref = solver_ref(**inputs)
+    self.assertTrue(solver.stats()["success"])
+    self.assertTrue(solver_ref.stats()["success"])
+    self.checkarray(sol_ref["x"], sol["x"],digits=7)
+    self.checkarray(sol_ref["lam_a"], sol["lam_a"],digits=6)
+    self.checkarray(sol_ref["lam_x"], sol["lam_x"],digits=6)
+    self.checkarray(sol_ref["cost"], sol["cost"],digits=7)
+
+    self.check_codegen(solver,inputs,std="c99")
+    self.check_serialize(solver,inputs)
+
+    # Inequality on a general row turned into an equality
+    inputs["lba"] = DM(lbg)
+    inputs["lba"][3] = inputs["uba"][3] = 0.8
+    sol = solver(**inputs)
+    sol_ref = solver_ref(**inputs)
+    self.assertTrue(solver.stats()["success"])
+    self.assertTrue(solver_ref.stats()["success"])
+    self.checkarray(sol_ref["x"], sol["x"],digits=7)
+
+    # Long horizon, double integrator
+    N = 100
+    nx = 2
+    nu = 1
+    x = [SX.sym("x%d" % k, nx) for k in range(N+1)]
+    u = [SX.sym("u%d" % k, nu) for k in range(N)]
+    w = []
+    con = []
+    for k in range(N):
+      w += [x[k], u[k]]
+      con += [x[k+1]-vertcat(x[k][0]+0.1*x[k][1], x[k][1]+0.1*u[k]), x[k][0]+u[k]]
+    w.append(x[N])
+    w = vcat(w)
+    con = vcat(con)
+    f = sum([sumsqr(x[k])+0.1*sumsqr(u[k]) for k in range(N)])+10*sumsqr(x[N])
+    H = hessian(f, w)[0]
+    A = jacobian(con, w)
+    H = Function('H',[w],[H])(0)
+    A = Function('A',[w],[A])(0)
+    lbw = vcat([-inf]*w.numel())
+    ubw = vcat([inf]*w.numel())
+    lbw[:2] = ubw[:2] = DM([1, 0])
+    for k in range(N):
+      lbw[k*(nx+nu)+nx] = -1
+      ubw[k*(nx+nu)+nx] = 1
+    lba = vcat([DM.zeros(nx), DM(-1.5)]*N)
+    uba = vcat([DM.zeros(nx), DM(inf)]*N)
+    inputs = dict(h=H,a=A,g=DM.zeros(w.numel()),lbx=lbw,ubx=ubw,lba=lba,uba=uba)
+
+    opts = {"N":N,"nx":[nx]*(N+1),"nu":[nu]*N,"ng":[1]*N+[0],"print_iter":False}
+    solver = conic('solver', 'riqp', {"a": A.sparsity(), "h": H.sparsity()}, opts)
+    solver_ref = conic('solver', 'ipqp', {"a": A.sparsity(), "h": H.sparsity()},
+                       {"print_iter":False, "linear_solver":"qr"})
+    sol = solver(**inputs)
+    sol_ref = solver_ref(**inputs)
+    self.assertTrue(solver.stats()["success"])
+    self.assertTrue(solver_ref.stats()["success"])
+    self.checkarray(sol_ref["x"], sol["x"],digits=6)
+    self.checkarray(sol_ref["lam_a"], sol["lam_a"],digits=5)
+
+    # Structure mismatch
+    with self.assertInException("must be block diagonal"):
+      conic('solver', 'riqp', {"a": A.sparsity(), "h": Sparsity.dense(w.numel(),w.numel())}, opts)
+
   @requires_nlpsol("ipopt")
   def test_SOCP(self):
 
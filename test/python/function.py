@@ -629,6 +629,18 @@ class Functiontests(casadiTestCase):
     self.checkfunction_light(fun.map(4,"thread",2),fun.map(4),inputs=[hcat(X_[:4]),hcat(Y_[:4]),hcat(Z_[:4]),hcat(V_[:4])])
     self.checkfunction_light(fun.map(4,"thread",5),fun.map(4),inputs=[hcat(X_[:4]),hcat(Y_[:4]),hcat(Z_[:4]),hcat(V_[:4])])
 
+  def test_map_thread_pool(self):
+    x = SX.sym("x")
+    y = SX.sym("y",2)
+    fun = Function("f",[x,y],[sin(y*x),x**2])
+    X = DM.rand(1,100)
+    Y = DM.rand(2,100)
+    for n in [1,3,0]:
+      GlobalOptions.setMaxNumThreads(n)
+      self.checkfunction_light(fun.map(100,"thread"),fun.map(100),inputs=[X,Y])
+      self.checkfunction_light(fun.map(7,"thread").map(3,"thread"),fun.map(21),inputs=[X[:,:21],Y[:,:21]])
+    GlobalOptions.setMaxNumThreads(0)
+
   @memory_heavy()
   def test_mapsum(self):
     x = SX.sym("x")
@@ -906,6 +918,40 @@ class Functiontests(casadiTestCase):
     for sf,sF in zip(scheme_out_fun,scheme_out_F):
       self.assertTrue(sf==sF)
 
+  def test_mapaccum_checkpoints(self):
+    x = SX.sym("x",2)
+    u = SX.sym("u")
+    p = SX.sym("p",Sparsity.upper(2))
+    fun = Function("f",[x,u,p],[vertcat(x[0]+0.1*x[1],x[1]+0.1*(u-sin(x[0])*p[0,1])),x[0]**2+u**2],["x","u","p"],["xn","y"])
+
+    n = 13
+    F_ref = fun.mapaccum("map",n)
+
+    np.random.seed(0)
+    inputs = [DM([0.3,-0.2]),DM(np.random.random((1,n))),DM(repmat(p.sparsity(),1,n),np.random.random(3*n))]
+
+    for schedule in ["binomial","equidistant"]:
+      for checkpoints in [0,1,3,20]:
+        F = fun.mapaccum("map",n,{"checkpoints":checkpoints,"checkpoint_schedule":schedule})
+        self.assertTrue(F.is_a("MapAccum"))
+        self.checkfunction(F,F_ref,inputs=inputs,hessian=False,sens_der=False,evals=False)
+        self.check_serialize(F,inputs=inputs)
+
+    # Fewer stored states for the reverse sweep
+    F = fun.mapaccum("map",n,{"checkpoints":2})
+    self.assertTrue(F.reverse(1).sz_w()<F_ref.reverse(1).sz_w())
+
+    # Symbolic evaluation unrolls the loop
+    U = DM.ones(1,n)
+    P = repmat(p,1,n)
+    self.checkfunction_light(Function("f",[x,p],[F(x,U,P)[1]]),Function("f",[x,p],[F_ref(x,U,P)[1]]),inputs=[DM([0.3,-0.2]),DM(p.sparsity(),[1,2,3])])
+
+    # Fold
+    self.checkfunction_light(fun.fold(n,{"checkpoints":2}),fun.fold(n),inputs=inputs)
+
+    with self.assertInException("Unknown checkpoint schedule"):
+      fun.mapaccum("map",n,{"checkpoints":2,"checkpoint_schedule":"foo"})
+
   # @requiresPlugin(Importer,"clang")
   # def test_jitfunction_clang(self):
   #   x = MX.sym("x")
@@ -1782,6 +1828,25 @@ class Functiontests(casadiTestCase):
     self.assertTrue("ffff_acc4_acc4_acc4" in code)
     
     
+  def test_codegen_stream(self):
+    x = SX.sym("x",100)
+    y = x
+    for i in range(200):
+      y = sin(y)*x+1
+    g = Function('g',[x],[y])
+    X = MX.sym("x",100)
+    f = Function('f',[X],[2*g(X),g(X[::-1])])
+
+    codes = []
+    for opts in [{}, {"stream": True}]:
+      c = CodeGenerator('me', opts)
+      c.add(f)
+      codes.append(c.dump())
+    self.assertTrue(len(codes[0])>2**21)
+    self.assertEqual(codes[0], codes[1])
+
+    self.check_codegen(f,inputs=[DM.rand(100)],opts={"stream": True})
+
   def test_codegen_with_jac_sparsity(self):
   
     if not args.run_slow: return
@@ -2692,6 +2757,73 @@ class Functiontests(casadiTestCase):
     f = Function("f",[],[c])
     self.check_codegen(f,inputs=[])
 
+  def test_jit_cache(self):
+    if not args.run_slow: return
+    if sys.platform=="darwin": return
+    import tempfile
+    cache = tempfile.mkdtemp()
+
+    x = MX.sym("x")
+    opts = {"jit":True, "compiler": "shell", "jit_cache": cache, "verbose": True}
+    with self.assertOutput(["Stored"],["Loaded"]):
+      f = Function('f',[x],[(x-3)**2],opts)
+    with self.assertOutput(["Loaded"],["Stored"]):
+      g = Function('f',[x],[(x-3)**2],opts)
+    self.checkfunction_light(f, g, inputs=[1.5])
+    self.assertEqual(len(os.listdir(cache)),2)
+
+    # Different code or compiler options result in a new entry
+    with self.assertOutput(["Stored"],["Loaded"]):
+      Function('f',[x],[(x-2)**2],opts)
+    opts["jit_options"] = {"flags": ["-O2"]}
+    with self.assertOutput(["Stored"],["Loaded"]):
+      Function('f',[x],[(x-3)**2],opts)
+    self.assertEqual(len(os.listdir(cache)),6)
+
+    # Least recently used entries are evicted
+    opts["jit_cache_size"] = 1
+    with self.assertOutput(["Stored"],["Loaded"]):
+      Function('f',[x],[(x-1)**2],opts)
+    self.assertEqual(len(os.listdir(cache)),2)
+
+  def test_jit_shard(self):
+    if not args.run_slow: return
+    if sys.platform=="darwin": return
+    x = SX.sym("x",5)
+    y = x
+    for i in range(50):
+      y = sin(y)*x+cos(y[::-1])
+    g = Function('g',[x],[y])
+    X = MX.sym("x",5)
+    f = Function('f',[X],[g(X)+g(2*X)])
+    with self.assertOutput(["_1.c"],[]):
+      fj = Function('f',[X],[g(X)+g(2*X)],{"jit":True,"compiler":"shell","jit_shard_size":2000,
+                                         "jit_options":{"verbose":True}})
+    self.checkfunction_light(f, fj, inputs=[DM.rand(5)])
+
+  def test_jit_cache_shard(self):
+    if sys.platform=="darwin": return
+    import tempfile
+    cache = tempfile.mkdtemp()
+    x = SX.sym("x",5)
+    y = x
+    for i in range(10):
+      y = sin(y)*x+cos(y[::-1])
+    g = Function('g',[x],[y])
+    X = MX.sym("x",5)
+    f = Function('f',[X],[g(X)+g(2*X)])
+    opts = {"jit":True,"compiler":"shell","jit_shard_size":500,"jit_cache":cache,"verbose":True}
+    # The key does not depend on the random jit name in the sharded sources
+    with self.assertOutput(["Stored"],["Loaded"]):
+      fj = Function('f',[X],[g(X)+g(2*X)],opts)
+    with self.assertOutput(["Loaded"],["Stored"]):
+      gj = Function('f',[X],[g(X)+g(2*X)],opts)
+    self.checkfunction_light(f, gj, inputs=[DM.rand(5)])
+    # The cache options are serialized
+    with self.assertOutput(["Loaded"],["Stored"]):
+      hj = Function.deserialize(fj.serialize())
+    self.checkfunction_light(f, hj, inputs=[DM.rand(5)])
+
   def test_jit_serialize(self):
     if not args.run_slow: return
     if sys.platform=="darwin": return
@@ -2852,6 +2984,104 @@ class Functiontests(casadiTestCase):
         self.assertTrue(f1.n_instructions()>3)
         self.assertTrue(f2.n_instructions()<=3)
 
+  def test_hash_consing(self):
+    x = SX.sym("x",2)
+    y = SX.sym("y",2)
+    w = sin(x*y+3)-sin(x*y+3)
+    self.assertFalse(w.is_zero())
+    self.assertTrue(cse(w).is_zero())
+    GlobalOptions.setHashConsing(True)
+    try:
+      z = sin(x*y+3)
+      z2 = sin(x*y+3)
+    finally:
+      GlobalOptions.setHashConsing(False)
+    self.assertTrue(is_equal(z,z2,0))
+    f = Function('f',[x,y],[z-z2,z*y],{"cse":False})
+    g = Function('f',[x,y],[DM.zeros(2),sin(x*y+3)*y])
+    self.checkfunction_light(f,g,inputs=[DM([1.1,2.2]),DM([0.3,-0.7])])
+
+  def test_hessian_edge_pushing(self):
+    x = SX.sym("x",3)
+    p = SX.sym("p",2)
+    f = sin(x[0]*x[1])+x[2]**3/p[0]+exp(x[0]-p[1])*x[2]+fmax(x[1],0.5)*x[1]+sqrt(x[0]**2+1)
+    g = vertcat(x[0]*x[2]-p[0], log(x[1]+2)*p[1], x[1]*x[1])
+    F = Function('F',[x,p],[f,g],["x","p"],["f","g"])
+    s_in = ["x","p","lam:f","lam:g"]
+    s_out = ["triu:hess:gamma:x:x","hess:gamma:x:p","hess:gamma:p:p"]
+    aux = {"gamma":["f","g"]}
+    inputs = [DM([0.3,1.7,-0.4]),DM([2.1,0.6]),DM(1.3),DM([0.7,-1.1,0.4])]
+    ref = F.factory("H",s_in,s_out,aux)
+    for method in ["edge_pushing","edge_pushing_numeric"]:
+      H = F.factory("H",s_in,s_out,aux,{"hessian_method":method})
+      self.assertEqual(H.is_a("EdgePushing"), method=="edge_pushing_numeric")
+      for r,e in zip(H.call(inputs),ref.call(inputs)):
+        self.checkarray(r,e,digits=12)
+      self.check_serialize(H,inputs=inputs)
+    self.checkarray(hessian(f,x,{"edge_pushing":True})[0],hessian(f,x)[0],digits=12)
+
+  def test_bytecode(self):
+    x = SX.sym("x",3)
+    y = SX.sym("y",2)
+    e = vertcat(x[0]*x[1]+y[0], 3*x[2]-sin(x[0]), 2/(x[1]+y[1]), fmax(x[0],2.5),
+                x[2]**2, 1-x[0], 7, y[0]-x[2]*x[1], x[0]*x[1]+x[2]*y[1]+x[2])
+    f = Function('f',[x,y],[e,x*y[1]])
+    fb = Function('f',[x,y],[e,x*y[1]],{"bytecode":True})
+    inputs = [DM([1.1,2.2,3.3]),DM([0.3,-0.7])]
+    self.checkfunction_light(fb,f,inputs=inputs,digits=15)
+    self.check_serialize(fb,inputs=inputs)
+
+  def test_numeric_ad(self):
+    x = SX.sym("x",3)
+    y = SX.sym("y",2)
+    e = vertcat(x[0]*x[1]+y[0], sin(x[0])*x[2], if_else(x[1]>0,x[2],2*y[1]), fmax(x[0],2.5), 7)
+    f = Function('f',[x,y],[e,x*y[1]])
+    fn = Function('f',[x,y],[e,x*y[1]],{"numeric_ad":True})
+    inputs = [DM([1.1,2.2,3.3]),DM([0.3,-0.7])]
+    self.assertTrue(fn.forward(2).is_a("TapeAD"))
+    self.assertTrue(fn.reverse(2).is_a("TapeAD"))
+    self.assertTrue(fn.jacobian().is_a("TapeAD"))
+    self.checkfunction_light(fn,f,inputs=inputs)
+    for g, ref in [(fn.forward(2),f.forward(2)),(fn.reverse(3),f.reverse(3)),(fn.jacobian(),f.jacobian())]:
+      g_in = [DM.rand(g.sparsity_in(i)) for i in range(g.n_in())]
+      self.checkfunction_light(g,ref,inputs=g_in,digits=14)
+      self.check_serialize(g,inputs=g_in)
+
+    # Non-differentiable inputs are not seeded in the Jacobian
+    p = SX.sym("p")
+    opts = {"is_diff_in":[True,False]}
+    f = Function('f',[x[0],p],[x[0]*x[0]+3*p],opts)
+    fn = Function('f',[x[0],p],[x[0]*x[0]+3*p],dict(opts,numeric_ad=True))
+    J = fn.jacobian()
+    self.assertTrue(J.is_a("TapeAD"))
+    self.checkfunction_light(J,f.jacobian(),inputs=[2,1,0])
+    self.checkarray(J(2,1,0)[0],DM(4))
+
+  def test_jac_threads(self):
+    x = SX.sym("x",40)
+    g = vertcat(*[sin(x[i]*x[i+1])+exp(x[i+2])*x[i] for i in range(38)])
+    J = jacobian(g,x,{"helper_options":{"max_num_dir":1}})
+    for n in [2,0]:
+      Jt = jacobian(g,x,{"helper_options":{"max_num_dir":1,"jac_threads":n}})
+      self.assertEqual(Jt.sparsity(),J.sparsity())
+      f = Function('f',[x],[Jt-J])
+      self.assertEqual(float(norm_inf(f(DM.rand(40)))),0)
+
+  def test_map_sx_batch(self):
+    x = SX.sym("x",2)
+    p = SX.sym("p")
+    f = Function('f',[x,p],[sin(x)*p+x[0]**2, p/x[1]-3])
+    for n in [1,7,8,19]:
+      F = f.map(n)
+      X = DM.rand(2,n)+1
+      P = DM.rand(1,n)
+      [r1,r2] = F(X,P)
+      for k in range(n):
+        [e1,e2] = f(X[:,k],P[:,k])
+        self.checkarray(r1[:,k],e1,digits=15)
+        self.checkarray(r2[:,k],e2,digits=15)
+      self.check_serialize(F,inputs=[X,P])
+
   def test_cse_call(self):
     x = MX.sym("x",2)
     f = Function("f",[x],[x**2],["x"],["y"],{"never_inline":True})
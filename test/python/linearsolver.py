@@ -90,6 +90,7 @@ except:
 try:
   load_linsol("ldl")
   lsolvers.append(("ldl",{},{"posdef","symmetry"}))
+  lsolvers.append(("ldl",{"supernodal":True},{"posdef","symmetry"}))
 except:
   pass
 
@@ -467,6 +468,56 @@ class LinearSolverTests(casadiTestCase):
 
         self.checkarray(mtimes(A_,f_out),b,digits=digits)
 
+  def test_ldl_supernodal(self):
+    # KKT matrix of an optimal control problem, dense blocks per stage
+    numpy.random.seed(1)
+    N, nx, nu = 6, 4, 2
+    nv = N*(nx+nu)+nx
+    H = DM.eye(nv)
+    G = DM(N*nx, nv)
+    for k in range(N):
+      o = k*(nx+nu)
+      M = DM(numpy.random.random((nx+nu,nx+nu)))
+      H[o:o+nx+nu,o:o+nx+nu] = mtimes(M.T,M) + DM.eye(nx+nu)
+      G[k*nx:(k+1)*nx,o:o+nx+nu] = DM(numpy.random.random((nx,nx+nu)))
+      G[k*nx:(k+1)*nx,o+nx+nu:o+2*nx+nu] = -DM.eye(nx)
+    A = sparsify(blockcat([[H, G.T],[G, -1e-6*DM.eye(N*nx)]]))
+    b = DM(numpy.random.random((A.shape[0],2)))
+
+    As = MX.sym("A",A.sparsity())
+    bs = MX.sym("B",b.sparsity())
+    ref = Function("f", [As,bs],[solve(As,bs,"ldl")])
+    f = Function("f", [As,bs],[solve(As,bs,"ldl",{"supernodal":True})])
+    self.checkarray(f(A,b),ref(A,b),digits=10)
+    self.checkarray(mtimes(A,f(A,b)),b,digits=8)
+
+    self.check_codegen(f,inputs=[A,b])
+    self.check_serialize(f,inputs=[A,b])
+
+    with self.assertInException("incomplete"):
+      Linsol("L","ldl",A.sparsity(),{"supernodal":True,"incomplete":True})
+
+  def test_parallel_factorization(self):
+    # Block diagonal matrix with a coupling border, independent subtrees
+    numpy.random.seed(1)
+    blocks = []
+    for i in range(8):
+      M = DM(numpy.random.random((5,5)))
+      blocks.append(mtimes(M.T,M) + 5*DM.eye(5))
+    A = diagcat(*blocks)
+    c = DM(numpy.random.random((1,A.shape[1])))
+    A = sparsify(blockcat([[A, c.T],[c, DM(100)]]))
+    b = DM(numpy.random.random((A.shape[0],2)))
+
+    As = MX.sym("A",A.sparsity())
+    bs = MX.sym("B",b.sparsity())
+    for Solver in ["ldl", "qr"]:
+      ref = Function("f", [As,bs],[solve(As,bs,Solver)])
+      f = Function("f", [As,bs],[solve(As,bs,Solver,{"threads":4})])
+      self.checkarray(f(A,b),ref(A,b),digits=12)
+      self.checkarray(mtimes(A,f(A,b)),b,digits=10)
+      self.check_serialize(f,inputs=[A,b])
+
   def test_dimmismatch(self):
     A = DM.eye(5)
     b = DM.ones((4,1))
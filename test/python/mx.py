@@ -3535,5 +3535,39 @@ class MXtests(casadiTestCase):
           self.assertTrue("sq(p)" in str(parametric))
           print(parametric)
       
+  def test_optimize_graph(self):
+      flag = GlobalOptions.getSimplificationOnTheFly()
+      GlobalOptions.setSimplificationOnTheFly(False)
+      try:
+        a = MX.sym("a",2)
+        b = MX.sym("b",3,2)
+        s = vertsplit(vertcat(a,vec(b)),[0,2,5,8])
+        C = MX(DM([[1,2],[3,4]]))
+        e = s[0]*s[1][:2] + mtimes(C.T,s[2][1:3]) + sin(C[:,0]) + vec(b)[[1,4]]
+      finally:
+        GlobalOptions.setSimplificationOnTheFly(flag)
+
+      f_ref = Function("f",[a,b],[e])
+      f = Function("f",[a,b],[e],{"optimize_graph": True})
+      self.checkfunction_light(f, f_ref, inputs=[DM([1,2]), DM([[1,2],[3,4],[5,6]])])
+      self.assertTrue(f.n_instructions()<f_ref.n_instructions())
+
+      stats = f.stats()["optimize_graph"]
+      self.assertEqual(stats["splits_cancelled"],2)
+      self.assertTrue(stats["nonzeros_fused"]>=1)
+      self.assertTrue(stats["constants_folded"]>=2)
+      self.assertTrue("vertsplit" in stats["removed"])
+      self.assertTrue(stats["n_nodes_after"]<stats["n_nodes_before"])
+
+      # Individual rewrites can be disabled
+      f = Function("f",[a,b],[e],{"optimize_graph": True,
+        "optimize_graph_options": {"cancel_split": False, "fold_constants": False,
+                                   "fuse_nonzeros": False}})
+      self.checkfunction_light(f, f_ref, inputs=[DM([1,2]), DM([[1,2],[3,4],[5,6]])])
+      stats = f.stats()["optimize_graph"]
+      self.assertEqual(stats["splits_cancelled"],0)
+      self.assertEqual(stats["constants_folded"],0)
+      self.assertEqual(stats["nonzeros_fused"],0)
+
 if __name__ == '__main__':
     unittest.main()
@@ -1680,6 +1680,31 @@ class NLPtests(casadiTestCase):
     self.assertTrue(stats_reg["iter_count"]==1)
     self.assertTrue("H:\n[[1, 0], \n [0, 2]]" in result[0])
 
+  @requires_nlpsol("sqpmethod")
+  @requires_conic("qrqp")
+  def test_lbfgs_compact_sqpmethod(self):
+    n = 10
+    x = MX.sym("x",n)
+    f = sum1(100*(x[1:]-x[:-1]**2)**2+(1-x[:-1])**2)
+    nlp = {"x":x,"f":f,"g":sum1(x)}
+    solver_in = {"lbg": -inf, "ubg": n-1}
+
+    qpsol_options = {"print_iter":False,"print_header":False,"error_on_fail":False}
+    solver = nlpsol("solver","sqpmethod",nlp,{"qpsol":"qrqp","qpsol_options":qpsol_options,"print_header":False,"print_iteration":False,"tol_du":1e-10,"tol_pr":1e-10})
+    res_ref = solver(**solver_in)
+
+    for lbfgs_memory in [1,5,10]:
+      opts = {"qpsol":"qrqp","qpsol_options":qpsol_options,"hessian_approximation":"limited-memory-compact","lbfgs_memory":lbfgs_memory,"max_iter_ls":30,"tol_du":1e-5,"tol_pr":1e-10,"min_step_size":1e-14,"max_iter":500,"print_header":False,"print_iteration":False}
+      solver = nlpsol("solver","sqpmethod",nlp,opts)
+      res = solver(**solver_in)
+      self.checkarray(res["x"],res_ref["x"],digits=6)
+      self.checkarray(res["lam_g"],res_ref["lam_g"],digits=4)
+      self.check_serialize(solver,solver_in)
+      self.check_codegen(solver,solver_in,std="c99")
+
+    with self.assertInException("Elastic mode is not supported"):
+      nlpsol("solver","sqpmethod",nlp,{"qpsol":"qrqp","hessian_approximation":"limited-memory-compact","elastic_mode":True})
+
   def test_infeasible(self):
     x = MX.sym("x")
 
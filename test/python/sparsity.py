@@ -479,6 +479,29 @@ class Sparsitytests(casadiTestCase):
 
     self.assertTrue(DM(J.sparsity_out(0))[:X.nnz(),:].sparsity()==Sparsity.diag(100))
 
+  def test_jacsparsity_threads(self):
+    x = SX.sym("x",300)
+    A = Sparsity.banded(300,2)+Sparsity.rowcol([0,150],range(300),300,300)
+    e = mtimes(SX(A,1),sin(x))+x[5]*x[250]
+    GlobalOptions.setMaxNumThreads(4)
+    for hierarchical in [True,False]:
+      GlobalOptions.setHierarchicalSparsity(hierarchical)
+      for ad_weight_sp in [0,1]:
+        ref = Function("f",[x],[e],{"ad_weight_sp":ad_weight_sp}).jac_sparsity(0,0)
+        for n in [2,3,0]:
+          f = Function("f",[x],[e],{"ad_weight_sp":ad_weight_sp,"sparsity_threads":n})
+          self.assertTrue(f.jac_sparsity(0,0)==ref)
+          f = Function("f",[x],[e],{"ad_weight_sp":ad_weight_sp,"sparsity_threads":n}).wrap()
+          self.assertTrue(f.jac_sparsity(0,0)==ref)
+          # Graph with call nodes, which share the callee between threads
+          g = Function("g",[x],[e])
+          X = MX.sym("x",300)
+          f = Function("f",[X],[g(X)+g(2*X)],
+                       {"ad_weight_sp":ad_weight_sp,"sparsity_threads":n})
+          self.assertTrue(f.jac_sparsity(0,0)==ref)
+    GlobalOptions.setHierarchicalSparsity(True)
+    GlobalOptions.setMaxNumThreads(0)
+
   @memory_heavy()
   def test_jacsparsityHierarchicalSymm(self):
     GlobalOptions.setHierarchicalSparsity(False)
@@ -567,6 +590,52 @@ class Sparsitytests(casadiTestCase):
         self.assertTrue(L.is_subset(R))
         self.assertFalse(R.is_subset(L))
 
+  def test_structured_patterns(self):
+      # Dense, banded and block diagonal patterns take shortcuts in the operations below
+      patterns = [Sparsity.dense(3, 5), Sparsity.dense(4, 4), Sparsity.diag(4), Sparsity.lower(4),
+                  Sparsity.banded(4, 1), Sparsity.banded(4, 1) + Sparsity.band(4, 2),
+                  kron(Sparsity.diag(2), Sparsity.dense(2, 2)), Sparsity.band(4, 1), Sparsity(4, 4)]
+
+      for a in patterns:
+        A = DM(a, list(range(a.nnz())))
+        at, mapping = a.transpose()
+        self.checkarray(DM(at, 1), DM(a, 1).T)
+        self.checkarray(DM(at, [A.nonzeros()[k] for k in mapping]), A.T)
+        self.assertEqual(a.is_symmetric(), a.is_transpose(a))
+        for b in patterns:
+          if a.size2()==b.size1():
+            self.checkarray(DM(Sparsity.mtimes(a, b), 1), mtimes(DM(a, 1), DM(b, 1))>0)
+          if a.size()==b.size():
+            self.checkarray(DM(a + b, 1), (DM(a, 1) + DM(b, 1))>0)
+            self.checkarray(DM(a * b, 1), (DM(a, 1) * DM(b, 1))>0)
+
+  def test_coloring_orderings(self):
+      T = Sparsity.banded(6, 1)
+      patterns = [Sparsity.banded(10, 2),
+                  kron(T, Sparsity.diag(6)) + kron(Sparsity.diag(6), T),
+                  Sparsity.diag(8) + Sparsity.triplet(8, 8, list(range(8)), [0]*8) + Sparsity.triplet(8, 8, [0]*8, list(range(8))),
+                  Sparsity.dense(5, 5), Sparsity(4, 4)]
+
+      for sp in patterns:
+        n = sp.size2()
+        for o in [sp.largest_first(), sp.smallest_last(), sp.incidence_degree(), sp.dynamic_largest_first()]:
+          self.assertEqual(sorted(o), list(range(n)))
+        for star_coloring in [sp.star_coloring, sp.star_coloring2]:
+          ncol = [star_coloring(ordering).size2() for ordering in range(5)]
+          best = star_coloring(-1)
+          self.assertEqual(best.size2(), min(ncol))
+          for ordering in range(-1, 5):
+            D = star_coloring(ordering)
+            self.assertEqual(D.size1(), n)
+            self.assertEqual(D.nnz(), n)
+            color = dict(zip(*D.get_triplet()))
+            # Adjacent columns have different colors
+            r, c = sp.get_triplet()
+            for i, j in zip(r, c):
+              if i!=j: self.assertNotEqual(color[i], color[j])
+      with self.assertInException("Unknown coloring ordering"):
+        Sparsity.banded(3, 1).star_coloring(7)
+
 
 
 if __name__ == '__main__':
@@ -1539,6 +1539,58 @@ class SXtests(casadiTestCase):
 
     self.checkarray(logsumexp(vertcat(100,1000,10000)),f(vertcat(100,1000,10000)))
 
+  def test_peephole(self):
+    flag = GlobalOptions.getSimplificationOnTheFly()
+    GlobalOptions.setSimplificationOnTheFly(False)
+    try:
+      x = SX.sym("x")
+      y = SX.sym("y")
+      e = vertcat(x*1, -(-x), sq(sqrt(x)), x**2, x/4, x/3, 0.3*x+0.3*y, x*0, x-x, y/1, x+x, y*2)
+    finally:
+      GlobalOptions.setSimplificationOnTheFly(flag)
+
+    f_ref = Function("f",[x,y],[e])
+    f = Function("f",[x,y],[e],{"peephole": True})
+    self.assertTrue(f.n_instructions()<f_ref.n_instructions())
+    # Only exact rewrites by default: results are bitwise identical
+    for v in [2.5, 0.0, -0.0, 1e-310]:
+      r, r_ref = numpy.array(f(v,1.5)), numpy.array(f_ref(v,1.5))
+      self.assertTrue(numpy.array_equal(r.view(numpy.uint64), r_ref.view(numpy.uint64)))
+    self.check_codegen(f,inputs=[2.5,1.5])
+
+    stats = f.stats()["peephole"]
+    self.assertTrue(stats["exact"])
+    self.assertTrue(stats["n_constants_after"]<stats["n_constants_before"])
+    self.assertTrue(stats["identities_removed"]>=2)
+    self.assertTrue(stats["strength_reduced"]>=3)
+    self.assertTrue(stats["n_operations_after"]<stats["n_operations_before"])
+
+    # Rewrites that are not exact for all arguments
+    f = Function("f",[x,y],[e],{"peephole": True, "peephole_exact": False})
+    self.checkfunction_light(f, f_ref, inputs=[2.5,1.5])
+    self.assertTrue(f.stats()["peephole"]["n_operations_after"]<stats["n_operations_after"])
+
+  def test_schedule(self):
+    x = SX.sym("x",4)
+    y = SX.sym("y")
+    # Independent chains sharing a few subexpressions
+    e = []
+    for i in range(4):
+      z = x[i]
+      for k in range(10):
+        z = sin(z)*y + cos(z*x[(i+1)%4])
+      e.append(z)
+    e = vertcat(*e)
+    f_ref = Function("f",[x,y],[e, jacobian(e,x)])
+    for schedule in ["depth_first","locality","latency"]:
+      f = Function("f",[x,y],[e, jacobian(e,x)],{"schedule": schedule})
+      self.assertEqual(f.n_instructions(),f_ref.n_instructions())
+      self.checkfunction_light(f, f_ref, inputs=[vertcat(0.1,0.2,0.3,0.4),1.3])
+      self.check_codegen(f,inputs=[vertcat(0.1,0.2,0.3,0.4),1.3])
+
+    with self.assertInException("Unknown schedule"):
+      Function("f",[x,y],[e],{"schedule": "foo"})
+
 
 if __name__ == '__main__':
     unittest.main()